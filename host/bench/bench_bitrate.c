@@ -0,0 +1,82 @@
+/*
+ * bench_bitrate.c - an ISO/IEC 14443-4 READ BINARY of 256 bytes after TCL_NegotiateBitRate() with each highest bit
+ * rate of the reader (PCD_SetMaxBitRate_h()), at 400 kHz and 3.4 MHz i2c. Reports the rates PPS agreed on and the
+ * virtual time, i2c transactions and RF frames per READ BINARY; fails if an exchange does not return the 256 bytes.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_TCL.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define EXCHANGES	10
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static const uint16_t kbits[] = {
+	[PCD_BITRATE_106] = 106,
+	[PCD_BITRATE_212] = 212,
+	[PCD_BITRATE_424] = 424,
+	[PCD_BITRATE_848] = 848,
+};
+
+int main(void) {
+	int failures = 0;
+	const uint8_t uid7[7] = {4, 1, 2, 3, 4, 5, 6};
+	const uint8_t readBinary[5] = {0x00, 0xB0, 0x00, 0x00, 0x00};
+	static uint8_t response[260];
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	const uint32_t busHz[] = {400000, 3400000};
+	printf("READ BINARY of 256 bytes, mean of %d, FSDI %d, MFRC_STREAM_MAX_BIT_RATE %u kbit/s, CRC mode %d\n", EXCHANGES,
+			MFRC_TCL_FSDI, kbits[MFRC_STREAM_MAX_BIT_RATE], MFRC_DEFAULT_CRC_MODE);
+	printf("i2c_khz  max_kbits  tx_kbits  rx_kbits  time_ms  i2c_transactions  rf_frames\n");
+	for (size_t b = 0; b < sizeof(busHz) / sizeof(busHz[0]); b++) {
+		for (enum PCD_BitRate maxRate = PCD_BITRATE_106; maxRate <= PCD_BITRATE_848; maxRate++) {
+			MFRC522_Sim_Init(&sim);
+			sim.i2cHz = busHz[b];
+			MFRC522_Sim_AddCard(&sim, SIM_CARD_ISO14443_4, uid7, 7);
+			PCD_Init_h(&reader);
+			PCD_SetMaxBitRate_h(&reader, maxRate);
+			uint8_t atqa[2];
+			uint8_t atqaSize = sizeof(atqa);
+			Uid uid;
+			MFRC522_TCL tcl;
+			if (PICC_RequestA_h(&reader, atqa, &atqaSize) != STATUS_OK || PICC_Select_h(&reader, &uid, 0) != STATUS_OK
+					|| TCL_Activate_h(&reader, &tcl, 0) != STATUS_OK || TCL_NegotiateBitRate(&tcl) != STATUS_OK) {
+				printf("FAIL: %" PRIu32 " Hz, %u kbit/s: activation failed\n", busHz[b], kbits[maxRate]);
+				failures++;
+				continue;
+			}
+
+			const int64_t start = esp_timer_get_time();
+			const uint32_t transactions0 = sim.i2cTransactions;
+			const uint32_t frames0 = sim.rfFrames;
+			for (uint8_t i = 0; i < EXCHANGES; i++) {
+				uint16_t responseLen = sizeof(response);
+				const enum StatusCode status = TCL_Exchange(&tcl, readBinary, sizeof(readBinary), response, &responseLen);
+				if (status != STATUS_OK || responseLen != 258) {
+					printf("FAIL: %" PRIu32 " Hz, %u kbit/s: %s, %u bytes\n", busHz[b], kbits[maxRate],
+							GetStatusCodeName(status), responseLen);
+					failures++;
+				}
+			}
+			const double us = (double)(esp_timer_get_time() - start) / EXCHANGES;
+			printf("%7" PRIu32 "  %9u  %8u  %8u  %7.1f  %16.1f  %9.1f\n", busHz[b] / 1000, kbits[maxRate],
+					kbits[tcl.txBitRate], kbits[tcl.rxBitRate], us / 1000.0,
+					(double)(sim.i2cTransactions - transactions0) / EXCHANGES, (double)(sim.rfFrames - frames0) / EXCHANGES);
+			TCL_Deselect(&tcl);
+		}
+	}
+	return failures != 0;
+} // End main()
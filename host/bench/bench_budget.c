@@ -0,0 +1,188 @@
+/*
+ * bench_budget.c - the i2c transactions per call of each operation (MFRC522_Accounting.h) for a Classic 1K session
+ * in every CRC mode, checked against the budgets in budget_baseline.txt. Fails if an operation is above its budget
+ * or has none. After a deliberate change, rewrite the baseline with:
+ *
+ * 		bench_budget --update
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_Accounting.h"
+#include "esp_host.h"
+
+#define BASELINE	MFRC_HOST_BENCH_DIR "/budget_baseline.txt"
+#define ROUNDS		10
+#define MODES		3
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_Accounting accounts[MODES];
+
+static const char *const modeNames[MODES] = {
+	[PCD_CRC_COPROCESSOR] = "coprocessor",
+	[PCD_CRC_SOFTWARE] = "software",
+	[PCD_CRC_HARDWARE] = "hardware",
+};
+
+// 20 polls of an empty field, then ROUNDS times: select, authenticate, read, write and halt
+static int RunSession(const enum PCD_CRCMode mode, MFRC522_Accounting *acct) {
+	const uint8_t id[4] = {1, 2, 3, 4};
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	int failures = 0;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+	PCD_SetCRCMode_h(&reader, mode);
+	MFRC522_Accounting_Attach(acct, &reader);
+	failures += PCD_Init_h(&reader) != ESP_OK;
+	for (uint8_t i = 0; i < 20; i++) {
+		failures += PICC_IsNewCardPresent_h(&reader);
+	}
+
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, id, sizeof(id));
+	for (uint8_t i = 0; i < ROUNDS; i++) {
+		Uid uid;
+		uint8_t buffer[18];
+		uint8_t size = sizeof(buffer);
+		memset(buffer, i, sizeof(buffer));
+		failures += !PICC_IsNewCardPresent_h(&reader) || !PICC_ReadCardSerial_h(&reader, &uid);
+		failures += PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid) != STATUS_OK;
+		failures += MIFARE_Read_h(&reader, 4, buffer, &size) != STATUS_OK;
+		failures += MIFARE_Write_h(&reader, 5, buffer, 16) != STATUS_OK;
+		failures += PICC_HaltA_h(&reader) != STATUS_OK;
+		PCD_StopCrypto1_h(&reader);
+		card->_state = 0;		// taken out of the field and back in
+	}
+	MFRC522_Accounting_Attach(NULL, &reader);
+	if (failures) {
+		printf("FAIL: %s: %d operations of the session failed\n", modeNames[mode], failures);
+	}
+	return failures;
+} // End RunSession()
+
+static uint32_t PerCall(const MFRC522_OpAccount *account) {
+	return (account->transactions + account->calls - 1) / account->calls;
+} // End PerCall()
+
+static int WriteBaseline(void) {
+	FILE *file = fopen(BASELINE, "w");
+	if (!file) {
+		perror(BASELINE);
+		return 1;
+	}
+	fprintf(file, "# i2c transactions per call, checked by bench_budget. Rewrite with bench_budget --update.\n");
+	fprintf(file, "# crc mode, operation (MFRC522_Accounting_OpName()), budget\n");
+	for (uint8_t mode = 0; mode < MODES; mode++) {
+		for (uint8_t op = 0; op < MFRC_OPS; op++) {
+			if (accounts[mode].op[op].calls) {
+				fprintf(file, "%s %s %" PRIu32 "\n", modeNames[mode], MFRC522_Accounting_OpName(op), PerCall(&accounts[mode].op[op]));
+			}
+		}
+	}
+	fclose(file);
+	printf("wrote %s\n", BASELINE);
+	return 0;
+} // End WriteBaseline()
+
+// checks every CRC mode against the baseline. returns the number of operations above or without a budget.
+static int CheckBaseline(void) {
+	MFRC522_OpBudget budgets[MODES][MFRC_OPS];
+	bool budgeted[MODES][MFRC_OPS] = {{false}};
+	size_t counts[MODES] = {0};
+	char line[128];
+	int failures = 0;
+
+	FILE *file = fopen(BASELINE, "r");
+	if (!file) {
+		perror(BASELINE);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), file)) {
+		char modeName[32], opName[32];
+		uint32_t budget;
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		if (sscanf(line, "%31s %31s %" SCNu32, modeName, opName, &budget) != 3) {
+			printf("FAIL: %s: cannot parse: %s", BASELINE, line);
+			failures++;
+			continue;
+		}
+		uint8_t mode = 0, op = 0;
+		while (mode < MODES && strcmp(modeName, modeNames[mode]) != 0) {
+			mode++;
+		}
+		while (op < MFRC_OPS && strcmp(opName, MFRC522_Accounting_OpName(op)) != 0) {
+			op++;
+		}
+		if (mode == MODES || op == MFRC_OPS) {
+			printf("FAIL: %s: unknown CRC mode or operation: %s", BASELINE, line);
+			failures++;
+			continue;
+		}
+		budgets[mode][counts[mode]++] = (MFRC522_OpBudget){op, budget};
+		budgeted[mode][op] = true;
+	}
+	fclose(file);
+
+	for (uint8_t mode = 0; mode < MODES; mode++) {
+		const uint8_t over = MFRC522_Accounting_CheckBudget(&accounts[mode], budgets[mode], counts[mode]);
+		if (over) {
+			printf("FAIL: %s: %u operations above their budget\n", modeNames[mode], over);
+			failures += over;
+		}
+		for (uint8_t op = 0; op < MFRC_OPS; op++) {
+			if (accounts[mode].op[op].calls && !budgeted[mode][op]) {
+				printf("FAIL: %s: %s has no budget\n", modeNames[mode], MFRC522_Accounting_OpName(op));
+				failures++;
+			}
+		}
+	}
+	return failures;
+} // End CheckBaseline()
+
+int main(const int argc, char **argv) {
+	const bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+	int failures = 0;
+	for (uint8_t mode = 0; mode < MODES; mode++) {
+		failures += RunSession(mode, &accounts[mode]);
+	}
+
+	printf("i2c transactions per call, %d rounds of select, auth, read, write, halt\n", ROUNDS);
+	printf("%-18s", "operation");
+	for (uint8_t mode = 0; mode < MODES; mode++) {
+		printf("  %11s", modeNames[mode]);
+	}
+	printf("\n");
+	for (uint8_t op = 0; op < MFRC_OPS; op++) {
+		bool called = false;
+		for (uint8_t mode = 0; mode < MODES; mode++) {
+			called |= accounts[mode].op[op].calls != 0;
+		}
+		if (!called) {
+			continue;
+		}
+		printf("%-18s", MFRC522_Accounting_OpName(op));
+		for (uint8_t mode = 0; mode < MODES; mode++) {
+			const MFRC522_OpAccount *account = &accounts[mode].op[op];
+			if (account->calls) {
+				printf("  %11.1f", (double)account->transactions / account->calls);
+			} else {
+				printf("  %11s", "-");
+			}
+		}
+		printf("\n");
+	}
+
+	if (failures) {
+		return 1;
+	}
+	return update ? WriteBaseline() : CheckBaseline() != 0;
+} // End main()
@@ -0,0 +1,297 @@
+/*
+ * bench_dump.c - CPU time of PICC_DumpMifareClassicToSerial_h() on a 1K and a 4K card, against the formatter it
+ * replaced: a copy of the printf() per byte code below, on the same card I/O. Both write to a stdio stream in
+ * memory. Fails if the two texts differ in one byte.
+ *
+ * The simulated card I/O costs far more CPU than the formatting, so each dump is also run once more with the
+ * output switched off, and the difference is reported as the formatting time.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+#include "dump_cards.h"
+
+#define REPEATS		200
+#define TEXT_SIZE	32768
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static const MIFARE_Key defaultKey = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+static FILE *output;				// NULL: the legacy formatter prints nothing
+static uint32_t outputCalls;
+
+/////////////////////////////////////////////////////////////////////////////////////
+// The legacy formatter: PICC_DumpMifareClassicToSerial() of the library before the dump writer
+/////////////////////////////////////////////////////////////////////////////////////
+
+enum Format {
+    DEC=01,
+    HEX=02,
+};
+
+static void serial_print(const char *msg)
+{
+	if (output) {
+		outputCalls++;
+		fprintf(output, "%s", msg);
+	}
+}
+
+static void serial_print_f(int i, enum Format format)
+{
+	if (output) {
+		outputCalls++;
+		fprintf(output, format == HEX ? "%x" : "%d", i);
+	}
+}
+
+static void serial_println(const char *msg)
+{
+    serial_print(msg);
+    serial_print("\n");
+}
+
+static void LegacyDumpSector(MFRC522_Handle *dev, const Uid *uid, const MIFARE_Key *key, const uint8_t sector) {
+    enum StatusCode status;
+    uint8_t firstBlock;
+    uint8_t no_of_blocks;
+	bool isSectorTrailer;
+    uint8_t c1, c2, c3;
+    uint8_t c1_, c2_, c3_;
+    bool invertedError = false;
+    uint8_t g[4];
+    uint8_t group;
+    bool firstInGroup;
+
+	if (sector < 32) {
+		no_of_blocks = 4;
+		firstBlock = sector * no_of_blocks;
+	}
+	else if (sector < 40) {
+		no_of_blocks = 16;
+		firstBlock = 128 + (sector - 32) * no_of_blocks;
+	}
+	else {
+		return;
+	}
+
+    uint8_t byteCount;
+    uint8_t buffer[18];
+    uint8_t blockAddr;
+	isSectorTrailer = true;
+	for (int8_t blockOffset = no_of_blocks - 1; blockOffset >= 0; blockOffset--) {
+		blockAddr = firstBlock + blockOffset;
+		if (isSectorTrailer) {
+			if(sector < 10)
+                serial_print("   ");
+			else
+                serial_print("  ");
+			serial_print_f(sector, DEC);
+            serial_print("   ");
+		}
+		else {
+            serial_print("       ");
+		}
+		if(blockAddr < 10)
+            serial_print("   ");
+		else {
+			if(blockAddr < 100)
+                serial_print("  ");
+			else
+                serial_print(" ");
+		}
+		serial_print_f(blockAddr, DEC);
+        serial_print("  ");
+		if (isSectorTrailer) {
+			status = PCD_Authenticate_h(dev, PICC_CMD_MF_AUTH_KEY_A, firstBlock, key, uid);
+			if (status != STATUS_OK) {
+                serial_print("PCD_Authenticate() failed: ");
+				serial_println(GetStatusCodeName(status));
+				return;
+			}
+		}
+		byteCount = sizeof(buffer);
+		status = MIFARE_Read_h(dev, blockAddr, buffer, &byteCount);
+		if (status != STATUS_OK) {
+            serial_print("MIFARE_Read() failed: ");
+			serial_println(GetStatusCodeName(status));
+			continue;
+		}
+        for (uint8_t index = 0; index < 16; index++) {
+			if(buffer[index] < 0x10)
+                serial_print(" 0");
+			else
+                serial_print(" ");
+			serial_print_f(buffer[index], HEX);
+			if ((index % 4) == 3) {
+                serial_print(" ");
+			}
+		}
+		if (isSectorTrailer) {
+			c1  = buffer[7] >> 4;
+			c2  = buffer[8] & 0xF;
+			c3  = buffer[8] >> 4;
+			c1_ = buffer[6] & 0xF;
+			c2_ = buffer[6] >> 4;
+			c3_ = buffer[7] & 0xF;
+            invertedError = (c1 != (~c1_ & 0xF)) || (c2 != (~c2_ & 0xF)) || (c3 != (~c3_ & 0xF));
+            g[0] = ((c1 & 1) << 2) | ((c2 & 1) << 1) | ((c3 & 1) << 0);
+            g[1] = ((c1 & 2) << 1) | ((c2 & 2) << 0) | ((c3 & 2) >> 1);
+            g[2] = ((c1 & 4) << 0) | ((c2 & 4) >> 1) | ((c3 & 4) >> 2);
+            g[3] = ((c1 & 8) >> 1) | ((c2 & 8) >> 2) | ((c3 & 8) >> 3);
+			isSectorTrailer = false;
+		}
+
+		if (no_of_blocks == 4) {
+			group = blockOffset;
+            firstInGroup = true;
+		}
+		else {
+			group = blockOffset / 5;
+            firstInGroup = (group == 3) || (group != (blockOffset + 1) / 5);
+		}
+
+		if (firstInGroup) {
+            serial_print(" [ ");
+            serial_print_f((g[group] >> 2) & 1, DEC); serial_print(" ");
+            serial_print_f((g[group] >> 1) & 1, DEC); serial_print(" ");
+			serial_print_f((g[group] >> 0) & 1, DEC);
+            serial_print(" ] ");
+			if (invertedError) {
+                serial_print(" Inverted access bits did not match! ");
+			}
+		}
+
+		if (group != 3 && (g[group] == 1 || g[group] == 6)) {
+			long value = ((long)((buffer[3])<<24)) | ((long)((buffer[2])<<16)) | ((long)((buffer[1])<<8)) | ((long)(buffer[0]));
+            serial_print(" Value=0x"); serial_print_f(value, HEX);
+            serial_print(" Adr=0x"); serial_print_f(buffer[12], HEX);
+		}
+		serial_println("");
+	}
+} // End LegacyDumpSector()
+
+static void LegacyDumpClassic(MFRC522_Handle *dev, const Uid *uid, const uint8_t piccType, const MIFARE_Key *key) {
+    uint8_t no_of_sectors = 0;
+	switch (piccType) {
+		case PICC_TYPE_MIFARE_MINI:
+			no_of_sectors = 5;
+			break;
+		case PICC_TYPE_MIFARE_1K:
+			no_of_sectors = 16;
+			break;
+		case PICC_TYPE_MIFARE_4K:
+			no_of_sectors = 40;
+			break;
+		default:
+			break;
+	}
+
+	if (no_of_sectors) {
+        serial_println("Sector Block   0  1  2  3   4  5  6  7   8  9 10 11  12 13 14 15  AccessBits");
+		for (int i = no_of_sectors - 1; i >= 0; i--) {
+			LegacyDumpSector(dev, uid, key, i);
+		}
+	}
+	PICC_HaltA_h(dev);
+	PCD_StopCrypto1_h(dev);
+} // End LegacyDumpClassic()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// The benchmark
+/////////////////////////////////////////////////////////////////////////////////////
+
+enum Formatter {
+	FORMATTER_LEGACY,
+	FORMATTER_WRITER,
+	FORMATTER_NONE			// the card I/O of a dump alone
+};
+
+static void StreamWriter(void *ctx, const char *text, const size_t length) {
+	outputCalls++;
+	fwrite(text, 1, length, ctx);
+} // End StreamWriter()
+
+static double CpuMs(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+} // End CpuMs()
+
+// dumps dumpCards[index] into stream (NULL for FORMATTER_NONE), returns the CPU time in ms
+static double Dump(const size_t index, const enum Formatter formatter, FILE *stream) {
+	Uid uid;
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	MFRC522_Sim_Init(&sim);
+	DumpTest_AddCard(&sim, index);
+	PCD_Init_h(&reader);
+	PICC_RequestA_h(&reader, atqa, &atqaSize);
+	PICC_Select_h(&reader, &uid, 0);
+	const uint8_t piccType = PICC_GetType(uid.sak);
+
+	const double start = CpuMs();
+	if (formatter == FORMATTER_WRITER) {
+		PCD_SetDumpWriter_h(&reader, StreamWriter, stream);
+		PICC_DumpMifareClassicToSerial_h(&reader, &uid, piccType, &defaultKey);
+		PCD_SetDumpWriter_h(&reader, NULL, NULL);
+	} else {
+		output = stream;
+		LegacyDumpClassic(&reader, &uid, piccType, &defaultKey);
+		output = NULL;
+	}
+	fflush(stream ? stream : stdout);
+	return CpuMs() - start;
+} // End Dump()
+
+int main(void) {
+	static char text[2][TEXT_SIZE];
+	const size_t cards[] = {1, 2};		// 1K and 4K in dumpCards
+	int failures = 0;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	printf("Classic dump, CPU ms per dump (mean of %d), formatting = dump - card I/O alone\n", REPEATS);
+	printf("card  formatter  output_calls     dump  card_io  formatting\n");
+	for (size_t c = 0; c < sizeof(cards) / sizeof(cards[0]); c++) {
+		double ms[3] = {0};
+		uint32_t calls[2] = {0};
+		size_t length[2] = {0};
+		for (uint16_t repeat = 0; repeat < REPEATS; repeat++) {
+			for (uint8_t formatter = FORMATTER_LEGACY; formatter <= FORMATTER_NONE; formatter++) {
+				FILE *stream = NULL;
+				if (formatter != FORMATTER_NONE) {
+					stream = fmemopen(text[formatter], TEXT_SIZE, "w");
+				}
+				outputCalls = 0;
+				ms[formatter] += Dump(cards[c], formatter, stream);
+				if (stream) {
+					length[formatter] = ftell(stream);
+					calls[formatter] = outputCalls;
+					fclose(stream);
+				}
+			}
+		}
+		const double io = ms[FORMATTER_NONE] / REPEATS;
+		for (uint8_t formatter = FORMATTER_LEGACY; formatter <= FORMATTER_WRITER; formatter++) {
+			printf("%-4s  %-9s  %12" PRIu32 "  %7.3f  %7.3f  %10.3f\n", dumpCards[cards[c]].name,
+					formatter == FORMATTER_LEGACY ? "printf" : "writer", calls[formatter], ms[formatter] / REPEATS, io,
+					ms[formatter] / REPEATS - io);
+		}
+		if (length[0] == 0 || length[0] != length[1] || memcmp(text[0], text[1], length[0]) != 0) {
+			printf("FAIL: %s: the dump writer output differs from the printf() formatter\n", dumpCards[cards[c]].name);
+			failures++;
+		}
+	}
+	return failures != 0;
+} // End main()
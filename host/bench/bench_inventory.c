@@ -0,0 +1,83 @@
+/*
+ * bench_inventory.c - PICC_Inventory_h() with 1 to 16 cards in the field: virtual time, i2c transactions and RF
+ * frames, the mean of LAYOUTS card sets per count. Fails if an inventory misses a card.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define MAX_CARDS	16
+#define LAYOUTS		10
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static uint32_t seed = 1;
+
+// the same UIDs on every host
+static uint8_t NextRandom(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+} // End NextRandom()
+
+// count cards, 4 and 7 byte UIDs mixed
+static void AddCards(const uint8_t count) {
+	MFRC522_Sim_Init(&sim);
+	for (uint8_t c = 0; c < count; c++) {
+		uint8_t uid[7];
+		const uint8_t size = (NextRandom() & 1) ? 4 : 7;
+		for (uint8_t i = 0; i < size; i++) {
+			uid[i] = NextRandom();
+		}
+		if (size == 7) {
+			uid[0] = 0x04;
+			if (uid[3] == 0x88) {
+				uid[3] = 0x12;
+			}
+		} else if (uid[0] == 0x88) {
+			uid[0] = 0x11;
+		}
+		MFRC522_Sim_AddCard(&sim, size == 4 ? SIM_CARD_MIFARE_1K : SIM_CARD_NTAG213, uid, size);
+	}
+	PCD_Init_h(&reader);
+} // End AddCards()
+
+int main(void) {
+	_Static_assert(MFRC522_SIM_MAX_CARDS >= MAX_CARDS, "the simulator takes fewer cards than the benchmark needs");
+	int failures = 0;
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	printf("PICC_Inventory_h(), mean of %d card sets, 400 kHz i2c, CRC mode %d\n", LAYOUTS, MFRC_DEFAULT_CRC_MODE);
+	printf("cards  time_ms  ms_per_card  i2c_transactions  rf_frames\n");
+	for (uint8_t count = 1; count <= MAX_CARDS; count++) {
+		int64_t us = 0;
+		uint32_t transactions = 0, frames = 0;
+		for (uint8_t layout = 0; layout < LAYOUTS; layout++) {
+			AddCards(count);
+			Uid found[MAX_CARDS];
+			size_t foundCount = 0;
+			const int64_t start = esp_timer_get_time();
+			const uint32_t transactions0 = sim.i2cTransactions;
+			const uint32_t frames0 = sim.rfFrames;
+			const enum StatusCode status = PICC_Inventory_h(&reader, found, MAX_CARDS, &foundCount, false);
+			us += esp_timer_get_time() - start;
+			transactions += sim.i2cTransactions - transactions0;
+			frames += sim.rfFrames - frames0;
+			if (status != STATUS_OK || foundCount != count) {
+				printf("FAIL: %u cards: %s, %zu found\n", count, GetStatusCodeName(status), foundCount);
+				failures++;
+			}
+		}
+		printf("%5u  %7.1f  %11.1f  %16.1f  %9.1f\n", count, us / 1000.0 / LAYOUTS, us / 1000.0 / LAYOUTS / count,
+				(double)transactions / LAYOUTS, (double)frames / LAYOUTS);
+	}
+	return failures != 0;
+} // End main()
@@ -0,0 +1,97 @@
+/*
+ * bench_keyring.c - MIFARE_ReadCard_h() of a Classic 1K card with the keys of a key ring: a dictionary of DICTIONARY
+ * keys with the key of each sector at another position. The first read, with an empty cache, and a second read of the
+ * same card, at the ring's MFRC_KEYRING_AUTH_TIMEOUT_US, at the MFRC_TIMEOUT_AUTH_US of single authentications and at
+ * the 25ms of one timeout for everything. Reports virtual time, authentication attempts and the hit rate; fails if a
+ * read fails or the second read needs more than one attempt per sector.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_KeyRing.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define DICTIONARY	32
+#define SECTORS		16
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MIFARE_KeyRing ring;
+static MIFARE_Key keys[DICTIONARY];
+static uint8_t data[1024];
+
+// wakes the card up and selects it
+static bool Select(Uid *uid) {
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	return PICC_WakeupA_h(&reader, atqa, &atqaSize) == STATUS_OK && PICC_Select_h(&reader, uid, 0) == STATUS_OK;
+} // End Select()
+
+// one read of the whole card; adds its time and authentication attempts
+static bool Read(Uid *uid, int64_t *us, uint32_t *attempts) {
+	uint32_t attempts0;
+	MIFARE_KeyRing_GetStats(&ring, NULL, NULL, NULL, &attempts0);
+	const int64_t start = esp_timer_get_time();
+	MIFARE_ClassicImage image = {.data = data, .dataSize = sizeof(data)};
+	MIFARE_KeyProvider provider = MIFARE_KeyRing_Provider(&ring);
+	const bool ok = Select(uid) && MIFARE_ReadCard_h(&reader, uid, PICC_TYPE_MIFARE_1K, &provider, NULL, &image) == STATUS_OK;
+	*us = esp_timer_get_time() - start;
+	PICC_HaltA_h(&reader);
+	PCD_StopCrypto1_h(&reader);
+	MIFARE_KeyRing_GetStats(&ring, NULL, NULL, NULL, attempts);
+	*attempts -= attempts0;
+	return ok;
+} // End Read()
+
+int main(void) {
+	int failures = 0;
+	const uint8_t uid[4] = {0x12, 0x34, 0x56, 0x78};
+	const MIFARE_Key wrongKey = {{0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE}};
+	for (uint8_t k = 0; k < DICTIONARY; k++) {
+		for (uint8_t j = 0; j < MF_KEY_SIZE; j++) {
+			keys[k].keyByte[j] = k * 11 + j;
+		}
+	}
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	const uint32_t timeouts[] = {MFRC_KEYRING_AUTH_TIMEOUT_US, MFRC_TIMEOUT_AUTH_US, MFRC_TIMEOUT_DEFAULT_US};
+	printf("Classic 1K, %d keys as key A, the key of sector s at position 2s, 400 kHz i2c, CRC mode %d\n", DICTIONARY,
+			MFRC_DEFAULT_CRC_MODE);
+	printf("auth_timeout_us  first_ms  first_attempts  again_ms  again_attempts  hit_rate\n");
+	for (size_t t = 0; t < sizeof(timeouts) / sizeof(timeouts[0]); t++) {
+		MIFARE_KeyRing_Init(&ring);
+		MIFARE_KeyRing_SetAuthTimeout(&ring, timeouts[t]);
+		for (uint8_t k = 0; k < DICTIONARY; k++) {
+			MIFARE_KeyRing_AddKey(&ring, &keys[k], PICC_CMD_MF_AUTH_KEY_A);
+		}
+		MFRC522_Sim_Init(&sim);
+		MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid, 4);
+		for (uint8_t s = 0; s < SECTORS; s++) {
+			MFRC522_Sim_SetSectorKeys(card, s, &keys[2 * s], &wrongKey);
+		}
+		PCD_Init_h(&reader);
+
+		Uid selected = {0};
+		int64_t firstUs, againUs;
+		uint32_t firstAttempts, againAttempts;
+		const bool first = Read(&selected, &firstUs, &firstAttempts);
+		const bool again = Read(&selected, &againUs, &againAttempts);
+		printf("%15" PRIu32 "  %8.1f  %14" PRIu32 "  %8.1f  %14" PRIu32 "  %8.2f\n", timeouts[t], firstUs / 1000.0,
+				firstAttempts, againUs / 1000.0, againAttempts, MIFARE_KeyRing_GetHitRate(&ring));
+		if (!first || !again || againAttempts != SECTORS) {
+			printf("FAIL: timeout %" PRIu32 "us: first read %s, second read %s in %" PRIu32 " attempts\n", timeouts[t],
+					first ? "ok" : "failed", again ? "ok" : "failed", againAttempts);
+			failures++;
+		}
+	}
+	return failures != 0;
+} // End main()
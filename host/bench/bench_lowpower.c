@@ -0,0 +1,76 @@
+/*
+ * bench_lowpower.c - low-power card detection (MFRC522_LowPower.h) in both sleep modes at several wake-up intervals,
+ * the default burst and settle time: duty cycle, wake-ups and field-on time over a minute of an empty field, and the
+ * time to detect a card that is there when the reader falls asleep, the worst case. Fails if the detection is missed
+ * or takes longer than an interval plus the wake-up.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_LowPower.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define EMPTY_MS	60000
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_LowPower lp;
+
+static const char *const modeNames[] = {
+	[MFRC522_LOWPOWER_SOFT_POWERDOWN] = "soft power-down",
+	[MFRC522_LOWPOWER_ANTENNA_OFF] = "antenna off",
+};
+
+int main(void) {
+	int failures = 0;
+	const uint8_t uid4[4] = {0x12, 0x34, 0x56, 0x78};
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	const uint32_t intervals[] = {100, MFRC_LOWPOWER_INTERVAL_MS, 1000};
+	printf("%d s of an empty field, then a card, burst %d, settle %d us\n", EMPTY_MS / 1000, MFRC_LOWPOWER_BURST,
+			MFRC_LOWPOWER_FIELD_SETTLE_US);
+	printf("mode             interval_ms  duty_cycle_%%  wakeups  field_on_ms  wake_us  detect_ms\n");
+	for (enum MFRC522_LowPowerMode mode = MFRC522_LOWPOWER_SOFT_POWERDOWN; mode <= MFRC522_LOWPOWER_ANTENNA_OFF; mode++) {
+		for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+			MFRC522_LowPowerConfig config;
+			MFRC522_LowPowerStats stats;
+			MFRC522_LowPower_DefaultConfig(&config);
+			config.mode = mode;
+			config.intervalMs = intervals[i];
+			MFRC522_Sim_Init(&sim);
+			PCD_Init_h(&reader);
+			MFRC522_LowPower_Init(&lp, &reader, &config);
+
+			if (MFRC522_LowPower_WaitForCard(&lp, pdMS_TO_TICKS(EMPTY_MS)) != STATUS_TIMEOUT) {
+				printf("FAIL: %s, %" PRIu32 " ms: a card on an empty field\n", modeNames[mode], intervals[i]);
+				failures++;
+			}
+			MFRC522_LowPower_GetStats(&lp, &stats);
+			const uint64_t fieldOnUs = sim.fieldOnUs;
+
+			// the card is there when the reader goes to sleep: found after one interval
+			MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+			const int64_t start = esp_timer_get_time();
+			const enum StatusCode status = MFRC522_LowPower_WaitForCard(&lp, pdMS_TO_TICKS(10 * intervals[i]));
+			const int64_t detectUs = esp_timer_get_time() - start;
+			if (status != STATUS_OK || detectUs > (int64_t)(intervals[i] + 20) * 1000) {
+				printf("FAIL: %s, %" PRIu32 " ms: %s after %.1f ms\n", modeNames[mode], intervals[i],
+						GetStatusCodeName(status), detectUs / 1000.0);
+				failures++;
+			}
+			printf("%-15s  %11" PRIu32 "  %12.2f  %7" PRIu32 "  %11.1f  %7" PRIu32 "  %9.1f\n", modeNames[mode],
+					intervals[i], stats.dutyCycle * 100, stats.wakeups, fieldOnUs / 1000.0, stats.avgWakeUs,
+					detectUs / 1000.0);
+		}
+	}
+	return failures != 0;
+} // End main()
@@ -0,0 +1,103 @@
+/*
+ * bench_presence.c - card presence tracking (MFRC522_Presence.h) with a Classic 1K card (4 byte UID) and an NTAG213
+ * (7 byte UID): i2c transactions and virtual time of a poll that finds a PICC by a full select (WUPA + anticollision)
+ * against one that confirms the known PICC (WUPA + SELECT), and of a poll on an empty field. Fails if a poll reports
+ * the wrong event.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_Presence.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define VISITS		10
+#define POLLS		50
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_Presence presence;
+
+// one poll; adds its virtual time to *us
+static enum MFRC522_PresenceEvent Poll(int64_t *us) {
+	const int64_t start = esp_timer_get_time();
+	const enum MFRC522_PresenceEvent event = MFRC522_Presence_Poll(&presence, NULL);
+	*us += esp_timer_get_time() - start;
+	return event;
+} // End Poll()
+
+int main(void) {
+	int failures = 0;
+	const uint8_t uid4[4] = {0x12, 0x34, 0x56, 0x78};
+	const uint8_t uid7[7] = {4, 1, 2, 3, 4, 5, 6};
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	const struct {
+		const char *name;
+		enum MFRC522_SimCardType type;
+		const uint8_t *uid;
+		uint8_t uidSize;
+	} cards[] = {
+		{"Classic 1K", SIM_CARD_MIFARE_1K, uid4, 4},
+		{"NTAG213", SIM_CARD_NTAG213, uid7, 7},
+	};
+	printf("%d visits of %d polls, arrival after %d polls, removal after %d misses, 400 kHz i2c, CRC mode %d\n",
+			VISITS, POLLS, MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS, MFRC_PRESENCE_REMOVAL_MISSES, MFRC_DEFAULT_CRC_MODE);
+	printf("card        uid  select_i2c  select_us  confirm_i2c  confirm_us  empty_i2c  empty_us\n");
+	for (size_t c = 0; c < sizeof(cards) / sizeof(cards[0]); c++) {
+		MFRC522_Sim_Init(&sim);
+		PCD_Init_h(&reader);
+		MFRC522_Presence_Init(&presence, &reader, NULL);
+		MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, cards[c].type, cards[c].uid, cards[c].uidSize);
+		card->inField = false;
+
+		int64_t selectUs = 0, confirmUs = 0, emptyUs = 0;
+		uint32_t confirmPolls = 0, emptyPolls = 0, emptyTransactions = 0, wrong = 0;
+		for (uint8_t v = 0; v < VISITS; v++) {
+			// empty field
+			const uint32_t before = reader._i2cTransactions;
+			wrong += Poll(&emptyUs) != MFRC522_PRESENCE_NONE;
+			emptyTransactions += reader._i2cTransactions - before;
+			emptyPolls++;
+
+			// a PICC entering the field powers up in IDLE: found by a full select, then confirmed
+			card->inField = true;
+			card->_state = 0;
+			wrong += Poll(&selectUs) != (MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS == 1 ? MFRC522_PRESENCE_ARRIVED
+					: MFRC522_PRESENCE_NONE);
+			for (uint8_t p = 1; p < POLLS; p++) {
+				const enum MFRC522_PresenceEvent expected = p == MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS - 1
+						? MFRC522_PRESENCE_ARRIVED : MFRC522_PRESENCE_NONE;
+				wrong += Poll(&confirmUs) != expected;
+				confirmPolls++;
+			}
+
+			card->inField = false;
+			int64_t removalUs = 0;
+			for (uint8_t m = 1; m <= MFRC_PRESENCE_REMOVAL_MISSES; m++) {
+				wrong += Poll(&removalUs) != (m == MFRC_PRESENCE_REMOVAL_MISSES ? MFRC522_PRESENCE_REMOVED
+						: MFRC522_PRESENCE_NONE);
+			}
+		}
+
+		MFRC522_PresenceStats stats;
+		MFRC522_Presence_GetStats(&presence, &stats);
+		printf("%-10s  %3u  %10.1f  %9.0f  %11.1f  %10.0f  %9.1f  %8.0f\n", cards[c].name, cards[c].uidSize,
+				stats.avgSelectTransactions, (double)selectUs / VISITS, stats.avgConfirmTransactions,
+				(double)confirmUs / confirmPolls, (double)emptyTransactions / emptyPolls, (double)emptyUs / emptyPolls);
+		if (wrong || stats.arrivals != VISITS || stats.removals != VISITS || stats.selects != VISITS) {
+			printf("FAIL: %s: %" PRIu32 " wrong events, %" PRIu32 " arrivals, %" PRIu32 " removals, %" PRIu32
+					" full selects\n", cards[c].name, wrong, stats.arrivals, stats.removals, stats.selects);
+			failures++;
+		}
+	}
+	return failures != 0;
+} // End main()
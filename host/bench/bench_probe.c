@@ -0,0 +1,96 @@
+/*
+ * bench_probe.c - PICC_ProbePresence_h() and PICC_IsNewCardPresent_h() against PICC_RequestA_h(): i2c transactions
+ * and virtual time per call on an empty field and with a card that answers, at the default REQA timeout (the host
+ * sleeps whole ticks of 1 ms) and at one below a tick (ComIrqReg is polled). Fails if a call gets the wrong answer.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define CALLS		100
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+enum Call { CALL_REQUEST_A, CALL_PROBE, CALL_IS_NEW_CARD_PRESENT };
+
+static const char *const callNames[] = {
+	[CALL_REQUEST_A] = "PICC_RequestA_h",
+	[CALL_PROBE] = "PICC_ProbePresence_h",
+	[CALL_IS_NEW_CARD_PRESENT] = "PICC_IsNewCardPresent_h",
+};
+
+// one call; true if it found a card
+static bool Run(const enum Call call) {
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	switch (call) {
+		case CALL_REQUEST_A:
+			return PICC_RequestA_h(&reader, atqa, &atqaSize) == STATUS_OK;
+		case CALL_PROBE:
+			return PICC_ProbePresence_h(&reader, NULL) == STATUS_OK;
+		default:
+			return PICC_IsNewCardPresent_h(&reader);
+	}
+} // End Run()
+
+// CALLS calls of call, after one to stage the registers; card (NULL: empty field) is put back to IDLE before each
+static int Measure(const enum Call call, MFRC522_SimCard *card, double *transactions, double *us) {
+	int failures = 0;
+	Run(call);
+	int64_t total = 0;
+	uint32_t count = 0;
+	for (uint16_t i = 0; i < CALLS; i++) {
+		if (card) {
+			card->_state = 0;
+		}
+		const uint32_t before = reader._i2cTransactions;
+		const int64_t start = esp_timer_get_time();
+		if (Run(call) != (card != NULL)) {
+			failures++;
+		}
+		total += esp_timer_get_time() - start;
+		count += reader._i2cTransactions - before;
+	}
+	*transactions = (double)count / CALLS;
+	*us = (double)total / CALLS;
+	return failures;
+} // End Measure()
+
+int main(void) {
+	int failures = 0;
+	const uint8_t uid[4] = {0x12, 0x34, 0x56, 0x78};
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	const uint32_t timeouts[] = {MFRC_TIMEOUT_REQA_US, 500};
+	printf("mean of %d calls, 400 kHz i2c, 1 ms tick, no IRQ pin\n", CALLS);
+	printf("reqa_timeout_us  call                     empty_i2c  empty_us  card_i2c  card_us\n");
+	for (size_t t = 0; t < sizeof(timeouts) / sizeof(timeouts[0]); t++) {
+		for (enum Call call = CALL_REQUEST_A; call <= CALL_IS_NEW_CARD_PRESENT; call++) {
+			double emptyTransactions, emptyUs, cardTransactions, cardUs;
+			MFRC522_Sim_Init(&sim);
+			PCD_Init_h(&reader);
+			PCD_SetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_REQA, timeouts[t]);
+			int callFailures = Measure(call, NULL, &emptyTransactions, &emptyUs);
+			MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid, 4);
+			callFailures += Measure(call, card, &cardTransactions, &cardUs);
+			printf("%15" PRIu32 "  %-23s  %9.1f  %8.0f  %8.1f  %7.0f\n", timeouts[t], callNames[call],
+					emptyTransactions, emptyUs, cardTransactions, cardUs);
+			if (callFailures) {
+				printf("FAIL: %s: %d calls with the wrong answer\n", callNames[call], callFailures);
+				failures += callFailures;
+			}
+		}
+	}
+	return failures != 0;
+} // End main()
@@ -0,0 +1,100 @@
+/*
+ * bench_timeouts.c - the per-command timeout table against one MFRC_TIMEOUT_DEFAULT_US timeout for every command:
+ * virtual time of a REQA on an empty field, a HLTA, a failed authentication and a whole session on a Classic 1K card
+ * (REQA, select, auth, read, halt). Fails if the session fails with either setting.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define CALLS		20
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static const MIFARE_Key defaultKey = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+static const MIFARE_Key wrongKey = {{0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE}};
+
+// REQA and select of the card in the field
+static bool Select(Uid *uid) {
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	return PICC_RequestA_h(&reader, atqa, &atqaSize) == STATUS_OK && PICC_Select_h(&reader, uid, 0) == STATUS_OK;
+} // End Select()
+
+// mean virtual time in ms of the four operations; false if a session failed
+static bool Measure(double ms[4]) {
+	const uint8_t uid4[4] = {0x12, 0x34, 0x56, 0x78};
+	bool ok = true;
+	int64_t us[4] = {0};
+	for (uint8_t i = 0; i < CALLS; i++) {
+		uint8_t atqa[2];
+		uint8_t atqaSize = sizeof(atqa);
+		MFRC522_Sim_Init(&sim);
+		PCD_Init_h(&reader);
+		int64_t start = esp_timer_get_time();
+		PICC_RequestA_h(&reader, atqa, &atqaSize);
+		us[0] += esp_timer_get_time() - start;
+
+		MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+		Uid uid;
+		ok &= Select(&uid);
+		start = esp_timer_get_time();
+		PICC_HaltA_h(&reader);
+		us[1] += esp_timer_get_time() - start;
+
+		card->_state = 0;
+		ok &= Select(&uid);
+		start = esp_timer_get_time();
+		ok &= PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &wrongKey, &uid) != STATUS_OK;
+		us[2] += esp_timer_get_time() - start;
+
+		card->_state = 0;
+		uint8_t buffer[18];
+		uint8_t size = sizeof(buffer);
+		start = esp_timer_get_time();
+		ok &= Select(&uid);
+		ok &= PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &defaultKey, &uid) == STATUS_OK;
+		ok &= MIFARE_Read_h(&reader, 4, buffer, &size) == STATUS_OK;
+		ok &= PICC_HaltA_h(&reader) == STATUS_OK;
+		PCD_StopCrypto1_h(&reader);
+		us[3] += esp_timer_get_time() - start;
+	}
+	for (uint8_t o = 0; o < 4; o++) {
+		ms[o] = us[o] / 1000.0 / CALLS;
+	}
+	return ok;
+} // End Measure()
+
+int main(void) {
+	int failures = 0;
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	printf("mean of %d, 400 kHz i2c, CRC mode %d, times in ms\n", CALLS, MFRC_DEFAULT_CRC_MODE);
+	printf("timeouts        empty_reqa     hlta  wrong_key  session\n");
+	const char *const settings[] = {"table", "25ms for all"};
+	for (uint8_t setting = 0; setting < 2; setting++) {
+		if (setting == 1) {
+			for (enum PCD_TimeoutClass c = PCD_TIMEOUT_DEFAULT; c < PCD_TIMEOUT_CLASSES; c++) {
+				PCD_SetCommandTimeoutUs_h(&reader, c, MFRC_TIMEOUT_DEFAULT_US);
+			}
+		}
+		double ms[4];
+		const bool ok = Measure(ms);
+		printf("%-14s  %10.2f  %7.2f  %9.2f  %7.2f\n", settings[setting], ms[0], ms[1], ms[2], ms[3]);
+		if (!ok) {
+			printf("FAIL: %s: a session failed\n", settings[setting]);
+			failures++;
+		}
+	}
+	return failures != 0;
+} // End main()
@@ -0,0 +1,111 @@
+/*
+ * bench_ultralight.c - a whole Ultralight or NTAG21x read: MIFARE_Ultralight_ReadAll_h() (GET_VERSION, then
+ * FAST_READ) against one READ per 4 pages with MIFARE_Ultralight_ReadPages_h(), in every CRC mode. Reports virtual
+ * time, i2c transactions and RF frames; fails if a read does not return the tag memory.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static const struct {
+	const char *name;
+	enum MFRC522_SimCardType type;
+	uint16_t pages;
+} tags[] = {
+	{"Ultralight",	SIM_CARD_ULTRALIGHT,	16},
+	{"NTAG213",		SIM_CARD_NTAG213,		45},
+	{"NTAG215",		SIM_CARD_NTAG215,		135},
+	{"NTAG216",		SIM_CARD_NTAG216,		231},
+};
+
+static const char *const modeNames[] = {
+	[PCD_CRC_COPROCESSOR] = "coprocessor",
+	[PCD_CRC_SOFTWARE] = "software",
+	[PCD_CRC_HARDWARE] = "hardware",
+};
+
+typedef struct {
+	int64_t us;
+	uint32_t transactions;
+	uint32_t frames;
+} Cost;
+
+// selects a fresh tags[index]
+static MFRC522_SimCard *Select(const size_t index, const enum PCD_CRCMode mode, Uid *uid) {
+	const uint8_t id[7] = {0x04, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	MFRC522_Sim_Init(&sim);
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, tags[index].type, id, sizeof(id));
+	for (uint16_t i = 16; i < tags[index].pages * 4; i++) {
+		card->memory[i] = (uint8_t)(i * 13);
+	}
+	PCD_Init_h(&reader);
+	PCD_SetCRCMode_h(&reader, mode);
+	PICC_RequestA_h(&reader, atqa, &atqaSize);
+	PICC_Select_h(&reader, uid, 0);
+	return card;
+} // End Select()
+
+static Cost Since(const Cost *start) {
+	return (Cost){esp_timer_get_time() - start->us, sim.i2cTransactions - start->transactions, sim.rfFrames - start->frames};
+} // End Since()
+
+static Cost Now(void) {
+	return (Cost){esp_timer_get_time(), sim.i2cTransactions, sim.rfFrames};
+} // End Now()
+
+int main(void) {
+	static uint8_t buffer[1024];
+	int failures = 0;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	printf("whole tag read: ReadAll (GET_VERSION + FAST_READ) vs READ of 4 pages\n");
+	printf("%-11s  %-10s  %5s  %8s  %6s  %6s  %8s  %6s  %6s\n", "mode", "tag", "pages",
+			"bulk_ms", "i2c", "frames", "read_ms", "i2c", "frames");
+	for (uint8_t mode = PCD_CRC_COPROCESSOR; mode <= PCD_CRC_HARDWARE; mode++) {
+		for (size_t t = 0; t < sizeof(tags) / sizeof(tags[0]); t++) {
+			Uid uid;
+			uint16_t pageCount = 0;
+			const uint16_t pages = tags[t].pages;
+
+			MFRC522_SimCard *card = Select(t, mode, &uid);
+			Cost start = Now();
+			const enum StatusCode bulkStatus = MIFARE_Ultralight_ReadAll_h(&reader, &uid, buffer, sizeof(buffer), &pageCount);
+			const Cost bulk = Since(&start);
+			if (bulkStatus != STATUS_OK || pageCount != pages || memcmp(buffer, card->memory, pages * 4) != 0) {
+				printf("FAIL: %s %s: ReadAll: %s, %u pages\n", modeNames[mode], tags[t].name, GetStatusCodeName(bulkStatus), pageCount);
+				failures++;
+			}
+
+			card = Select(t, mode, &uid);
+			memset(buffer, 0, sizeof(buffer));
+			start = Now();
+			const enum StatusCode readStatus = MIFARE_Ultralight_ReadPages_h(&reader, 0, pages, false, buffer, sizeof(buffer));
+			const Cost read = Since(&start);
+			if (readStatus != STATUS_OK || memcmp(buffer, card->memory, pages * 4) != 0) {
+				printf("FAIL: %s %s: READ: %s\n", modeNames[mode], tags[t].name, GetStatusCodeName(readStatus));
+				failures++;
+			}
+
+			printf("%-11s  %-10s  %5u  %8.1f  %6" PRIu32 "  %6" PRIu32 "  %8.1f  %6" PRIu32 "  %6" PRIu32 "\n",
+					modeNames[mode], tags[t].name, pages, bulk.us / 1000.0, bulk.transactions, bulk.frames,
+					read.us / 1000.0, read.transactions, read.frames);
+		}
+	}
+	return failures != 0;
+} // End main()
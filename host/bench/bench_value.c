@@ -0,0 +1,120 @@
+/*
+ * bench_value.c - a backup and a decrement of a value block: MIFARE_ValueTransaction_h() against the same work done
+ * with the single value block calls (auth, read, restore, transfer, decrement, transfer, read back), with and without
+ * reading the backup block back too, in every CRC mode. Reports virtual time and i2c transactions; fails if a path
+ * leaves other values than expected.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "MFRC522_Classic.h"
+#include "esp_host.h"
+
+#include <esp_timer.h>
+
+#define START_VALUE		1000
+#define FARE			150
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static const MIFARE_Key defaultKey = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+static const char *const modeNames[] = {
+	[PCD_CRC_COPROCESSOR] = "coprocessor",
+	[PCD_CRC_SOFTWARE] = "software",
+	[PCD_CRC_HARDWARE] = "hardware",
+};
+
+typedef struct {
+	int64_t us;
+	uint32_t transactions;
+} Cost;
+
+// a fresh card with START_VALUE in block 4, selected
+static void Select(const enum PCD_CRCMode mode, Uid *uid) {
+	const uint8_t id[4] = {1, 2, 3, 4};
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	MFRC522_Sim_Init(&sim);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, id, sizeof(id));
+	PCD_Init_h(&reader);
+	PCD_SetCRCMode_h(&reader, mode);
+	PICC_RequestA_h(&reader, atqa, &atqaSize);
+	PICC_Select_h(&reader, uid, 0);
+	PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &defaultKey, uid);
+	MIFARE_SetValue_h(&reader, 4, START_VALUE);
+	PCD_StopCrypto1_h(&reader);
+	PICC_HaltA_h(&reader);
+	atqaSize = sizeof(atqa);
+	PICC_WakeupA_h(&reader, atqa, &atqaSize);
+	PICC_Select_h(&reader, uid, 0);
+} // End Select()
+
+// the single calls. returns the number of failed steps.
+static int SingleCalls(const Uid *uid, const bool readBackup, Cost *cost) {
+	long before = 0, after = 0, backup = START_VALUE;
+	int failures = 0;
+	const int64_t start = esp_timer_get_time();
+	const uint32_t transactions = reader._i2cTransactions;
+	failures += PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &defaultKey, uid) != STATUS_OK;
+	failures += MIFARE_GetValue_h(&reader, 4, &before) != STATUS_OK;
+	failures += MIFARE_Restore_h(&reader, 4) != STATUS_OK;
+	failures += MIFARE_Transfer_h(&reader, 5) != STATUS_OK;
+	failures += MIFARE_Decrement_h(&reader, 4, FARE) != STATUS_OK;
+	failures += MIFARE_Transfer_h(&reader, 4) != STATUS_OK;
+	failures += MIFARE_GetValue_h(&reader, 4, &after) != STATUS_OK;
+	if (readBackup) {
+		failures += MIFARE_GetValue_h(&reader, 5, &backup) != STATUS_OK;
+	}
+	cost->us = esp_timer_get_time() - start;
+	cost->transactions = reader._i2cTransactions - transactions;
+	return failures + (before != START_VALUE) + (after != START_VALUE - FARE) + (backup != START_VALUE);
+} // End SingleCalls()
+
+static int Transaction(const Uid *uid, Cost *cost) {
+	const MIFARE_KeyProvider keys = MIFARE_KeyAProvider(&defaultKey);
+	const MIFARE_ValueOp ops[] = {{PICC_CMD_MF_RESTORE, 4, 5, 0}, {PICC_CMD_MF_DECREMENT, 4, 4, FARE}};
+	MIFARE_ValueResult result;
+	const int64_t start = esp_timer_get_time();
+	const uint32_t transactions = reader._i2cTransactions;
+	const enum StatusCode status = MIFARE_ValueTransaction_h(&reader, uid, &keys, ops, 2, &result);
+	cost->us = esp_timer_get_time() - start;
+	cost->transactions = reader._i2cTransactions - transactions;
+	return status != STATUS_OK || !result.verified || result.previousValue != START_VALUE
+			|| result.value != START_VALUE - FARE;
+} // End Transaction()
+
+int main(void) {
+	int failures = 0;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+
+	printf("backup + decrement of a value block, read before and read back\n");
+	printf("%-11s  %18s  %18s  %18s\n", "mode", "single calls", "+ backup read", "transaction");
+	for (uint8_t mode = PCD_CRC_COPROCESSOR; mode <= PCD_CRC_HARDWARE; mode++) {
+		Uid uid;
+		Cost single, verified, transaction;
+		int modeFailures = 0;
+		Select(mode, &uid);
+		modeFailures += SingleCalls(&uid, false, &single);
+		Select(mode, &uid);
+		modeFailures += SingleCalls(&uid, true, &verified);
+		Select(mode, &uid);
+		modeFailures += Transaction(&uid, &transaction);
+		if (modeFailures) {
+			printf("FAIL: %s: a path left other values than expected\n", modeNames[mode]);
+			failures += modeFailures;
+		}
+		printf("%-11s  %5" PRIu32 " i2c %6.1f ms  %5" PRIu32 " i2c %6.1f ms  %5" PRIu32 " i2c %6.1f ms\n", modeNames[mode],
+				single.transactions, single.us / 1000.0, verified.transactions, verified.us / 1000.0,
+				transaction.transactions, transaction.us / 1000.0);
+	}
+	return failures != 0;
+} // End main()
@@ -0,0 +1,276 @@
+/*
+ * esp_host.c - the ESP-IDF and FreeRTOS functions the MFRC522 library calls, for a Linux host build.
+ * See esp_host.h for an overview.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
+
+#include "esp_host.h"
+
+#define HOST_MAX_SIMS		32
+
+static MFRC522_Sim *sims[HOST_MAX_SIMS];
+static uint8_t simCount;
+static int64_t nowUs;					// the shared virtual clock
+
+static struct {
+	gpio_isr_t handler;
+	void *arg;
+} isrHandlers[GPIO_NUM_MAX];
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Virtual clock
+/////////////////////////////////////////////////////////////////////////////////////
+
+// Lets sim catch up with the clock, e.g. after a delay or traffic on another simulator.
+static void EspHost_SyncIn(MFRC522_Sim *sim) {
+	if (nowUs > sim->nowUs) {
+		MFRC522_Sim_AdvanceUs(sim, nowUs - sim->nowUs);
+	}
+}
+
+// Moves the clock on to the end of the last transaction of sim.
+static void EspHost_SyncOut(const MFRC522_Sim *sim) {
+	if (sim->nowUs > nowUs) {
+		nowUs = sim->nowUs;
+	}
+}
+
+static void EspHost_Advance(const int64_t us) {
+	nowUs += us;
+	for (uint8_t i = 0; i < simCount; i++) {
+		EspHost_SyncIn(sims[i]);
+	}
+}
+
+void EspHost_AddSim(MFRC522_Sim *sim) {
+	for (uint8_t i = 0; i < simCount; i++) {
+		if (sims[i] == sim) {
+			return;
+		}
+	}
+	if (simCount == HOST_MAX_SIMS) {
+		abort();
+	}
+	sims[simCount++] = sim;
+	EspHost_SyncIn(sim);
+}
+
+i2c_master_dev_handle_t EspHost_I2cDevice(MFRC522_Sim *sim) {
+	return (i2c_master_dev_handle_t)sim;
+}
+
+void EspHost_Reset(void) {
+	simCount = 0;
+	nowUs = 0;
+	memset(isrHandlers, 0, sizeof(isrHandlers));
+}
+
+int64_t esp_timer_get_time(void) {
+	// transactions through MFRC522_AttachSimulator_h() bypass the functions below
+	for (uint8_t i = 0; i < simCount; i++) {
+		EspHost_SyncOut(sims[i]);
+	}
+	return nowUs;
+}
+
+void esp_rom_delay_us(const uint32_t us) {
+	esp_timer_get_time();
+	EspHost_Advance(us);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// i2c: every device is a simulated MFRC522
+/////////////////////////////////////////////////////////////////////////////////////
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, const size_t write_size, const int xfer_timeout_ms) {
+	MFRC522_Sim *sim = (MFRC522_Sim *)i2c_dev;
+	esp_timer_get_time();
+	EspHost_SyncIn(sim);
+	const esp_err_t err = MFRC522_Sim_Transmit(sim, write_buffer, write_size);
+	EspHost_SyncOut(sim);
+	return err;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, const size_t write_size,
+									uint8_t *read_buffer, const size_t read_size, const int xfer_timeout_ms) {
+	MFRC522_Sim *sim = (MFRC522_Sim *)i2c_dev;
+	esp_timer_get_time();
+	EspHost_SyncIn(sim);
+	const esp_err_t err = MFRC522_Sim_TransmitReceive(sim, write_buffer, write_size, read_buffer, read_size);
+	EspHost_SyncOut(sim);
+	return err;
+}
+
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t i2c_dev, i2c_master_transmit_multi_buffer_info_t *buffer_info_array,
+									const size_t array_size, const int xfer_timeout_ms) {
+	uint8_t data[1 + 300];
+	size_t length = 0;
+	for (size_t i = 0; i < array_size; i++) {
+		if (length + buffer_info_array[i].buffer_size > sizeof(data)) {
+			return ESP_ERR_INVALID_SIZE;
+		}
+		memcpy(&data[length], buffer_info_array[i].write_buffer, buffer_info_array[i].buffer_size);
+		length += buffer_info_array[i].buffer_size;
+	}
+	return i2c_master_transmit(i2c_dev, data, length, xfer_timeout_ms);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// GPIO: inputs read high, outputs and interrupts do nothing
+/////////////////////////////////////////////////////////////////////////////////////
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig) {
+	return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(const gpio_num_t gpio_num) {
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(const gpio_num_t gpio_num, const gpio_mode_t mode) {
+	return ESP_OK;
+}
+
+esp_err_t gpio_set_level(const gpio_num_t gpio_num, const uint32_t level) {
+	return ESP_OK;
+}
+
+int gpio_get_level(const gpio_num_t gpio_num) {
+	return 1;
+}
+
+esp_err_t gpio_install_isr_service(const int intr_alloc_flags) {
+	return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(const gpio_num_t gpio_num, const gpio_isr_t isr_handler, void *args) {
+	if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	isrHandlers[gpio_num].handler = isr_handler;
+	isrHandlers[gpio_num].arg = args;
+	return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(const gpio_num_t gpio_num) {
+	if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	isrHandlers[gpio_num].handler = NULL;
+	isrHandlers[gpio_num].arg = NULL;
+	return ESP_OK;
+}
+
+gpio_isr_t EspHost_GpioIsrHandler(const gpio_num_t pin, void **arg) {
+	if (pin < 0 || pin >= GPIO_NUM_MAX) {
+		return NULL;
+	}
+	if (arg) {
+		*arg = isrHandlers[pin].arg;
+	}
+	return isrHandlers[pin].handler;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// FreeRTOS: one task, the caller
+/////////////////////////////////////////////////////////////////////////////////////
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, const uint32_t usStackDepth, void *pvParameters,
+						const UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+	return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+	esp_timer_get_time();
+	EspHost_Advance((int64_t)xTicksToDelay * portTICK_PERIOD_MS * 1000);
+}
+
+void taskYIELD(void) {
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+	return (TaskHandle_t)&nowUs;			// any non-NULL value: there is one task
+}
+
+// No ISR ever notifies: waits out the ticks, so an IRQ wait turns into a wait for the timeout.
+uint32_t ulTaskNotifyTake(const BaseType_t xClearCountOnExit, const TickType_t xTicksToWait) {
+	if (xTicksToWait != portMAX_DELAY) {
+		vTaskDelay(xTicksToWait);
+	}
+	return 0;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken) {
+}
+
+struct QueueDefinition {
+	size_t itemSize;
+	size_t length;
+	size_t head;
+	size_t count;
+	uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize) {
+	QueueHandle_t queue = calloc(1, sizeof(*queue) + (size_t)uxQueueLength * uxItemSize);
+	if (queue) {
+		queue->itemSize = uxItemSize;
+		queue->length = uxQueueLength;
+	}
+	return queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {
+	free(xQueue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, const TickType_t xTicksToWait) {
+	if (xQueue->count == xQueue->length) {
+		return pdFALSE;
+	}
+	const size_t slot = (xQueue->head + xQueue->count) % xQueue->length;
+	memcpy(&xQueue->items[slot * xQueue->itemSize], pvItemToQueue, xQueue->itemSize);
+	xQueue->count++;
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, const TickType_t xTicksToWait) {
+	if (xQueue->count == 0) {
+		return pdFALSE;
+	}
+	memcpy(pvBuffer, &xQueue->items[xQueue->head * xQueue->itemSize], xQueue->itemSize);
+	xQueue->head = (xQueue->head + 1) % xQueue->length;
+	xQueue->count--;
+	return pdTRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// esp_err.h
+/////////////////////////////////////////////////////////////////////////////////////
+
+const char *esp_err_to_name(const esp_err_t code) {
+	switch (code) {
+		case ESP_OK:					return "ESP_OK";
+		case ESP_FAIL:					return "ESP_FAIL";
+		case ESP_ERR_NO_MEM:			return "ESP_ERR_NO_MEM";
+		case ESP_ERR_INVALID_ARG:		return "ESP_ERR_INVALID_ARG";
+		case ESP_ERR_INVALID_STATE:		return "ESP_ERR_INVALID_STATE";
+		case ESP_ERR_INVALID_SIZE:		return "ESP_ERR_INVALID_SIZE";
+		case ESP_ERR_NOT_FOUND:			return "ESP_ERR_NOT_FOUND";
+		case ESP_ERR_NOT_SUPPORTED:		return "ESP_ERR_NOT_SUPPORTED";
+		case ESP_ERR_TIMEOUT:			return "ESP_ERR_TIMEOUT";
+		case ESP_ERR_INVALID_RESPONSE:	return "ESP_ERR_INVALID_RESPONSE";
+		default:						return "UNKNOWN ERROR";
+	}
+}
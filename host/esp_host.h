@@ -0,0 +1,42 @@
+/**
+ * esp_host.h - the ESP-IDF and FreeRTOS functions the MFRC522 library calls, for a Linux host build.
+ *
+ * Every i2c device handle is a simulated MFRC522 (MFRC522_Sim.h), so the library runs unmodified off-target:
+ *
+ * 		static MFRC522_Sim sim;
+ * 		static MFRC522_Handle reader;
+ * 		MFRC522_Sim_Init(&sim);
+ * 		EspHost_AddSim(&sim);
+ * 		MFRC522_Init_h(&reader, EspHost_I2cDevice(&sim), -1);	// i2c_master_transmit() & co. reach sim
+ * 		PCD_Init_h(&reader);
+ *
+ * MFRC522_AttachSimulator_h() skips the i2c functions and gives the same transactions; the tests use both.
+ *
+ * Time is virtual. All simulators added with EspHost_AddSim() share one clock: an i2c transaction advances it by
+ * its bus time, vTaskDelay() and esp_rom_delay_us() by the delay, and esp_timer_get_time() reads it. Timings
+ * measured on the host are therefore the ones of the modelled bus and RF traffic, not of the host CPU.
+ *
+ * There is no scheduler. xTaskCreate() fails, so MFRC522_Pool_Start() and MFRC522_Log_StartTask() report an
+ * error; call MFRC522_Pool_Service() and MFRC522_Log_Drain() yourself. GPIO ISR handlers are recorded, never called.
+ */
+#ifndef esp_host_h
+#define esp_host_h
+
+#include <driver/gpio.h>
+#include <driver/i2c_master.h>
+
+#include "MFRC522_Sim.h"
+
+// puts sim on the shared virtual clock. adding it again does nothing.
+void EspHost_AddSim(MFRC522_Sim *sim);
+
+// the i2c device handle of sim, for MFRC522_Init_h(). EspHost_AddSim() it too.
+i2c_master_dev_handle_t EspHost_I2cDevice(MFRC522_Sim *sim);
+
+// forgets all simulators and sets the clock back to 0.
+void EspHost_Reset(void);
+
+// the handler gpio_isr_handler_add() installed on pin, NULL if none. arg (NULL: unused) gets its argument.
+gpio_isr_t EspHost_GpioIsrHandler(gpio_num_t pin, void **arg);
+
+#endif // esp_host_h
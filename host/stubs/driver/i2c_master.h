@@ -0,0 +1,24 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ * A device handle is a simulated MFRC522, see EspHost_I2cDevice() in host/esp_host.h.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+typedef struct i2c_master_dev_t *i2c_master_dev_handle_t;
+
+typedef struct {
+	uint8_t *write_buffer;
+	size_t buffer_size;
+} i2c_master_transmit_multi_buffer_info_t;
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size, int xfer_timeout_ms);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size,
+									uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms);
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t i2c_dev, i2c_master_transmit_multi_buffer_info_t *buffer_info_array,
+									size_t array_size, int xfer_timeout_ms);
@@ -0,0 +1,6 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ */
+#pragma once
+
+#define IRAM_ATTR
@@ -0,0 +1,15 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#define ESP_RETURN_ON_ERROR(x, log_tag, format, ...) do {								\
+		const esp_err_t err_rc_ = (x);													\
+		if (err_rc_ != ESP_OK) {														\
+			ESP_LOGE(log_tag, "%s(%d): " format, __FUNCTION__, __LINE__, ##__VA_ARGS__);	\
+			return err_rc_;																\
+		}																				\
+	} while (0)
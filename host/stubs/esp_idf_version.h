@@ -0,0 +1,18 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: the host build behaves like ESP-IDF 5.4, unless the
+ * ESP_IDF_VERSION_xxx parts are defined on the command line (see mfrc522_host_idf53 in host/CMakeLists.txt).
+ */
+#pragma once
+
+#ifndef ESP_IDF_VERSION_MAJOR
+#define ESP_IDF_VERSION_MAJOR						5
+#endif
+#ifndef ESP_IDF_VERSION_MINOR
+#define ESP_IDF_VERSION_MINOR						4
+#endif
+#ifndef ESP_IDF_VERSION_PATCH
+#define ESP_IDF_VERSION_PATCH						0
+#endif
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch)	(((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION								ESP_IDF_VERSION_VAL(ESP_IDF_VERSION_MAJOR, ESP_IDF_VERSION_MINOR, ESP_IDF_VERSION_PATCH)
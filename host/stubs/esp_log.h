@@ -0,0 +1,16 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ * The log macros print "<level> <tag>: <message>" to stdout. ESP_LOGD is compiled out, as with the default
+ * CONFIG_LOG_DEFAULT_LEVEL_INFO.
+ */
+#pragma once
+
+#include <stdio.h>
+
+#include "esp_err.h"
+
+#define ESP_LOGE(tag, format, ...)	printf("E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)	printf("W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)	printf("I %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)	do { if (0) printf("D %s: " format "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, format, ...)	do { if (0) printf("V %s: " format "\n", tag, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,8 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ */
+#pragma once
+
+#include <stdint.h>
+
+void esp_rom_delay_us(uint32_t us);		// advances the virtual clock
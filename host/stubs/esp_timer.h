@@ -0,0 +1,9 @@
+/*
+ * Host build stub of the ESP-IDF header of the same name: only what the MFRC522 library uses.
+ * The time is virtual, see host/esp_host.h.
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
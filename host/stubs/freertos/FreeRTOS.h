@@ -0,0 +1,26 @@
+/*
+ * Host build stub of the FreeRTOS header of the same name: only what the MFRC522 library uses.
+ * One tick is one millisecond of virtual time, see host/esp_host.h.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>			// FreeRTOSConfig.h of ESP-IDF brings it in
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE						((BaseType_t)0)
+#define pdTRUE						((BaseType_t)1)
+#define pdFAIL						pdFALSE
+#define pdPASS						pdTRUE
+
+#define portTICK_PERIOD_MS			((TickType_t)1)
+#define portMAX_DELAY				((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs)	((TickType_t)(xTimeInMs) / portTICK_PERIOD_MS)
+#define portYIELD_FROM_ISR(x)		((void)(x))
+
+#define configMAX_TASK_NAME_LEN		16
@@ -0,0 +1,61 @@
+/*
+ * dump_cards.h - the cards test_dump.c dumps and compares with golden/dump_<name>.txt.
+ */
+#ifndef dump_cards_h
+#define dump_cards_h
+
+#include <string.h>
+
+#include "MFRC522_Sim.h"
+
+static const struct {
+	const char *name;
+	enum MFRC522_SimCardType type;
+	uint8_t uidSize;
+} dumpCards[] = {
+	{"mini",		SIM_CARD_MIFARE_MINI,	4},
+	{"1k",			SIM_CARD_MIFARE_1K,		4},
+	{"4k",			SIM_CARD_MIFARE_4K,		4},
+	{"ultralight",	SIM_CARD_ULTRALIGHT,	7},
+	{"ntag213",		SIM_CARD_NTAG213,		7},
+	{"iso14443_4",	SIM_CARD_ISO14443_4,	7},
+};
+
+#define DUMP_CARDS (sizeof(dumpCards) / sizeof(dumpCards[0]))
+
+// Puts dumpCards[index] into sim. A Classic card has a value block (block 5) and sector 0 under another key A, so
+// the dump also shows the value and the authentication failure.
+static inline MFRC522_SimCard *DumpTest_AddCard(MFRC522_Sim *sim, const size_t index) {
+	const uint8_t uid[7] = {0x04, 0xA1, 0x0B, 0xC3, 0x5D, 0xE6, 0x7F};
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(sim, dumpCards[index].type, uid, dumpCards[index].uidSize);
+	const bool classic = dumpCards[index].type <= SIM_CARD_MIFARE_4K;
+	for (uint16_t i = 16; i < card->memorySize; i++) {
+		const uint16_t block = i / 16;
+		const bool trailer = block < 128 ? block % 4 == 3 : block % 16 == 15;
+		if (!classic || !trailer) {
+			card->memory[i] = (uint8_t)(i * 7 + 3);
+		}
+	}
+	if (classic) {
+		const int32_t value = -123456;
+		const int32_t inverted = ~value;
+		uint8_t *block = &card->memory[5 * 16];
+		memcpy(&block[0], &value, 4);
+		memcpy(&block[4], &inverted, 4);
+		memcpy(&block[8], &value, 4);
+		block[12] = 5;
+		block[13] = ~5;
+		block[14] = 5;
+		block[15] = ~5;
+		uint8_t *trailer = &card->memory[7 * 16];		// sector 1: block 5 is a value block (110)
+		trailer[6] = 0xDD;
+		trailer[7] = 0x27;
+		trailer[8] = 0x82;
+		card->memory[11 * 16 + 8] = 0x81;				// sector 2: inverted access bits that do not match
+		const MIFARE_Key key = {{1, 2, 3, 4, 5, 6}};
+		MFRC522_Sim_SetSectorKeys(card, 0, &key, &key);
+	}
+	return card;
+} // End DumpTest_AddCard()
+
+#endif // dump_cards_h
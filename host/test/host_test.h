@@ -0,0 +1,54 @@
+/*
+ * host_test.h - checks for the host tests. Each test is a program that returns non-zero if a check failed.
+ */
+#ifndef host_test_h
+#define host_test_h
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MFRC522_I2C.h"
+#include "MFRC522_Sim.h"
+#include "esp_host.h"
+
+static int hostTestFailures;
+
+// counts and prints a failed check, the test carries on
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+		hostTestFailures++; \
+	} \
+} while (0)
+
+#define CHECK_STATUS(expected, call) do { \
+	const enum StatusCode _status = (call); \
+	if (_status != (expected)) { \
+		printf("FAIL %s:%d: %s returned %s, expected %s\n", __FILE__, __LINE__, #call, \
+				GetStatusCodeName(_status), GetStatusCodeName(expected)); \
+		hostTestFailures++; \
+	} \
+} while (0)
+
+// the exit code of main()
+static inline int HostTest_Summary(const char *name) {
+	printf("%s: %s (%d failed checks)\n", name, hostTestFailures ? "FAILED" : "passed", hostTestFailures);
+	return hostTestFailures != 0;
+}
+
+// Empties sim and opens dev on it through MFRC522_AttachSimulator_h(), in the given CRC mode.
+static inline void HostTest_OpenReader(MFRC522_Handle *dev, MFRC522_Sim *sim, const enum PCD_CRCMode crcMode) {
+	MFRC522_Sim_Init(sim);
+	EspHost_AddSim(sim);
+	MFRC522_Init_h(dev, NULL, -1);
+	MFRC522_AttachSimulator_h(dev, sim);
+	PCD_SetCRCMode_h(dev, crcMode);
+	CHECK(PCD_Init_h(dev) == ESP_OK);
+} // End HostTest_OpenReader()
+
+// Selects the only card in the field, dev from HostTest_OpenReader().
+static inline bool HostTest_SelectCard(MFRC522_Handle *dev, Uid *uid) {
+	return PICC_IsNewCardPresent_h(dev) && PICC_ReadCardSerial_h(dev, uid);
+} // End HostTest_SelectCard()
+
+#endif // host_test_h
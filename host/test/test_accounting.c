@@ -0,0 +1,73 @@
+/*
+ * test_accounting.c - i2c transaction accounting (MFRC522_Accounting.h): every transaction of the reader counted
+ * against exactly one operation, nested operations, the bus time model and the budget check.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Accounting.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_Accounting acct;
+
+static void TestSession(const enum PCD_CRCMode mode) {
+	const uint8_t id[4] = {1, 2, 3, 4};
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	Uid uid;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+	PCD_SetCRCMode_h(&reader, mode);
+	MFRC522_Accounting_Attach(&acct, &reader);
+	const uint32_t transactions0 = reader._i2cTransactions;
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+	CHECK(!PICC_IsNewCardPresent_h(&reader));
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, id, sizeof(id));
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid));
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));
+	CHECK_STATUS(STATUS_OK, MIFARE_Write_h(&reader, 5, buffer, 16));
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	PCD_StopCrypto1_h(&reader);
+
+	// each transaction once, against the outermost operation: the REQA inside PICC_IsNewCardPresent_h() is no request
+	uint32_t transactions = 0;
+	for (uint8_t op = 0; op < MFRC_OPS; op++) {
+		transactions += acct.op[op].transactions;
+		CHECK(acct.op[op].transactions == acct.op[op].reads + acct.op[op].writes);
+	}
+	CHECK(transactions == reader._i2cTransactions - transactions0);
+	CHECK(acct.op[MFRC_OP_INIT].calls == 1);
+	CHECK(acct.op[MFRC_OP_IS_NEW_CARD_PRESENT].calls == 2 && acct.op[MFRC_OP_REQUEST].calls == 0);
+	CHECK(acct.op[MFRC_OP_SELECT].calls == 1 && acct.op[MFRC_OP_AUTH].calls == 1 && acct.op[MFRC_OP_HALT].calls == 1);
+	CHECK(acct.op[MFRC_OP_READ].calls == 1 && acct.op[MFRC_OP_WRITE].calls == 1);
+	CHECK(acct.op[MFRC_OP_TRANSCEIVE].calls == 0);
+	CHECK(acct.op[MFRC_OP_CRC].calls == 0);							// only ever called inside the operations above
+
+	// the bus time model: a slower clock takes longer
+	const MFRC522_OpAccount *select = &acct.op[MFRC_OP_SELECT];
+	CHECK(MFRC522_Accounting_BusTimeUs(select, 100000) > MFRC522_Accounting_BusTimeUs(select, 400000));
+	CHECK(MFRC522_Accounting_BusTimeUs(select, 400000) > MFRC522_Accounting_BusTimeUs(select, 1000000));
+
+	const MFRC522_OpBudget generous[] = {{MFRC_OP_SELECT, select->transactions}, {MFRC_OP_CRC, 0}};	// no calls: passes
+	const MFRC522_OpBudget tight[] = {{MFRC_OP_SELECT, select->transactions - 1}, {MFRC_OP_READ, 1}};
+	CHECK(MFRC522_Accounting_CheckBudget(&acct, generous, 2) == 0);
+	CHECK(MFRC522_Accounting_CheckBudget(&acct, tight, 2) == 2);
+
+	// detached: nothing is counted any more
+	MFRC522_Accounting_Attach(NULL, &reader);
+	const uint32_t selectTransactions = select->transactions;
+	CHECK(!PICC_IsNewCardPresent_h(&reader));
+	CHECK(select->transactions == selectTransactions && acct.op[MFRC_OP_IS_NEW_CARD_PRESENT].calls == 2);
+} // End TestSession()
+
+int main(void) {
+	TestSession(PCD_CRC_COPROCESSOR);
+	TestSession(PCD_CRC_SOFTWARE);
+	TestSession(PCD_CRC_HARDWARE);
+	return HostTest_Summary("accounting");
+} // End main()
@@ -0,0 +1,130 @@
+/*
+ * test_classic.c - MIFARE_ReadCard_h() on Mini, 1K and 4K cards with key providers, and the key ring.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Classic.h"
+#include "MFRC522_KeyRing.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MIFARE_KeyRing ring;
+
+static const uint8_t uid4[4] = {0x11, 0x22, 0x33, 0x44};
+static const MIFARE_Key defaultKey = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+static const MIFARE_Key otherKey = {{1, 2, 3, 4, 5, 6}};
+
+// the default key first, then otherKey
+static bool TwoKeys(void *context, const Uid *uid, uint8_t sector, uint8_t attempt, uint8_t *command, MIFARE_Key *key) {
+	if (attempt > 1) {
+		return false;
+	}
+	*command = PICC_CMD_MF_AUTH_KEY_A;
+	*key = attempt ? otherKey : defaultKey;
+	return true;
+} // End TwoKeys()
+
+static MFRC522_SimCard *InsertCard(const enum MFRC522_SimCardType type, Uid *uid) {
+	MFRC522_Sim_Init(&sim);
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, type, uid4, 4);
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+	CHECK(HostTest_SelectCard(&reader, uid));
+	return card;
+} // End InsertCard()
+
+static void TestReadCard(const enum MFRC522_SimCardType type, const uint8_t piccType, const uint16_t blocks) {
+	static uint8_t data[4096];
+	Uid uid;
+	MFRC522_SimCard *card = InsertCard(type, &uid);
+	for (uint16_t b = 0; b < blocks; b++) {
+		if (!MIFARE_IsTrailerBlock(b)) {
+			for (uint8_t i = 0; i < 16; i++) {
+				card->memory[b * 16 + i] = b ^ i;
+			}
+		}
+	}
+	MFRC522_Sim_SetSectorKeys(card, 2, &otherKey, &otherKey);
+
+	// the default key only: sector 2 is missing, the rest is read
+	MIFARE_ClassicImage image = {.data = data, .dataSize = sizeof(data)};
+	MIFARE_Key key = defaultKey;
+	MIFARE_KeyProvider keys = MIFARE_KeyAProvider(&key);
+	CHECK_STATUS(STATUS_TIMEOUT, MIFARE_ReadCard_h(&reader, &uid, piccType, &keys, NULL, &image));
+	CHECK(image.sectorKey[2] == MIFARE_KEY_NONE && image.sectorKey[3] == 0);
+	CHECK(!MIFARE_ImageHasBlock(&image, 8) && MIFARE_ImageHasBlock(&image, 12));
+
+	// both keys, trailers skipped
+	MIFARE_KeyProvider twoKeys = {.getKey = TwoKeys};
+	uint8_t mask[32];
+	MIFARE_SetBlockMask(mask, piccType, false);
+	CHECK_STATUS(STATUS_OK, MIFARE_ReadCard_h(&reader, &uid, piccType, &twoKeys, mask, &image));
+	CHECK(image.sectorKey[2] == 1);
+	for (uint16_t b = 0; b < blocks; b++) {
+		CHECK(MIFARE_ImageHasBlock(&image, b) == !MIFARE_IsTrailerBlock(b));
+		if (!MIFARE_IsTrailerBlock(b)) {
+			CHECK(memcmp(&data[b * 16], &card->memory[b * 16], 16) == 0);
+		}
+	}
+	PICC_HaltA_h(&reader);
+	PCD_StopCrypto1_h(&reader);
+} // End TestReadCard()
+
+// 16 keys as A and B; every card has a different one per sector as key B and a wrong key A
+static void TestKeyRing(void) {
+	MIFARE_Key keys[16];
+	MIFARE_KeyRing_Init(&ring);
+	CHECK(MFRC_KEYRING_AUTH_TIMEOUT_US < PCD_GetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_AUTH));	// wrong keys fail faster
+	for (uint8_t k = 0; k < 16; k++) {
+		for (uint8_t j = 0; j < 6; j++) {
+			keys[k].keyByte[j] = k * 7 + j;
+		}
+		MIFARE_KeyRing_AddKey(&ring, &keys[k], PICC_CMD_MF_AUTH_KEY_A);
+		MIFARE_KeyRing_AddKey(&ring, &keys[k], PICC_CMD_MF_AUTH_KEY_B);
+	}
+	const MIFARE_Key wrongKey = {{0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xEE}};
+	static uint8_t data[1024];
+
+	for (uint8_t round = 0; round < 3; round++) {
+		for (uint8_t c = 0; c < 4; c++) {
+			MFRC522_Sim_Init(&sim);
+			const uint8_t uid[4] = {c, 1, 2, 3};
+			MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid, 4);
+			for (uint8_t s = 0; s < 16; s++) {
+				MFRC522_Sim_SetSectorKeys(card, s, &wrongKey, &keys[(c * 5 + s) % 16]);
+			}
+			CHECK(PCD_Init_h(&reader) == ESP_OK);
+			Uid selected;
+			CHECK(HostTest_SelectCard(&reader, &selected));
+
+			MIFARE_ClassicImage image = {.data = data, .dataSize = sizeof(data)};
+			MIFARE_KeyProvider provider = MIFARE_KeyRing_Provider(&ring);
+			CHECK_STATUS(STATUS_OK, MIFARE_ReadCard_h(&reader, &selected, PICC_TYPE_MIFARE_1K, &provider, NULL, &image));
+			CHECK(PCD_GetTimeoutUs_h(&reader) == 25000);		// the short authentication timeout is undone
+			PCD_StopCrypto1_h(&reader);
+
+			// the ring remembers the key of every sector
+			PICC_HaltA_h(&reader);
+			uint8_t atqa[2];
+			uint8_t atqaSize = sizeof(atqa);
+			PICC_WakeupA_h(&reader, atqa, &atqaSize);
+			PICC_Select_h(&reader, &selected, 0);
+			CHECK_STATUS(STATUS_OK, MIFARE_KeyRing_Authenticate_h(&reader, &ring, 5, &selected));
+			PCD_StopCrypto1_h(&reader);
+		}
+	}
+	uint32_t hits, misses, failures, attempts;
+	MIFARE_KeyRing_GetStats(&ring, &hits, &misses, &failures, &attempts);
+	printf("key ring: %u hits, %u misses, %u failures, %u attempts\n", hits, misses, failures, attempts);
+	CHECK(misses == 4 * 16);			// each card and sector once, in the first round
+	CHECK(hits > 2 * misses);
+	CHECK(MIFARE_KeyRing_GetHitRate(&ring) > 0.5f);
+} // End TestKeyRing()
+
+int main(void) {
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	TestReadCard(SIM_CARD_MIFARE_MINI, PICC_TYPE_MIFARE_MINI, 20);
+	TestReadCard(SIM_CARD_MIFARE_1K, PICC_TYPE_MIFARE_1K, 64);
+	TestReadCard(SIM_CARD_MIFARE_4K, PICC_TYPE_MIFARE_4K, 256);
+	TestKeyRing();
+	return HostTest_Summary("classic");
+} // End main()
@@ -0,0 +1,129 @@
+/*
+ * test_core.c - PCD_Init, select, authenticate, read, write and value blocks, HaltA, in every CRC mode and over both
+ * simulator routes (i2c functions and MFRC522_AttachSimulator_h()). Also the IRQ handler of MFRC522_InitWithIrq_h().
+ */
+
+#include "host_test.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static const uint8_t uid4[4] = {0x11, 0x22, 0x33, 0x44};
+static const uint8_t uid7[7] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6};
+
+static void TestClassic(const enum PCD_CRCMode mode, const bool viaI2c) {
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	if (viaI2c) {
+		MFRC522_Init_h(&reader, EspHost_I2cDevice(&sim), -1);
+	} else {
+		MFRC522_Init_h(&reader, NULL, -1);
+		MFRC522_AttachSimulator_h(&reader, &sim);
+	}
+	PCD_SetCRCMode_h(&reader, mode);
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	CHECK(uid.size == 4 && memcmp(uid.uidByte, uid4, 4) == 0 && uid.sak == 0x08);
+
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid));
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	for (uint8_t i = 0; i < 16; i++) {
+		buffer[i] = i + mode;
+	}
+	CHECK_STATUS(STATUS_OK, MIFARE_Write_h(&reader, 5, buffer, 16));
+	memset(buffer, 0, sizeof(buffer));
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 5, buffer, &size));
+	CHECK(size == (mode == PCD_CRC_HARDWARE ? 16 : 18) && buffer[3] == 3 + mode);	// HARDWARE strips the CRC_A
+
+	long value = 0;
+	CHECK_STATUS(STATUS_OK, MIFARE_SetValue_h(&reader, 6, 100));
+	CHECK_STATUS(STATUS_OK, MIFARE_Increment_h(&reader, 6, 5));
+	CHECK_STATUS(STATUS_OK, MIFARE_Transfer_h(&reader, 6));
+	CHECK_STATUS(STATUS_OK, MIFARE_GetValue_h(&reader, 6, &value));
+	CHECK(value == 105);
+
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	PCD_StopCrypto1_h(&reader);
+	CHECK(!PICC_IsNewCardPresent_h(&reader));		// halted: REQA gets no answer
+
+	// a wrong key: the card stays silent
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	CHECK_STATUS(STATUS_OK, PICC_WakeupA_h(&reader, atqa, &atqaSize));
+	CHECK(PICC_ReadCardSerial_h(&reader, &uid));
+	MIFARE_Key wrongKey = {{1, 2, 3, 4, 5, 6}};
+	CHECK_STATUS(STATUS_TIMEOUT, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &wrongKey, &uid));
+	PCD_StopCrypto1_h(&reader);
+
+	// and the card leaving the field
+	card->inField = false;
+	atqaSize = sizeof(atqa);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_WakeupA_h(&reader, atqa, &atqaSize));
+} // End TestClassic()
+
+static void TestUltralight(void) {
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_NTAG213, uid7, 7);
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	CHECK(uid.size == 7 && memcmp(uid.uidByte, uid7, 7) == 0);
+	const uint8_t page[4] = {9, 8, 7, 6};
+	CHECK_STATUS(STATUS_OK, MIFARE_Ultralight_Write_h(&reader, 5, page, 4));
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));
+	CHECK(memcmp(&buffer[4], page, 4) == 0);
+} // End TestUltralight()
+
+static void TestTwoCards(void) {
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	const uint8_t uidA[4] = {0x10, 0x20, 0x30, 0x40};
+	const uint8_t uidB[4] = {0x10, 0x21, 0x30, 0x40};		// collides from bit 8 on
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uidA, 4);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uidB, 4);
+	Uid first, second;
+	CHECK(HostTest_SelectCard(&reader, &first));
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	CHECK(HostTest_SelectCard(&reader, &second));
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	CHECK(memcmp(first.uidByte, second.uidByte, 4) != 0);
+	CHECK(memcmp(first.uidByte, uidA, 4) == 0 || memcmp(first.uidByte, uidB, 4) == 0);
+	CHECK(memcmp(second.uidByte, uidA, 4) == 0 || memcmp(second.uidByte, uidB, 4) == 0);
+	CHECK(!PICC_IsNewCardPresent_h(&reader));
+} // End TestTwoCards()
+
+static void TestIrqHandler(void) {
+	static MFRC522_Handle other;
+	const gpio_num_t pin = (gpio_num_t)4;
+	void *arg = NULL;
+
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	CHECK(MFRC522_InitWithIrq_h(&reader, EspHost_I2cDevice(&sim), -1, pin));
+	CHECK(EspHost_GpioIsrHandler(pin, &arg) != NULL && arg == &reader);
+
+	// the pin reused without MFRC522_Deinit_h(): the handler now belongs to the new reader
+	CHECK(MFRC522_InitWithIrq_h(&other, EspHost_I2cDevice(&sim), -1, pin));
+	CHECK(EspHost_GpioIsrHandler(pin, &arg) != NULL && arg == &other);
+
+	MFRC522_Deinit_h(&other);
+	CHECK(EspHost_GpioIsrHandler(pin, NULL) == NULL);
+	MFRC522_Deinit_h(&other);		// twice does nothing
+} // End TestIrqHandler()
+
+int main(void) {
+	const enum PCD_CRCMode modes[] = {PCD_CRC_COPROCESSOR, PCD_CRC_SOFTWARE, PCD_CRC_HARDWARE};
+	for (uint8_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		TestClassic(modes[i], false);
+		TestClassic(modes[i], true);
+	}
+	TestUltralight();
+	TestTwoCards();
+	TestIrqHandler();
+	return HostTest_Summary("core");
+} // End main()
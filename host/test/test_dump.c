@@ -0,0 +1,80 @@
+/*
+ * test_dump.c - the text of PICC_DumpToSerial_h(), byte for byte. The files in golden/ are the stdout of
+ * PICC_DumpToSerial() of the library before the dump writer, with its printf() per byte, on the cards of
+ * dump_cards.h. Also checks that the output is passed on in whole lines.
+ */
+
+#include <stdlib.h>
+
+#include "host_test.h"
+#include "dump_cards.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+typedef struct {
+	char text[32768];
+	size_t length;
+	uint32_t writes;
+	bool partialLine;			// a write that did not end with "\n"
+} Capture;
+
+static void CaptureWriter(void *ctx, const char *text, const size_t length) {
+	Capture *capture = ctx;
+	if (capture->length + length <= sizeof(capture->text)) {
+		memcpy(&capture->text[capture->length], text, length);
+	}
+	capture->length += length;
+	capture->writes++;
+	capture->partialLine |= length == 0 || text[length - 1] != '\n';
+} // End CaptureWriter()
+
+static size_t ReadGolden(const char *name, char *text, const size_t size) {
+	char path[512];
+	snprintf(path, sizeof(path), "%s/dump_%s.txt", MFRC_HOST_GOLDEN_DIR, name);
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		printf("cannot open %s\n", path);
+		return 0;
+	}
+	const size_t length = fread(text, 1, size, file);
+	fclose(file);
+	return length;
+} // End ReadGolden()
+
+static void TestCard(const size_t index, const enum PCD_CRCMode mode) {
+	static Capture capture;
+	static char golden[32768];
+	memset(&capture, 0, sizeof(capture));
+	const size_t goldenLength = ReadGolden(dumpCards[index].name, golden, sizeof(golden));
+	CHECK(goldenLength > 0);
+
+	HostTest_OpenReader(&reader, &sim, mode);
+	DumpTest_AddCard(&sim, index);
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	PCD_SetDumpWriter_h(&reader, CaptureWriter, &capture);
+	PICC_DumpToSerial_h(&reader, &uid);
+	PCD_SetDumpWriter_h(&reader, NULL, NULL);
+
+	CHECK(capture.length == goldenLength && memcmp(capture.text, golden, goldenLength) == 0);
+	if (capture.length != goldenLength || memcmp(capture.text, golden, goldenLength) != 0) {
+		size_t offset = 0;
+		while (offset < capture.length && offset < goldenLength && capture.text[offset] == golden[offset]) {
+			offset++;
+		}
+		printf("%s, CRC mode %d: %zu bytes instead of %zu, first difference at byte %zu\n",
+				dumpCards[index].name, mode, capture.length, goldenLength, offset);
+	}
+	CHECK(!capture.partialLine);
+} // End TestCard()
+
+int main(void) {
+	const enum PCD_CRCMode modes[] = {PCD_CRC_COPROCESSOR, PCD_CRC_SOFTWARE, PCD_CRC_HARDWARE};
+	for (uint8_t m = 0; m < 3; m++) {
+		for (size_t i = 0; i < DUMP_CARDS; i++) {
+			TestCard(i, modes[m]);
+		}
+	}
+	return HostTest_Summary("dump");
+} // End main()
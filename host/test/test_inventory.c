@@ -0,0 +1,148 @@
+/*
+ * test_inventory.c - PICC_Inventory_h(), also with a HLTA lost on the bus, and the step API select with up to
+ * MFRC522_SIM_MAX_CARDS cards in the field.
+ */
+
+#include <stdlib.h>
+
+#include "host_test.h"
+#include "MFRC522_Step.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+// Fills the field with count random 4 and 7 byte UID cards.
+static void AddRandomCards(const uint8_t count) {
+	MFRC522_Sim_Init(&sim);
+	for (uint8_t c = 0; c < count; c++) {
+		uint8_t uid[7];
+		const uint8_t size = (rand() % 2) ? 4 : 7;
+		for (uint8_t i = 0; i < size; i++) {
+			uid[i] = rand();
+		}
+		if (size == 7) {
+			uid[0] = 0x04;			// NXP
+			if (uid[3] == 0x88) {	// no cascade tag inside a UID
+				uid[3] = 0x12;
+			}
+		} else if (uid[0] == 0x88) {
+			uid[0] = 0x11;
+		}
+		CHECK(MFRC522_Sim_AddCard(&sim, size == 4 ? SIM_CARD_MIFARE_1K : SIM_CARD_NTAG213, uid, size) != NULL);
+	}
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+} // End AddRandomCards()
+
+static bool InField(const Uid *uid) {
+	for (uint8_t c = 0; c < sim.cardCount; c++) {
+		if (sim.cards[c].uidSize == uid->size && memcmp(sim.cards[c].uid, uid->uidByte, uid->size) == 0) {
+			return true;
+		}
+	}
+	return false;
+} // End InField()
+
+static void TestInventory(void) {
+	for (uint8_t count = 1; count <= MFRC522_SIM_MAX_CARDS; count++) {
+		for (uint8_t trial = 0; trial < 5; trial++) {
+			AddRandomCards(count);
+			Uid found[MFRC522_SIM_MAX_CARDS];
+			size_t foundCount = 0;
+			CHECK_STATUS(STATUS_OK, PICC_Inventory_h(&reader, found, MFRC522_SIM_MAX_CARDS, &foundCount, true));
+			CHECK(foundCount == count);
+			for (size_t f = 0; f < foundCount; f++) {
+				CHECK(InField(&found[f]));
+				for (size_t g = 0; g < f; g++) {
+					CHECK(found[g].size != found[f].size || memcmp(found[g].uidByte, found[f].uidByte, found[f].size) != 0);
+				}
+			}
+			// reactivated: each card can be selected by its UID
+			Uid uid = found[0];
+			CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, uid.size * 8));
+		}
+	}
+
+	// more cards than room
+	AddRandomCards(3);
+	Uid found[2];
+	size_t foundCount = 0;
+	CHECK_STATUS(STATUS_NO_ROOM, PICC_Inventory_h(&reader, found, 2, &foundCount, false));
+	CHECK(foundCount == 2);
+} // End TestInventory()
+
+// a HLTA that fails on the bus leaves its PICC selected: the next REQA sends it back to IDLE, the one after finds it
+// again. It is in out[] once, and every PICC is found.
+static void FillFailedHalt(void) {
+	const uint8_t uidA[4] = {0x12, 0x34, 0x56, 0x78};
+	const uint8_t uidB[7] = {0x04, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+	MFRC522_Sim_Init(&sim);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uidA, 4);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_NTAG213, uidB, 7);
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+} // End FillFailedHalt()
+
+static void TestFailedHalt(void) {
+	// the transactions of the first REQA and select
+	FillFailedHalt();
+	const uint32_t before = reader._i2cTransactions;
+	Uid uid;
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	PICC_RequestA_h(&reader, atqa, &atqaSize);
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	const uint32_t selectTransactions = reader._i2cTransactions - before;
+
+	// the same once more in PICC_Inventory_h(), then the first transaction of the HLTA fails
+	FillFailedHalt();
+	sim.failAfterTransactions = selectTransactions;
+	sim.failTransactions = 1;
+	Uid found[MFRC522_SIM_MAX_CARDS];
+	size_t foundCount = 0;
+	CHECK_STATUS(STATUS_OK, PICC_Inventory_h(&reader, found, MFRC522_SIM_MAX_CARDS, &foundCount, false));
+	CHECK(sim.failTransactions == 0);
+	CHECK(foundCount == 2);
+	CHECK(foundCount == 2 && found[0].size != found[1].size);
+} // End TestFailedHalt()
+
+// the step API walks through the same cards one REQA, select and HLTA at a time
+static void TestStepSelect(void) {
+	for (uint8_t trial = 0; trial < 20; trial++) {
+		const uint8_t count = 2 + trial % (MFRC522_SIM_MAX_CARDS - 1);
+		AddRandomCards(count);
+		uint8_t selected = 0;
+		for (;;) {
+			MFRC522_Op op;
+			uint8_t atqa[2];
+			uint8_t atqaSize = sizeof(atqa);
+			enum StatusCode status = PICC_BeginRequestA(&op, &reader, atqa, &atqaSize);
+			while (status == STATUS_PENDING) {
+				status = MFRC522_Op_Poll(&op);
+			}
+			if (status == STATUS_TIMEOUT) {
+				break;
+			}
+			Uid uid;
+			status = PICC_BeginSelect(&op, &reader, &uid);
+			while (status == STATUS_PENDING) {
+				status = MFRC522_Op_Poll(&op);
+			}
+			CHECK_STATUS(STATUS_OK, status);
+			if (status != STATUS_OK) {
+				break;
+			}
+			CHECK(InField(&uid));
+			selected++;
+			PICC_HaltA_h(&reader);
+		}
+		CHECK(selected == count);
+	}
+} // End TestStepSelect()
+
+int main(void) {
+	srand(7);
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	TestInventory();
+	TestFailedHalt();
+	TestStepSelect();
+	return HostTest_Summary("inventory");
+} // End main()
@@ -0,0 +1,61 @@
+/*
+ * test_log.c - the deferred log ring (MFRC522_Log.h): records of failed i2c transactions, the burst limit per site
+ * and period, the suppressed count, and dropping when the ring is full.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Log.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+int main(void) {
+	MFRC522_LogRecord record;
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	CHECK(!MFRC522_Log_Pop(&record));
+
+	// twelve failed writes: only the burst of the site is recorded
+	sim.failTransactions = 12;
+	for (uint8_t i = 0; i < 12; i++) {
+		PCD_WriteRegister_h(&reader, TxModeReg, 0x80 + i);
+	}
+	uint8_t records = 0;
+	while (MFRC522_Log_Pop(&record)) {
+		CHECK(strcmp(record.function, "PCD_WriteRegister_h") == 0);
+		CHECK(record.reg == TxModeReg && record.value == 0x80 + records);
+		CHECK(record.err == ESP_FAIL && record.suppressed == 0 && record.dev == &reader);
+		records++;
+	}
+	CHECK(records == MFRC_LOG_SITE_BURST);
+
+	// the next period: the first record carries the suppressed count
+	vTaskDelay(pdMS_TO_TICKS(MFRC_LOG_SITE_PERIOD_MS));
+	sim.failTransactions = 2;
+	uint8_t value;
+	PCD_WriteRegister_h(&reader, TxModeReg, 1);
+	PCD_ReadRegister_h(&reader, TxModeReg, &value);
+	CHECK(MFRC522_Log_Pop(&record) && record.suppressed == 12 - MFRC_LOG_SITE_BURST);
+	CHECK(MFRC522_Log_Pop(&record) && strcmp(record.function, "PCD_ReadRegister_h") == 0);
+	CHECK(record.value == 0 && record.length == 1);
+
+	const uint8_t data[3] = {7, 8, 9};
+	sim.failTransactions = 1;
+	PCD_WriteRegisterData_h(&reader, FIFODataReg, 3, data);
+	CHECK(MFRC522_Log_Pop(&record) && strcmp(record.function, "PCD_WriteRegisterSegments_h") == 0);
+	CHECK(record.value == 9 && record.length == 3);
+
+	// ten periods of a full burst, not drained: the ring keeps the first records, the rest is dropped
+	for (uint8_t p = 0; p < 10; p++) {
+		vTaskDelay(pdMS_TO_TICKS(MFRC_LOG_SITE_PERIOD_MS));
+		sim.failTransactions = MFRC_LOG_SITE_BURST;
+		for (uint8_t i = 0; i < MFRC_LOG_SITE_BURST; i++) {
+			PCD_WriteRegister_h(&reader, TxModeReg, i);
+		}
+	}
+	CHECK(MFRC522_Log_Drain() == MFRC_LOG_RING_SIZE);
+	CHECK(MFRC522_Log_Dropped() == 10 * MFRC_LOG_SITE_BURST - MFRC_LOG_RING_SIZE);
+	CHECK(MFRC522_Log_Drain() == 0);
+
+	CHECK(!MFRC522_Log_StartTask(1, 3072));		// no tasks on the host
+	return HostTest_Summary("log");
+} // End main()
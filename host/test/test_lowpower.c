@@ -0,0 +1,72 @@
+/*
+ * test_lowpower.c - low-power card detection (MFRC522_LowPower.h) in both sleep modes: an empty field, a card
+ * arriving, a halted card after the hold-off, and the reader woken for normal use.
+ */
+
+#include "host_test.h"
+#include "MFRC522_LowPower.h"
+
+#include <esp_timer.h>
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_LowPower lp;
+
+static void TestMode(const enum MFRC522_LowPowerMode mode) {
+	MFRC522_LowPowerConfig config;
+	MFRC522_LowPowerStats stats;
+	MFRC522_LowPower_DefaultConfig(&config);
+	config.mode = mode;
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	MFRC522_LowPower_Init(&lp, &reader, &config);
+
+	// ten seconds of an empty field: a wake-up per interval, the field mostly off
+	CHECK_STATUS(STATUS_TIMEOUT, MFRC522_LowPower_WaitForCard(&lp, pdMS_TO_TICKS(10000)));
+	MFRC522_LowPower_GetStats(&lp, &stats);
+	CHECK(stats.detections == 0);
+	CHECK(stats.wakeups >= 10000 / (config.intervalMs + 20) && stats.wakeups <= 10000 / config.intervalMs + 1);
+	CHECK(stats.probes >= stats.wakeups * config.burst);
+	CHECK(stats.dutyCycle < 0.05f);
+	CHECK(sim.fieldOnUs < 500000);
+	if (mode == MFRC522_LOWPOWER_SOFT_POWERDOWN) {
+		CHECK(stats.avgWakeUs > 0);				// the oscillator start-up of the simulator
+		CHECK(sim.powerDownUs > 9000000);
+	}
+
+	// a card arrives: found at the next wake-up
+	const uint8_t uid4[4] = {1, 2, 3, 4};
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	int64_t start = esp_timer_get_time();
+	CHECK_STATUS(STATUS_OK, MFRC522_LowPower_WaitForCard(&lp, portMAX_DELAY));
+	CHECK(esp_timer_get_time() - start <= (config.intervalMs + 10) * 1000);
+	Uid uid;
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	CHECK(memcmp(uid.uidByte, uid4, 4) == 0);
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+
+	// it stays, halted: nothing while polling at full rate, then sleeping resets it and it is found again
+	start = esp_timer_get_time();
+	CHECK_STATUS(STATUS_OK, MFRC522_LowPower_WaitForCard(&lp, portMAX_DELAY));
+	CHECK(esp_timer_get_time() - start >= (config.holdOffMs - 100) * 1000);
+
+	// gone
+	sim.cardCount = 0;
+	CHECK_STATUS(STATUS_TIMEOUT, MFRC522_LowPower_WaitForCard(&lp, pdMS_TO_TICKS(1000)));
+	MFRC522_LowPower_GetStats(&lp, &stats);
+	CHECK(stats.detections == 2);
+
+	// awake again for normal use
+	CHECK(MFRC522_LowPower_Wake(&lp) == ESP_OK);
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_RequestA_h(&reader, atqa, &atqaSize));
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	atqaSize = sizeof(atqa);
+	CHECK_STATUS(STATUS_OK, PICC_RequestA_h(&reader, atqa, &atqaSize));
+} // End TestMode()
+
+int main(void) {
+	TestMode(MFRC522_LOWPOWER_SOFT_POWERDOWN);
+	TestMode(MFRC522_LOWPOWER_ANTENNA_OFF);
+	return HostTest_Summary("lowpower");
+} // End main()
@@ -0,0 +1,57 @@
+/*
+ * test_pool.c - the reader pool, driven through MFRC522_Pool_Service() since the host has no tasks.
+ */
+
+#include "host_test.h"
+#include "MFRC522_ReaderPool.h"
+
+#include <esp_timer.h>
+
+#define READERS 4
+
+static MFRC522_Sim sims[READERS];
+static MFRC522_Handle readers[READERS];
+static MFRC522_ReaderPool pool;
+
+int main(void) {
+	const uint8_t uid[4] = {1, 2, 3, 4};
+	for (uint8_t i = 0; i < READERS; i++) {
+		HostTest_OpenReader(&readers[i], &sims[i], MFRC_DEFAULT_CRC_MODE);
+	}
+	MFRC522_Sim_AddCard(&sims[2], SIM_CARD_MIFARE_1K, uid, 4);
+
+	CHECK(MFRC522_Pool_Init(&pool, 8));
+	for (uint8_t i = 0; i < READERS; i++) {
+		CHECK(MFRC522_Pool_AddReader(&pool, &readers[i], 0) == i);
+	}
+	CHECK(!MFRC522_Pool_Start(&pool, 5, 4096));		// no tasks on the host
+
+	// one second of polling
+	const int64_t start = esp_timer_get_time();
+	while (esp_timer_get_time() - start < 1000000) {
+		if (MFRC522_Pool_Service(&pool, 0) == 0) {
+			vTaskDelay(1);
+		}
+	}
+
+	MFRC522_PoolEvent event;
+	uint32_t events = 0;
+	while (MFRC522_Pool_GetEvent(&pool, &event, 0)) {
+		CHECK(event.readerId == 2);
+		CHECK(event.uid.size == 4 && memcmp(event.uid.uidByte, uid, 4) == 0);
+		CHECK(event.timestampUs >= start);
+		events++;
+	}
+	CHECK(events >= 1);
+
+	for (uint8_t i = 0; i < READERS; i++) {
+		uint32_t scans, cards, errors, scanIntervalUs;
+		CHECK(MFRC522_Pool_GetReaderStats(&pool, i, &scans, &cards, &errors, &scanIntervalUs));
+		printf("reader %u: %u scans, %u cards, %u errors, %u us between scans\n", i, scans, cards, errors, scanIntervalUs);
+		CHECK(scans > 10);
+		CHECK(errors == 0);
+		CHECK(cards == (i == 2 ? events : 0));
+	}
+	CHECK(MFRC522_Pool_GetScansPerSecond(&pool) > 0);
+	return HostTest_Summary("pool");
+} // End main()
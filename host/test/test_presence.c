@@ -0,0 +1,112 @@
+/*
+ * test_presence.c - card presence tracking (MFRC522_Presence.h): arrival with debounce, staying, a lost poll,
+ * removal, a bouncing card, and a Classic card the application authenticates between polls. Also PICC_Reselect_h(),
+ * which it is built on.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Presence.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_Presence presence;
+
+static const uint8_t uid7[7] = {4, 1, 2, 3, 4, 5, 6};
+
+// a PICC entering the field powers up in IDLE
+static void Enter(MFRC522_SimCard *card) {
+	card->inField = true;
+	card->_state = 0;
+} // End Enter()
+
+static enum MFRC522_PresenceEvent Poll(Uid *uid) {
+	const enum MFRC522_PresenceEvent event = MFRC522_Presence_Poll(&presence, uid);
+	vTaskDelay(pdMS_TO_TICKS(50));
+	return event;
+} // End Poll()
+
+static void TestTracking(void) {
+	Uid uid;
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	MFRC522_Presence_Init(&presence, &reader, NULL);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_NTAG213, uid7, 7);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);			// debounce
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_ARRIVED);
+	CHECK(uid.size == 7 && memcmp(uid.uidByte, uid7, 7) == 0);
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));	// selected after the event
+	for (uint8_t i = 0; i < 20; i++) {
+		CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	}
+	CHECK(MFRC522_Presence_IsPresent(&presence, NULL));
+
+	// a single lost poll is no removal
+	card->inField = false;
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	card->inField = true;
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+
+	card->inField = false;
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_REMOVED);
+	CHECK(memcmp(uid.uidByte, uid7, 7) == 0);
+	CHECK(!MFRC522_Presence_IsPresent(&presence, NULL));
+
+	// in the field for one poll only
+	Enter(card);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	card->inField = false;
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	Enter(card);
+	Poll(&uid);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_ARRIVED);
+
+	// a Classic card, authenticated by the application between the polls
+	card->inField = false;
+	for (uint8_t i = 0; i < 3; i++) {
+		Poll(&uid);
+	}
+	const uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	Poll(&uid);
+	CHECK(Poll(&uid) == MFRC522_PRESENCE_ARRIVED && uid.size == 4);
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid));
+	size = sizeof(buffer);
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));
+	for (uint8_t i = 0; i < 5; i++) {
+		CHECK(Poll(&uid) == MFRC522_PRESENCE_NONE);
+	}
+
+	MFRC522_PresenceStats stats;
+	MFRC522_Presence_GetStats(&presence, &stats);
+	CHECK(stats.arrivals == 3 && stats.removals == 2 && stats.bounces == 1);
+	CHECK(stats.lastConfirmTransactions < stats.lastSelectTransactions);
+} // End TestTracking()
+
+static void TestReselect(void) {
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_NTAG213, uid7, 7);
+	Uid uid;
+	CHECK_STATUS(STATUS_OK, PICC_ProbeWakeup_h(&reader, NULL));
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	for (uint8_t i = 0; i < 3; i++) {
+		CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+		CHECK_STATUS(STATUS_OK, PICC_Reselect_h(&reader, &uid));
+	}
+	// another UID does not answer
+	Uid other = uid;
+	other.uidByte[6] ^= 0xFF;
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	CHECK(PICC_Reselect_h(&reader, &other) != STATUS_OK);
+} // End TestReselect()
+
+int main(void) {
+	TestTracking();
+	TestReselect();
+	return HostTest_Summary("presence");
+} // End main()
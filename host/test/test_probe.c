@@ -0,0 +1,71 @@
+/*
+ * test_probe.c - the presence probe PICC_ProbePresence_h(): its transactions on an empty field, a card that answers,
+ * staging its registers again after another command, and polling ComIrqReg when the timer period is below one tick.
+ */
+
+#include "host_test.h"
+
+#include <esp_timer.h>
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static void TestProbe(void) {
+	uint32_t transactions = 0;
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_ProbePresence_h(&reader, &transactions));
+	for (uint8_t i = 0; i < 10; i++) {
+		const uint32_t before = sim.i2cTransactions;
+		CHECK_STATUS(STATUS_TIMEOUT, PICC_ProbePresence_h(&reader, &transactions));
+		CHECK(sim.i2cTransactions - before == transactions);
+	}
+	CHECK(transactions == 7);							// once staged: six writes and one read after the sleep
+
+	const uint8_t uid4[4] = {1, 2, 3, 4};
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	CHECK_STATUS(STATUS_OK, PICC_ProbePresence_h(&reader, &transactions));
+	Uid uid;
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	CHECK(memcmp(uid.uidByte, uid4, 4) == 0);
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	CHECK(!PICC_IsNewCardPresent_h(&reader));
+
+	// another command in between: the probe stages its registers again
+	MFRC522_Sim_Init(&sim);
+	PCD_SetBitRate_h(&reader, PCD_BITRATE_212, PCD_BITRATE_212);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_ProbePresence_h(&reader, &transactions));
+} // End TestProbe()
+
+// a timer period below one tick: ComIrqReg is polled, and the first TimerIRq or RxIRq ends the probe
+static void TestProbeBelowTick(void) {
+	uint32_t transactions = 0;
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	PCD_SetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_REQA, 500);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_ProbePresence_h(&reader, &transactions));
+	int64_t start = esp_timer_get_time();
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_ProbePresence_h(&reader, &transactions));
+	const int64_t emptyUs = esp_timer_get_time() - start;
+	const uint32_t empty = transactions;
+	CHECK(empty > 7);
+
+	const uint8_t uid4[4] = {1, 2, 3, 4};
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uid4, 4);
+	start = esp_timer_get_time();
+	CHECK_STATUS(STATUS_OK, PICC_ProbePresence_h(&reader, &transactions));
+	CHECK(transactions < empty && esp_timer_get_time() - start < emptyUs);	// the ATQA came before the timer ran out
+	Uid uid;
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	CHECK(!PICC_IsNewCardPresent_h(&reader));
+	CHECK_STATUS(STATUS_OK, PICC_ProbeWakeup_h(&reader, NULL));
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+	CHECK_STATUS(STATUS_OK, PICC_HaltA_h(&reader));
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_NTAG213, (const uint8_t[7]){4, 1, 2, 3, 4, 5, 6}, 7);
+	CHECK(PICC_IsNewCardPresent_h(&reader));			// a 16 bit ATQA
+} // End TestProbeBelowTick()
+
+int main(void) {
+	TestProbe();
+	TestProbeBelowTick();
+	return HostTest_Summary("probe");
+} // End main()
@@ -0,0 +1,61 @@
+/*
+ * test_segments.c - scatter-gather FIFO uploads: PCD_MIFARE_TransceiveSegments_h() with a WRITE split over several
+ * segments, over both simulator routes and in every CRC mode.
+ */
+
+#include "host_test.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static void TestWrite(const bool viaI2c) {
+	const uint8_t id[4] = {1, 2, 3, 4};
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	if (viaI2c) {
+		MFRC522_Init_h(&reader, EspHost_I2cDevice(&sim), -1);
+	} else {
+		MFRC522_Init_h(&reader, NULL, -1);
+		MFRC522_AttachSimulator_h(&reader, &sim);
+	}
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, id, 4);
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+
+	for (uint8_t mode = PCD_CRC_COPROCESSOR; mode <= PCD_CRC_HARDWARE; mode++) {
+		PCD_SetCRCMode_h(&reader, (enum PCD_CRCMode)mode);
+		Uid uid;
+		uint8_t atqa[2];
+		uint8_t atqaSize = sizeof(atqa);
+		PICC_WakeupA_h(&reader, atqa, &atqaSize);
+		CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+		MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+		CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid));
+
+		uint8_t block[16];
+		for (uint8_t i = 0; i < 16; i++) {
+			block[i] = i * mode + 1 + viaI2c;
+		}
+		// WRITE: command and address, then the block in two halves
+		const uint8_t command[2] = {PICC_CMD_MF_WRITE, 6};
+		const PCD_Segment commandSegments[] = {{command, 2}};
+		const PCD_Segment dataSegments[] = {{block, 8}, {block + 8, 8}};
+		CHECK_STATUS(STATUS_OK, PCD_MIFARE_TransceiveSegments_h(&reader, commandSegments, 1, false));
+		CHECK_STATUS(STATUS_OK, PCD_MIFARE_TransceiveSegments_h(&reader, dataSegments, 2, false));
+		uint8_t buffer[18];
+		uint8_t size = sizeof(buffer);
+		CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 6, buffer, &size));
+		CHECK(memcmp(buffer, block, 16) == 0);
+
+		const PCD_Segment tooMany[4] = {{block, 1}, {block, 1}, {block, 1}, {block, 1}};
+		CHECK_STATUS(STATUS_INVALID, PCD_MIFARE_TransceiveSegments_h(&reader, tooMany, 4, false));
+
+		PICC_HaltA_h(&reader);
+		PCD_StopCrypto1_h(&reader);
+	}
+} // End TestWrite()
+
+int main(void) {
+	TestWrite(false);
+	TestWrite(true);
+	return HostTest_Summary("segments");
+} // End main()
@@ -0,0 +1,108 @@
+/*
+ * test_stats.c - latency histograms and status counters (MFRC522_Stats.h), and snapshots taken while another
+ * thread records.
+ */
+
+#include <pthread.h>
+
+#include "host_test.h"
+#include "MFRC522_Stats.h"
+
+#define RECORDS 2000000
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+static MFRC522_Stats stats;
+
+static MFRC522_Handle otherReader;
+static MFRC522_Stats otherStats;
+static volatile bool writerDone;
+
+static uint32_t Samples(const MFRC522_StatsCounters *counters, const uint8_t latency) {
+	uint32_t samples = 0;
+	for (uint8_t b = 0; b < MFRC_STATS_LATENCY_BUCKETS; b++) {
+		samples += counters->latency[latency][b];
+	}
+	return samples;
+} // End Samples()
+
+static void TestCounters(void) {
+	MFRC522_StatsCounters counters;
+	MFRC522_Sim_Init(&sim);
+	EspHost_AddSim(&sim);
+	MFRC522_Init_h(&reader, NULL, -1);
+	MFRC522_AttachSimulator_h(&reader, &sim);
+	MFRC522_Stats_Attach(&stats, &reader);
+	CHECK(PCD_Init_h(&reader) == ESP_OK);
+
+	for (uint8_t i = 0; i < 20; i++) {
+		CHECK(!PICC_IsNewCardPresent_h(&reader));
+	}
+	const uint8_t uidA[4] = {1, 2, 3, 4};
+	const uint8_t uidB[4] = {5, 6, 7, 8};
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uidA, 4);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, uidB, 4);
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid));
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));
+	CHECK_STATUS(STATUS_OK, MIFARE_Write_h(&reader, 5, (uint8_t[16]){0}, 16));
+	sim.failTransactions = 1;
+	size = sizeof(buffer);
+	CHECK(MIFARE_Read_h(&reader, 4, buffer, &size) != STATUS_OK);
+
+	MFRC522_Stats_Snapshot(&stats, &counters);
+	MFRC522_Stats_Print(&counters);
+	CHECK(Samples(&counters, MFRC_LATENCY_REQA) == 21);
+	CHECK(Samples(&counters, MFRC_LATENCY_AUTH) == 1);
+	CHECK(counters.errorReg[3] >= 1);				// CollErr: anticollision of the two cards
+	CHECK(counters.i2cErrors[MFRC_I2C_ERR_FAIL] == 1);
+	CHECK(counters.status[STATUS_OK] >= 3);
+	CHECK(MFRC522_Stats_Percentile(&counters, MFRC_LATENCY_AUTH, 50) >= 1024);
+
+	MFRC522_Stats_Reset(&stats);
+	MFRC522_Stats_Snapshot(&stats, &counters);
+	CHECK(counters.status[STATUS_OK] == 0 && counters.i2cErrors[MFRC_I2C_ERR_FAIL] == 0);
+	size = sizeof(buffer);
+	MIFARE_Read_h(&reader, 4, buffer, &size);
+	MFRC522_Stats_Snapshot(&stats, &counters);
+	CHECK(Samples(&counters, MFRC_LATENCY_READ) == 1);
+} // End TestCounters()
+
+static void *Writer(void *arg) {
+	for (uint32_t i = 0; i < RECORDS; i++) {
+		MFRC522_Stats_RecordStatus(&otherReader, STATUS_OK);
+	}
+	writerDone = true;
+	return NULL;
+} // End Writer()
+
+// a snapshot never goes backwards, whatever the writer is doing
+static void TestConcurrentSnapshots(void) {
+	MFRC522_StatsCounters counters;
+	MFRC522_Stats_Attach(&otherStats, &otherReader);
+	pthread_t writer;
+	CHECK(pthread_create(&writer, NULL, Writer, NULL) == 0);
+	uint32_t last = 0;
+	uint32_t snapshots = 0;
+	while (!writerDone) {
+		MFRC522_Stats_Snapshot(&otherStats, &counters);
+		CHECK(counters.status[STATUS_OK] >= last);
+		last = counters.status[STATUS_OK];
+		if (++snapshots % 100 == 0) {
+			MFRC522_Stats_Reset(&otherStats);
+			last = 0;
+		}
+	}
+	pthread_join(writer, NULL);
+	CHECK(otherStats.live.status[STATUS_OK] == RECORDS);
+} // End TestConcurrentSnapshots()
+
+int main(void) {
+	TestCounters();
+	TestConcurrentSnapshots();
+	return HostTest_Summary("stats");
+} // End main()
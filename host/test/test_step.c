@@ -0,0 +1,115 @@
+/*
+ * test_step.c - the non-blocking step API (MFRC522_Step.h): REQA on four readers interleaved, select,
+ * authenticate, read and write, in every CRC mode.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Step.h"
+
+#define READERS 4
+
+static MFRC522_Sim sims[READERS];
+static MFRC522_Handle readers[READERS];
+
+static const uint8_t uid4[4] = {1, 2, 3, 4};
+static const uint8_t uid7[7] = {4, 5, 6, 7, 8, 9, 10};
+
+static enum StatusCode Run(MFRC522_Op *op) {
+	enum StatusCode status;
+	while ((status = MFRC522_Op_Poll(op)) == STATUS_PENDING) {
+	}
+	return status;
+} // End Run()
+
+static void TestInterleaved(const enum PCD_CRCMode mode) {
+	for (uint8_t i = 0; i < READERS; i++) {
+		HostTest_OpenReader(&readers[i], &sims[i], mode);
+	}
+	MFRC522_Sim_AddCard(&sims[1], SIM_CARD_MIFARE_1K, uid4, 4);
+	MFRC522_Sim_AddCard(&sims[3], SIM_CARD_NTAG213, uid7, 7);
+
+	// one REQA per reader, all in flight at the same time
+	MFRC522_Op ops[READERS];
+	uint8_t atqa[READERS][2];
+	uint8_t atqaSize[READERS];
+	enum StatusCode result[READERS];
+	for (uint8_t i = 0; i < READERS; i++) {
+		atqaSize[i] = 2;
+		CHECK_STATUS(STATUS_PENDING, PICC_BeginRequestA(&ops[i], &readers[i], atqa[i], &atqaSize[i]));
+	}
+	for (uint8_t done = 0; done < READERS; ) {
+		for (uint8_t i = 0; i < READERS; i++) {
+			if (ops[i].status == STATUS_PENDING && (result[i] = MFRC522_Op_Poll(&ops[i])) != STATUS_PENDING) {
+				done++;
+			}
+		}
+	}
+	CHECK(result[0] == STATUS_TIMEOUT && result[1] == STATUS_OK && result[2] == STATUS_TIMEOUT && result[3] == STATUS_OK);
+	CHECK(atqa[1][0] == 0x04 && atqa[3][0] == 0x44);
+
+	Uid uid, uidNtag;
+	CHECK_STATUS(STATUS_PENDING, PICC_BeginSelect(&ops[1], &readers[1], &uid));
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	CHECK(uid.size == 4 && memcmp(uid.uidByte, uid4, 4) == 0 && uid.sak == 0x08);
+	CHECK_STATUS(STATUS_PENDING, PICC_BeginSelect(&ops[3], &readers[3], &uidNtag));
+	CHECK_STATUS(STATUS_OK, Run(&ops[3]));
+	CHECK(uidNtag.size == 7 && memcmp(uidNtag.uidByte, uid7, 7) == 0 && uidNtag.sak == 0x00);
+
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	PCD_BeginAuthenticate(&ops[1], &readers[1], PICC_CMD_MF_AUTH_KEY_A, 4, &key, &uid);
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	uint8_t data[16];
+	for (uint8_t i = 0; i < 16; i++) {
+		data[i] = 0x30 + i;
+	}
+	CHECK_STATUS(STATUS_PENDING, MIFARE_BeginWrite(&ops[1], &readers[1], 5, data, 16));
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	MIFARE_BeginRead(&ops[1], &readers[1], 5, buffer, &size);
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	CHECK(size == 18 && memcmp(buffer, data, 16) == 0);		// the step API always computes CRC_A itself
+
+	// on the NTAG this is a COMPATIBILITY_WRITE: only the first 4 of the 16 bytes are stored
+	CHECK_STATUS(STATUS_PENDING, MIFARE_BeginWrite(&ops[3], &readers[3], 4, data, 16));
+	CHECK_STATUS(STATUS_OK, Run(&ops[3]));
+	size = sizeof(buffer);
+	MIFARE_BeginRead(&ops[3], &readers[3], 4, buffer, &size);
+	CHECK_STATUS(STATUS_OK, Run(&ops[3]));
+	CHECK(memcmp(buffer, data, 4) == 0);
+
+	// a wrong key times out
+	MIFARE_Key wrongKey = {{1, 1, 1, 1, 1, 1}};
+	PICC_HaltA_h(&readers[1]);
+	PCD_StopCrypto1_h(&readers[1]);
+	atqaSize[1] = 2;
+	PICC_BeginWakeupA(&ops[1], &readers[1], atqa[1], &atqaSize[1]);
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	PICC_BeginSelect(&ops[1], &readers[1], &uid);
+	CHECK_STATUS(STATUS_OK, Run(&ops[1]));
+	PCD_BeginAuthenticate(&ops[1], &readers[1], PICC_CMD_MF_AUTH_KEY_A, 4, &wrongKey, &uid);
+	CHECK_STATUS(STATUS_TIMEOUT, Run(&ops[1]));
+} // End TestInterleaved()
+
+// PICC_BeginRequestA() after a T=CL exchange at a higher bit rate: REQA is only answered at 106 kbit/s.
+static void TestRequestAfterBitRateChange(void) {
+	HostTest_OpenReader(&readers[0], &sims[0], MFRC_DEFAULT_CRC_MODE);
+	MFRC522_Sim_AddCard(&sims[0], SIM_CARD_MIFARE_1K, uid4, 4);
+	CHECK(PCD_SetBitRate_h(&readers[0], PCD_BITRATE_424, PCD_BITRATE_424) == ESP_OK);
+	MFRC522_Op op;
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	PICC_BeginRequestA(&op, &readers[0], atqa, &atqaSize);
+	CHECK_STATUS(STATUS_OK, Run(&op));
+	enum PCD_BitRate tx, rx;
+	PCD_GetBitRate_h(&readers[0], &tx, &rx);
+	CHECK(tx == PCD_BITRATE_106 && rx == PCD_BITRATE_106);
+} // End TestRequestAfterBitRateChange()
+
+int main(void) {
+	TestInterleaved(PCD_CRC_COPROCESSOR);
+	TestInterleaved(PCD_CRC_SOFTWARE);
+	TestInterleaved(PCD_CRC_HARDWARE);
+	TestRequestAfterBitRateChange();
+	return HostTest_Summary("step");
+} // End main()
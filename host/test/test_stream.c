@@ -0,0 +1,64 @@
+/*
+ * test_stream.c - PCD_TransceiveStream_h(): frames longer than the 64 byte FIFO, sent and received, in every CRC mode.
+ */
+
+#include "host_test.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+// nobody answers, but the simulator has seen the whole frame go through the FIFO
+static void TestSend(const enum PCD_CRCMode mode) {
+	uint8_t frame[256];
+	for (uint16_t i = 0; i < sizeof(frame); i++) {
+		frame[i] = i;
+	}
+	HostTest_OpenReader(&reader, &sim, mode);
+	for (uint16_t length = 10; length <= 256; length += 123) {
+		uint8_t back[64];
+		uint16_t backLen = sizeof(back);
+		CHECK_STATUS(STATUS_TIMEOUT, PCD_TransceiveStream_h(&reader, frame, length, back, &backLen, NULL, true));
+		// the FIFO gets the CRC_A too, unless the MFRC522 appends it on the air (TxCRCEn)
+		CHECK(sim._txLen == length + (mode == PCD_CRC_HARDWARE ? 0 : 2));
+		CHECK(memcmp(sim._txBuf, frame, length) == 0);
+	}
+} // End TestSend()
+
+// a T=CL card sends 203 bytes back to a READ BINARY of 200 bytes
+static void TestReceive(const enum PCD_CRCMode mode) {
+	const uint8_t id[7] = {4, 1, 2, 3, 4, 5, 6};
+	HostTest_OpenReader(&reader, &sim, mode);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_ISO14443_4, id, 7);
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+
+	uint8_t back[256];
+	uint16_t backLen = sizeof(back);
+	const uint8_t rats[2] = {0xE0, 0x80};		// FSD 256, CID 0
+	CHECK_STATUS(STATUS_OK, PCD_TransceiveStream_h(&reader, rats, sizeof(rats), back, &backLen, NULL, true));
+	CHECK(backLen == 6 && back[0] == 6);
+
+	const uint8_t readBinary[6] = {0x02, 0x00, 0xB0, 0x00, 0x00, 200};
+	backLen = sizeof(back);
+	CHECK_STATUS(STATUS_OK, PCD_TransceiveStream_h(&reader, readBinary, sizeof(readBinary), back, &backLen, NULL, true));
+	CHECK(backLen == 1 + 200 + 2 && back[0] == 0x02);
+	bool ok = true;
+	for (uint16_t i = 0; i < 200; i++) {
+		ok &= back[1 + i] == (uint8_t)i;
+	}
+	CHECK(ok && back[201] == 0x90 && back[202] == 0x00);
+
+	// the same with too small a buffer
+	const uint8_t readAgain[6] = {0x03, 0x00, 0xB0, 0x00, 0x00, 200};
+	backLen = 100;
+	CHECK_STATUS(STATUS_NO_ROOM, PCD_TransceiveStream_h(&reader, readAgain, sizeof(readAgain), back, &backLen, NULL, true));
+} // End TestReceive()
+
+int main(void) {
+	const enum PCD_CRCMode modes[] = {PCD_CRC_COPROCESSOR, PCD_CRC_SOFTWARE, PCD_CRC_HARDWARE};
+	for (uint8_t m = 0; m < 3; m++) {
+		TestSend(modes[m]);
+		TestReceive(modes[m]);
+	}
+	return HostTest_Summary("stream");
+} // End main()
@@ -0,0 +1,143 @@
+/*
+ * test_tcl.c - ISO/IEC 14443-4 (T=CL): RATS, I-block chaining both ways, WTX, PPS to 212/424/848 kbit/s and
+ * DESELECT, with and without CID, in every CRC mode. Also the per-command timeouts (frame waiting times).
+ */
+
+#include "host_test.h"
+#include "MFRC522_TCL.h"
+
+#include <esp_timer.h>
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static const uint8_t uid7[7] = {4, 1, 2, 3, 4, 5, 6};
+static const uint8_t readBinary[5] = {0x00, 0xB0, 0x00, 0x00, 0x00};	// 256 bytes
+static uint32_t timeoutBefore;			// PCD_TIMEOUT_ISO14443_4 before TCL_Activate_h()
+
+static MFRC522_SimCard *Activate(MFRC522_TCL *tcl, const enum PCD_CRCMode mode, const enum PCD_BitRate maxBitRate, const uint8_t cid) {
+	HostTest_OpenReader(&reader, &sim, mode);
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, SIM_CARD_ISO14443_4, uid7, 7);
+	PCD_SetMaxBitRate_h(&reader, maxBitRate);
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	CHECK(PICC_GetType(uid.sak) == PICC_TYPE_ISO_14443_4);
+	timeoutBefore = PCD_GetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_ISO14443_4);
+	CHECK_STATUS(STATUS_OK, TCL_Activate_h(&reader, tcl, cid));
+	return card;
+} // End Activate()
+
+// READ BINARY of 256 bytes (chained response) and an echo of 300 bytes (chained both ways)
+static void CheckExchanges(MFRC522_TCL *tcl) {
+	static uint8_t response[600];
+	uint16_t responseLen = 260;
+	CHECK_STATUS(STATUS_OK, TCL_Exchange(tcl, readBinary, sizeof(readBinary), response, &responseLen));
+	CHECK(responseLen == 258);
+	bool ok = true;
+	for (uint16_t i = 0; i < 256; i++) {
+		ok &= response[i] == (uint8_t)i;
+	}
+	CHECK(ok && response[256] == 0x90 && response[257] == 0x00);
+
+	uint8_t command[300];
+	for (uint16_t i = 0; i < sizeof(command); i++) {
+		command[i] = i * 7;
+	}
+	responseLen = sizeof(response);
+	CHECK_STATUS(STATUS_OK, TCL_Exchange(tcl, command, sizeof(command), response, &responseLen));
+	CHECK(responseLen == 302 && memcmp(response, command, sizeof(command)) == 0);
+} // End CheckExchanges()
+
+static void TestExchange(const enum PCD_CRCMode mode, const uint8_t cid) {
+	MFRC522_TCL tcl;
+	MFRC522_SimCard *card = Activate(&tcl, mode, PCD_BITRATE_106, cid);
+	CHECK(tcl.fsc == 128 && tcl.fwi == 8 && tcl.sfgi == 1 && tcl.ta1 == 0x77);
+	CHECK(tcl.useCid == (cid != 0) && tcl.atsLength == 6);
+	CheckExchanges(&tcl);
+
+	// two S(WTX) requests before the response; the extended FWT is undone afterwards
+	static uint8_t response[260];
+	uint16_t responseLen = sizeof(response);
+	card->wtxRequests = 2;
+	CHECK_STATUS(STATUS_OK, TCL_Exchange(&tcl, readBinary, sizeof(readBinary), response, &responseLen));
+	CHECK(responseLen == 258);
+	card->wtxRequests = 0;
+	const uint32_t timeout = PCD_GetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_ISO14443_4);
+	CHECK(timeout >= tcl.fwtUs && timeout < tcl.fwtUs + 4000);
+
+	responseLen = 100;
+	CHECK_STATUS(STATUS_NO_ROOM, TCL_Exchange(&tcl, readBinary, sizeof(readBinary), response, &responseLen));
+
+	CHECK_STATUS(STATUS_OK, TCL_Deselect(&tcl));
+	CHECK(PCD_GetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_ISO14443_4) == timeoutBefore);
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	CHECK(PICC_RequestA_h(&reader, atqa, &atqaSize) != STATUS_OK);		// deselected is HALT
+} // End TestExchange()
+
+static void TestBitRate(const enum PCD_CRCMode mode, const enum PCD_BitRate maxBitRate, const uint8_t cid) {
+	static const uint8_t modWidth[4] = {0x26, 0x15, 0x0A, 0x05};
+	MFRC522_TCL tcl;
+	Activate(&tcl, mode, maxBitRate, cid);
+	CHECK_STATUS(STATUS_OK, TCL_NegotiateBitRate(&tcl));
+	// receiving frames longer than the FIFO is limited to MFRC_STREAM_MAX_BIT_RATE
+	const enum PCD_BitRate rx = (tcl.fsd > 64 && maxBitRate > MFRC_STREAM_MAX_BIT_RATE) ? MFRC_STREAM_MAX_BIT_RATE : maxBitRate;
+	CHECK(tcl.txBitRate == maxBitRate && tcl.rxBitRate == rx);
+	CHECK(((sim._regs[TxModeReg] >> 4) & 0x07) == maxBitRate && ((sim._regs[RxModeReg] >> 4) & 0x07) == rx);
+	CHECK(sim._regs[ModWidthReg] == modWidth[maxBitRate]);
+	CHECK_STATUS(maxBitRate ? STATUS_INVALID : STATUS_OK, TCL_NegotiateBitRate(&tcl));		// PPS only once
+	CheckExchanges(&tcl);
+
+	// DESELECT goes back to 106 kbit/s, where the card can be woken again
+	CHECK_STATUS(STATUS_OK, TCL_Deselect(&tcl));
+	CHECK(((sim._regs[TxModeReg] >> 4) & 0x07) == 0 && sim._regs[ModWidthReg] == 0x26);
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	Uid uid;
+	CHECK_STATUS(STATUS_OK, PICC_WakeupA_h(&reader, atqa, &atqaSize));
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, &uid, 0));
+
+	// so does HLTA after a rate set by hand
+	PCD_SetBitRate_h(&reader, PCD_BITRATE_424, PCD_BITRATE_424);
+	PICC_HaltA_h(&reader);
+	enum PCD_BitRate txRate, rxRate;
+	PCD_GetBitRate_h(&reader, &txRate, &rxRate);
+	CHECK(txRate == PCD_BITRATE_106 && rxRate == PCD_BITRATE_106);
+} // End TestBitRate()
+
+static void TestTimeouts(void) {
+	HostTest_OpenReader(&reader, &sim, MFRC_DEFAULT_CRC_MODE);
+	CHECK(PCD_SetTimeoutUs_h(&reader, 5000000) == ESP_OK);
+	CHECK(PCD_GetTimeoutUs_h(&reader) >= 5000000 && PCD_GetTimeoutUs_h(&reader) < 5001000);
+	CHECK(PCD_SetTimeoutUs_h(&reader, 5000) == ESP_OK);
+	CHECK(PCD_GetTimeoutUs_h(&reader) == 5000);
+	CHECK(PCD_SetTimeoutUs_h(&reader, 25000) == ESP_OK);
+
+	// an empty field: REQA gives up after its own short timeout, not the 25ms of the timer
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	int64_t start = esp_timer_get_time();
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_RequestA_h(&reader, atqa, &atqaSize));
+	CHECK(esp_timer_get_time() - start < 5000);
+	CHECK(PCD_GetTimeoutUs_h(&reader) == 25000);
+
+	PCD_SetCommandTimeoutUs_h(&reader, PCD_TIMEOUT_REQA, 25000);
+	start = esp_timer_get_time();
+	atqaSize = sizeof(atqa);
+	CHECK_STATUS(STATUS_TIMEOUT, PICC_RequestA_h(&reader, atqa, &atqaSize));
+	CHECK(esp_timer_get_time() - start >= 25000);
+} // End TestTimeouts()
+
+int main(void) {
+	const enum PCD_CRCMode modes[] = {PCD_CRC_COPROCESSOR, PCD_CRC_SOFTWARE, PCD_CRC_HARDWARE};
+	for (uint8_t m = 0; m < 3; m++) {
+		for (uint8_t cid = 0; cid < 4; cid += 3) {
+			TestExchange(modes[m], cid);
+			for (uint8_t rate = PCD_BITRATE_106; rate <= PCD_BITRATE_848; rate++) {
+				TestBitRate(modes[m], (enum PCD_BitRate)rate, cid);
+			}
+		}
+	}
+	TestTimeouts();
+	return HostTest_Summary("tcl");
+} // End main()
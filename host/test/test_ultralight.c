@@ -0,0 +1,45 @@
+/*
+ * test_ultralight.c - MIFARE_Ultralight_ReadAll_h() (GET_VERSION, FAST_READ) and MIFARE_Ultralight_ReadPages_h()
+ * on Ultralight and NTAG213/215/216, in every CRC mode.
+ */
+
+#include "host_test.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+static void TestReadAll(const enum PCD_CRCMode mode, const enum MFRC522_SimCardType type, const uint16_t pages) {
+	static uint8_t buffer[1024];
+	const uint8_t id[7] = {4, 1, 2, 3, 4, 5, 6};
+
+	HostTest_OpenReader(&reader, &sim, mode);
+	MFRC522_SimCard *card = MFRC522_Sim_AddCard(&sim, type, id, 7);
+	for (uint16_t i = 16; i < pages * 4; i++) {
+		card->memory[i] = i * 13;
+	}
+	Uid uid;
+	CHECK(HostTest_SelectCard(&reader, &uid));
+
+	uint16_t pagesRead = 0;
+	CHECK_STATUS(STATUS_OK, MIFARE_Ultralight_ReadAll_h(&reader, &uid, buffer, sizeof(buffer), &pagesRead));
+	CHECK(pagesRead == pages);
+	CHECK(memcmp(buffer, card->memory, pages * 4) == 0);
+
+	memset(buffer, 0, sizeof(buffer));
+	CHECK_STATUS(STATUS_OK, MIFARE_Ultralight_ReadPages_h(&reader, 0, pages, false, buffer, sizeof(buffer)));
+	CHECK(memcmp(buffer, card->memory, pages * 4) == 0);
+
+	// too small a buffer
+	CHECK_STATUS(STATUS_NO_ROOM, MIFARE_Ultralight_ReadAll_h(&reader, &uid, buffer, pages * 4 - 1, &pagesRead));
+} // End TestReadAll()
+
+int main(void) {
+	const enum PCD_CRCMode modes[] = {PCD_CRC_COPROCESSOR, PCD_CRC_SOFTWARE, PCD_CRC_HARDWARE};
+	for (uint8_t m = 0; m < 3; m++) {
+		TestReadAll(modes[m], SIM_CARD_ULTRALIGHT, 16);
+		TestReadAll(modes[m], SIM_CARD_NTAG213, 45);
+		TestReadAll(modes[m], SIM_CARD_NTAG215, 135);
+		TestReadAll(modes[m], SIM_CARD_NTAG216, 231);
+	}
+	return HostTest_Summary("ultralight");
+} // End main()
@@ -0,0 +1,97 @@
+/*
+ * test_value.c - MIFARE_ValueTransaction_h(): backup, decrement, increment and restore under one authentication,
+ * the read-back, the checks of the operations, and a transaction whose TRANSFER is lost, in every CRC mode.
+ */
+
+#include "host_test.h"
+#include "MFRC522_Classic.h"
+
+static MFRC522_Sim sim;
+static MFRC522_Handle reader;
+
+// selects the card again, without authentication
+static void Reselect(Uid *uid) {
+	PCD_StopCrypto1_h(&reader);
+	PICC_HaltA_h(&reader);
+	uint8_t atqa[2];
+	uint8_t atqaSize = sizeof(atqa);
+	PICC_WakeupA_h(&reader, atqa, &atqaSize);
+	CHECK_STATUS(STATUS_OK, PICC_Select_h(&reader, uid, 0));
+} // End Reselect()
+
+static void TestTransactions(const enum PCD_CRCMode mode) {
+	const uint8_t id[4] = {1, 2, 3, 4};
+	MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+	MIFARE_KeyProvider keys = MIFARE_KeyAProvider(&key);
+	MIFARE_ValueResult result;
+	Uid uid;
+	long value = 0;
+
+	HostTest_OpenReader(&reader, &sim, mode);
+	MFRC522_Sim_AddCard(&sim, SIM_CARD_MIFARE_1K, id, 4);
+	CHECK(HostTest_SelectCard(&reader, &uid));
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 7, &key, &uid));
+	CHECK_STATUS(STATUS_OK, MIFARE_SetValue_h(&reader, 4, 1000));
+	CHECK_STATUS(STATUS_OK, MIFARE_Write_h(&reader, 6, (uint8_t[16]){0}, 16));		// not a value block
+
+	// backup and decrement
+	Reselect(&uid);
+	const MIFARE_ValueOp fare[] = {{PICC_CMD_MF_RESTORE, 4, 5, 0}, {PICC_CMD_MF_DECREMENT, 4, 4, 150}};
+	CHECK_STATUS(STATUS_OK, MIFARE_ValueTransaction_h(&reader, &uid, &keys, fare, 2, &result));
+	CHECK(result.previousValue == 1000 && result.value == 850 && result.verified && result.completedOps == 2);
+	CHECK(result.authUs > 0);
+
+	// four operations on the sector authenticated by the last transaction
+	const MIFARE_ValueOp four[] = {
+		{PICC_CMD_MF_RESTORE, 4, 5, 0},
+		{PICC_CMD_MF_DECREMENT, 4, 4, 200},
+		{PICC_CMD_MF_INCREMENT, 5, 5, -1},
+		{PICC_CMD_MF_RESTORE, 4, 4, 0}
+	};
+	CHECK_STATUS(STATUS_OK, MIFARE_ValueTransaction_h(&reader, &uid, NULL, four, 4, &result));
+	CHECK(result.previousValue == 850 && result.value == 650 && result.authUs == 0 && result.completedOps == 4);
+	CHECK_STATUS(STATUS_OK, MIFARE_GetValue_h(&reader, 5, &value));
+	CHECK(value == 849);
+
+	// operations that are refused before anything is sent: a trailer, another sector, no value block, no value command
+	const MIFARE_ValueOp trailer[] = {{PICC_CMD_MF_DECREMENT, 4, 7, 1}};
+	const MIFARE_ValueOp otherSector[] = {{PICC_CMD_MF_DECREMENT, 4, 8, 1}};
+	const MIFARE_ValueOp plainBlock[] = {{PICC_CMD_MF_DECREMENT, 6, 6, 1}};
+	const MIFARE_ValueOp write[] = {{PICC_CMD_MF_WRITE, 4, 4, 1}};
+	CHECK_STATUS(STATUS_INVALID, MIFARE_ValueTransaction_h(&reader, &uid, NULL, trailer, 1, &result));
+	CHECK_STATUS(STATUS_INVALID, MIFARE_ValueTransaction_h(&reader, &uid, NULL, otherSector, 1, &result));
+	CHECK_STATUS(STATUS_INVALID, MIFARE_ValueTransaction_h(&reader, &uid, NULL, plainBlock, 1, &result));
+	CHECK_STATUS(STATUS_INVALID, MIFARE_ValueTransaction_h(&reader, &uid, NULL, write, 1, &result));
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	CHECK_STATUS(STATUS_OK, MIFARE_Read_h(&reader, 4, buffer, &size));		// still authenticated
+
+	// the TRANSFER is lost after the command and the delta: the card stays as it was. The frames of the transaction
+	// are counted on a RESTORE of the block onto itself, the TRANSFER is the last but one.
+	const MIFARE_ValueOp same[] = {{PICC_CMD_MF_RESTORE, 4, 4, 0}};
+	const MIFARE_ValueOp one[] = {{PICC_CMD_MF_DECREMENT, 4, 4, 1}};
+	Reselect(&uid);
+	uint32_t frames = sim.rfFrames;
+	CHECK_STATUS(STATUS_OK, MIFARE_ValueTransaction_h(&reader, &uid, &keys, same, 1, &result));
+	frames = sim.rfFrames - frames;
+	Reselect(&uid);
+	sim.lostFrame = frames - 1;
+	CHECK(MIFARE_ValueTransaction_h(&reader, &uid, &keys, one, 1, &result) != STATUS_OK);
+	CHECK(sim.lostFrame == 0);
+	CHECK(result.completedOps == 0 && result.opUs[0] > 0 && result.transferUs[0] > 0);
+	Reselect(&uid);
+	CHECK_STATUS(STATUS_OK, PCD_Authenticate_h(&reader, PICC_CMD_MF_AUTH_KEY_A, 7, &key, &uid));
+	CHECK_STATUS(STATUS_OK, MIFARE_GetValue_h(&reader, 4, &value));
+	CHECK(value == 650);
+	Reselect(&uid);
+	CHECK_STATUS(STATUS_OK, MIFARE_ValueTransaction_h(&reader, &uid, &keys, one, 1, &result));
+	CHECK(result.previousValue == 650 && result.value == 649);
+	PCD_StopCrypto1_h(&reader);
+} // End TestTransactions()
+
+int main(void) {
+	TestTransactions(PCD_CRC_COPROCESSOR);
+	TestTransactions(PCD_CRC_SOFTWARE);
+	TestTransactions(PCD_CRC_HARDWARE);
+	return HostTest_Summary("value");
+} // End main()
@@ -0,0 +1,167 @@
+/*
+* MFRC522_Accounting.c - i2c transaction accounting and bus time cost model, per high-level operation.
+* See MFRC522_Accounting.h for an overview. Compiled only with MFRC_INCLUDE_ACCOUNTING=1.
+*/
+
+#include <memory.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <esp_log.h>
+
+#include "MFRC522_Accounting.h"
+
+#if MFRC_INCLUDE_ACCOUNTING == 1
+
+static const char* TAG = "mfrc_acct";
+
+#define WIRE_BITS_PER_BYTE		9	// 8 data bits + ACK
+#define WIRE_BITS_PER_FRAME		3	// START, STOP, repeated START
+
+#define TOP_REGISTERS			3	// registers listed per operation by MFRC522_Accounting_Print()
+
+static const char *const op_names[MFRC_OPS] = {
+	[MFRC_OP_OTHER] = "other",
+	[MFRC_OP_INIT] = "init",
+	[MFRC_OP_REQUEST] = "request",
+	[MFRC_OP_IS_NEW_CARD_PRESENT] = "isNewCardPresent",
+	[MFRC_OP_SELECT] = "select",
+	[MFRC_OP_HALT] = "halt",
+	[MFRC_OP_AUTH] = "auth",
+	[MFRC_OP_READ] = "read",
+	[MFRC_OP_WRITE] = "write",
+	[MFRC_OP_TRANSCEIVE] = "transceive",
+	[MFRC_OP_CRC] = "crc",
+};
+
+void MFRC522_Accounting_Reset(MFRC522_Accounting *acct) {
+	memset(acct, 0, sizeof(*acct));
+} // End MFRC522_Accounting_Reset()
+
+void MFRC522_Accounting_Attach(MFRC522_Accounting *acct, MFRC522_Handle *dev) {
+	if (acct) {
+		MFRC522_Accounting_Reset(acct);
+	}
+	dev->_accountOp = MFRC_OP_OTHER;
+	dev->_accounting = acct;
+} // End MFRC522_Accounting_Attach()
+
+const char *MFRC522_Accounting_OpName(const enum MFRC522_Op op) {
+	return op < MFRC_OPS ? op_names[op] : "?";
+} // End MFRC522_Accounting_OpName()
+
+/**
+ * Starts an operation. Only the outermost one counts: a PICC_Select_h() inside PICC_ReadCardSerial_h() or an
+ * MFRC_OP_REQUEST inside PICC_IsNewCardPresent_h() neither adds a call nor takes over the transactions.
+ *
+ * @return what MFRC522_Accounting_Leave() needs to restore.
+ */
+MFRC522_AccountingScope MFRC522_Accounting_Enter(MFRC522_Handle *dev, const enum MFRC522_Op op) {
+	const MFRC522_AccountingScope scope = {dev, dev->_accountOp};
+	if (dev->_accountOp == MFRC_OP_OTHER) {
+		dev->_accountOp = op;
+		if (dev->_accounting) {
+			dev->_accounting->op[op].calls++;
+		}
+	}
+	return scope;
+} // End MFRC522_Accounting_Enter()
+
+void MFRC522_Accounting_Leave(const MFRC522_AccountingScope *scope) {
+	scope->dev->_accountOp = scope->previous;
+} // End MFRC522_Accounting_Leave()
+
+/**
+ * Counts one i2c transaction of dev against the operation running.
+ */
+void MFRC522_Accounting_Transaction(MFRC522_Handle *dev, const uint8_t reg,
+									const bool read,			///< register address write + repeated START + read
+									const size_t wireBytes		///< slave address, register address and data bytes
+									) {
+	MFRC522_Accounting *acct = dev->_accounting;
+	if (!acct) {
+		return;
+	}
+	MFRC522_OpAccount *account = &acct->op[dev->_accountOp];
+	const uint8_t index = reg & 0x3F;
+	account->transactions++;
+	account->bytes += wireBytes;
+	account->bits += wireBytes * WIRE_BITS_PER_BYTE + WIRE_BITS_PER_FRAME;
+	if (read) {
+		account->reads++;
+		account->regReads[index]++;
+	}
+	else {
+		account->writes++;
+		account->regWrites[index]++;
+	}
+} // End MFRC522_Accounting_Transaction()
+
+uint32_t MFRC522_Accounting_BusTimeUs(const MFRC522_OpAccount *account, const uint32_t busHz) {
+	if (busHz == 0) {
+		return 0;
+	}
+	return (uint32_t)((account->bits * 1000000 + busHz / 2) / busHz);
+} // End MFRC522_Accounting_BusTimeUs()
+
+void MFRC522_Accounting_Print(const MFRC522_Accounting *acct) {
+	ESP_LOGI(TAG, "%-16s %7s %8s %8s %9s %9s %9s  %s", "operation", "calls", "i2c/call", "B/call",
+			"us@100k", "us@400k", "us@1M", "top registers (reads/writes)");
+	for (uint8_t op = 0; op < MFRC_OPS; op++) {
+		const MFRC522_OpAccount *account = &acct->op[op];
+		if (account->transactions == 0) {
+			continue;
+		}
+		const uint32_t calls = account->calls ? account->calls : 1;		// MFRC_OP_OTHER has no calls
+
+		// the registers with the most transactions, as "09h 40/0"
+		uint8_t top[TOP_REGISTERS];
+		uint8_t topCount = 0;
+		uint64_t picked = 0;
+		for (; topCount < TOP_REGISTERS; topCount++) {
+			uint32_t most = 0;
+			for (uint8_t reg = 0; reg < 0x40; reg++) {
+				const uint32_t total = account->regReads[reg] + account->regWrites[reg];
+				if (total > most && !(picked & (1ULL << reg))) {
+					most = total;
+					top[topCount] = reg;
+				}
+			}
+			if (most == 0) {
+				break;
+			}
+			picked |= 1ULL << top[topCount];
+		}
+		char registers[TOP_REGISTERS * 32] = "";
+		size_t used = 0;
+		for (uint8_t i = 0; i < topCount; i++) {
+			used += snprintf(&registers[used], sizeof(registers) - used, "%s%02Xh %" PRIu32 "/%" PRIu32, i ? ", " : "",
+							top[i], account->regReads[top[i]], account->regWrites[top[i]]);
+		}
+
+		ESP_LOGI(TAG, "%-16s %7" PRIu32 " %8.1f %8.1f %9" PRIu32 " %9" PRIu32 " %9" PRIu32 "  %s",
+				MFRC522_Accounting_OpName(op), account->calls, (float)account->transactions / calls,
+				(float)account->bytes / calls, MFRC522_Accounting_BusTimeUs(account, 100000) / calls,
+				MFRC522_Accounting_BusTimeUs(account, 400000) / calls, MFRC522_Accounting_BusTimeUs(account, 1000000) / calls,
+				registers);
+	}
+} // End MFRC522_Accounting_Print()
+
+uint8_t MFRC522_Accounting_CheckBudget(const MFRC522_Accounting *acct, const MFRC522_OpBudget *budget, const size_t count) {
+	uint8_t over = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (budget[i].op >= MFRC_OPS) {
+			continue;
+		}
+		const MFRC522_OpAccount *account = &acct->op[budget[i].op];
+		if (account->calls == 0 || account->transactions <= (uint64_t)budget[i].maxTransactionsPerCall * account->calls) {
+			continue;
+		}
+		ESP_LOGW(TAG, "%s: %.1f i2c transactions per call, budget %" PRIu32, MFRC522_Accounting_OpName(budget[i].op),
+				(float)account->transactions / account->calls, budget[i].maxTransactionsPerCall);
+		over++;
+	}
+	return over;
+} // End MFRC522_Accounting_CheckBudget()
+
+#endif // MFRC_INCLUDE_ACCOUNTING
@@ -0,0 +1,99 @@
+/**
+ * MFRC522_Accounting.h - i2c transaction accounting and bus time cost model, per high-level operation.
+ *
+ * Every register read and write the library does is one i2c transaction, and on a 400 kHz bus the transactions,
+ * not the RF traffic, are what most operations spend their time on. With MFRC_INCLUDE_ACCOUNTING=1 (MFRC522_I2C.h)
+ * and an MFRC522_Accounting attached to a reader, each transaction is counted against the operation it belongs to
+ * (PICC_IsNewCardPresent_h(), PICC_Select_h(), PCD_Authenticate_h(), MIFARE_Read_h(), ...): calls, transactions,
+ * bytes on the wire and a per-register breakdown. A nested call is counted against the outermost operation, e.g. the
+ * REQA of PICC_IsNewCardPresent_h() against MFRC_OP_IS_NEW_CARD_PRESENT; transactions outside all of them go to
+ * MFRC_OP_OTHER.
+ *
+ * 		static MFRC522_Accounting acct;
+ * 		MFRC522_Accounting_Attach(&acct, &reader);
+ * 		...													// the code to measure
+ * 		MFRC522_Accounting_Print(&acct);					// per-operation budget table
+ *
+ * The bus time model counts 9 bit times per byte (8 data bits + ACK) plus 3 for START, STOP and the repeated START,
+ * and is evaluated for any bus clock with MFRC522_Accounting_BusTimeUs(). MFRC522_Accounting_CheckBudget() compares
+ * the transactions per call with a baseline, so a benchmark can fail when a change adds i2c traffic.
+ */
+#ifndef MFRC522_Accounting_h
+#define MFRC522_Accounting_h
+
+#include "MFRC522_I2C.h"
+
+#if MFRC_INCLUDE_ACCOUNTING == 1
+
+// The operations transactions are counted against.
+enum MFRC522_Op {
+    MFRC_OP_OTHER					= 0,	// outside the operations below: direct register access, module code
+    MFRC_OP_INIT					= 1,	// PCD_Init_h(), PCD_Reset_h()
+    MFRC_OP_REQUEST					= 2,	// PICC_REQA_or_WUPA_h(), PICC_ProbePresence_h(), PICC_ProbeWakeup_h()
+    MFRC_OP_IS_NEW_CARD_PRESENT		= 3,	// PICC_IsNewCardPresent_h()
+    MFRC_OP_SELECT					= 4,	// PICC_Select_h()
+    MFRC_OP_HALT					= 5,	// PICC_HaltA_h()
+    MFRC_OP_AUTH					= 6,	// PCD_Authenticate_h()
+    MFRC_OP_READ					= 7,	// MIFARE_Read_h(), MIFARE_FastRead_h(), MIFARE_GetVersion_h()
+    MFRC_OP_WRITE					= 8,	// MIFARE_Write_h(), MIFARE_Ultralight_Write_h(), MIFARE_TwoStepHelper_h(), MIFARE_Transfer_h()
+    MFRC_OP_TRANSCEIVE				= 9,	// PCD_TransceiveData_h(), PCD_CommunicateWithPICC_h(), PCD_TransceiveStream_h(), PCD_TransceiveBlock_h()
+    MFRC_OP_CRC						= 10,	// PCD_CalculateCRC_h()
+    MFRC_OPS						= 11
+};
+
+// Counters of one operation.
+typedef struct {
+    uint32_t	calls;
+    uint32_t	transactions;
+    uint32_t	writes;				// transactions that write a register
+    uint32_t	reads;				// transactions that read a register
+    uint32_t	bytes;				// on the wire: slave address, register address and data bytes
+    uint64_t	bits;				// bit times on the wire, the input of the bus time model
+    uint32_t	regWrites[0x40];	// write transactions per register
+    uint32_t	regReads[0x40];		// read transactions per register
+} MFRC522_OpAccount;
+
+// The accounting of one reader, see MFRC522_Accounting_Attach(). ~6 KB: keep it static.
+typedef struct MFRC522_Accounting {
+    MFRC522_OpAccount op[MFRC_OPS];
+} MFRC522_Accounting;
+
+// An upper bound for MFRC522_Accounting_CheckBudget(): the average transactions per call of op.
+typedef struct {
+    enum MFRC522_Op op;
+    uint32_t	maxTransactionsPerCall;
+} MFRC522_OpBudget;
+
+// Used by MFRC522_I2C.c to attribute transactions to the operation running, see PCD_ACCOUNT_OP().
+typedef struct {
+    MFRC522_Handle *dev;
+    uint8_t		previous;
+} MFRC522_AccountingScope;
+
+// resets acct and counts the transactions of dev into it from now on. acct NULL: stop counting.
+void MFRC522_Accounting_Attach(MFRC522_Accounting *acct, MFRC522_Handle *dev);
+
+// zeroes all counters.
+void MFRC522_Accounting_Reset(MFRC522_Accounting *acct);
+
+// the name of op, e.g. "select".
+const char *MFRC522_Accounting_OpName(enum MFRC522_Op op);
+
+// estimated time the transactions of account took on a bus clocked at busHz (100000, 400000, 1000000 ...).
+uint32_t MFRC522_Accounting_BusTimeUs(const MFRC522_OpAccount *account, uint32_t busHz);
+
+// logs the budget table: per operation the calls, and per call the transactions, bytes, bus time at 100 kHz,
+// 400 kHz and 1 MHz and the registers accessed most.
+void MFRC522_Accounting_Print(const MFRC522_Accounting *acct);
+
+// compares the transactions per call with budget[0..count-1], logs every operation above it.
+// returns the number of operations above their budget; operations without calls pass.
+uint8_t MFRC522_Accounting_CheckBudget(const MFRC522_Accounting *acct, const MFRC522_OpBudget *budget, size_t count);
+
+// hooks for MFRC522_I2C.c
+MFRC522_AccountingScope MFRC522_Accounting_Enter(MFRC522_Handle *dev, enum MFRC522_Op op);
+void MFRC522_Accounting_Leave(const MFRC522_AccountingScope *scope);
+void MFRC522_Accounting_Transaction(MFRC522_Handle *dev, uint8_t reg, bool read, size_t wireBytes);
+
+#endif // MFRC_INCLUDE_ACCOUNTING
+#endif // MFRC522_Accounting_h
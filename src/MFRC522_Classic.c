@@ -0,0 +1,416 @@
+/*
+* MFRC522_Classic.c - reads whole MIFARE Classic cards (Mini, 1K, 4K) into memory.
+* See MFRC522_Classic.h for an overview.
+*/
+
+#include <memory.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "MFRC522_Classic.h"
+
+static const char* TAG = "mfrc_classic";
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Card geometry
+/////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t MIFARE_GetBlockCount(const uint8_t piccType) {
+	switch (piccType) {
+		case PICC_TYPE_MIFARE_MINI:	return 20;		// 5 sectors * 4 blocks/sector
+		case PICC_TYPE_MIFARE_1K:	return 64;		// 16 sectors * 4 blocks/sector
+		case PICC_TYPE_MIFARE_4K:	return 256;		// 32 sectors * 4 blocks/sector + 8 sectors * 16 blocks/sector
+		default:					return 0;
+	}
+} // End MIFARE_GetBlockCount()
+
+uint8_t MIFARE_GetSectorCount(const uint8_t piccType) {
+	switch (piccType) {
+		case PICC_TYPE_MIFARE_MINI:	return 5;
+		case PICC_TYPE_MIFARE_1K:	return 16;
+		case PICC_TYPE_MIFARE_4K:	return 40;
+		default:					return 0;
+	}
+} // End MIFARE_GetSectorCount()
+
+uint8_t MIFARE_SectorOfBlock(const uint8_t blockAddr) {
+	if (blockAddr < 128) {
+		return blockAddr / 4;
+	}
+	return 32 + (blockAddr - 128) / 16;
+} // End MIFARE_SectorOfBlock()
+
+uint8_t MIFARE_FirstBlockOfSector(const uint8_t sector) {
+	if (sector < 32) {
+		return sector * 4;
+	}
+	return 128 + (sector - 32) * 16;
+} // End MIFARE_FirstBlockOfSector()
+
+uint8_t MIFARE_BlocksInSector(const uint8_t sector) {
+	return sector < 32 ? 4 : 16;
+} // End MIFARE_BlocksInSector()
+
+bool MIFARE_IsTrailerBlock(const uint8_t blockAddr) {
+	const uint8_t sector = MIFARE_SectorOfBlock(blockAddr);
+	return blockAddr == MIFARE_FirstBlockOfSector(sector) + MIFARE_BlocksInSector(sector) - 1;
+} // End MIFARE_IsTrailerBlock()
+
+void MIFARE_SetBlockMask(uint8_t *blockMask, const uint8_t piccType, const bool trailers) {
+	memset(blockMask, 0, MIFARE_CLASSIC_MAX_BLOCKS / 8);
+	const uint16_t blockCount = MIFARE_GetBlockCount(piccType);
+	for (uint16_t block = 0; block < blockCount; block++) {
+		if (trailers || !MIFARE_IsTrailerBlock(block)) {
+			blockMask[block / 8] |= 1 << (block % 8);
+		}
+	}
+} // End MIFARE_SetBlockMask()
+
+bool MIFARE_ImageHasBlock(const MIFARE_ClassicImage *image, const uint8_t blockAddr) {
+	return image->blockRead[blockAddr / 8] & (1 << (blockAddr % 8));
+} // End MIFARE_ImageHasBlock()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Key providers
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool MIFARE_KeyAProvider_GetKey(void *context, const Uid *uid, uint8_t sector, uint8_t attempt, uint8_t *command, MIFARE_Key *key) {
+	if (attempt > 0) {
+		return false;
+	}
+	*command = PICC_CMD_MF_AUTH_KEY_A;
+	*key = *(const MIFARE_Key *)context;
+	return true;
+} // End MIFARE_KeyAProvider_GetKey()
+
+MIFARE_KeyProvider MIFARE_KeyAProvider(const MIFARE_Key *key) {
+	const MIFARE_KeyProvider provider = {
+		.getKey = MIFARE_KeyAProvider_GetKey,
+		.authenticated = NULL,
+		.context = (void *)key,
+		.authTimeoutUs = 0,
+	};
+	return provider;
+} // End MIFARE_KeyAProvider()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Reading
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Authenticates a sector with the keys of the provider, in order.
+ * After a wrong key the PICC is woken up and selected again (PICC_Reselect_h()) before the next key is tried.
+ *
+ * @return STATUS_OK if a key worked, STATUS_??? otherwise (STATUS_TIMEOUT if the PICC rejected all keys).
+ */
+enum StatusCode MIFARE_AuthenticateSector_h(MFRC522_Handle *dev,	const Uid *uid,				///< The selected PICC
+																const MIFARE_KeyProvider *keys,	///< Keys to try
+																const uint8_t sector,		///< The sector to authenticate
+																uint8_t *attemptOut,		///< Out (NULL: unused): the key attempt that worked, MIFARE_KEY_NONE if none did.
+																uint8_t *commandOut			///< Out (NULL: unused): PICC_CMD_MF_AUTH_KEY_A/B of that attempt.
+											) {
+	const uint8_t trailer = MIFARE_FirstBlockOfSector(sector) + MIFARE_BlocksInSector(sector) - 1;
+	enum StatusCode result = STATUS_TIMEOUT;
+	uint8_t worked = MIFARE_KEY_NONE;
+
+	const uint32_t savedTimeoutUs = PCD_GetCommandTimeoutUs_h(dev, PCD_TIMEOUT_AUTH);
+	if (keys->authTimeoutUs) {
+		PCD_SetCommandTimeoutUs_h(dev, PCD_TIMEOUT_AUTH, keys->authTimeoutUs);
+	}
+
+	uint8_t command = 0;
+	MIFARE_Key key;
+	for (uint8_t attempt = 0; attempt < MIFARE_KEY_NONE && keys->getKey(keys->context, uid, sector, attempt, &command, &key); attempt++) {
+		result = PCD_Authenticate_h(dev, command, trailer, &key, uid);
+		if (result == STATUS_OK) {
+			worked = attempt;
+			break;
+		}
+		// A failed authentication drops the PICC back to IDLE. Bring it back before the next key.
+		const enum StatusCode reselect = PICC_Reselect_h(dev, uid);
+		if (reselect != STATUS_OK) {
+			ESP_LOGD(TAG, "sector %d: PICC lost after a failed authentication: %s", sector, GetStatusCodeName(reselect));
+			result = reselect;
+			break;
+		}
+	}
+
+	PCD_SetCommandTimeoutUs_h(dev, PCD_TIMEOUT_AUTH, savedTimeoutUs);
+	if (keys->authenticated && (result == STATUS_OK || result == STATUS_TIMEOUT)) {
+		keys->authenticated(keys->context, uid, sector, worked);
+	}
+	if (attemptOut) {
+		*attemptOut = worked;
+	}
+	if (commandOut) {
+		*commandOut = worked == MIFARE_KEY_NONE ? 0 : command;
+	}
+	return result;
+} // End MIFARE_AuthenticateSector_h()
+
+/**
+ * Reads the requested blocks of a MIFARE Classic PICC into an image, lowest address first.
+ * A sector is only authenticated if at least one of its blocks is requested.
+ *
+ * @return STATUS_OK if every requested block was read, else the error of the first block that could not be read.
+ */
+enum StatusCode MIFARE_ReadCard_h(MFRC522_Handle *dev, 	const Uid *uid,				///< The selected PICC, from PICC_Select_h()
+														const uint8_t piccType,		///< PICC_TYPE_MIFARE_MINI, _1K or _4K, see PICC_GetType()
+														const MIFARE_KeyProvider *keys,	///< Keys to authenticate the sectors with
+														const uint8_t *blockMask,	///< Bit n%8 of blockMask[n/8] set => read block n. NULL => all blocks.
+														MIFARE_ClassicImage *image	///< In: data/dataSize. Out: everything else.
+								) {
+	image->blockCount = MIFARE_GetBlockCount(piccType);
+	image->sectorCount = MIFARE_GetSectorCount(piccType);
+	memset(image->blockRead, 0, sizeof(image->blockRead));
+	memset(image->sectorKey, MIFARE_KEY_NONE, sizeof(image->sectorKey));
+	memset(image->sectorCommand, 0, sizeof(image->sectorCommand));
+
+	if (image->blockCount == 0) {
+		return STATUS_INVALID;
+	}
+	if (image->data == NULL || image->dataSize < (size_t)image->blockCount * 16) {
+		return STATUS_NO_ROOM;
+	}
+
+	enum StatusCode firstError = STATUS_OK;
+	for (uint8_t sector = 0; sector < image->sectorCount; sector++) {
+		const uint8_t firstBlock = MIFARE_FirstBlockOfSector(sector);
+		const uint8_t blocks = MIFARE_BlocksInSector(sector);
+
+		bool wanted = blockMask == NULL;
+		for (uint8_t i = 0; i < blocks && !wanted; i++) {
+			wanted = blockMask[(firstBlock + i) / 8] & (1 << ((firstBlock + i) % 8));
+		}
+		if (!wanted) {
+			continue;
+		}
+
+		enum StatusCode result = MIFARE_AuthenticateSector_h(dev, uid, keys, sector, &image->sectorKey[sector], &image->sectorCommand[sector]);
+		if (result != STATUS_OK) {
+			if (firstError == STATUS_OK) {
+				firstError = result;
+			}
+			if (result != STATUS_TIMEOUT) {		// Not just wrong keys: the PICC is gone, stop.
+				return firstError;
+			}
+			continue;
+		}
+
+		for (uint8_t i = 0; i < blocks; i++) {
+			const uint8_t block = firstBlock + i;
+			if (blockMask && !(blockMask[block / 8] & (1 << (block % 8)))) {
+				continue;
+			}
+			uint8_t buffer[18];
+			uint8_t byteCount = sizeof(buffer);
+			result = MIFARE_Read_h(dev, block, buffer, &byteCount);
+			if (result != STATUS_OK) {
+				ESP_LOGD(TAG, "block %d: read failed: %s", block, GetStatusCodeName(result));
+				if (firstError == STATUS_OK) {
+					firstError = result;
+				}
+				// After a NAK (access bits) or a broken frame the PICC is in IDLE or HALT. Get it back for the next sector.
+				if (PICC_Reselect_h(dev, uid) != STATUS_OK) {
+					return firstError;
+				}
+				break;
+			}
+			memcpy(&image->data[16 * block], buffer, 16);
+			image->blockRead[block / 8] |= 1 << (block % 8);
+		}
+	}
+	return firstError;
+} // End MIFARE_ReadCard_h()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Value block transactions
+/////////////////////////////////////////////////////////////////////////////////////
+
+// The frames of one MIFARE_ValueOp, each followed by its CRC_A.
+typedef struct {
+	uint8_t command[2];		// command, block address
+	uint8_t commandCRC[2];
+	uint8_t delta[4];		// LSB first
+	uint8_t deltaCRC[2];
+	uint8_t transfer[2];	// PICC_CMD_MF_TRANSFER, block address
+	uint8_t transferCRC[2];
+} MIFARE_ValueFrames;
+
+// The value of a block in value block format: value, inverted value, value, and the address byte twice, as is and inverted.
+static bool MIFARE_ParseValueBlock(const uint8_t *block, int32_t *value) {
+	const uint32_t v = block[0] | (block[1] << 8) | (block[2] << 16) | ((uint32_t)block[3] << 24);
+	const uint32_t inverted = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	const uint32_t copy = block[8] | (block[9] << 8) | (block[10] << 16) | ((uint32_t)block[11] << 24);
+	if (v != copy || v != ~inverted || block[12] != block[14] || block[13] != block[15] || (block[12] ^ block[13]) != 0xFF) {
+		return false;
+	}
+	*value = (int32_t)v;
+	return true;
+} // End MIFARE_ParseValueBlock()
+
+static enum StatusCode MIFARE_ReadValue(MFRC522_Handle *dev, const uint8_t blockAddr, int32_t *value) {
+	uint8_t buffer[18];
+	uint8_t size = sizeof(buffer);
+	const enum StatusCode result = MIFARE_Read_h(dev, blockAddr, buffer, &size);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	return MIFARE_ParseValueBlock(buffer, value) ? STATUS_OK : STATUS_INVALID;
+} // End MIFARE_ReadValue()
+
+// One frame of an operation, with its precomputed CRC_A. The PICC answers with an ACK, or not at all (acceptTimeout).
+static enum StatusCode MIFARE_SendValueFrame(MFRC522_Handle *dev, const uint8_t *data, const uint8_t length, const uint8_t *crc, const bool acceptTimeout) {
+	const PCD_Segment segment = {data, length};
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	return PCD_MIFARE_TransceiveWithCRC_h(dev, &segment, 1, crc, acceptTimeout);
+} // End MIFARE_SendValueFrame()
+
+/**
+ * Runs a list of value block operations of one sector: authenticates the sector once, reads the values the operations
+ * start from, sends command, delta and transfer of each operation, and reads every transfer block back.
+ *
+ * All frames are built and their CRC_A calculated on the host before the first one is sent, so there is no CRC
+ * round trip to the MFRC522 between the frames, whatever PCD_SetCRCMode_h() says. Values a previous operation
+ * transferred are not read again.
+ *
+ * @return STATUS_OK if all operations were transferred and read back with the expected values, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_ValueTransaction_h(MFRC522_Handle *dev,	const Uid *uid,				///< The selected PICC
+															const MIFARE_KeyProvider *keys,	///< Keys for the sector. NULL => it is authenticated already.
+															const MIFARE_ValueOp *ops,	///< The operations, in order
+															const uint8_t count,		///< Number of operations, 1..MIFARE_VALUE_MAX_OPS
+															MIFARE_ValueResult *result	///< Out: values, progress and timings
+										) {
+	const int64_t startUs = esp_timer_get_time();
+	memset(result, 0, sizeof(*result));
+	if (count == 0 || count > MIFARE_VALUE_MAX_OPS) {
+		return STATUS_INVALID;
+	}
+
+	// Check the operations and prepare their frames.
+	const uint8_t sector = MIFARE_SectorOfBlock(ops[0].blockAddr);
+	const uint8_t firstBlock = MIFARE_FirstBlockOfSector(sector);
+	MIFARE_ValueFrames frames[MIFARE_VALUE_MAX_OPS];
+	for (uint8_t i = 0; i < count; i++) {
+		const MIFARE_ValueOp *op = &ops[i];
+		if (op->command != PICC_CMD_MF_DECREMENT && op->command != PICC_CMD_MF_INCREMENT && op->command != PICC_CMD_MF_RESTORE) {
+			return STATUS_INVALID;
+		}
+		if (MIFARE_SectorOfBlock(op->blockAddr) != sector || MIFARE_SectorOfBlock(op->transferAddr) != sector
+				|| MIFARE_IsTrailerBlock(op->blockAddr) || MIFARE_IsTrailerBlock(op->transferAddr) || op->transferAddr == 0) {
+			return STATUS_INVALID;
+		}
+		MIFARE_ValueFrames *frame = &frames[i];
+		const uint32_t delta = op->command == PICC_CMD_MF_RESTORE ? 0 : (uint32_t)op->delta;
+		frame->command[0] = op->command;
+		frame->command[1] = op->blockAddr;
+		frame->delta[0] = delta;
+		frame->delta[1] = delta >> 8;
+		frame->delta[2] = delta >> 16;
+		frame->delta[3] = delta >> 24;
+		frame->transfer[0] = PICC_CMD_MF_TRANSFER;
+		frame->transfer[1] = op->transferAddr;
+		CRC_A_Calculate(frame->command, sizeof(frame->command), frame->commandCRC);
+		CRC_A_Calculate(frame->delta, sizeof(frame->delta), frame->deltaCRC);
+		CRC_A_Calculate(frame->transfer, sizeof(frame->transfer), frame->transferCRC);
+	}
+
+	enum StatusCode status;
+	int64_t stepUs = esp_timer_get_time();
+	if (keys) {
+		status = MIFARE_AuthenticateSector_h(dev, uid, keys, sector, NULL, NULL);
+		if (status != STATUS_OK) {
+			return status;
+		}
+		result->authUs = (uint32_t)(esp_timer_get_time() - stepUs);
+	}
+
+	// The values of the blocks of the sector as they will be after each operation, offset from firstBlock.
+	int32_t values[16];
+	uint16_t known = 0;
+	uint16_t transferred = 0;
+	stepUs = esp_timer_get_time();
+	for (uint8_t i = 0; i < count; i++) {
+		const uint8_t index = ops[i].blockAddr - firstBlock;
+		if (!(known & (1 << index))) {
+			status = MIFARE_ReadValue(dev, ops[i].blockAddr, &values[index]);
+			if (status != STATUS_OK) {
+				return status;
+			}
+			known |= 1 << index;
+		}
+		if (i == 0) {
+			result->previousValue = values[index];
+		}
+		int32_t value = values[index];
+		if (ops[i].command == PICC_CMD_MF_DECREMENT) {
+			value = (int32_t)((uint32_t)value - (uint32_t)ops[i].delta);
+		}
+		else if (ops[i].command == PICC_CMD_MF_INCREMENT) {
+			value = (int32_t)((uint32_t)value + (uint32_t)ops[i].delta);
+		}
+		const uint8_t target = ops[i].transferAddr - firstBlock;
+		values[target] = value;
+		known |= 1 << target;
+		transferred |= 1 << target;
+	}
+	result->readUs = (uint32_t)(esp_timer_get_time() - stepUs);
+
+	for (uint8_t i = 0; i < count; i++) {
+		const MIFARE_ValueFrames *frame = &frames[i];
+		stepUs = esp_timer_get_time();
+		status = MIFARE_SendValueFrame(dev, frame->command, sizeof(frame->command), frame->commandCRC, false);
+		if (status == STATUS_OK) {
+			// The PICC does not answer the delta, the timeout is the time it gets to compute the value.
+			status = MIFARE_SendValueFrame(dev, frame->delta, sizeof(frame->delta), frame->deltaCRC, true);
+		}
+		const int64_t transferStartUs = esp_timer_get_time();
+		result->opUs[i] = (uint32_t)(transferStartUs - stepUs);
+		if (status == STATUS_OK) {
+			status = MIFARE_SendValueFrame(dev, frame->transfer, sizeof(frame->transfer), frame->transferCRC, false);
+			result->transferUs[i] = (uint32_t)(esp_timer_get_time() - transferStartUs);
+		}
+		if (status != STATUS_OK) {
+			ESP_LOGD(TAG, "value operation %d on block %d failed: %s", i, ops[i].blockAddr, GetStatusCodeName(status));
+			result->totalUs = (uint32_t)(esp_timer_get_time() - startUs);
+			return status;
+		}
+		result->completedOps++;
+	}
+
+	// Read back every block a transfer went to.
+	stepUs = esp_timer_get_time();
+	status = STATUS_OK;
+	for (uint8_t index = 0; index < 16 && status == STATUS_OK; index++) {
+		if (!(transferred & (1 << index))) {
+			continue;
+		}
+		int32_t value;
+		status = MIFARE_ReadValue(dev, firstBlock + index, &value);
+		if (status == STATUS_OK && value != values[index]) {
+			ESP_LOGW(TAG, "block %d holds %ld after the transaction, expected %ld", firstBlock + index, (long)value, (long)values[index]);
+			status = STATUS_ERROR;
+		}
+	}
+	result->verifyUs = (uint32_t)(esp_timer_get_time() - stepUs);
+	result->verified = status == STATUS_OK;
+	if (result->verified) {
+		result->value = values[ops[count - 1].transferAddr - firstBlock];
+	}
+	result->totalUs = (uint32_t)(esp_timer_get_time() - startUs);
+	return status;
+} // End MIFARE_ValueTransaction_h()
+
+enum StatusCode MIFARE_ReadCard(const Uid *uid, uint8_t piccType, const MIFARE_KeyProvider *keys, const uint8_t *blockMask, MIFARE_ClassicImage *image) {
+	return MIFARE_ReadCard_h(MFRC522_DefaultHandle(), uid, piccType, keys, blockMask, image);
+}
+
+enum StatusCode MIFARE_AuthenticateSector(const Uid *uid, const MIFARE_KeyProvider *keys, uint8_t sector, uint8_t *attemptOut, uint8_t *commandOut) {
+	return MIFARE_AuthenticateSector_h(MFRC522_DefaultHandle(), uid, keys, sector, attemptOut, commandOut);
+}
+
+enum StatusCode MIFARE_ValueTransaction(const Uid *uid, const MIFARE_KeyProvider *keys, const MIFARE_ValueOp *ops, uint8_t count, MIFARE_ValueResult *result) {
+	return MIFARE_ValueTransaction_h(MFRC522_DefaultHandle(), uid, keys, ops, count, result);
+}
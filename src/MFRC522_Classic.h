@@ -0,0 +1,131 @@
+/**
+ * MFRC522_Classic.h - reads whole MIFARE Classic cards (Mini, 1K, 4K) into memory.
+ *
+ * MIFARE_ReadCard() fills a caller-provided image with the blocks of the card in address order, authenticating once
+ * per sector with keys from a MIFARE_KeyProvider, and records per block whether it could be read. Unlike
+ * PICC_DumpMifareClassicToSerial() nothing is printed and any subset of blocks can be read, e.g. without the sector
+ * trailers when the access bits are not of interest.
+ *
+ * 		uint8_t data[1024];
+ * 		MIFARE_ClassicImage image = { .data = data, .dataSize = sizeof(data) };
+ * 		MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+ * 		MIFARE_KeyProvider keys = MIFARE_KeyAProvider(&key);
+ * 		if (MIFARE_ReadCard(&uid, PICC_GetType(uid.sak), &keys, NULL, &image) == STATUS_OK) ...
+ *
+ * MIFARE_ValueTransaction() runs a list of value block operations (decrement, increment, restore, each followed by a
+ * transfer) of one sector under one authentication, and reads the results back:
+ *
+ * 		const MIFARE_ValueOp ops[] = {
+ * 			{PICC_CMD_MF_RESTORE, 4, 5, 0},						// backup: block 4 to block 5
+ * 			{PICC_CMD_MF_DECREMENT, 4, 4, fare},				// the fare off block 4
+ * 		};
+ * 		MIFARE_ValueResult result;
+ * 		if (MIFARE_ValueTransaction(&uid, &keys, ops, 2, &result) == STATUS_OK) ...	// result.value: the new balance
+ *
+ * The card only changes at a transfer, so a transaction broken off before the first transfer leaves it as it was, and
+ * the backup block of the example holds the old balance until the decremented value is transferred.
+ */
+#ifndef MFRC522_Classic_h
+#define MFRC522_Classic_h
+
+#include "MFRC522_I2C.h"
+
+#define MIFARE_CLASSIC_MAX_BLOCKS	256		// MIFARE Classic 4K
+#define MIFARE_CLASSIC_MAX_SECTORS	40
+
+// Supplies the keys to authenticate sectors with.
+typedef struct {
+    // Key number attempt (0, 1, ...) to try on sector of the PICC uid. Sets *command to PICC_CMD_MF_AUTH_KEY_A or
+    // PICC_CMD_MF_AUTH_KEY_B and fills *key. Returns false when there are no more keys to try.
+    bool (*getKey)(void *context, const Uid *uid, uint8_t sector, uint8_t attempt, uint8_t *command, MIFARE_Key *key);
+    // Optional (NULL): called after key attempt authenticated the sector, or with attempt = MIFARE_KEY_NONE if none did.
+    void (*authenticated)(void *context, const Uid *uid, uint8_t sector, uint8_t attempt);
+    void *context;
+    // MFRC522 timeout of the authentications (PCD_TIMEOUT_AUTH) while the keys are tried, 0 => keep the one of the
+    // reader. A wrong key only fails when the timer expires, so a timeout just above the authentication time makes
+    // wrong keys cheap.
+    uint32_t authTimeoutUs;
+} MIFARE_KeyProvider;
+
+#define MIFARE_KEY_NONE	0xFF
+
+// Result of MIFARE_ReadCard(). Set data/dataSize, the rest is filled in.
+typedef struct {
+    uint8_t		*data;			// 16 bytes per block, block n at data[16 * n]. 320 (Mini), 1024 (1K) or 4096 (4K) bytes.
+    size_t		dataSize;
+    uint16_t	blockCount;		// number of blocks of the card type
+    uint8_t		sectorCount;
+    uint8_t		blockRead[MIFARE_CLASSIC_MAX_BLOCKS / 8];	// bit n%8 of blockRead[n/8] set => block n is in data
+    uint8_t		sectorKey[MIFARE_CLASSIC_MAX_SECTORS];		// key attempt that authenticated the sector, MIFARE_KEY_NONE if none did
+    uint8_t		sectorCommand[MIFARE_CLASSIC_MAX_SECTORS];	// PICC_CMD_MF_AUTH_KEY_A/B used for the sector, 0 if not authenticated
+} MIFARE_ClassicImage;
+
+// Geometry of the Classic types: Mini 5 sectors, 1K 16 sectors, 4K 32 sectors of 4 blocks + 8 sectors of 16 blocks.
+uint16_t MIFARE_GetBlockCount(uint8_t piccType);			// 0 if piccType is not a MIFARE Classic
+uint8_t MIFARE_GetSectorCount(uint8_t piccType);
+uint8_t MIFARE_SectorOfBlock(uint8_t blockAddr);
+uint8_t MIFARE_FirstBlockOfSector(uint8_t sector);
+uint8_t MIFARE_BlocksInSector(uint8_t sector);
+bool MIFARE_IsTrailerBlock(uint8_t blockAddr);
+
+// sets blockMask (MIFARE_CLASSIC_MAX_BLOCKS / 8 bytes) to all blocks of piccType, with or without the sector trailers.
+void MIFARE_SetBlockMask(uint8_t *blockMask, uint8_t piccType, bool trailers);
+bool MIFARE_ImageHasBlock(const MIFARE_ClassicImage *image, uint8_t blockAddr);
+
+// a key provider that offers one key, as key A, for every sector (like PICC_DumpMifareClassicToSerial()).
+// key must stay valid while the provider is used.
+MIFARE_KeyProvider MIFARE_KeyAProvider(const MIFARE_Key *key);
+
+// reads the blocks in blockMask (NULL => all blocks, trailers included) of the selected PICC uid into image.
+// sectors are authenticated once each, in address order; after a wrong key the PICC is woken up and selected
+// again (WUPA + SELECT with the known UID) before the next key is tried.
+// returns STATUS_OK if every requested block was read, else the error of the first block that could not be read.
+// leaves the PICC selected, with Crypto1 on if any sector was authenticated: finish with PICC_HaltA() and PCD_StopCrypto1().
+enum StatusCode MIFARE_ReadCard(const Uid *uid, uint8_t piccType, const MIFARE_KeyProvider *keys, const uint8_t *blockMask, MIFARE_ClassicImage *image);
+enum StatusCode MIFARE_ReadCard_h(MFRC522_Handle *dev, const Uid *uid, uint8_t piccType, const MIFARE_KeyProvider *keys, const uint8_t *blockMask, MIFARE_ClassicImage *image);
+
+// authenticates one sector of the selected PICC uid with the keys of the provider, like MIFARE_ReadCard() does.
+// *attemptOut/*commandOut (may be NULL) get the key attempt and PICC_CMD_MF_AUTH_KEY_A/B that worked.
+// STATUS_TIMEOUT if all keys were rejected; the PICC is selected again but not authenticated then.
+enum StatusCode MIFARE_AuthenticateSector(const Uid *uid, const MIFARE_KeyProvider *keys, uint8_t sector, uint8_t *attemptOut, uint8_t *commandOut);
+enum StatusCode MIFARE_AuthenticateSector_h(MFRC522_Handle *dev, const Uid *uid, const MIFARE_KeyProvider *keys, uint8_t sector, uint8_t *attemptOut, uint8_t *commandOut);
+
+// Most operations in one MIFARE_ValueTransaction().
+#ifndef MIFARE_VALUE_MAX_OPS
+#define MIFARE_VALUE_MAX_OPS 4
+#endif
+
+// One operation of MIFARE_ValueTransaction(): command on the value block blockAddr, then the result transferred to
+// transferAddr. Both blocks are in the same sector.
+typedef struct {
+    uint8_t		command;		// PICC_CMD_MF_DECREMENT, PICC_CMD_MF_INCREMENT or PICC_CMD_MF_RESTORE
+    uint8_t		blockAddr;		// the value block the command reads
+    uint8_t		transferAddr;	// where the result goes: blockAddr, or e.g. a backup block
+    int32_t		delta;			// subtracted or added, not used by PICC_CMD_MF_RESTORE
+} MIFARE_ValueOp;
+
+// Result of MIFARE_ValueTransaction(), filled in as far as the transaction got.
+typedef struct {
+    int32_t		previousValue;	// value of the block of the first operation before the transaction
+    int32_t		value;			// value read back from the transfer block of the last operation
+    uint8_t		completedOps;	// operations transferred
+    bool		verified;		// all transfer blocks read back with the expected values
+    uint32_t	authUs;			// MIFARE_AuthenticateSector_h(), 0 if the sector was authenticated before
+    uint32_t	readUs;			// reading the values before the first operation
+    uint32_t	opUs[MIFARE_VALUE_MAX_OPS];			// both steps of the command
+    uint32_t	transferUs[MIFARE_VALUE_MAX_OPS];	// the transfer
+    uint32_t	verifyUs;		// reading the transfer blocks back
+    uint32_t	totalUs;
+} MIFARE_ValueResult;
+
+// runs ops[0..count-1] on the selected PICC uid under one authentication of their sector, with keys (NULL: the
+// sector is authenticated already, e.g. by the previous transaction). the values are read before the first operation
+// and every transfer block is read back at the end. the frames and their CRC_A are all prepared before the first one
+// is sent. returns STATUS_OK if all operations were transferred and verified, STATUS_INVALID if an operation or a
+// block is not valid (blocks of several sectors, a sector trailer, no value block), STATUS_ERROR if a block read back
+// does not hold the expected value, else the error of the operation that failed (result->completedOps).
+// the sector stays authenticated: finish with PICC_HaltA() and PCD_StopCrypto1().
+enum StatusCode MIFARE_ValueTransaction(const Uid *uid, const MIFARE_KeyProvider *keys, const MIFARE_ValueOp *ops, uint8_t count, MIFARE_ValueResult *result);
+enum StatusCode MIFARE_ValueTransaction_h(MFRC522_Handle *dev, const Uid *uid, const MIFARE_KeyProvider *keys, const MIFARE_ValueOp *ops, uint8_t count, MIFARE_ValueResult *result);
+
+#endif // MFRC522_Classic_h
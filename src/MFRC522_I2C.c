@@ -10,14 +10,31 @@
 */
 
 #include <memory.h>
+#include <stdio.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <esp_log.h>
 #include <esp_check.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
+#include <esp_idf_version.h>
 #include <driver/i2c_master.h>
 
 #include "MFRC522_I2C.h"
+#if MFRC_INCLUDE_SIMULATOR == 1
+#include "MFRC522_Sim.h"
+#endif
+#if MFRC_INCLUDE_ACCOUNTING == 1
+#include "MFRC522_Accounting.h"
+#endif
+#if MFRC_INCLUDE_STATS == 1
+#include "MFRC522_Stats.h"
+#endif
+#if MFRC_INCLUDE_LOG_RING == 1
+#include "MFRC522_Log.h"
+#endif
 
 #ifdef ARDUINO
 // if you hit this, you're trying to use this with the Arduino framework.
@@ -28,32 +45,107 @@
 
 static const char* TAG = "mfrc_lib";
 
-typedef struct {
-    // if not GPIO_NUM_NC, we'll pulse this GPIO pin# connected to MFRC522's reset and power down input (Pin 6, NRSTPD, active low)
-    int _resetPowerDownPin;
-
-    // set to true to enable more debug logging
-    bool _logDebugInfo;
-
-    // set to true if this device has been initialized
-    bool _initialized;
-
-    // when performing i2c operations, how long should we block and wait before timing out? [0 = don't block]
-    int _i2cIoTimeoutMs;
-
-	// registered i2c device to send commands to (uses the new ESP-IDF >= 5.0 i2c API)
-	i2c_master_dev_handle_t _dev_handle;
-} MFRC5222;
-
-// TODO: doing this as a global means we can only have one device and there's global state.
-//  to support multiple devices, remove g_mfrc and instead pass around "struct MFRC5222* device" to each function in the API
-static MFRC5222 g_mfrc = {
-        ._resetPowerDownPin = -1,
-        ._logDebugInfo = false,
-        ._initialized = false,
-        ._i2cIoTimeoutMs = 1000,
-		._dev_handle = NULL,
-};
+#if MFRC_INCLUDE_ACCOUNTING == 1
+// counts the i2c transactions until the end of the enclosing function against op, unless an outer operation runs
+#define PCD_ACCOUNT_OP(dev, op)	\
+	const MFRC522_AccountingScope _accountingScope __attribute__((cleanup(MFRC522_Accounting_Leave))) = MFRC522_Accounting_Enter(dev, op)
+#else
+#define PCD_ACCOUNT_OP(dev, op)
+#endif
+
+#if MFRC_INCLUDE_STATS == 1
+// puts the time until the end of the enclosing function into the latency histogram of kind
+#define PCD_STATS_LATENCY(dev, kind)	\
+	const MFRC522_StatsScope _statsScope __attribute__((cleanup(MFRC522_Stats_Leave))) = MFRC522_Stats_Enter(dev, kind)
+#define PCD_STATS_STATUS(dev, status)		MFRC522_Stats_RecordStatus(dev, status)
+#define PCD_STATS_ERROR_REG(dev, value)		MFRC522_Stats_RecordErrorReg(dev, value)
+#define PCD_STATS_I2C_ERROR(dev, err)		MFRC522_Stats_RecordI2cError(dev, err)
+#else
+#define PCD_STATS_LATENCY(dev, kind)
+#define PCD_STATS_STATUS(dev, status)
+#define PCD_STATS_ERROR_REG(dev, value)
+#define PCD_STATS_I2C_ERROR(dev, err)
+#endif
+
+#if MFRC_LOG_LEVEL < 1
+#define PCD_LOG_I2C_ERROR(dev, reg, value, length, err)
+#elif MFRC_INCLUDE_LOG_RING == 1
+// records a failed i2c transaction for the log task, at most MFRC_LOG_SITE_BURST per function and period
+#define PCD_LOG_I2C_ERROR(dev, reg, value, length, err)	do {	\
+		static MFRC522_LogSite _logSite = {.function = __func__};	\
+		MFRC522_Log_I2cError(&_logSite, dev, reg, value, length, err);	\
+	} while (0)
+#else
+#define PCD_LOG_I2C_ERROR(dev, reg, value, length, err)	\
+	printf("MFRC: %s(reg 0x%02x) i2c err: %s\n", __func__, reg, esp_err_to_name(err))
+#endif
+
+
+#define CRC_OFFLOAD_TX	0x01
+#define CRC_OFFLOAD_RX	0x02
+
+// The reader used by the functions without a handle argument (the original single-reader API).
+// They are thin wrappers around the *_h() functions, see the end of this file.
+static MFRC522_Handle g_mfrc;
+
+// PICC_Inventory_h() gives up after this many failed REQA/SELECT attempts in a row
+#define INVENTORY_MAX_FAILURES	3
+
+// extra time allowed on top of the MFRC522 timer when sleeping on the IRQ line (frame transmission, i2c, tick granularity)
+#define IRQ_WAIT_MARGIN_MS	5
+
+// Registers that are shadowed, and which of their bits only ever change when the host writes them.
+// Bits not listed are read-only (their written value is ignored by the MFRC522) or self-clearing strobes
+// (FlushBuffer, StartSend), so a bit mask update can be done as a single write of the shadow value.
+// Volatile status registers (ComIrqReg, ErrorReg, Status2Reg, ...) are never shadowed.
+#define SHADOWED(reg)	(1ULL << (reg))
+static const uint64_t shadow_registers =
+		SHADOWED(ComIEnReg) | SHADOWED(DivIEnReg) | SHADOWED(FIFOLevelReg) | SHADOWED(WaterLevelReg) |
+		SHADOWED(BitFramingReg) | SHADOWED(CollReg) | SHADOWED(ModeReg) | SHADOWED(TxModeReg) | SHADOWED(RxModeReg) |
+		SHADOWED(TxControlReg) | SHADOWED(TxASKReg) | SHADOWED(TxSelReg) | SHADOWED(RxSelReg) | SHADOWED(RxThresholdReg) |
+		SHADOWED(DemodReg) | SHADOWED(MfTxReg) | SHADOWED(MfRxReg) | SHADOWED(ModWidthReg) | SHADOWED(RFCfgReg) |
+		SHADOWED(GsNReg) | SHADOWED(CWGsPReg) | SHADOWED(ModGsPReg) | SHADOWED(TModeReg) | SHADOWED(TPrescalerReg) |
+		SHADOWED(TReloadRegH) | SHADOWED(TReloadRegL);
+
+static uint8_t shadow_owned_bits(const uint8_t reg) {
+	switch (reg) {
+		case FIFOLevelReg:	return 0x00;	// FlushBuffer strobe, FIFOLevel[6:0] read-only
+		case BitFramingReg:	return 0x7F;	// StartSend strobe
+		case CollReg:		return 0x80;	// ValuesAfterColl, the rest is the read-only collision position
+		default:			return 0xFF;
+	}
+}
+
+static bool PCD_IsShadowed(const uint8_t reg) {
+	return reg < 0x40 && (shadow_registers & SHADOWED(reg));
+}
+
+// true if a bit mask update on reg can be done without reading it first
+static bool PCD_ShadowKnown(MFRC522_Handle *dev, const uint8_t reg) {
+	return PCD_IsShadowed(reg) && (shadow_owned_bits(reg) == 0 || (dev->_shadowValid & SHADOWED(reg)));
+}
+
+static void PCD_ShadowStore(MFRC522_Handle *dev, const uint8_t reg, const uint8_t value) {
+	if (PCD_IsShadowed(reg)) {
+		dev->_shadow[reg] = value & shadow_owned_bits(reg);
+		dev->_shadowValid |= SHADOWED(reg);
+	}
+}
+
+static void PCD_ShadowInvalidate(MFRC522_Handle *dev, const uint8_t reg) {
+	if (PCD_IsShadowed(reg))
+		dev->_shadowValid &= ~SHADOWED(reg);
+}
+
+// writes a shadowed register only if the value is different from what is already programmed
+static esp_err_t PCD_WriteRegisterCached(MFRC522_Handle *dev, const uint8_t reg, const uint8_t value) {
+	if ((dev->_shadowValid & SHADOWED(reg)) && dev->_shadow[reg] == (value & shadow_owned_bits(reg)))
+		return ESP_OK;
+	return PCD_WriteRegister_h(dev, reg, value);
+}
+
+static enum StatusCode PCD_CalculateCRC_Coprocessor(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, uint8_t *result);
+static esp_err_t PCD_SetCRCOffload(MFRC522_Handle *dev, bool txCRC, bool rxCRC);
 
 // --------------------------------------------------------------------------------
 // BEGIN HACKY FAKE ARDUINO SERIAL PRINTING API WRAPPER
@@ -68,6 +160,7 @@ enum Format {
     HEX=02,
 };
 
+#if MFRC_LOG_LEVEL >= 3
 // NOTE: can't directly use the most common ESP_LOGxxx() here
 //       because print() expects us to not put a newline in there
 static void serial_print(const char *msg)
@@ -96,21 +189,311 @@ static void serial_println_f(const int i, const enum Format format)
     serial_print_f(i, format);
     serial_print("\n");
 }
+#else
+// MFRC_LOG_LEVEL below info: the messages are compiled out
+#define serial_print(msg)					((void)(msg))
+#define serial_print_f(i, format)			((void)(i))
+#define serial_println(msg)					((void)(msg))
+#define serial_println_f(i, format)			((void)(i))
+#endif
 // ----------------------------------------
 // END FAKE ARDUINO WRAPPER STUFF
 // ----------------------------------------
 
+// ----------------------------------------
+// Line formatter of the dump functions (PCD_DumpVersionToSerial_h(), PICC_Dump*ToSerial_h()).
+// A line is built in a buffer on the stack and handed to the dump writer of the reader in one call, instead of
+// a printf per hex byte and per padding space. The text is the same as serial_print*() produced.
+// ----------------------------------------
+#define DUMP_LINE_SIZE 160		// longest line: a sector trailer with the inverted access bits warning, ~120 chars
+
+typedef struct {
+	MFRC522_Handle *dev;
+	size_t len;
+	char text[DUMP_LINE_SIZE];
+} DumpLine;
+
+static const char dump_hex_digits[] = "0123456789abcdef";
+
+static void dump_flush(DumpLine *line)
+{
+	if (line->len == 0)
+		return;
+	if (line->dev->_dumpWriter)
+		line->dev->_dumpWriter(line->dev->_dumpWriterCtx, line->text, line->len);
+	else
+		fwrite(line->text, 1, line->len, stdout);
+	line->len = 0;
+}
+
+// makes room for n more chars. only a line longer than the buffer reaches the writer in pieces.
+static char *dump_reserve(DumpLine *line, const size_t n)
+{
+	if (line->len + n > sizeof(line->text))
+		dump_flush(line);
+	char *out = &line->text[line->len];
+	line->len += n;
+	return out;
+}
+
+static void dump_str(DumpLine *line, const char *msg)
+{
+	for (size_t n = strlen(msg); n > 0; ) {
+		const size_t chunk = n < sizeof(line->text) ? n : sizeof(line->text);
+		memcpy(dump_reserve(line, chunk), msg, chunk);
+		msg += chunk;
+		n -= chunk;
+	}
+}
+
+// " 0a": a space and the byte as two lowercase hex digits
+static void dump_hex_byte(DumpLine *line, const uint8_t value)
+{
+	char *out = dump_reserve(line, 3);
+	out[0] = ' ';
+	out[1] = dump_hex_digits[value >> 4];
+	out[2] = dump_hex_digits[value & 0xF];
+}
+
+// value in lowercase hex without leading zeros, as printf("%x")
+static void dump_hex(DumpLine *line, uint32_t value)
+{
+	char digits[8];
+	uint8_t n = 0;
+	do {
+		digits[n++] = dump_hex_digits[value & 0xF];
+		value >>= 4;
+	} while (value);
+	char *out = dump_reserve(line, n);
+	while (n)
+		*out++ = digits[--n];
+}
+
+// value in decimal, right aligned in width chars, as printf("%*u")
+static void dump_dec(DumpLine *line, uint32_t value, const uint8_t width)
+{
+	char digits[10];
+	uint8_t n = 0;
+	do {
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	char *out = dump_reserve(line, width > n ? width : n);
+	for (uint8_t pad = n; pad < width; pad++)
+		*out++ = ' ';
+	while (n)
+		*out++ = digits[--n];
+}
+
+// ends the line and hands it to the writer
+static void dump_println(DumpLine *line, const char *msg)
+{
+	dump_str(line, msg);
+	*dump_reserve(line, 1) = '\n';
+	dump_flush(line);
+}
+// ----------------------------------------
+// END DUMP LINE FORMATTER
+// ----------------------------------------
+
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for setting up the Arduino
 /////////////////////////////////////////////////////////////////////////////////////
 
-bool MFRC522_Init(i2c_master_dev_handle_t dev_handle, const int resetPowerDownPin)
+MFRC522_Handle *MFRC522_DefaultHandle()
 {
-    g_mfrc._resetPowerDownPin = resetPowerDownPin; // -1 to skip
-	g_mfrc._initialized = true;
-	g_mfrc._dev_handle = dev_handle;
+	return &g_mfrc;
+}
 
-    return true;
+bool MFRC522_Init_h(MFRC522_Handle *dev, i2c_master_dev_handle_t dev_handle, const int resetPowerDownPin)
+{
+	return MFRC522_InitWithIrq_h(dev, dev_handle, resetPowerDownPin, GPIO_NUM_NC);
+}
+
+/**
+ * Wakes up the task waiting in PCD_WaitForIrq() when the MFRC522 asserts its IRQ line.
+ */
+static void IRAM_ATTR PCD_IrqHandler(void *arg)
+{
+	MFRC522_Handle *mfrc = (MFRC522_Handle *)arg;
+	const TaskHandle_t waiter = mfrc->_irqWaiter;
+	if (waiter == NULL)
+		return;
+
+	BaseType_t higherPriorityTaskWoken = pdFALSE;
+	vTaskNotifyGiveFromISR(waiter, &higherPriorityTaskWoken);
+	portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+bool MFRC522_InitWithIrq_h(MFRC522_Handle *dev, i2c_master_dev_handle_t dev_handle, const int resetPowerDownPin, const int irqPin)
+{
+	assert(dev);
+	if (!dev)
+		return false;
+
+	// handles may come from uninitialized memory: set up every field
+	memset(dev, 0, sizeof(*dev));
+    dev->_resetPowerDownPin = resetPowerDownPin; // -1 to skip
+	dev->_logDebugInfo = false;
+	dev->_i2cIoTimeoutMs = 1000;
+	dev->_crcMode = MFRC_DEFAULT_CRC_MODE;
+	dev->_maxBitRate = MFRC_MAX_BIT_RATE;
+	dev->_timeoutUs[PCD_TIMEOUT_DEFAULT] = MFRC_TIMEOUT_DEFAULT_US;
+	dev->_timeoutUs[PCD_TIMEOUT_REQA] = MFRC_TIMEOUT_REQA_US;
+	dev->_timeoutUs[PCD_TIMEOUT_HLTA] = MFRC_TIMEOUT_HLTA_US;
+	dev->_timeoutUs[PCD_TIMEOUT_SELECT] = MFRC_TIMEOUT_SELECT_US;
+	dev->_timeoutUs[PCD_TIMEOUT_AUTH] = MFRC_TIMEOUT_AUTH_US;
+	dev->_timeoutUs[PCD_TIMEOUT_READ] = MFRC_TIMEOUT_READ_US;
+	dev->_timeoutUs[PCD_TIMEOUT_WRITE] = MFRC_TIMEOUT_WRITE_US;
+	dev->_timeoutUs[PCD_TIMEOUT_ISO14443_4] = MFRC_TIMEOUT_ISO14443_4_US;
+	dev->_timeoutClass = PCD_TIMEOUT_DEFAULT;
+	dev->_initialized = true;
+	dev->_dev_handle = dev_handle;
+	dev->_irqPin = GPIO_NUM_NC;
+
+	if (irqPin == GPIO_NUM_NC)
+		return true;
+
+	// IRQ is driven active low (ComIEnReg IRqInv=1, DivIEnReg IRQPushPull=1, programmed in PCD_Init_h())
+	const gpio_config_t io_conf = {
+		.pin_bit_mask = 1ULL << irqPin,
+		.mode = GPIO_MODE_INPUT,
+		.pull_up_en = GPIO_PULLUP_ENABLE,
+		.pull_down_en = GPIO_PULLDOWN_DISABLE,
+		.intr_type = GPIO_INTR_NEGEDGE,
+	};
+	esp_err_t err = gpio_config(&io_conf);
+	if (err == ESP_OK) {
+		err = gpio_install_isr_service(0);
+		if (err == ESP_ERR_INVALID_STATE)
+			err = ESP_OK; // already installed by someone else
+	}
+	if (err == ESP_OK) {
+		// a reader initialised again on the same pin, without MFRC522_Deinit_h(), still has its handler there
+		gpio_isr_handler_remove((gpio_num_t)irqPin);
+		err = gpio_isr_handler_add((gpio_num_t)irqPin, PCD_IrqHandler, dev);
+	}
+
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "IRQ pin %d setup failed (%s), polling instead", irqPin, esp_err_to_name(err));
+		return true;
+	}
+
+	dev->_irqPin = irqPin;
+	return true;
+}
+
+/**
+ * Releases what MFRC522_InitWithIrq_h() set up: the IRQ pin handler. The GPIO ISR service stays installed, other
+ * drivers may use it. dev can be set up again with MFRC522_Init_h() afterwards.
+ */
+void MFRC522_Deinit_h(MFRC522_Handle *dev)
+{
+	if (!dev->_initialized)
+		return;
+	if (dev->_irqPin != GPIO_NUM_NC) {
+		gpio_isr_handler_remove((gpio_num_t)dev->_irqPin);
+		dev->_irqPin = GPIO_NUM_NC;
+	}
+	dev->_irqWaiter = NULL;
+	dev->_initialized = false;
+}
+
+#if MFRC_INCLUDE_SIMULATOR == 1
+/**
+ * Makes dev talk to a simulated MFRC522 instead of the i2c bus. Everything above the four register functions runs
+ * unchanged: the same transactions in the same order, so i2c counts and timings measured against the simulator
+ * carry over to hardware.
+ */
+void MFRC522_AttachSimulator_h(MFRC522_Handle *dev, struct MFRC522_Sim *sim)
+{
+	dev->_sim = sim;
+	if (sim)
+		dev->_simEpochUs = esp_timer_get_time() - sim->nowUs;
+	dev->_shadowValid = 0; // another register file
+}
+
+// Lets the simulated MFRC522 catch up with the time that passed since its last transaction (task delays, busy waits).
+static void PCD_SimSync(MFRC522_Handle *dev)
+{
+	const int64_t nowUs = esp_timer_get_time() - dev->_simEpochUs;
+	if (nowUs > dev->_sim->nowUs)
+		MFRC522_Sim_AdvanceUs(dev->_sim, nowUs - dev->_sim->nowUs);
+}
+#endif
+
+// The two kinds of i2c transaction the MFRC522 knows: a register write, and a register address write + read.
+static esp_err_t PCD_I2cTransmit(MFRC522_Handle *dev, const uint8_t *data, const size_t length)
+{
+	dev->_i2cTransactions++;
+#if MFRC_INCLUDE_ACCOUNTING == 1
+	MFRC522_Accounting_Transaction(dev, data[0], false, 1 + length);		// slave address, register, data
+#endif
+#if MFRC_INCLUDE_SIMULATOR == 1
+	if (dev->_sim) {
+		PCD_SimSync(dev);
+		return MFRC522_Sim_Transmit(dev->_sim, data, length);
+	}
+#endif
+	return i2c_master_transmit(dev->_dev_handle, data, length, dev->_i2cIoTimeoutMs);
+}
+
+// A register write with the data in pieces, still one transaction: the register address and the pieces go out back to back.
+static esp_err_t PCD_I2cTransmitSegments(MFRC522_Handle *dev, const uint8_t reg, const PCD_Segment *segments, const uint8_t count,
+										const size_t length)	///< total of the segments
+{
+	dev->_i2cTransactions++;
+#if MFRC_INCLUDE_ACCOUNTING == 1
+	MFRC522_Accounting_Transaction(dev, reg, false, 2 + length);			// slave address, register, data
+#endif
+#if MFRC_INCLUDE_SIMULATOR == 1
+	if (dev->_sim) {
+		PCD_SimSync(dev);
+		return MFRC522_Sim_TransmitSegments(dev->_sim, reg, segments, count);
+	}
+#endif
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+	// i2c_master_multi_buffer_transmit() came with ESP-IDF 5.4. it only reads the buffers, the casts are for its non-const API
+	i2c_master_transmit_multi_buffer_info_t buffers[1 + MFRC_MAX_SEGMENTS];
+	buffers[0].write_buffer = (uint8_t *)&reg;
+	buffers[0].buffer_size = 1;
+	size_t used = 1;
+	for (uint8_t i = 0; i < count; i++) {
+		if (segments[i].length) {
+			buffers[used].write_buffer = (uint8_t *)segments[i].data;
+			buffers[used].buffer_size = segments[i].length;
+			used++;
+		}
+	}
+	return i2c_master_multi_buffer_transmit(dev->_dev_handle, buffers, used, dev->_i2cIoTimeoutMs);
+#else
+	// no scatter-gather in this driver: gather into a buffer of FIFO size
+	uint8_t buffer[1 + 64];
+	if (length > 64)
+		return ESP_ERR_INVALID_SIZE;
+	buffer[0] = reg;
+	size_t used = 1;
+	for (uint8_t i = 0; i < count; i++) {
+		memcpy(&buffer[used], segments[i].data, segments[i].length);
+		used += segments[i].length;
+	}
+	return i2c_master_transmit(dev->_dev_handle, buffer, used, dev->_i2cIoTimeoutMs);
+#endif
+}
+
+static esp_err_t PCD_I2cTransmitReceive(MFRC522_Handle *dev, const uint8_t reg, uint8_t *values, const size_t count)
+{
+	dev->_i2cTransactions++;
+#if MFRC_INCLUDE_ACCOUNTING == 1
+	MFRC522_Accounting_Transaction(dev, reg, true, 3 + count);			// slave address, register, slave address, data
+#endif
+#if MFRC_INCLUDE_SIMULATOR == 1
+	if (dev->_sim) {
+		PCD_SimSync(dev);
+		return MFRC522_Sim_TransmitReceive(dev->_sim, &reg, 1, values, count);
+	}
+#endif
+	return i2c_master_transmit_receive(dev->_dev_handle, &reg, 1, values, count, dev->_i2cIoTimeoutMs);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -121,63 +504,94 @@ bool MFRC522_Init(i2c_master_dev_handle_t dev_handle, const int resetPowerDownPi
  * The interface is described in the datasheet section 8.1.2.
  * Note: this will BLOCK while waiting for the I2C IO
  */
-esp_err_t PCD_WriteRegister(const uint8_t reg,    ///< The register to write to. One of the PCD_Register enums.
+esp_err_t PCD_WriteRegister_h(MFRC522_Handle *dev, const uint8_t reg,    ///< The register to write to. One of the PCD_Register enums.
 							const uint8_t value   ///< The value to write.
                       ) {
     const uint8_t write_data[] = {reg, value};
-    const esp_err_t err = i2c_master_transmit(g_mfrc._dev_handle, write_data, 2, g_mfrc._i2cIoTimeoutMs);
-	if (err != ESP_OK)
-        printf("MFRC: %s(%d, %d) i2c err: %s\n", __FUNCTION__, reg, value, esp_err_to_name(err));
+    const esp_err_t err = PCD_I2cTransmit(dev, write_data, 2);
+	if (err != ESP_OK) {
+        PCD_LOG_I2C_ERROR(dev, reg, value, 1, err);
+        PCD_STATS_I2C_ERROR(dev, err);
+		PCD_ShadowInvalidate(dev, reg); // we don't know whether the write made it
+		return err;
+	}
 
+	PCD_ShadowStore(dev, reg, value);
 	return err;
-} // End PCD_WriteRegister()
+} // End PCD_WriteRegister_h()
 
 /**
  * Writes a number of bytes to the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
  */
-esp_err_t PCD_WriteRegisterData(const uint8_t reg,      ///< The register to write to. One of the PCD_Register enums.
+esp_err_t PCD_WriteRegisterData_h(MFRC522_Handle *dev, const uint8_t reg,      ///< The register to write to. One of the PCD_Register enums.
 								const uint8_t count,     ///< The number of bytes to write to the register
 								const uint8_t *values    ///< The values to write. Byte array.
                           ) {
-    if (count == 0) {
-        return ESP_OK;
-    }
+	const PCD_Segment segment = {values, count};
+	return PCD_WriteRegisterSegments_h(dev, reg, &segment, 1);
+} // End PCD_WriteRegisterData_h()
 
-    // Create buffer with register + data
-    uint8_t write_buf[count + 1];
-    write_buf[0] = reg;
-    memcpy(&write_buf[1], values, count);
+/**
+ * Writes the bytes of a segment list to the specified register in one i2c transaction, without copying them
+ * together first: e.g. a frame header, its data and the CRC_A from three buffers into FIFODataReg.
+ */
+esp_err_t PCD_WriteRegisterSegments_h(MFRC522_Handle *dev, const uint8_t reg,	///< The register to write to. One of the PCD_Register enums.
+									const PCD_Segment *segments,	///< The pieces, written in order. Empty ones are skipped.
+									const uint8_t count				///< Number of segments, at most MFRC_MAX_SEGMENTS.
+						) {
+	if (count > MFRC_MAX_SEGMENTS) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	size_t length = 0;
+	const PCD_Segment *last = NULL;			// the last segment with data
+	for (uint8_t i = 0; i < count; i++) {
+		if (segments[i].length) {
+			length += segments[i].length;
+			last = &segments[i];
+		}
+	}
+	if (length == 0) {
+		return ESP_OK;
+	}
 
-    const esp_err_t err = i2c_master_transmit(g_mfrc._dev_handle, write_buf, count + 1, g_mfrc._i2cIoTimeoutMs);
-    if (err != ESP_OK) {
-	    printf("%s: MFRC i2c err: %s\n", __FUNCTION__, esp_err_to_name(err));
-    }
+	const esp_err_t err = PCD_I2cTransmitSegments(dev, reg, segments, count, length);
+	if (err != ESP_OK) {
+		PCD_LOG_I2C_ERROR(dev, reg, last->data[last->length - 1], length, err);
+		PCD_STATS_I2C_ERROR(dev, err);
+		PCD_ShadowInvalidate(dev, reg);
+		return err;
+	}
 
+	PCD_ShadowStore(dev, reg, last->data[last->length - 1]); // every byte lands in the same register, the last one sticks
 	return err;
-} // End PCD_WriteRegisterData()
+} // End PCD_WriteRegisterSegments_h()
 
 /**
  * Reads a byte from the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
  * Note: this will BLOCK while waiting for the I2C IO
  */
-esp_err_t PCD_ReadRegister(const uint8_t reg,   ///< The register to read from. One of the PCD_Register enums.
+esp_err_t PCD_ReadRegister_h(MFRC522_Handle *dev, const uint8_t reg,   ///< The register to read from. One of the PCD_Register enums.
 							uint8_t* val_out	///< Output value to write to
 ) {
-    const esp_err_t err = i2c_master_transmit_receive(g_mfrc._dev_handle, &reg, 1, val_out, 1, g_mfrc._i2cIoTimeoutMs);
-    if (err != ESP_OK)
-        printf("MFRC:%s(%d) i2c err: %s\n", __FUNCTION__, reg, esp_err_to_name(err));
+    const esp_err_t err = PCD_I2cTransmitReceive(dev, reg, val_out, 1);
+    if (err != ESP_OK) {
+        PCD_LOG_I2C_ERROR(dev, reg, 0, 1, err);
+        PCD_STATS_I2C_ERROR(dev, err);
+        return err;
+    }
 
+    PCD_ShadowStore(dev, reg, *val_out);
     return err;
-} // End PCD_ReadRegister()
+} // End PCD_ReadRegister_h()
 
 /**
  * Reads a number of bytes from the specified register in the MFRC522 chip.
  * The interface is described in the datasheet section 8.1.2.
  * Note: this will BLOCK while waiting for the I2C IO
  */
-esp_err_t PCD_ReadRegisterData(const uint8_t reg,        ///< The register to read from. One of the PCD_Register enums.
+esp_err_t PCD_ReadRegisterData_h(MFRC522_Handle *dev, const uint8_t reg,        ///< The register to read from. One of the PCD_Register enums.
                          const uint8_t count,       ///< The number of bytes to read
                          uint8_t* const values,     ///< Byte array to store the values in.
                          const uint8_t rxAlign      ///< Only bit positions rxAlign..7 in values[0] are updated.
@@ -185,80 +599,407 @@ esp_err_t PCD_ReadRegisterData(const uint8_t reg,        ///< The register to re
     if (count == 0)
         return ESP_OK; // technically?
 
-    *values = 0;
+    const uint8_t value0 = values[0];		// bits 0..rxAlign-1 are kept
 
-    const esp_err_t err = i2c_master_transmit_receive(g_mfrc._dev_handle, &reg, 1, values, count, g_mfrc._i2cIoTimeoutMs);
+    const esp_err_t err = PCD_I2cTransmitReceive(dev, reg, values, count);
     if (err != ESP_OK) {
-        printf("%s: MFRC i2c err: %s\n", __FUNCTION__, esp_err_to_name(err));
+        PCD_LOG_I2C_ERROR(dev, reg, 0, count, err);
+        PCD_STATS_I2C_ERROR(dev, err);
         return err;
     }
 
-    // If rxAlign is used, adjust the first byte
+    // If rxAlign is used, merge the received bits into the first byte
     if (rxAlign != 0) {
-        const uint8_t mask = ((1 << (rxAlign + 1)) - 1) << (7 - rxAlign);
-        values[0] = (values[0] & ~mask) | (values[0] & mask);
+        const uint8_t mask = (uint8_t)(0xFF << rxAlign);
+        values[0] = (value0 & ~mask) | (values[0] & mask);
     }
 
 	return ESP_OK;
-} // End PCD_ReadRegisterData()
+} // End PCD_ReadRegisterData_h()
+/**
+ * Gets the current value of reg for a read-modify-write.
+ * Shadowed registers come from the host-side copy, everything else is read from the MFRC522.
+ */
+static esp_err_t PCD_ReadRegisterForUpdate(MFRC522_Handle *dev, const uint8_t reg, uint8_t* val_out) {
+	if (!PCD_ShadowKnown(dev, reg))
+		return PCD_ReadRegister_h(dev, reg, val_out);
+
+	*val_out = dev->_shadow[reg];
+#if MFRC_SHADOW_VERIFY == 1
+	uint8_t hw;
+	const esp_err_t err = PCD_ReadRegister_h(dev, reg, &hw); // also re-syncs the shadow
+	if (err != ESP_OK)
+		return err;
+	if ((hw & shadow_owned_bits(reg)) != *val_out) {
+		ESP_LOGE(TAG, "shadow mismatch reg 0x%02x: shadow 0x%02x, MFRC522 0x%02x", reg, *val_out, hw);
+		*val_out = hw;
+	}
+#endif
+	return ESP_OK;
+}
+
 /**
  * Sets the bits given in mask in register reg.
+ * For shadowed configuration registers this is a single write.
  */
-esp_err_t PCD_SetRegisterBitMask(const uint8_t reg,	///< The register to update. One of the PCD_Register enums.
+esp_err_t PCD_SetRegisterBitMask_h(MFRC522_Handle *dev, const uint8_t reg,	///< The register to update. One of the PCD_Register enums.
                                  const uint8_t mask	///< The bits to set.
 									) {
     uint8_t tmp;
-	const esp_err_t err = PCD_ReadRegister(reg, &tmp);
+	const esp_err_t err = PCD_ReadRegisterForUpdate(dev, reg, &tmp);
 	if (err != ESP_OK)
 		return err;
 
-	return PCD_WriteRegister(reg, tmp | mask);			// set bit mask
-} // End PCD_SetRegisterBitMask()
+	return PCD_WriteRegister_h(dev, reg, tmp | mask);			// set bit mask
+} // End PCD_SetRegisterBitMask_h()
 
 /**
  * Clears the bits given in mask from register reg.
+ * For shadowed configuration registers this is a single write.
  */
-esp_err_t PCD_ClearRegisterBitMask(const uint8_t reg,	///< The register to update. One of the PCD_Register enums.
+esp_err_t PCD_ClearRegisterBitMask_h(MFRC522_Handle *dev, const uint8_t reg,	///< The register to update. One of the PCD_Register enums.
                                    const uint8_t mask	///< The bits to clear.
 									  ) {
     uint8_t tmp;
-	const esp_err_t err = PCD_ReadRegister(reg, &tmp);
+	const esp_err_t err = PCD_ReadRegisterForUpdate(dev, reg, &tmp);
 	if (err != ESP_OK)
 		return err;
 
-	return PCD_WriteRegister(reg, tmp & (~mask));		// clear bit mask
-} // End PCD_ClearRegisterBitMask()
+	return PCD_WriteRegister_h(dev, reg, tmp & (~mask));		// clear bit mask
+} // End PCD_ClearRegisterBitMask_h()
+
+/**
+ * Debug helper: reads back every shadowed register we have a value for and compares it with the host-side copy.
+ * Mismatches are logged and the shadow is re-synced from the MFRC522.
+ *
+ * @return ESP_OK if everything matched, ESP_ERR_INVALID_STATE on a mismatch, or the i2c error.
+ */
+esp_err_t PCD_VerifyShadowRegisters_h(MFRC522_Handle *dev) {
+	esp_err_t result = ESP_OK;
+	for (uint8_t reg = 0; reg < 0x40; reg++) {
+		if (!(dev->_shadowValid & SHADOWED(reg)))
+			continue;
+
+		const uint8_t expected = dev->_shadow[reg];
+		uint8_t hw;
+		const esp_err_t err = PCD_ReadRegister_h(dev, reg, &hw);
+		if (err != ESP_OK)
+			return err;
+
+		if ((hw & shadow_owned_bits(reg)) != expected) {
+			ESP_LOGE(TAG, "shadow mismatch reg 0x%02x: shadow 0x%02x, MFRC522 0x%02x", reg, expected, hw);
+			result = ESP_ERR_INVALID_STATE;
+		}
+	}
+	return result;
+} // End PCD_VerifyShadowRegisters_h()
 
 
 /**
- * Use the CRC coprocessor in the MFRC522 to calculate a CRC_A.
+ * The time the MFRC522 timer runs before it raises TimerIRq, from the shadowed timer registers.
+ * Falls back to the PCD_TIMEOUT_DEFAULT timeout PCD_Init_h() programs if the registers have not been written yet.
+ */
+static uint32_t PCD_TimerPeriodUs(MFRC522_Handle *dev) {
+	const uint64_t timer_regs = SHADOWED(TModeReg) | SHADOWED(TPrescalerReg) | SHADOWED(TReloadRegH) | SHADOWED(TReloadRegL);
+	if ((dev->_shadowValid & timer_regs) != timer_regs)
+		return dev->_timeoutUs[PCD_TIMEOUT_DEFAULT];
+
+	// f_timer = 13.56 MHz / (2*TPreScaler+1), the timer fires after TReload+1 ticks
+	const uint32_t prescaler = ((dev->_shadow[TModeReg] & 0x0F) << 8) | dev->_shadow[TPrescalerReg];
+	const uint32_t reload = (dev->_shadow[TReloadRegH] << 8) | dev->_shadow[TReloadRegL];
+	return (uint32_t)(((uint64_t)(reload + 1) * (2 * prescaler + 1) * 100) / 1356);
+}
+
+/**
+ * Prepares to sleep until the MFRC522 raises one of the irqBits on its IRQ pin. Call before starting the command.
+ * irqReg is ComIrqReg or DivIrqReg; the enable bits go to the matching ComIEnReg/DivIEnReg.
+ */
+static esp_err_t PCD_ArmIrq(MFRC522_Handle *dev, const uint8_t irqReg, const uint8_t irqBits) {
+	esp_err_t err;
+	if (irqReg == ComIrqReg) {
+		if (dev->_divIrqPending) {
+			err = PCD_WriteRegister_h(dev, DivIrqReg, 0x14);			// Clear MfinActIRq and CRCIRq, they would hold the line low
+			if (err != ESP_OK) return err;
+			dev->_divIrqPending = false;
+		}
+		err = PCD_WriteRegisterCached(dev, ComIEnReg, 0x80 | irqBits);	// IRqInv=1 => active low
+	}
+	else {
+		if (dev->_comIrqPending) {
+			err = PCD_WriteRegister_h(dev, ComIrqReg, 0x7F);
+			if (err != ESP_OK) return err;
+			dev->_comIrqPending = false;
+		}
+		err = PCD_WriteRegisterCached(dev, DivIEnReg, 0x80 | irqBits);	// IRQPushPull=1 => CMOS output
+	}
+	if (err != ESP_OK) return err;
+
+	ulTaskNotifyTake(pdTRUE, 0);	// drop a stale notification
+	dev->_irqWaiter = xTaskGetCurrentTaskHandle();
+	return ESP_OK;
+}
+
+/**
+ * Sleeps until the IRQ pin fires or the MFRC522 timer (plus a margin) has certainly expired.
+ * The caller then reads the interrupt request register as usual; on a missed edge that is the polling fallback.
+ */
+static void PCD_WaitForIrq(MFRC522_Handle *dev, const uint8_t irqReg) {
+	const TickType_t ticks = pdMS_TO_TICKS(PCD_TimerPeriodUs(dev) / 1000 + IRQ_WAIT_MARGIN_MS) + 1;
+	ulTaskNotifyTake(pdTRUE, ticks);
+	dev->_irqWaiter = NULL;
+
+	if (irqReg == ComIrqReg)
+		dev->_comIrqPending = true;
+	else
+		dev->_divIrqPending = true;
+}
+
+/**
+ * Calculates a CRC_A, either on the host or with the CRC coprocessor in the MFRC522 depending on PCD_SetCRCMode_h().
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PCD_CalculateCRC(	const uint8_t *data,		///< In: Pointer to the data to transfer to the FIFO for CRC calculation.
-									const uint8_t length,	    ///< In: The number of bytes to transfer.
+enum StatusCode PCD_CalculateCRC_h(MFRC522_Handle *dev, 	const uint8_t *data,		///< In: Pointer to the data to calculate the CRC_A over.
+									const uint8_t length,	    ///< In: The number of bytes.
 									uint8_t *result				///< Out: Pointer to result buffer. Result is written to result[0..1], low byte first.
 					 ) {
-	esp_err_t err = PCD_WriteRegister(CommandReg, PCD_Idle);		// Stop any active command.
+	const PCD_Segment segment = {data, length};
+	return PCD_CalculateCRCSegments_h(dev, &segment, 1, result);
+} // End PCD_CalculateCRC_h()
+
+/**
+ * PCD_CalculateCRC_h() over the concatenation of a segment list, which is not copied together.
+ * The coprocessor takes at most 64 bytes (its FIFO).
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_CalculateCRCSegments_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< In: The data to calculate the CRC_A over.
+											const uint8_t count,			///< In: Number of segments, at most MFRC_MAX_SEGMENTS.
+											uint8_t *result					///< Out: Result is written to result[0..1], low byte first.
+					 ) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_CRC);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_CRC);
+	if (dev->_crcMode != PCD_CRC_COPROCESSOR) {
+		uint16_t crc = CRC_A_PRESET;
+		for (uint8_t i = 0; i < count; i++) {
+			crc = CRC_A_Update(crc, segments[i].data, segments[i].length);
+		}
+		result[0] = crc & 0xFF;
+		result[1] = crc >> 8;
+		return STATUS_OK;
+	}
+	return PCD_CalculateCRC_Coprocessor(dev, segments, count, result);
+} // End PCD_CalculateCRCSegments_h()
+
+/**
+ * Selects where PCD_CalculateCRC_h() calculates CRC_A values. See MFRC_DEFAULT_CRC_MODE.
+ */
+void PCD_SetCRCMode_h(MFRC522_Handle *dev, const enum PCD_CRCMode mode) {
+	dev->_crcMode = mode;
+} // End PCD_SetCRCMode_h()
+
+enum PCD_CRCMode PCD_GetCRCMode_h(MFRC522_Handle *dev) {
+	return dev->_crcMode;
+} // End PCD_GetCRCMode_h()
+
+/**
+ * Programs the MFRC522 timer to raise TimerIRq timeoutUs after it starts.
+ * Up to ~1.6s the prescaler of PCD_Init_h() is used, a resolution of ~25us. Longer timeouts, e.g. the frame waiting
+ * times of ISO/IEC 14443-4, need a coarser prescaler: the smallest one that reaches the timeout is programmed.
+ * The registers are shadowed, so programming the same timeout again costs no i2c traffic.
+ */
+static esp_err_t PCD_ProgramTimer(MFRC522_Handle *dev, uint32_t timeoutUs	///< Rounded up to the timer resolution, at most ~39.6s.
+								) {
+	// the timer fires after TReload+1 ticks of (2*TPreScaler+1) / 13.56 MHz
+	const uint64_t cycles = ((uint64_t)timeoutUs * 1356 + 99) / 100;
+	uint32_t prescaler = 0x0A9;
+	if (cycles > (uint64_t)0x10000 * (2 * prescaler + 1)) {
+		const uint64_t cyclesPerTick = (cycles + 0xFFFF) / 0x10000;
+		prescaler = cyclesPerTick / 2 < 0xFFF ? cyclesPerTick / 2 : 0xFFF;
+	}
+	const uint8_t tMode = dev->_shadowValid & SHADOWED(TModeReg) ? dev->_shadow[TModeReg] & 0xF0 : 0x80;	// keep TAuto
+	esp_err_t err = PCD_WriteRegisterCached(dev, TModeReg, tMode | (prescaler >> 8));
+	if (err != ESP_OK) return err;
+	err = PCD_WriteRegisterCached(dev, TPrescalerReg, prescaler & 0xFF);
+	if (err != ESP_OK) return err;
+
+	uint64_t ticks = (cycles + 2 * prescaler) / (2 * prescaler + 1);
+	if (ticks < 1)
+		ticks = 1;
+	if (ticks > 0x10000)
+		ticks = 0x10000;
+	const uint16_t reload = ticks - 1;
+
+	err = PCD_WriteRegisterCached(dev, TReloadRegH, reload >> 8);
+	if (err != ESP_OK) return err;
+	return PCD_WriteRegisterCached(dev, TReloadRegL, reload & 0xFF);
+} // End PCD_ProgramTimer()
+
+/**
+ * Programs the timeout of the command about to start: the one chosen with PCD_UseCommandTimeout_h(), else
+ * PCD_TIMEOUT_DEFAULT. Consecutive commands of the same class leave the timer registers alone.
+ */
+static esp_err_t PCD_ApplyCommandTimeout(MFRC522_Handle *dev) {
+	const uint8_t timeoutClass = dev->_timeoutClass;
+	dev->_timeoutClass = PCD_TIMEOUT_DEFAULT;
+	return PCD_ProgramTimer(dev, dev->_timeoutUs[timeoutClass]);
+} // End PCD_ApplyCommandTimeout()
+
+/**
+ * Sets how long the MFRC522 waits for a PICC answer before TimerIRq ends the command, for the commands of
+ * PCD_TIMEOUT_DEFAULT (MFRC_TIMEOUT_DEFAULT_US after MFRC522_Init_h()). The timer is programmed right away.
+ */
+esp_err_t PCD_SetTimeoutUs_h(MFRC522_Handle *dev, uint32_t timeoutUs	///< Rounded up to the timer resolution, at most ~39.6s.
+								) {
+	dev->_timeoutUs[PCD_TIMEOUT_DEFAULT] = timeoutUs;
+	return PCD_ProgramTimer(dev, timeoutUs);
+} // End PCD_SetTimeoutUs_h()
+
+/**
+ * The timeout set with PCD_SetTimeoutUs_h().
+ */
+uint32_t PCD_GetTimeoutUs_h(MFRC522_Handle *dev) {
+	return dev->_timeoutUs[PCD_TIMEOUT_DEFAULT];
+} // End PCD_GetTimeoutUs_h()
+
+/**
+ * Sets the timeout of a kind of command (MFRC_TIMEOUT_DEFAULT_US & co. after MFRC522_Init_h()). It is programmed
+ * when the next command of that kind starts.
+ */
+void PCD_SetCommandTimeoutUs_h(MFRC522_Handle *dev, const enum PCD_TimeoutClass timeoutClass,
+								uint32_t timeoutUs		///< Rounded up to the timer resolution, at most ~39.6s.
+								) {
+	if (timeoutClass < PCD_TIMEOUT_CLASSES) {
+		dev->_timeoutUs[timeoutClass] = timeoutUs;
+	}
+} // End PCD_SetCommandTimeoutUs_h()
+
+uint32_t PCD_GetCommandTimeoutUs_h(MFRC522_Handle *dev, const enum PCD_TimeoutClass timeoutClass) {
+	return timeoutClass < PCD_TIMEOUT_CLASSES ? dev->_timeoutUs[timeoutClass] : 0;
+} // End PCD_GetCommandTimeoutUs_h()
+
+/**
+ * The next command started runs with the timeout of timeoutClass; the ones after it with PCD_TIMEOUT_DEFAULT again.
+ */
+void PCD_UseCommandTimeout_h(MFRC522_Handle *dev, const enum PCD_TimeoutClass timeoutClass) {
+	dev->_timeoutClass = timeoutClass < PCD_TIMEOUT_CLASSES ? timeoutClass : PCD_TIMEOUT_DEFAULT;
+} // End PCD_UseCommandTimeout_h()
+
+/**
+ * Sets the bit rates of the link: TxSpeed (PCD->PICC) in TxModeReg, RxSpeed (PICC->PCD) in RxModeReg, and the width
+ * of the modulation pulse in ModWidthReg, which has to shrink with the bit period (values of NXP AN10834).
+ * Rates above the maximum of the reader (PCD_SetMaxBitRate_h()) are lowered to it. The registers are shadowed,
+ * so going back to the rate that is already programmed costs no i2c traffic.
+ * Above 106 kbit/s the MFRC522 only works with TxCRCEn/RxCRCEn set, see PCD_CRCInHardware().
+ */
+esp_err_t PCD_SetBitRate_h(MFRC522_Handle *dev, enum PCD_BitRate txRate, enum PCD_BitRate rxRate) {
+	static const uint8_t modWidth[4] = { 0x26, 0x15, 0x0A, 0x05 };
+	if (txRate > dev->_maxBitRate)
+		txRate = dev->_maxBitRate;
+	if (rxRate > dev->_maxBitRate)
+		rxRate = dev->_maxBitRate;
+
+	uint8_t value;
+	esp_err_t err = PCD_ReadRegisterForUpdate(dev, TxModeReg, &value);
+	if (err != ESP_OK) return err;
+	err = PCD_WriteRegisterCached(dev, TxModeReg, (value & ~0x70) | (txRate << 4));
+	if (err != ESP_OK) return err;
+	dev->_txBitRate = txRate;
+
+	err = PCD_ReadRegisterForUpdate(dev, RxModeReg, &value);
+	if (err != ESP_OK) return err;
+	err = PCD_WriteRegisterCached(dev, RxModeReg, (value & ~0x70) | (rxRate << 4));
+	if (err != ESP_OK) return err;
+	dev->_rxBitRate = rxRate;
+
+	return PCD_WriteRegisterCached(dev, ModWidthReg, modWidth[txRate]);
+} // End PCD_SetBitRate_h()
+
+void PCD_GetBitRate_h(MFRC522_Handle *dev, enum PCD_BitRate *txRate, enum PCD_BitRate *rxRate) {
+	if (txRate) *txRate = dev->_txBitRate;
+	if (rxRate) *rxRate = dev->_rxBitRate;
+} // End PCD_GetBitRate_h()
+
+/**
+ * Sets the highest bit rate PCD_SetBitRate_h() programs on this reader. See MFRC_MAX_BIT_RATE.
+ * Does not change the rate in use.
+ */
+void PCD_SetMaxBitRate_h(MFRC522_Handle *dev, const enum PCD_BitRate maxRate) {
+	dev->_maxBitRate = maxRate;
+} // End PCD_SetMaxBitRate_h()
+
+enum PCD_BitRate PCD_GetMaxBitRate_h(MFRC522_Handle *dev) {
+	return dev->_maxBitRate;
+} // End PCD_GetMaxBitRate_h()
+
+/**
+ * True if frames with CRC_A get it appended and checked by the MFRC522: in PCD_CRC_HARDWARE mode, and always above
+ * 106 kbit/s, where TxCRCEn/RxCRCEn cannot be cleared.
+ */
+static bool PCD_CRCInHardware(MFRC522_Handle *dev) {
+	return dev->_crcMode == PCD_CRC_HARDWARE || dev->_txBitRate != PCD_BITRATE_106 || dev->_rxBitRate != PCD_BITRATE_106;
+}
+
+/**
+ * Programs TxCRCEn (TxModeReg bit 7) and RxCRCEn (RxModeReg bit 7).
+ * The registers are only written when the requested state differs from what is currently programmed.
+ */
+static esp_err_t PCD_SetCRCOffload(MFRC522_Handle *dev, const bool txCRC,	///< True => the MFRC522 appends CRC_A to transmitted frames.
+								   const bool rxCRC		///< True => the MFRC522 checks and strips the CRC_A of received frames, CRCErr in ErrorReg.
+								   ) {
+	esp_err_t err;
+	if (txCRC != ((dev->_crcOffload & CRC_OFFLOAD_TX) != 0)) {
+		err = txCRC ? PCD_SetRegisterBitMask_h(dev, TxModeReg, 0x80) : PCD_ClearRegisterBitMask_h(dev, TxModeReg, 0x80);
+		if (err != ESP_OK) return err;
+		dev->_crcOffload ^= CRC_OFFLOAD_TX;
+	}
+	if (rxCRC != ((dev->_crcOffload & CRC_OFFLOAD_RX) != 0)) {
+		err = rxCRC ? PCD_SetRegisterBitMask_h(dev, RxModeReg, 0x80) : PCD_ClearRegisterBitMask_h(dev, RxModeReg, 0x80);
+		if (err != ESP_OK) return err;
+		dev->_crcOffload ^= CRC_OFFLOAD_RX;
+	}
+	return ESP_OK;
+} // End PCD_SetCRCOffload()
+
+/**
+ * Use the CRC coprocessor in the MFRC522 to calculate a CRC_A.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+static enum StatusCode PCD_CalculateCRC_Coprocessor(MFRC522_Handle *dev, 	const PCD_Segment *segments,	///< In: The data to transfer to the FIFO for CRC calculation.
+														const uint8_t count,	    ///< In: The number of segments.
+														uint8_t *result				///< Out: Pointer to result buffer. Result is written to result[0..1], low byte first.
+					 ) {
+	esp_err_t err = PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);		// Stop any active command.
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_WriteRegister(DivIrqReg, 0x04);				// Clear the CRCIRq interrupt request bit
+	err = PCD_WriteRegister_h(dev, DivIrqReg, 0x04);				// Clear the CRCIRq interrupt request bit
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_SetRegisterBitMask(FIFOLevelReg, 0x80);		// FlushBuffer = 1, FIFO initialization
+	err = PCD_SetRegisterBitMask_h(dev, FIFOLevelReg, 0x80);		// FlushBuffer = 1, FIFO initialization
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_WriteRegisterData(FIFODataReg, length, data);	// Write data to the FIFO
+	err = PCD_WriteRegisterSegments_h(dev, FIFODataReg, segments, count);	// Write data to the FIFO
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_WriteRegister(CommandReg, PCD_CalcCRC);		// Start the calculation
+	const bool useIrq = dev->_irqPin != GPIO_NUM_NC;
+	if (useIrq) {
+		err = PCD_ArmIrq(dev, DivIrqReg, 0x04);					// CRCIEn
+		if (err != ESP_OK) return STATUS_ERROR;
+	}
+
+	err = PCD_WriteRegister_h(dev, CommandReg, PCD_CalcCRC);		// Start the calculation
 	if (err != ESP_OK) return STATUS_ERROR;
 
+	if (useIrq) {
+		PCD_WaitForIrq(dev, DivIrqReg);
+	}
+
 	// Wait for the CRC calculation to complete. Each iteration of the while-loop takes 17.73�s.
     unsigned int i = 5000;
 	while (1) {
 		uint8_t n;
-		err = PCD_ReadRegister(DivIrqReg, &n);	// DivIrqReg[7..0] bits are: Set2 reserved reserved MfinActIRq reserved CRCIRq reserved reserved
+		err = PCD_ReadRegister_h(dev, DivIrqReg, &n);	// DivIrqReg[7..0] bits are: Set2 reserved reserved MfinActIRq reserved CRCIRq reserved reserved
 		if (err != ESP_OK)
 			return STATUS_ERROR;
 
@@ -269,22 +1010,22 @@ enum StatusCode PCD_CalculateCRC(	const uint8_t *data,		///< In: Pointer to the
 			return STATUS_TIMEOUT;
 		}
 	}
-	err = PCD_WriteRegister(CommandReg, PCD_Idle);		// Stop calculating CRC for new content in the FIFO.
+	err = PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);		// Stop calculating CRC for new content in the FIFO.
 	if (err != ESP_OK)
 		return STATUS_ERROR;
 
 	// Transfer the result from the registers to the result buffer
 
-	err = PCD_ReadRegister(CRCResultRegL, &result[0]);
+	err = PCD_ReadRegister_h(dev, CRCResultRegL, &result[0]);
 	if (err != ESP_OK)
 		return STATUS_ERROR;
 
-	err = PCD_ReadRegister(CRCResultRegH, &result[1]);
+	err = PCD_ReadRegister_h(dev, CRCResultRegH, &result[1]);
 	if (err != ESP_OK)
 		return STATUS_ERROR;
 
 	return STATUS_OK;
-} // End PCD_CalculateCRC()
+} // End PCD_CalculateCRC_Coprocessor()
 
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -293,13 +1034,13 @@ enum StatusCode PCD_CalculateCRC(	const uint8_t *data,		///< In: Pointer to the
 
 /// NOTE: please customize GPIO initialization to suit your project's needs
 /// return false if software reset is still needed, true if we handled it here
-bool PCD_HardGpioReset()
+static bool PCD_HardGpioReset(MFRC522_Handle *dev)
 {
     // Set the resetPowerDownPin as digital output, do not reset or(typo? "on"?) power down.
-    if (g_mfrc._resetPowerDownPin == -1)
+    if (dev->_resetPowerDownPin == -1)
         return false;
 
-    const gpio_num_t gpio_num = (gpio_num_t)(g_mfrc._resetPowerDownPin);
+    const gpio_num_t gpio_num = (gpio_num_t)(dev->_resetPowerDownPin);
     gpio_reset_pin(gpio_num);
     gpio_set_direction(gpio_num, GPIO_MODE_OUTPUT);
 
@@ -321,58 +1062,75 @@ bool PCD_HardGpioReset()
 /**
  * Initializes the MFRC522 chip.
  */
-esp_err_t PCD_Init()
+esp_err_t PCD_Init_h(MFRC522_Handle *dev)
 {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_INIT);
 	serial_println("starting PCD_Init()");
 
     // Perform a soft reset if necessary
-    if (!PCD_HardGpioReset()) {
+    if (!PCD_HardGpioReset(dev)) {
     	// soft reset
-    	ESP_RETURN_ON_ERROR(PCD_Reset(), TAG, "PCD_Reset() failed");
+    	ESP_RETURN_ON_ERROR(PCD_Reset_h(dev), TAG, "PCD_Reset() failed");
 	}
+	dev->_crcOffload = 0;
+	dev->_txBitRate = PCD_BITRATE_106;
+	dev->_rxBitRate = PCD_BITRATE_106;
+	dev->_shadowValid = 0;
+	dev->_comIrqPending = false;
+	dev->_divIrqPending = false;
 
 	// When communicating with a PICC we need a timeout if something goes wrong.
 	// f_timer = 13.56 MHz / (2*TPreScaler+1) where TPreScaler = [TPrescaler_Hi:TPrescaler_Lo].
 	// TPrescaler_Hi are the four low bits in TModeReg. TPrescaler_Lo is TPrescalerReg.
 
 	// TAuto=1; timer starts automatically at the end of the transmission in all communication modes at all speeds
-	esp_err_t err = PCD_WriteRegister(TModeReg, 0x80);
+	esp_err_t err = PCD_WriteRegister_h(dev, TModeReg, 0x80);
 	if (err != ESP_OK) return err;
 
 	// TPreScaler = TModeReg[3..0]:TPrescalerReg, ie 0x0A9 = 169 => f_timer=40kHz, ie a timer period of 25�s.
-	err = PCD_WriteRegister(TPrescalerReg, 0xA9);
+	err = PCD_WriteRegister_h(dev, TPrescalerReg, 0xA9);
 	if (err != ESP_OK) return err;
 
-	// Reload timer with 0x3E8 = 1000, ie 25ms before timeout.
-	err = PCD_WriteRegister(TReloadRegH, 0x03);
-	if (err != ESP_OK) return err;
-
-	err = PCD_WriteRegister(TReloadRegL, 0xE8);
+	// Reload timer for the PCD_TIMEOUT_DEFAULT timeout, 0x3E8 = 1000, ie 25ms by default.
+	// Each command reprograms it for its own class, see PCD_ApplyCommandTimeout().
+	dev->_timeoutClass = PCD_TIMEOUT_DEFAULT;
+	err = PCD_ProgramTimer(dev, dev->_timeoutUs[PCD_TIMEOUT_DEFAULT]);
 	if (err != ESP_OK) return err;
 
 	// Default 0x00. Force a 100 % ASK modulation independent of the ModGsPReg register setting
-	err = PCD_WriteRegister(TxASKReg, 0x40);
+	err = PCD_WriteRegister_h(dev, TxASKReg, 0x40);
 	if (err != ESP_OK) return err;
 
 	// Default 0x3F. Set the preset value for the CRC coprocessor for the CalcCRC command to 0x6363 (ISO 14443-3 part 6.2.4)
-	err = PCD_WriteRegister(ModeReg, 0x3D);
+	err = PCD_WriteRegister_h(dev, ModeReg, 0x3D);
 	if (err != ESP_OK) return err;
 
+	// IRQ pin as an active low CMOS output. The individual sources are enabled per command, see PCD_ArmIrq()
+	if (dev->_irqPin != GPIO_NUM_NC) {
+		err = PCD_WriteRegister_h(dev, ComIEnReg, 0x80);
+		if (err != ESP_OK) return err;
+
+		err = PCD_WriteRegister_h(dev, DivIEnReg, 0x80);
+		if (err != ESP_OK) return err;
+	}
+
 	// Enable the antenna driver pins TX1 and TX2 (they were disabled by the reset)
-	err = PCD_AntennaOn();
+	err = PCD_AntennaOn_h(dev);
 	if (err != ESP_OK) return err;
 
 	return ESP_OK;
-} // End PCD_Init()
+} // End PCD_Init_h()
 
 /**
  * Performs a soft reset on the MFRC522 chip and waits for it to be ready again.
  */
-esp_err_t PCD_Reset()
+esp_err_t PCD_Reset_h(MFRC522_Handle *dev)
 {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_INIT);
 	ESP_LOGI(TAG, "starting PCD_Reset()");
 	// Issue the SoftReset command.
-	ESP_RETURN_ON_ERROR(PCD_WriteRegister(CommandReg, PCD_SoftReset), TAG, "PCD_Reset: i2c fail");
+	ESP_RETURN_ON_ERROR(PCD_WriteRegister_h(dev, CommandReg, PCD_SoftReset), TAG, "PCD_Reset: i2c fail");
+	dev->_shadowValid = 0; // all registers are back at their reset values
 
 	// The datasheet does not mention how long the SoftRest command takes to complete.
 	// But the MFRC522 might have been in soft power-down mode (triggered by bit 4 of CommandReg)
@@ -389,12 +1147,15 @@ esp_err_t PCD_Reset()
 
 		// Wait for the PowerDown bit in CommandReg to be cleared
 		uint8_t val;
-		if (PCD_ReadRegister(CommandReg, &val) != ESP_OK)
+		if (PCD_ReadRegister_h(dev, CommandReg, &val) != ESP_OK)
 			return ESP_FAIL;
 
 		const bool should_keep_looping = val & (1<<4);
 		if (!should_keep_looping)
 		{
+			dev->_crcOffload = 0; // TxModeReg/RxModeReg are back at their reset value 0x00, 106 kbit/s
+			dev->_txBitRate = PCD_BITRATE_106;
+			dev->_rxBitRate = PCD_BITRATE_106;
 			ESP_LOGI(TAG, "PCD reset: soft reset OK");
 			return ESP_OK; // we're good now
 		}
@@ -404,43 +1165,43 @@ esp_err_t PCD_Reset()
 		serial_println("PCD Still restarting after SoftReset");
 		// PCD still restarting - unlikely after waiting 50ms, but better safe than sorry.
 	}
-} // End PCD_Reset()
+} // End PCD_Reset_h()
 
-esp_err_t PCD_SetMaxInductance()
+esp_err_t PCD_SetMaxInductance_h(MFRC522_Handle *dev)
 {
 	// experimental, not sure this actually does anything useful.
 	// purports to increase the conductance of the TX pins and
 	// potentially increase the range of scans (uses/drives more power)
-	esp_err_t err = PCD_WriteRegister(CWGsPReg, 0b111111);
+	esp_err_t err = PCD_WriteRegister_h(dev, CWGsPReg, 0b111111);
 	if (err != ESP_OK) return err;
 
-	err = PCD_WriteRegister(ModGsPReg, 0b111111);
+	err = PCD_WriteRegister_h(dev, ModGsPReg, 0b111111);
 	if (err != ESP_OK) return err;
 
-	return PCD_WriteRegister(GsNReg, 0b11111111);
+	return PCD_WriteRegister_h(dev, GsNReg, 0b11111111);
 }
 
 /**
  * Turns the antenna on by enabling pins TX1 and TX2.
  * After a reset these pins are disabled.
  */
-esp_err_t PCD_AntennaOn() {
+esp_err_t PCD_AntennaOn_h(MFRC522_Handle *dev) {
     uint8_t value;
-	const esp_err_t err = PCD_ReadRegister(TxControlReg, &value);
+	const esp_err_t err = PCD_ReadRegisterForUpdate(dev, TxControlReg, &value);
 	if (err != ESP_OK) return err;
 
 	if ((value & 0x03) != 0x03) {
-		ESP_RETURN_ON_ERROR(PCD_WriteRegister(TxControlReg, value | 0x03), TAG, "Antenna on");
+		ESP_RETURN_ON_ERROR(PCD_WriteRegister_h(dev, TxControlReg, value | 0x03), TAG, "Antenna on");
 	}
 	return ESP_OK;
-} // End PCD_AntennaOn()
+} // End PCD_AntennaOn_h()
 
 /**
  * Turns the antenna off by disabling pins TX1 and TX2.
  */
-esp_err_t PCD_AntennaOff() {
-	return PCD_ClearRegisterBitMask(TxControlReg, 0x03);
-} // End PCD_AntennaOff()
+esp_err_t PCD_AntennaOff_h(MFRC522_Handle *dev) {
+	return PCD_ClearRegisterBitMask_h(dev, TxControlReg, 0x03);
+} // End PCD_AntennaOff_h()
 
 /**
  * Get the current MFRC522 Receiver Gain (RxGain[2:0]) value.
@@ -449,34 +1210,34 @@ esp_err_t PCD_AntennaOff() {
  *
  * @return Value of the RxGain, scrubbed to the 3 bits used.
  */
-esp_err_t PCD_GetAntennaGain(uint8_t* val_out) {
+esp_err_t PCD_GetAntennaGain_h(MFRC522_Handle *dev, uint8_t* val_out) {
 	uint8_t val;
-	const esp_err_t err = PCD_ReadRegister(RFCfgReg, &val);
+	const esp_err_t err = PCD_ReadRegisterForUpdate(dev, RFCfgReg, &val);
 	if (err != ESP_OK) return err;
 	*val_out = val & (0x07<<4);
 	return ESP_OK;
-} // End PCD_GetAntennaGain()
+} // End PCD_GetAntennaGain_h()
 
 /**
  * Set the MFRC522 Receiver Gain (RxGain) to value specified by given mask.
  * See 9.3.3.6 / table 98 in http://www.nxp.com/documents/data_sheet/MFRC522.pdf
  * NOTE: Given mask is scrubbed with (0x07<<4)=01110000b as RCFfgReg may use reserved bits.
  */
-esp_err_t PCD_SetAntennaGain(const uint8_t mask) {
+esp_err_t PCD_SetAntennaGain_h(MFRC522_Handle *dev, const uint8_t mask) {
 	uint8_t gain_val;
-	esp_err_t err = PCD_GetAntennaGain(&gain_val);
+	esp_err_t err = PCD_GetAntennaGain_h(dev, &gain_val);
 	if (err != ESP_OK) return err;
 
 	if (gain_val != mask) {						// only bother if there is a change
-		err = PCD_ClearRegisterBitMask(RFCfgReg, (0x07<<4));		// clear needed to allow 000 pattern
+		err = PCD_ClearRegisterBitMask_h(dev, RFCfgReg, (0x07<<4));		// clear needed to allow 000 pattern
 		if (err != ESP_OK) return err;
 
-		err= PCD_SetRegisterBitMask(RFCfgReg, mask & (0x07<<4));	// only set RxGain[2:0] bits
+		err= PCD_SetRegisterBitMask_h(dev, RFCfgReg, mask & (0x07<<4));	// only set RxGain[2:0] bits
 		if (err != ESP_OK) return err;
 	}
 
 	return ESP_OK;
-} // End PCD_SetAntennaGain()
+} // End PCD_SetAntennaGain_h()
 
 /**
  * Performs a self-test of the MFRC522
@@ -484,7 +1245,7 @@ esp_err_t PCD_SetAntennaGain(const uint8_t mask) {
  *
  * @return Whether or not the test passed.
  */
-bool PCD_PerformSelfTest()
+bool PCD_PerformSelfTest_h(MFRC522_Handle *dev)
 {
     #if MFRC_INCLUDE_SELFTEST != 1
     // main reason to disable is simply saving some flash memory.
@@ -497,44 +1258,44 @@ bool PCD_PerformSelfTest()
 
 	// This follows directly the steps outlined in 16.1.1
 	// 1. Perform a soft reset.
-	PCD_Reset();
+	PCD_Reset_h(dev);
 
 	// 2. Clear the internal buffer by writing 25 bytes of 00h
     uint8_t ZEROES[25] = {0x00};
-	PCD_SetRegisterBitMask(FIFOLevelReg, 0x80);	// flush the FIFO buffer
-	PCD_WriteRegister(FIFODataReg, 25, ZEROES);	// write 25 bytes of 00h to FIFO
-	PCD_WriteRegister(CommandReg, PCD_Mem);		// transfer to internal buffer
+	PCD_SetRegisterBitMask_h(dev, FIFOLevelReg, 0x80);	// flush the FIFO buffer
+	PCD_WriteRegister_h(dev, FIFODataReg, 25, ZEROES);	// write 25 bytes of 00h to FIFO
+	PCD_WriteRegister_h(dev, CommandReg, PCD_Mem);		// transfer to internal buffer
 
 	// 3. Enable self-test
-	PCD_WriteRegister(AutoTestReg, 0x09);
+	PCD_WriteRegister_h(dev, AutoTestReg, 0x09);
 
 	// 4. Write 00h to FIFO buffer
-	PCD_WriteRegister(FIFODataReg, 0x00);
+	PCD_WriteRegister_h(dev, FIFODataReg, 0x00);
 
 	// 5. Start self-test by issuing the CalcCRC command
-	PCD_WriteRegister(CommandReg, PCD_CalcCRC);
+	PCD_WriteRegister_h(dev, CommandReg, PCD_CalcCRC);
 
 	// 6. Wait for self-test to complete
     unsigned int i;
     uint8_t n;
 	for (i = 0; i < 0xFF; i++) {
-		n = PCD_ReadRegister(DivIrqReg);	// DivIrqReg[7..0] bits are: Set2 reserved reserved MfinActIRq reserved CRCIRq reserved reserved
+		n = PCD_ReadRegister_h(dev, DivIrqReg);	// DivIrqReg[7..0] bits are: Set2 reserved reserved MfinActIRq reserved CRCIRq reserved reserved
 		if (n & 0x04) {						// CRCIRq bit set - calculation done
 			break;
 		}
 	}
-	PCD_WriteRegister(CommandReg, PCD_Idle);		// Stop calculating CRC for new content in the FIFO.
+	PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);		// Stop calculating CRC for new content in the FIFO.
 
 	// 7. Read out resulting 64 bytes from the FIFO buffer.
     uint8_t result[64];
-	PCD_ReadRegister(FIFODataReg, 64, result, 0);
+	PCD_ReadRegister_h(dev, FIFODataReg, 64, result, 0);
 
 	// Auto self-test done
 	// Reset AutoTestReg register to be 0 again. Required for normal operation.
-	PCD_WriteRegister(AutoTestReg, 0x00);
+	PCD_WriteRegister_h(dev, AutoTestReg, 0x00);
 
 	// Determine firmware version (see section 9.3.4.8 in spec)
-    uint8_t version = PCD_ReadRegister(VersionReg);
+    uint8_t version = PCD_ReadRegister_h(dev, VersionReg);
 
     // Pick the appropriate reference values
     const uint8_t *reference;
@@ -565,7 +1326,7 @@ bool PCD_PerformSelfTest()
 	// Test passed; all is good.
 	return true;
     #endif // MFRC_INCLUDE_SELFTEST
-} // End PCD_PerformSelfTest()
+} // End PCD_PerformSelfTest_h()
 
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for communicating with PICCs
@@ -577,7 +1338,7 @@ bool PCD_PerformSelfTest()
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PCD_TransceiveData( const uint8_t *sendData,		///< Pointer to the data to transfer to the FIFO.
+enum StatusCode PCD_TransceiveData_h(MFRC522_Handle *dev,  const uint8_t *sendData,		///< Pointer to the data to transfer to the FIFO.
                                     const uint8_t sendLen,		///< Number of bytes to transfer to the FIFO.
                                     uint8_t *backData,		///< NULL or pointer to buffer if data should be read back after executing the command.
                                     uint8_t *backLen,		///< In: Max number of bytes to write to *backData. Out: The number of bytes returned.
@@ -585,9 +1346,253 @@ enum StatusCode PCD_TransceiveData( const uint8_t *sendData,		///< Pointer to th
                                     const uint8_t rxAlign,		///< In: Defines the bit position in backData[0] for the first bit received. Default 0.
 									const bool checkCRC		///< In: True => The last two bytes of the response is assumed to be a CRC_A that must be validated.
 								 ) {
+	const PCD_Segment segment = {sendData, sendLen};
+	return PCD_TransceiveDataSegments_h(dev, &segment, 1, backData, backLen, validBits, rxAlign, checkCRC);
+} // End PCD_TransceiveData_h()
+
+/**
+ * PCD_TransceiveData_h() with the frame in pieces, which go to the FIFO in one i2c transaction without being
+ * copied together.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_TransceiveDataSegments_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< The frame to transfer to the FIFO.
+											const uint8_t count,		///< Number of segments, at most MFRC_MAX_SEGMENTS.
+											uint8_t *backData,			///< NULL or pointer to buffer if data should be read back after executing the command.
+											uint8_t *backLen,			///< In: Max number of bytes to write to *backData. Out: The number of bytes returned.
+											uint8_t *validBits,			///< In/Out: The number of valid bits in the last byte. 0 for 8 valid bits.
+											const uint8_t rxAlign,		///< In: Defines the bit position in backData[0] for the first bit received.
+											const bool checkCRC			///< In: True => The last two bytes of the response is assumed to be a CRC_A that must be validated.
+								 ) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_TRANSCEIVE);
     const uint8_t waitIRq = 0x30;		// RxIRq and IdleIRq
-	return PCD_CommunicateWithPICC(PCD_Transceive, waitIRq, sendData, sendLen, backData, backLen, validBits, rxAlign, checkCRC);
-} // End PCD_TransceiveData()
+
+	// The caller supplies raw frames, make sure the MFRC522 does not add or strip a CRC_A.
+	if (PCD_SetCRCOffload(dev, false, false) != ESP_OK)
+		return STATUS_ERROR;
+
+	return PCD_CommunicateWithPICCSegments_h(dev, PCD_Transceive, waitIRq, segments, count, backData, backLen, validBits, rxAlign, checkCRC);
+} // End PCD_TransceiveDataSegments_h()
+
+/**
+ * Clears the interrupt request bits, loads sendData into the FIFO and starts the command.
+ * With armIrq the IRQ pin is set up for PCD_WaitForIrq() before the command starts.
+ */
+static enum StatusCode PCD_StartCommandIrq(MFRC522_Handle *dev, 	const uint8_t command,
+										const uint8_t waitIRq,
+										const PCD_Segment *segments,
+										const uint8_t count,
+										const uint8_t bitFraming,
+										const bool armIrq
+									) {
+	if (count > MFRC_MAX_SEGMENTS) return STATUS_INVALID;
+
+	// Stop any active command.
+	esp_err_t err = PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	err = PCD_ApplyCommandTimeout(dev);
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	err = PCD_WriteRegister_h(dev, ComIrqReg, 0x7F);					// Clear all seven interrupt request bits
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	err = PCD_SetRegisterBitMask_h(dev, FIFOLevelReg, 0x80);			// FlushBuffer = 1, FIFO initialization
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	err = PCD_WriteRegisterSegments_h(dev, FIFODataReg, segments, count);	// Write the segments to the FIFO
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	err = PCD_WriteRegister_h(dev, BitFramingReg, bitFraming);		// Bit adjustments
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	if (armIrq) {
+		err = PCD_ArmIrq(dev, ComIrqReg, waitIRq | 0x01);		// waitIRq + TimerIEn
+		if (err != ESP_OK) return STATUS_ERROR;
+	}
+
+	dev->_cmdWaitIRq = waitIRq;
+	dev->_cmdStartUs = esp_timer_get_time();
+
+	err = PCD_WriteRegister_h(dev, CommandReg, command);				// Execute the command
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	if (command == PCD_Transceive) {
+		err = PCD_SetRegisterBitMask_h(dev, BitFramingReg, 0x80);	// StartSend=1, transmission of data starts
+		if (err != ESP_OK) return STATUS_ERROR;
+	}
+	return STATUS_OK;
+} // End PCD_StartCommandIrq()
+
+/**
+ * Starts a command and returns without waiting for it to complete.
+ * Follow up with PCD_PollCommand_h() until it stops returning STATUS_PENDING, then PCD_FinishCommand_h().
+ * The TxCRCEn/RxCRCEn settings are left as they are.
+ *
+ * @return STATUS_OK if the command was started, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_StartCommand_h(MFRC522_Handle *dev, 	const uint8_t command,		///< The command to execute. One of the PCD_Command enums.
+									const uint8_t waitIRq,		///< The bits in the ComIrqReg register that signals successful completion of the command.
+									const uint8_t *sendData,	///< Pointer to the data to transfer to the FIFO.
+									const uint8_t sendLen,		///< Number of bytes to transfer to the FIFO.
+									const uint8_t txLastBits,	///< The number of valid bits in the last byte. 0 for 8 valid bits.
+									const uint8_t rxAlign		///< Defines the bit position in backData[0] for the first bit received. Pass the same value to PCD_FinishCommand_h().
+								 ) {
+	const PCD_Segment segment = {sendData, sendLen};
+	return PCD_StartCommandSegments_h(dev, command, waitIRq, &segment, 1, txLastBits, rxAlign);
+} // End PCD_StartCommand_h()
+
+/**
+ * PCD_StartCommand_h() with the data for the FIFO in pieces.
+ *
+ * @return STATUS_OK if the command was started, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_StartCommandSegments_h(MFRC522_Handle *dev,	const uint8_t command,		///< The command to execute. One of the PCD_Command enums.
+											const uint8_t waitIRq,		///< The bits in the ComIrqReg register that signals successful completion of the command.
+											const PCD_Segment *segments,	///< The data to transfer to the FIFO.
+											const uint8_t count,		///< Number of segments, at most MFRC_MAX_SEGMENTS.
+											const uint8_t txLastBits,	///< The number of valid bits in the last byte. 0 for 8 valid bits.
+											const uint8_t rxAlign		///< Defines the bit position in backData[0] for the first bit received. Pass the same value to PCD_FinishCommand_h().
+								 ) {
+	return PCD_StartCommandIrq(dev, command, waitIRq, segments, count, (rxAlign << 4) + txLastBits, false);
+} // End PCD_StartCommandSegments_h()
+
+/**
+ * Starts a Transceive command and returns without waiting for the PICC.
+ * Follow up with PCD_PollCommand_h() until it stops returning STATUS_PENDING, then PCD_FinishCommand_h().
+ * Meanwhile other devices (or other MFRC522s) can use the i2c bus.
+ *
+ * @return STATUS_OK if the command was started, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_StartTransceive_h(MFRC522_Handle *dev, 	const uint8_t *sendData,	///< Pointer to the data to transfer to the FIFO.
+										const uint8_t sendLen,		///< Number of bytes to transfer to the FIFO.
+										const uint8_t txLastBits,	///< The number of valid bits in the last byte. 0 for 8 valid bits.
+										const uint8_t rxAlign		///< Defines the bit position in backData[0] for the first bit received. Pass the same value to PCD_FinishCommand_h().
+								 ) {
+	const PCD_Segment segment = {sendData, sendLen};
+	return PCD_StartTransceiveSegments_h(dev, &segment, 1, txLastBits, rxAlign);
+} // End PCD_StartTransceive_h()
+
+/**
+ * PCD_StartTransceive_h() with the frame in pieces.
+ *
+ * @return STATUS_OK if the command was started, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_StartTransceiveSegments_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< The frame to transfer to the FIFO.
+												const uint8_t count,		///< Number of segments, at most MFRC_MAX_SEGMENTS.
+												const uint8_t txLastBits,	///< The number of valid bits in the last byte. 0 for 8 valid bits.
+												const uint8_t rxAlign		///< Defines the bit position in backData[0] for the first bit received. Pass the same value to PCD_FinishCommand_h().
+								 ) {
+	// The caller supplies raw frames, make sure the MFRC522 does not add or strip a CRC_A.
+	if (PCD_SetCRCOffload(dev, false, false) != ESP_OK)
+		return STATUS_ERROR;
+
+	return PCD_StartCommandSegments_h(dev, PCD_Transceive, 0x30, segments, count, txLastBits, rxAlign);	// RxIRq and IdleIRq
+} // End PCD_StartTransceiveSegments_h()
+
+/**
+ * Checks once (one i2c read) whether the command started with PCD_StartTransceive_h() or PCD_StartCommand_h() has completed.
+ *
+ * @return STATUS_PENDING while the command runs, STATUS_OK when it completed, STATUS_TIMEOUT if the MFRC522 timer
+ * 			expired (nothing received) or the command overran the timer, STATUS_ERROR on an i2c error.
+ */
+enum StatusCode PCD_PollCommand_h(MFRC522_Handle *dev) {
+	uint8_t n;
+	if (PCD_ReadRegister_h(dev, ComIrqReg, &n) != ESP_OK)	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
+		return STATUS_ERROR;
+
+	if (n & dev->_cmdWaitIRq) {			// One of the interrupts that signal success has been set.
+		return STATUS_OK;
+	}
+	if (n & 0x01) {						// Timer interrupt - nothing received in time
+		return STATUS_TIMEOUT;
+	}
+	// The emergency break: the timer should have fired long ago. Communication with the MFRC522 might be down.
+	if (esp_timer_get_time() - dev->_cmdStartUs > (int64_t)PCD_TimerPeriodUs(dev) + IRQ_WAIT_MARGIN_MS * 1000) {
+		return STATUS_TIMEOUT;
+	}
+	return STATUS_PENDING;
+} // End PCD_PollCommand_h()
+
+/**
+ * Collects the result of a command once PCD_PollCommand_h() returned STATUS_OK: checks ErrorReg and
+ * transfers the received data from the FIFO.
+ * CRC validation can only be done if backData and backLen are specified.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_FinishCommand_h(MFRC522_Handle *dev, 	uint8_t *backData,		///< NULL or pointer to buffer if data should be read back after executing the command.
+										uint8_t *backLen,		///< In: Max number of bytes to write to *backData. Out: The number of bytes returned.
+										uint8_t *validBits,	///< Out: The number of valid bits in the last byte. 0 for 8 valid bits. Can be NULL.
+										const uint8_t rxAlign,		///< In: Defines the bit position in backData[0] for the first bit received.
+										const bool checkCRC		///< In: True => The last two bytes of the response is assumed to be a CRC_A that must be validated.
+								  ) {
+	uint8_t n=0, _validBits=0;
+
+	// Stop now if any errors except collisions were detected.
+    uint8_t errorRegValue;
+	esp_err_t err = PCD_ReadRegister_h(dev, ErrorReg, &errorRegValue); // ErrorReg[7..0] bits are: WrErr TempErr reserved BufferOvfl CollErr CRCErr ParityErr ProtocolErr
+	if (err != ESP_OK) return STATUS_ERROR;
+	PCD_STATS_ERROR_REG(dev, errorRegValue);
+
+	if (errorRegValue & 0x13) {	 // BufferOvfl ParityErr ProtocolErr
+		return STATUS_ERROR;
+	}
+
+	// If the caller wants data back, get it from the MFRC522.
+	if (backData && backLen) {
+		err = PCD_ReadRegister_h(dev, FIFOLevelReg, &n);			// Number of bytes in the FIFO
+		if (err != ESP_OK) return STATUS_ERROR;
+
+		if (n > *backLen) {
+			return STATUS_NO_ROOM;
+		}
+		*backLen = n;											// Number of bytes returned
+		err = PCD_ReadRegisterData_h(dev, FIFODataReg, n, backData, rxAlign);	// Get received data from FIFO
+		if (err != ESP_OK) return STATUS_ERROR;
+
+		uint8_t tmp;
+		err = PCD_ReadRegister_h(dev, ControlReg, &tmp);		// RxLastBits[2:0] indicates the number of valid bits in the last received byte. If this value is 000b, the whole byte is valid.
+		if (err != ESP_OK) return STATUS_ERROR;
+
+		_validBits = tmp & 0x07;
+		if (validBits) {
+			*validBits = _validBits;
+		}
+	}
+
+	// Tell about collisions
+	if (errorRegValue & 0x08) {		// CollErr
+		return STATUS_COLLISION;
+	}
+
+	// Perform CRC_A validation if requested.
+	if (backData && backLen && checkCRC) {
+		// In this case a MIFARE Classic NAK is not OK.
+		if (*backLen == 1 && _validBits == 4) {
+			return STATUS_MIFARE_NACK;
+		}
+		// The MFRC522 already checked (and removed) the CRC_A while receiving.
+		if (dev->_crcOffload & CRC_OFFLOAD_RX) {
+			return (errorRegValue & 0x04) ? STATUS_CRC_WRONG : STATUS_OK;	// CRCErr
+		}
+		// We need at least the CRC_A value and all 8 bits of the last byte must be received.
+		if (*backLen < 2 || _validBits != 0) {
+			return STATUS_CRC_WRONG;
+		}
+		// Verify CRC_A - do our own calculation and store the control in controlBuffer.
+        uint8_t controlBuffer[2];
+		n = PCD_CalculateCRC_h(dev, &backData[0], *backLen - 2, &controlBuffer[0]);
+		if (n != STATUS_OK) {
+			return n;
+		}
+		if ((backData[*backLen - 2] != controlBuffer[0]) || (backData[*backLen - 1] != controlBuffer[1])) {
+			return STATUS_CRC_WRONG;
+		}
+	}
+
+	return STATUS_OK;
+} // End PCD_FinishCommand_h()
 
 /**
  * Transfers data to the MFRC522 FIFO, executes a command, waits for completion and transfers data back from the FIFO.
@@ -595,124 +1600,382 @@ enum StatusCode PCD_TransceiveData( const uint8_t *sendData,		///< Pointer to th
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PCD_CommunicateWithPICC(	const uint8_t command,		///< The command to execute. One of the PCD_Command enums.
+static enum StatusCode PCD_ExecuteCommand(MFRC522_Handle *dev, 	const uint8_t command,		///< The command to execute. One of the PCD_Command enums.
 		                                    const uint8_t waitIRq,		///< The bits in the ComIrqReg register that signals successful completion of the command.
-		                                    const uint8_t *sendData,		///< Pointer to the data to transfer to the FIFO.
-		                                    const uint8_t sendLen,		///< Number of bytes to transfer to the FIFO.
+		                                    const PCD_Segment *segments,	///< The data to transfer to the FIFO.
+		                                    const uint8_t count,		///< Number of segments.
 		                                    uint8_t *backData,		///< NULL or pointer to buffer if data should be read back after executing the command.
 		                                    uint8_t *backLen,		///< In: Max number of bytes to write to *backData. Out: The number of bytes returned.
 		                                    uint8_t *validBits,	///< In/Out: The number of valid bits in the last byte. 0 for 8 valid bits.
 		                                    const uint8_t rxAlign,		///< In: Defines the bit position in backData[0] for the first bit received. Default 0.
 											const bool checkCRC		///< In: True => The last two bytes of the response is assumed to be a CRC_A that must be validated.
 									) {
-    uint8_t n=0, _validBits=0;
+    uint8_t n=0;
 
 	// Prepare values for BitFramingReg
     const uint8_t txLastBits = validBits ? *validBits : 0;
     const uint8_t bitFraming = (rxAlign << 4) + txLastBits;		// RxAlign = BitFramingReg[6..4]. TxLastBits = BitFramingReg[2..0]
 
-	// Stop any active command.
-	esp_err_t err = PCD_WriteRegister(CommandReg, PCD_Idle);
-	if (err != ESP_OK) return STATUS_ERROR;
+	const bool useIrq = dev->_irqPin != GPIO_NUM_NC;
+	enum StatusCode status = PCD_StartCommandIrq(dev, command, waitIRq, segments, count, bitFraming, useIrq);
+	if (status != STATUS_OK) return status;
 
-	err = PCD_WriteRegister(ComIrqReg, 0x7F);					// Clear all seven interrupt request bits
-	if (err != ESP_OK) return STATUS_ERROR;
+	// Sleep instead of hammering ComIrqReg over i2c while the PICC answers. The loop below then normally exits on its first read.
+	if (useIrq) {
+		PCD_WaitForIrq(dev, ComIrqReg);
+	}
 
-	err = PCD_SetRegisterBitMask(FIFOLevelReg, 0x80);			// FlushBuffer = 1, FIFO initialization
-	if (err != ESP_OK) return STATUS_ERROR;
+	// Wait for the command to complete.
+	// In PCD_Init_h() we set the TAuto flag in TModeReg. This means the timer automatically starts when the PCD stops transmitting.
+	// Each iteration of the do-while-loop takes 17.86�s.
+	unsigned int i = 2000;
+	while (1) {
+		esp_err_t err = PCD_ReadRegister_h(dev, ComIrqReg, &n);	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
+		if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_WriteRegisterData(FIFODataReg, sendLen, sendData);	// Write sendData to the FIFO
-	if (err != ESP_OK) return STATUS_ERROR;
+		if (n & waitIRq) {					// One of the interrupts that signal success has been set.
+			break;
+		}
+		if (n & 0x01) {						// Timer interrupt - nothing received before the timeout
+			return STATUS_TIMEOUT;
+		}
+		if (--i == 0) {						// The emergency break. If all other conditions fail we will eventually terminate on this one after 35.7ms. Communication with the MFRC522 might be down.
+			return STATUS_TIMEOUT;
+		}
+	}
+
+	return PCD_FinishCommand_h(dev, backData, backLen, validBits, rxAlign, checkCRC);
+} // End PCD_ExecuteCommand()
+
+// PCD_ExecuteCommand(), with the result counted in the reader statistics (MFRC522_Stats.h).
+enum StatusCode PCD_CommunicateWithPICC_h(MFRC522_Handle *dev, const uint8_t command, const uint8_t waitIRq, const uint8_t *sendData,
+										const uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits,
+										const uint8_t rxAlign, const bool checkCRC) {
+	const PCD_Segment segment = {sendData, sendLen};
+	return PCD_CommunicateWithPICCSegments_h(dev, command, waitIRq, &segment, 1, backData, backLen, validBits, rxAlign, checkCRC);
+} // End PCD_CommunicateWithPICC_h()
+
+// PCD_CommunicateWithPICC_h() with the data for the FIFO in pieces (at most MFRC_MAX_SEGMENTS).
+enum StatusCode PCD_CommunicateWithPICCSegments_h(MFRC522_Handle *dev, const uint8_t command, const uint8_t waitIRq,
+												const PCD_Segment *segments, const uint8_t count, uint8_t *backData,
+												uint8_t *backLen, uint8_t *validBits, const uint8_t rxAlign, const bool checkCRC) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_TRANSCEIVE);
+	const enum StatusCode result = PCD_ExecuteCommand(dev, command, waitIRq, segments, count, backData, backLen, validBits, rxAlign, checkCRC);
+	PCD_STATS_STATUS(dev, result);
+	return result;
+} // End PCD_CommunicateWithPICCSegments_h()
+
+// A response as pieces that are received back to back: header, data, CRC_A
+typedef struct {
+	uint8_t		*ptr[3];
+	uint16_t	len[3];
+} PCD_StreamParts;
+
+/**
+ * Writes count bytes of the segments, starting at byte *done of the whole frame, to the FIFO in one i2c transaction.
+ */
+static esp_err_t PCD_StreamToFIFO(MFRC522_Handle *dev, const PCD_Segment *segments, const uint8_t segmentCount, uint16_t *done, uint8_t count) {
+	PCD_Segment chunk[MFRC_MAX_SEGMENTS];
+	uint8_t used = 0;
+	uint16_t start = 0;
+	uint16_t at = *done;
+	for (uint8_t i = 0; i < segmentCount && count; i++) {
+		if (at < start + segments[i].length) {
+			const uint16_t offset = at - start;
+			const uint8_t part = segments[i].length - offset < count ? segments[i].length - offset : count;
+			chunk[used].data = &segments[i].data[offset];
+			chunk[used].length = part;
+			used++;
+			at += part;
+			count -= part;
+		}
+		start += segments[i].length;
+	}
+	const esp_err_t err = PCD_WriteRegisterSegments_h(dev, FIFODataReg, chunk, used);
+	if (err == ESP_OK) {
+		*done = at;
+	}
+	return err;
+} // End PCD_StreamToFIFO()
+
+/**
+ * Moves the bytes in the FIFO to the pieces, starting at byte *done of the whole response.
+ *
+ * @return STATUS_OK on success, STATUS_NO_ROOM if the pieces are full, STATUS_ERROR on an i2c error.
+ */
+static enum StatusCode PCD_StreamFromFIFO(MFRC522_Handle *dev, const PCD_StreamParts *parts, uint16_t *done) {
+	uint8_t level;
+	if (PCD_ReadRegister_h(dev, FIFOLevelReg, &level) != ESP_OK)
+		return STATUS_ERROR;
+	level &= 0x7F;
+
+	uint16_t start = 0;
+	for (int i = 0; i < 3 && level; i++) {
+		if (*done < start + parts->len[i]) {
+			const uint16_t offset = *done - start;
+			const uint8_t part = parts->len[i] - offset < level ? parts->len[i] - offset : level;
+			if (PCD_ReadRegisterData_h(dev, FIFODataReg, part, &parts->ptr[i][offset], 0) != ESP_OK)
+				return STATUS_ERROR;
+			*done += part;
+			level -= part;
+		}
+		start += parts->len[i];
+	}
+	return level ? STATUS_NO_ROOM : STATUS_OK;
+} // End PCD_StreamFromFIFO()
+
+/**
+ * The work of PCD_TransceiveStreamSegments_h() and PCD_TransceiveBlock_h(): sends the segments (header, data, ...)
+ * followed by CRC_A and receives into the pieces of rx in order (header, data, ...), unused pieces with length 0.
+ * Without hardware CRC the received CRC_A is stored like the data, so the pieces need room for 2 more bytes: at the
+ * end of the data piece (PCD_TransceiveStreamSegments_h()) or in a piece of its own (PCD_TransceiveBlock_h() when no
+ * data is expected).
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. *received is the number of bytes received, CRC_A included.
+ */
+static enum StatusCode PCD_TransceiveParts(MFRC522_Handle *dev, const PCD_Segment *segments, const uint8_t segmentCount, PCD_StreamParts *rx,
+											uint16_t *received, uint8_t *validBits, const bool withCRC) {
+	if (segmentCount > MFRC_MAX_SEGMENTS - 1) {		// one is kept for the CRC_A
+		return STATUS_INVALID;
+	}
+	const bool hardwareCRC = withCRC && PCD_CRCInHardware(dev);
+	const bool softwareCRC = withCRC && !hardwareCRC;
+	PCD_Segment tx[MFRC_MAX_SEGMENTS];
+	uint8_t txCount = 0;
+	uint16_t total = 0;
+	uint16_t crc = CRC_A_PRESET;
+	for (; txCount < segmentCount; txCount++) {
+		tx[txCount] = segments[txCount];
+		total += segments[txCount].length;
+		if (softwareCRC) {
+			crc = CRC_A_Update(crc, segments[txCount].data, segments[txCount].length);
+		}
+	}
+	uint8_t txCRC[2];
+	if (softwareCRC) {
+		txCRC[0] = crc & 0xFF;
+		txCRC[1] = crc >> 8;
+		tx[txCount].data = txCRC;
+		tx[txCount].length = 2;
+		txCount++;
+		total += 2;
+	}
 
-	err = PCD_WriteRegister(BitFramingReg, bitFraming);		// Bit adjustments
+	if (PCD_SetCRCOffload(dev, hardwareCRC, hardwareCRC) != ESP_OK)
+		return STATUS_ERROR;
+
+	// Stop any active command, clear the interrupt requests and the FIFO, load the first FIFO full.
+	esp_err_t err = PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_ApplyCommandTimeout(dev);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, ComIrqReg, 0x7F);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_SetRegisterBitMask_h(dev, FIFOLevelReg, 0x80);			// FlushBuffer = 1
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, WaterLevelReg, MFRC_STREAM_WATER_LEVEL);
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	err = PCD_WriteRegister(CommandReg, command);				// Execute the command
+	uint16_t sent = 0;
+	err = PCD_StreamToFIFO(dev, tx, txCount, &sent, total < 64 ? total : 64);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, BitFramingReg, 0x00);
 	if (err != ESP_OK) return STATUS_ERROR;
 
-	if (command == PCD_Transceive) {
-		err = PCD_SetRegisterBitMask(BitFramingReg, 0x80);	// StartSend=1, transmission of data starts
-		if (err != ESP_OK) return STATUS_ERROR;
-	}
+	err = PCD_WriteRegister_h(dev, CommandReg, PCD_Transceive);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_SetRegisterBitMask_h(dev, BitFramingReg, 0x80);		// StartSend=1, transmission of data starts
+	if (err != ESP_OK) return STATUS_ERROR;
 
-	// Wait for the command to complete.
-	// In PCD_Init() we set the TAuto flag in TModeReg. This means the timer automatically starts when the PCD stops transmitting.
-	// Each iteration of the do-while-loop takes 17.86�s.
-	unsigned int i = 2000;
+	// Feed and drain the FIFO until the response is complete.
+	*received = 0;
+	bool txDone = false;
+	int64_t progressUs = esp_timer_get_time();
+	enum StatusCode status = STATUS_OK;
 	while (1) {
-		err = PCD_ReadRegister(ComIrqReg, &n);	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
+		uint8_t n;
+		err = PCD_ReadRegister_h(dev, ComIrqReg, &n);	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
 		if (err != ESP_OK) return STATUS_ERROR;
 
-		if (n & waitIRq) {					// One of the interrupts that signal success has been set.
+		if (!txDone && sent < total) {
+			if (n & 0x40) {						// TxIRq: the frame ended, the FIFO ran dry
+				status = STATUS_ERROR;
+				break;
+			}
+			if (n & 0x04) {						// LoAlertIRq: refill
+				err = PCD_WriteRegister_h(dev, ComIrqReg, 0x04);
+				if (err != ESP_OK) return STATUS_ERROR;
+				uint8_t level;
+				err = PCD_ReadRegister_h(dev, FIFOLevelReg, &level);
+				if (err != ESP_OK) return STATUS_ERROR;
+				const uint16_t space = 64 - (level & 0x7F);
+				err = PCD_StreamToFIFO(dev, tx, txCount, &sent, total - sent < space ? total - sent : space);
+				if (err != ESP_OK) return STATUS_ERROR;
+				progressUs = esp_timer_get_time();
+			}
+		}
+		else if (!txDone) {
+			if (n & 0x40) {						// TxIRq: all sent. Until now the FIFO held frame data, forget its HiAlertIRq.
+				err = PCD_WriteRegister_h(dev, ComIrqReg, 0x08);
+				if (err != ESP_OK) return STATUS_ERROR;
+				txDone = true;
+			}
+		}
+		else if (n & 0x08) {					// HiAlertIRq: drain
+			err = PCD_WriteRegister_h(dev, ComIrqReg, 0x08);
+			if (err != ESP_OK) return STATUS_ERROR;
+			status = PCD_StreamFromFIFO(dev, rx, received);
+			if (status != STATUS_OK) break;
+			progressUs = esp_timer_get_time();
+		}
+
+		if (n & 0x30) {							// RxIRq or IdleIRq: complete
 			break;
 		}
-		if (n & 0x01) {						// Timer interrupt - nothing received in 25ms
-			return STATUS_TIMEOUT;
+		if (n & 0x01) {							// Timer interrupt - nothing received in time
+			status = STATUS_TIMEOUT;
+			break;
 		}
-		if (--i == 0) {						// The emergency break. If all other conditions fail we will eventually terminate on this one after 35.7ms. Communication with the MFRC522 might be down.
-			return STATUS_TIMEOUT;
+		if (esp_timer_get_time() - progressUs > (int64_t)PCD_TimerPeriodUs(dev) + IRQ_WAIT_MARGIN_MS * 1000) {
+			status = STATUS_TIMEOUT;			// The emergency break. Communication with the MFRC522 might be down.
+			break;
 		}
 	}
+	if (status != STATUS_OK) {
+		PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);
+		return status;
+	}
 
-	// Stop now if any errors except collisions were detected.
-    uint8_t errorRegValue;
-	err = PCD_ReadRegister(ErrorReg, &errorRegValue); // ErrorReg[7..0] bits are: WrErr TempErr reserved BufferOvfl CollErr CRCErr ParityErr ProtocolErr
+	// The rest of the response, then the same checks as PCD_FinishCommand_h().
+	uint8_t errorRegValue;
+	err = PCD_ReadRegister_h(dev, ErrorReg, &errorRegValue); // ErrorReg[7..0] bits are: WrErr TempErr reserved BufferOvfl CollErr CRCErr ParityErr ProtocolErr
 	if (err != ESP_OK) return STATUS_ERROR;
-
+	PCD_STATS_ERROR_REG(dev, errorRegValue);
 	if (errorRegValue & 0x13) {	 // BufferOvfl ParityErr ProtocolErr
 		return STATUS_ERROR;
 	}
+	status = PCD_StreamFromFIFO(dev, rx, received);
+	if (status != STATUS_OK) return status;
 
-	// If the caller wants data back, get it from the MFRC522.
-	if (backData && backLen) {
-		err = PCD_ReadRegister(FIFOLevelReg, &n);			// Number of bytes in the FIFO
-		if (err != ESP_OK) return STATUS_ERROR;
-
-		if (n > *backLen) {
-			return STATUS_NO_ROOM;
-		}
-		*backLen = n;											// Number of bytes returned
-		err = PCD_ReadRegisterData(FIFODataReg, n, backData, rxAlign);	// Get received data from FIFO
-		if (err != ESP_OK) return STATUS_ERROR;
-
-		uint8_t tmp;
-		err = PCD_ReadRegister(ControlReg, &tmp);		// RxLastBits[2:0] indicates the number of valid bits in the last received byte. If this value is 000b, the whole byte is valid.
-		if (err != ESP_OK) return STATUS_ERROR;
-
-		_validBits = tmp & 0x07;
-		if (validBits) {
-			*validBits = _validBits;
-		}
+	uint8_t control;
+	err = PCD_ReadRegister_h(dev, ControlReg, &control);		// RxLastBits[2:0]
+	if (err != ESP_OK) return STATUS_ERROR;
+	const uint8_t _validBits = control & 0x07;
+	if (validBits) {
+		*validBits = _validBits;
 	}
 
-	// Tell about collisions
 	if (errorRegValue & 0x08) {		// CollErr
 		return STATUS_COLLISION;
 	}
-
-	// Perform CRC_A validation if requested.
-	if (backData && backLen && checkCRC) {
-		// In this case a MIFARE Classic NAK is not OK.
-		if (*backLen == 1 && _validBits == 4) {
+	if (withCRC) {
+		if (*received == 1 && _validBits == 4) {
 			return STATUS_MIFARE_NACK;
 		}
-		// We need at least the CRC_A value and all 8 bits of the last byte must be received.
-		if (*backLen < 2 || _validBits != 0) {
+		if (hardwareCRC) {
+			return (errorRegValue & 0x04) ? STATUS_CRC_WRONG : STATUS_OK;	// CRCErr
+		}
+		if (*received < 2 || _validBits != 0) {
 			return STATUS_CRC_WRONG;
 		}
-		// Verify CRC_A - do our own calculation and store the control in controlBuffer.
-        uint8_t controlBuffer[2];
-		n = PCD_CalculateCRC(&backData[0], *backLen - 2, &controlBuffer[0]);
-		if (n != STATUS_OK) {
-			return n;
+		// The residue over everything received, CRC_A included, is 0. The pieces are consecutive in the frame.
+		uint16_t residue = CRC_A_PRESET;
+		uint16_t left = *received;
+		for (int i = 0; i < 3 && left; i++) {
+			const uint16_t part = rx->len[i] < left ? rx->len[i] : left;
+			residue = CRC_A_Update(residue, rx->ptr[i], part);
+			left -= part;
 		}
-		if ((backData[*backLen - 2] != controlBuffer[0]) || (backData[*backLen - 1] != controlBuffer[1])) {
+		if (residue != 0x0000) {
 			return STATUS_CRC_WRONG;
 		}
+		*received -= 2;
+	}
+	return STATUS_OK;
+} // End PCD_TransceiveParts()
+
+/**
+ * Executes the Transceive command for frames of any length, up to the 256 bytes of ISO/IEC 14443-4 (FSD 256).
+ * PCD_CommunicateWithPICC_h() loads the whole frame into the 64 byte FIFO at once and reads the response once at
+ * the end. Here the FIFO is refilled on LoAlertIRq while sending and drained on HiAlertIRq while receiving, see
+ * MFRC_STREAM_WATER_LEVEL. ComIrqReg is polled: the FIFO has to be serviced within a few byte times, which the
+ * IRQ pin and a task wakeup cannot guarantee.
+ * In PCD_CRC_HARDWARE mode the MFRC522 appends and checks CRC_A. Otherwise it is calculated on the host, also in
+ * PCD_CRC_COPROCESSOR mode: the coprocessor shares the FIFO with the frame.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. STATUS_ERROR also if the FIFO ran dry while sending.
+ */
+enum StatusCode PCD_TransceiveStream_h(MFRC522_Handle *dev,	const uint8_t *sendData,	///< The frame to send, without CRC_A
+															const uint16_t sendLen,		///< Number of bytes to send
+															uint8_t *backData,			///< NULL or buffer for the response
+															uint16_t *backLen,			///< In: size of backData. Out: number of bytes received, without CRC_A.
+															uint8_t *validBits,			///< Out: the number of valid bits in the last byte. 0 for 8 valid bits. Can be NULL.
+															const bool withCRC			///< True => append CRC_A to the frame, check and strip it from the response.
+									) {
+	const PCD_Segment segment = {sendData, sendLen};
+	return PCD_TransceiveStreamSegments_h(dev, &segment, 1, backData, backLen, validBits, withCRC);
+} // End PCD_TransceiveStream_h()
+
+/**
+ * PCD_TransceiveStream_h() with the frame in pieces, at most MFRC_MAX_SEGMENTS - 1 (one is kept for the CRC_A).
+ * Each FIFO refill is one i2c transaction, also where it spans segments.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_TransceiveStreamSegments_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< The frame to send, without CRC_A
+																	const uint8_t count,		///< Number of segments
+																	uint8_t *backData,			///< NULL or buffer for the response
+																	uint16_t *backLen,			///< In: size of backData. Out: number of bytes received, without CRC_A.
+																	uint8_t *validBits,			///< Out: the number of valid bits in the last byte. 0 for 8 valid bits. Can be NULL.
+																	const bool withCRC			///< True => append CRC_A to the frame, check and strip it from the response.
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_TRANSCEIVE);
+	PCD_StreamParts rx = { .ptr = { NULL, backData }, .len = { 0, backLen ? *backLen : 0 } };
+	uint16_t received;
+	const enum StatusCode status = PCD_TransceiveParts(dev, segments, count, &rx, &received, validBits, withCRC);
+	if (backLen && (status == STATUS_OK || status == STATUS_COLLISION || status == STATUS_MIFARE_NACK || status == STATUS_CRC_WRONG)) {
+		*backLen = received;
 	}
+	return status;
+} // End PCD_TransceiveStreamSegments_h()
 
+/**
+ * Like PCD_TransceiveStream_h(), with CRC_A, for block protocols (ISO/IEC 14443-4): a header (PCB, CID, ...) is sent
+ * in front of the data and the same number of bytes at the start of the response is split off into rxHeader.
+ * Frames are assembled and taken apart in the FIFO, the data is never copied.
+ * In software and coprocessor CRC mode the CRC_A of the response is received behind the data:
+ * backData needs room for 2 more bytes than the data. The MFRC522 waits PCD_TIMEOUT_ISO14443_4 for the response.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. STATUS_CRC_WRONG also if the response is shorter than the header.
+ */
+enum StatusCode PCD_TransceiveBlock_h(MFRC522_Handle *dev,	const uint8_t *txHeader,	///< Sent first
+															const uint8_t headerLen,	///< Length of txHeader and rxHeader
+															const uint8_t *sendData,	///< Sent behind the header. NULL if sendLen is 0.
+															const uint16_t sendLen,
+															uint8_t *rxHeader,			///< Out: the first headerLen bytes of the response
+															uint8_t *backData,			///< Out: the rest of the response
+															uint16_t *backLen			///< In: size of backData, CRC_A room included. Out: number of data bytes received.
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_TRANSCEIVE);
+	const PCD_Segment tx[] = { {txHeader, headerLen}, {sendData, sendLen} };
+	uint8_t crcRoom[2];
+	PCD_StreamParts rx = { .ptr = { rxHeader, backData, crcRoom }, .len = { headerLen, *backLen, 0 } };
+	if (!PCD_CRCInHardware(dev) && *backLen < 2) {
+		rx.len[1] = 0;							// no data expected: the CRC_A goes to crcRoom
+		rx.len[2] = 2;
+	}
+	uint16_t received;
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_ISO14443_4);
+	const enum StatusCode status = PCD_TransceiveParts(dev, tx, 2, &rx, &received, NULL, true);
+	if (status != STATUS_OK) {
+		return status;
+	}
+	if (received < headerLen) {
+		return STATUS_CRC_WRONG;
+	}
+	*backLen = received - headerLen;
 	return STATUS_OK;
-} // End PCD_CommunicateWithPICC()
+} // End PCD_TransceiveBlock_h()
 
 /**
  * Transmits a REQuest command, Type A. Invites PICCs in state IDLE to go to READY and prepare for anticollision or selection. 7 bit frame.
@@ -720,11 +1983,11 @@ enum StatusCode PCD_CommunicateWithPICC(	const uint8_t command,		///< The comman
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode  PICC_RequestA(uint8_t *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
+enum StatusCode  PICC_RequestA_h(MFRC522_Handle *dev, uint8_t *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
                             uint8_t *bufferSize	///< Buffer size, at least two bytes. Also number of bytes returned if STATUS_OK.
 							) {
-	return PICC_REQA_or_WUPA(PICC_CMD_REQA, bufferATQA, bufferSize);
-} // End PICC_RequestA()
+	return PICC_REQA_or_WUPA_h(dev, PICC_CMD_REQA, bufferATQA, bufferSize);
+} // End PICC_RequestA_h()
 
 /**
  * Transmits a Wake-UP command, Type A. Invites PICCs in state IDLE and HALT to go to READY(*) and prepare for anticollision or selection. 7 bit frame.
@@ -732,11 +1995,11 @@ enum StatusCode  PICC_RequestA(uint8_t *bufferATQA,	///< The buffer to store the
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode  PICC_WakeupA(	uint8_t *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
+enum StatusCode  PICC_WakeupA_h(MFRC522_Handle *dev, 	uint8_t *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
                             uint8_t *bufferSize	///< Buffer size, at least two bytes. Also number of bytes returned if STATUS_OK.
 							) {
-	return PICC_REQA_or_WUPA(PICC_CMD_WUPA, bufferATQA, bufferSize);
-} // End PICC_WakeupA()
+	return PICC_REQA_or_WUPA_h(dev, PICC_CMD_WUPA, bufferATQA, bufferSize);
+} // End PICC_WakeupA_h()
 
 /**
  * Transmits REQA or WUPA commands.
@@ -744,21 +2007,26 @@ enum StatusCode  PICC_WakeupA(	uint8_t *bufferATQA,	///< The buffer to store the
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode  PICC_REQA_or_WUPA(	const uint8_t command, 		///< The command to send - PICC_CMD_REQA or PICC_CMD_WUPA
+enum StatusCode  PICC_REQA_or_WUPA_h(MFRC522_Handle *dev, 	const uint8_t command, 		///< The command to send - PICC_CMD_REQA or PICC_CMD_WUPA
                                     uint8_t *bufferATQA,	///< The buffer to store the ATQA (Answer to request) in
                                     uint8_t *bufferSize	///< Buffer size, at least two bytes. Also number of bytes returned if STATUS_OK.
 							   ) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_REQUEST);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_REQA);
 	if (bufferATQA == NULL || *bufferSize < 2) {	// The ATQA response is 2 bytes long.
 		return STATUS_NO_ROOM;
 	}
 
-	if (PCD_ClearRegisterBitMask(CollReg, 0x80) != ESP_OK)			// ValuesAfterColl=1 => Bits received after collision are cleared.
+	if (PCD_SetBitRate_h(dev, PCD_BITRATE_106, PCD_BITRATE_106) != ESP_OK)	// A PICC answers REQA/WUPA at 106 kbit/s only
+		return STATUS_ERROR;
+	if (PCD_ClearRegisterBitMask_h(dev, CollReg, 0x80) != ESP_OK)			// ValuesAfterColl=1 => Bits received after collision are cleared.
 		return STATUS_ERROR;
 
 	uint8_t validBits = 7;									// For REQA and WUPA we need the short frame format - transmit only 7 bits of the last (and only) byte. TxLastBits = BitFramingReg[2..0]
     const uint8_t rxAlign = 0;
     const bool checkCRC = false;
-    const uint8_t status = PCD_TransceiveData(&command, 1, bufferATQA, bufferSize, &validBits, rxAlign, checkCRC);
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_REQA);			// The ATQA comes within ~90us, an empty field needs no 25ms to tell
+    const uint8_t status = PCD_TransceiveData_h(dev, &command, 1, bufferATQA, bufferSize, &validBits, rxAlign, checkCRC);
 	if (status != STATUS_OK) {
 		return status;
 	}
@@ -766,11 +2034,11 @@ enum StatusCode  PICC_REQA_or_WUPA(	const uint8_t command, 		///< The command to
 		return STATUS_ERROR;
 	}
 	return STATUS_OK;
-} // End PICC_REQA_or_WUPA()
+} // End PICC_REQA_or_WUPA_h()
 
 /**
  * Transmits SELECT/ANTICOLLISION commands to select a single PICC.
- * Before calling this function the PICCs must be placed in the READY(*) state by calling PICC_RequestA() or PICC_WakeupA().
+ * Before calling this function the PICCs must be placed in the READY(*) state by calling PICC_RequestA_h() or PICC_WakeupA_h().
  * On success:
  * 		- The chosen PICC is in state ACTIVE(*) and all other PICCs have returned to state IDLE/HALT. (Figure 7 of the ISO/IEC 14443-3 draft.)
  * 		- The UID size and value of the chosen PICC is returned in *uid along with the SAK.
@@ -785,9 +2053,11 @@ enum StatusCode  PICC_REQA_or_WUPA(	const uint8_t command, 		///< The command to
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally output, but can also be used to supply a known UID.
+enum StatusCode PICC_Select_h(MFRC522_Handle *dev, 	Uid *uid,			///< Pointer to Uid struct. Normally output, but can also be used to supply a known UID.
                         const uint8_t validBits		///< The number of known UID bits supplied in *uid. Normally 0. If set you must also supply uid->size.
 						 ) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_SELECT);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_SELECT);
 	bool uidComplete;
 	bool selectDone;
 	bool useCascadeTag;
@@ -803,6 +2073,7 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
     uint8_t txLastBits;				// Used in BitFramingReg. The number of valid bits in the last transmitted byte.
     uint8_t *responseBuffer = NULL;
     uint8_t responseLength;
+    const bool useCRCOffload = dev->_crcMode == PCD_CRC_HARDWARE;
 
 	// Description of buffer structure:
 	//		Byte 0: SEL 				Indicates the Cascade Level: PICC_CMD_SEL_CL1, PICC_CMD_SEL_CL2 or PICC_CMD_SEL_CL3
@@ -832,7 +2103,7 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 	}
 
 	// Prepare MFRC522
-	esp_err_t err = PCD_ClearRegisterBitMask(CollReg, 0x80);		// ValuesAfterColl=1 => Bits received after collision are cleared.
+	esp_err_t err = PCD_ClearRegisterBitMask_h(dev, CollReg, 0x80);		// ValuesAfterColl=1 => Bits received after collision are cleared.
 	if (err != ESP_OK) return STATUS_ERROR;
 
 	// Repeat Cascade Level loop until we have a complete UID.
@@ -892,25 +2163,30 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 		while (!selectDone) {
 			// Find out how many bits and bytes to send and receive.
 			if (currentLevelKnownBits >= 32) { // All UID bits in this Cascade Level are known. This is a SELECT.
-                if (g_mfrc._logDebugInfo) {
+                if (dev->_logDebugInfo) {
                     serial_print("SELECT: currentLevelKnownBits=");serial_println_f(currentLevelKnownBits, DEC);
                 }
 				buffer[1] = 0x70; // NVB - Number of Valid Bits: Seven whole bytes
 				// Calculate BCC - Block Check Character
 				buffer[6] = buffer[2] ^ buffer[3] ^ buffer[4] ^ buffer[5];
-				// Calculate CRC_A
-				result = PCD_CalculateCRC(buffer, 7, &buffer[7]);
-				if (result != STATUS_OK) {
-					return result;
+				if (useCRCOffload) {
+					bufferUsed	= 7; // The MFRC522 appends CRC_A
+				}
+				else {
+					// Calculate CRC_A
+					result = PCD_CalculateCRC_h(dev, buffer, 7, &buffer[7]);
+					if (result != STATUS_OK) {
+						return result;
+					}
+					bufferUsed	= 9;
 				}
 				txLastBits		= 0; // 0 => All 8 bits are valid.
-				bufferUsed		= 9;
 				// Store response in the last 3 bytes of buffer (BCC and CRC_A - not needed after tx)
 				responseBuffer	= &buffer[6];
 				responseLength	= 3;
 			}
 			else { // This is an ANTICOLLISION.
-                if (g_mfrc._logDebugInfo) {
+                if (dev->_logDebugInfo) {
                     serial_print("ANTICOLLISION: currentLevelKnownBits="); serial_println_f(currentLevelKnownBits, DEC);
                 }
 				txLastBits		= currentLevelKnownBits % 8;
@@ -925,15 +2201,24 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 
 			// Set bit adjustments
 			rxAlign = txLastBits;											// Having a seperate variable is overkill. But it makes the next line easier to read.
-			err = PCD_WriteRegister(BitFramingReg, (rxAlign << 4) + txLastBits);	// RxAlign = BitFramingReg[6..4]. TxLastBits = BitFramingReg[2..0]
+			err = PCD_WriteRegister_h(dev, BitFramingReg, (rxAlign << 4) + txLastBits);	// RxAlign = BitFramingReg[6..4]. TxLastBits = BitFramingReg[2..0]
 			if (err != ESP_OK)
 				return STATUS_ERROR;
 
 			// Transmit the buffer and receive the response.
-            const bool checkCRC = false;
-			result = PCD_TransceiveData(buffer, bufferUsed, responseBuffer, &responseLength, &txLastBits, rxAlign, checkCRC);
+			PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_SELECT);
+			if (useCRCOffload && currentLevelKnownBits >= 32) {
+				// SELECT: CRC_A appended to our frame and checked on the SAK by the MFRC522.
+				if (PCD_SetCRCOffload(dev, true, true) != ESP_OK)
+					return STATUS_ERROR;
+				result = PCD_CommunicateWithPICC_h(dev, PCD_Transceive, 0x30, buffer, bufferUsed, responseBuffer, &responseLength, &txLastBits, rxAlign, true);
+			}
+			else {
+				const bool checkCRC = false;
+				result = PCD_TransceiveData_h(dev, buffer, bufferUsed, responseBuffer, &responseLength, &txLastBits, rxAlign, checkCRC);
+			}
 			if (result == STATUS_COLLISION) { // More than one PICC in the field => collision.
-				err = PCD_ReadRegister(CollReg, &result); // CollReg[7..0] bits are: ValuesAfterColl reserved CollPosNotValid CollPos[4:0]
+				err = PCD_ReadRegister_h(dev, CollReg, &result); // CollReg[7..0] bits are: ValuesAfterColl reserved CollPosNotValid CollPos[4:0]
 				if (err != ESP_OK)
 					return STATUS_ERROR;
 
@@ -944,13 +2229,15 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 				if (collisionPos == 0) {
 					collisionPos = 32;
 				}
-				if (collisionPos <= currentLevelKnownBits) { // No progress - should not happen
+				// CollPos counts from the first bit of the first received byte, which starts with the known bits.
+				collisionPos += (currentLevelKnownBits / 8) * 8;
+				if (collisionPos <= currentLevelKnownBits || collisionPos > 32) { // No progress - should not happen
 					return STATUS_INTERNAL_ERROR;
 				}
 				// Choose the PICC with the bit set.
 				currentLevelKnownBits = collisionPos;
 				count			= (currentLevelKnownBits - 1) % 8; // The bit to modify
-				index			= 1 + (currentLevelKnownBits / 8) + (count ? 1 : 0); // First byte is index 0.
+				index			= 2 + (currentLevelKnownBits - 1) / 8; // The byte to modify. UID bytes start at index 2.
 				buffer[index]	|= (1 << count);
 			}
 			else if (result != STATUS_OK) {
@@ -979,16 +2266,23 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 		}
 
 		// Check response SAK (Select Acknowledge)
-		if (responseLength != 3 || txLastBits != 0) { // SAK must be exactly 24 bits (1 byte + CRC_A).
-			return STATUS_ERROR;
-		}
-		// Verify CRC_A - do our own calculation and store the control in buffer[2..3] - those bytes are not needed anymore.
-		result = PCD_CalculateCRC(responseBuffer, 1, &buffer[2]);
-		if (result != STATUS_OK) {
-			return result;
+		if (useCRCOffload) {
+			if (responseLength != 1 || txLastBits != 0) { // SAK must be exactly 8 bits, CRC_A already checked and removed.
+				return STATUS_ERROR;
+			}
 		}
-		if ((buffer[2] != responseBuffer[1]) || (buffer[3] != responseBuffer[2])) {
-			return STATUS_CRC_WRONG;
+		else {
+			if (responseLength != 3 || txLastBits != 0) { // SAK must be exactly 24 bits (1 byte + CRC_A).
+				return STATUS_ERROR;
+			}
+			// Verify CRC_A - do our own calculation and store the control in buffer[2..3] - those bytes are not needed anymore.
+			result = PCD_CalculateCRC_h(dev, responseBuffer, 1, &buffer[2]);
+			if (result != STATUS_OK) {
+				return result;
+			}
+			if ((buffer[2] != responseBuffer[1]) || (buffer[3] != responseBuffer[2])) {
+				return STATUS_CRC_WRONG;
+			}
 		}
 
         // TODO: GCC complaining that error: 'responseBuffer' may be used uninitialized on the line below.
@@ -1010,31 +2304,60 @@ enum StatusCode PICC_Select(	Uid *uid,			///< Pointer to Uid struct. Normally ou
 	uid->size = 3 * cascadeLevel + 1;
 
 	return STATUS_OK;
-} // End PICC_Select()
+} // End PICC_Select_h()
 
 /**
  * Instructs a PICC in state ACTIVE(*) to go to state HALT.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PICC_HaltA() {
+enum StatusCode PICC_HaltA_h(MFRC522_Handle *dev) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_HALT);
 	uint8_t buffer[4];
+	enum StatusCode result;
 
-	// Build command buffer
-	buffer[0] = PICC_CMD_HLTA;
-	buffer[1] = 0;
-	// Calculate CRC_A
-	enum StatusCode result = PCD_CalculateCRC(buffer, 2, &buffer[2]);
-	if (result != STATUS_OK) {
+	// HLTA is an ISO/IEC 14443-3 command, 106 kbit/s. The next PICC starts there too.
+	if (PCD_SetBitRate_h(dev, PCD_BITRATE_106, PCD_BITRATE_106) != ESP_OK)
+		return STATUS_ERROR;
+
+	if (dev->_crcMode == PCD_CRC_HARDWARE) {
+		// The MFRC522 appends the CRC_A, nothing comes back.
+		if (PCD_SetCRCOffload(dev, true, false) != ESP_OK)
+			return STATUS_ERROR;
+		buffer[0] = PICC_CMD_HLTA;
+		buffer[1] = 0;
+		PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_HLTA);
+		result = PCD_CommunicateWithPICC_h(dev, PCD_Transceive, 0x30, buffer, 2, NULL, NULL, NULL, 0, false);
+		if (result == STATUS_TIMEOUT) {
+			return STATUS_OK;
+		}
+		if (result == STATUS_OK) {
+			return STATUS_ERROR;
+		}
 		return result;
 	}
 
+	// Build command buffer
+	if (dev->_crcMode == PCD_CRC_SOFTWARE) {
+		memcpy(buffer, CRC_A_HLTA_FRAME, sizeof(buffer));	// The HLTA frame is constant, CRC_A included.
+	}
+	else {
+		buffer[0] = PICC_CMD_HLTA;
+		buffer[1] = 0;
+		// Calculate CRC_A
+		result = PCD_CalculateCRC_h(dev, buffer, 2, &buffer[2]);
+		if (result != STATUS_OK) {
+			return result;
+		}
+	}
+
 	// Send the command.
 	// The standard says:
 	//		If the PICC responds with any modulation during a period of 1 ms after the end of the frame containing the
 	//		HLTA command, this response shall be interpreted as 'not acknowledge'.
-	// We interpret that this way: Only STATUS_TIMEOUT is an success.
-	result = PCD_TransceiveData(buffer, sizeof(buffer), NULL, 0, NULL, 0, false);
+	// We interpret that this way: Only STATUS_TIMEOUT is an success. So the timeout is all HLTA costs: PCD_TIMEOUT_HLTA.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_HLTA);
+	result = PCD_TransceiveData_h(dev, buffer, sizeof(buffer), NULL, 0, NULL, 0, false);
 	if (result == STATUS_TIMEOUT) {
 		return STATUS_OK;
 	}
@@ -1042,7 +2365,114 @@ enum StatusCode PICC_HaltA() {
 		return STATUS_ERROR;
 	}
 	return result;
-} // End PICC_HaltA()
+} // End PICC_HaltA_h()
+
+// true if uid is one of the count Uid in list
+static bool PICC_InventoryContains(const Uid *list, const size_t count, const Uid *uid) {
+	for (size_t i = 0; i < count; i++) {
+		if (list[i].size == uid->size && memcmp(list[i].uidByte, uid->uidByte, uid->size) == 0) {
+			return true;
+		}
+	}
+	return false;
+} // End PICC_InventoryContains()
+
+/**
+ * Enumerates every PICC in the field: REQA, anticollision/SELECT of one PICC, HLTA, and again until no PICC answers
+ * the REQA anymore. Only PICCs in state IDLE take part, like PICC_IsNewCardPresent_h().
+ * With reactivate a WUPA is sent at the end, which brings the halted PICCs back to READY*: any of them can then be
+ * selected directly with PICC_Select_h(dev, &uid, uid.size * 8). Otherwise they stay in HALT until they leave the field.
+ * A PICC whose HLTA failed is selected again by a later round; it is in out[] once.
+ *
+ * @return STATUS_OK when all PICCs were read (*found may be 0), STATUS_NO_ROOM if there were more than max PICCs
+ * 			(the first max are in out[]), STATUS_??? if communication failed repeatedly.
+ */
+enum StatusCode PICC_Inventory_h(MFRC522_Handle *dev, 	Uid *out,			///< Out: the UIDs of the PICCs found, in the order they were selected.
+								const size_t max,		///< Number of Uid in out[].
+								size_t *found,			///< Out: the number of Uid written to out[].
+								const bool reactivate	///< True => WUPA at the end. Default false.
+								) {
+	enum StatusCode result = STATUS_OK;
+	uint8_t failures = 0;
+	*found = 0;
+
+	while (true) {
+		uint8_t bufferATQA[2];
+		uint8_t bufferSize = sizeof(bufferATQA);
+		const enum StatusCode request = PICC_RequestA_h(dev, bufferATQA, &bufferSize);
+		if (request == STATUS_TIMEOUT) {
+			// Nobody left in state IDLE. Unless the last SELECT failed: PICCs left in READY ignore a REQA, ask again.
+			if (failures == 0 || ++failures >= INVENTORY_MAX_FAILURES) {
+				break;
+			}
+			continue;
+		}
+		if (request != STATUS_OK && request != STATUS_COLLISION) {		// Collision => several PICCs answered
+			if (++failures >= INVENTORY_MAX_FAILURES) {
+				result = request;
+				break;
+			}
+			continue;
+		}
+
+		Uid uid;
+		const enum StatusCode select = PICC_Select_h(dev, &uid, 0);
+		if (select != STATUS_OK) {
+			// A PICC that failed the anticollision went back to IDLE (or HALT), the next REQA tries again.
+			if (++failures >= INVENTORY_MAX_FAILURES) {
+				result = select;
+				break;
+			}
+			continue;
+		}
+		if (!PICC_InventoryContains(out, *found, &uid)) {
+			if (*found == max) {			// Someone is still there
+				result = STATUS_NO_ROOM;
+				break;
+			}
+			out[(*found)++] = uid;
+		}
+		const enum StatusCode halt = PICC_HaltA_h(dev);
+		if (halt != STATUS_OK) {
+			// The PICC may not be halted: the next REQA sends it back to IDLE, it answers the one after and is skipped.
+			if (++failures >= INVENTORY_MAX_FAILURES) {
+				result = halt;
+				break;
+			}
+			continue;
+		}
+		failures = 0;
+	}
+
+	if (reactivate) {
+		uint8_t bufferATQA[2];
+		uint8_t bufferSize = sizeof(bufferATQA);
+		PICC_WakeupA_h(dev, bufferATQA, &bufferSize);
+	}
+	return result;
+} // End PICC_Inventory_h()
+
+/**
+ * Wakes up a known PICC and selects it again, e.g. after a failed authentication dropped it back to IDLE.
+ * Stops Crypto1, sends WUPA (which also reaches PICCs in HALT) and a SELECT with the full UID, skipping the anticollision.
+ * The WUPA is a PICC_ProbeWakeup_h(): the ATQA is not read.
+ *
+ * @return STATUS_OK if the PICC is selected again, STATUS_??? otherwise (STATUS_TIMEOUT: it left the field).
+ */
+enum StatusCode PICC_Reselect_h(MFRC522_Handle *dev, const Uid *uid	///< The UID of the PICC, from an earlier PICC_Select_h().
+								) {
+	if (PCD_StopCrypto1_h(dev) != ESP_OK) {
+		return STATUS_ERROR;
+	}
+
+	const enum StatusCode result = PICC_ProbeWakeup_h(dev, NULL);
+	if (result != STATUS_OK && result != STATUS_COLLISION) {	// Collision => other PICCs woke up too, the SELECT picks ours.
+		return result;
+	}
+
+	Uid known = *uid;
+	return PICC_Select_h(dev, &known, uid->size * 8);
+} // End PICC_Reselect_h()
 
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -1055,17 +2485,19 @@ enum StatusCode PICC_HaltA() {
  * The authentication is described in the MFRC522 datasheet section 10.3.1.9 and http://www.nxp.com/documents/data_sheet/MF1S503x.pdf section 10.1.
  * For use with MIFARE Classic PICCs.
  * The PICC must be selected - ie in state ACTIVE(*) - before calling this function.
- * Remember to call PCD_StopCrypto1() after communicating with the authenticated PICC - otherwise no new communications can start.
+ * Remember to call PCD_StopCrypto1_h() after communicating with the authenticated PICC - otherwise no new communications can start.
  *
  * All keys are set to FFFFFFFFFFFFh at chip delivery.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise. Probably STATUS_TIMEOUT if you supply the wrong key.
  */
-enum StatusCode PCD_Authenticate(const uint8_t command,		///< PICC_CMD_MF_AUTH_KEY_A or PICC_CMD_MF_AUTH_KEY_B
+enum StatusCode PCD_Authenticate_h(MFRC522_Handle *dev, const uint8_t command,		///< PICC_CMD_MF_AUTH_KEY_A or PICC_CMD_MF_AUTH_KEY_B
                                  const uint8_t blockAddr, 	///< The block number. See numbering in the comments in the .h file.
 								 const MIFARE_Key *key,	///< Pointer to the Crypteo1 key to use (6 bytes)
 								 const Uid *uid			///< Pointer to Uid struct. The first 4 bytes of the UID is used.
 								) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_AUTH);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_AUTH);
     const uint8_t waitIRq = 0x10;		// IdleIRq
 
 	// Build command buffer
@@ -1079,18 +2511,19 @@ enum StatusCode PCD_Authenticate(const uint8_t command,		///< PICC_CMD_MF_AUTH_K
 		sendData[8+i] = uid->uidByte[i+uid->size-4];
 	}
 
-	// Start the authentication.
-    return PCD_CommunicateWithPICC(PCD_MFAuthent, waitIRq, &sendData[0], sizeof(sendData), NULL, NULL, NULL, 0, false);
-} // End PCD_Authenticate()
+	// Start the authentication. A wrong key only shows as a timeout, PCD_TIMEOUT_AUTH keeps that short.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_AUTH);
+    return PCD_CommunicateWithPICC_h(dev, PCD_MFAuthent, waitIRq, &sendData[0], sizeof(sendData), NULL, NULL, NULL, 0, false);
+} // End PCD_Authenticate_h()
 
 /**
  * Used to exit the PCD from its authenticated state.
  * Remember to call this function after communicating with an authenticated PICC - otherwise no new communications can start.
  */
-esp_err_t PCD_StopCrypto1() {
+esp_err_t PCD_StopCrypto1_h(MFRC522_Handle *dev) {
 	// Clear MFCrypto1On bit
-	return PCD_ClearRegisterBitMask(Status2Reg, 0x08); // Status2Reg[7..0] bits are: TempSensClear I2CForceHS reserved reserved MFCrypto1On ModemState[2:0]
-} // End PCD_StopCrypto1()
+	return PCD_ClearRegisterBitMask_h(dev, Status2Reg, 0x08); // Status2Reg[7..0] bits are: TempSensClear I2CForceHS reserved reserved MFCrypto1On ModemState[2:0]
+} // End PCD_StopCrypto1_h()
 
 /**
  * Reads 16 bytes (+ 2 bytes CRC_A) from the active PICC.
@@ -1105,13 +2538,16 @@ esp_err_t PCD_StopCrypto1() {
  *
  * The buffer must be at least 18 bytes because a CRC_A is also returned.
  * Checks the CRC_A before returning STATUS_OK.
+ * In PCD_CRC_HARDWARE mode the MFRC522 strips the CRC_A and *bufferSize is 16.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Read(	uint8_t blockAddr, 	///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The first page to return data from.
+enum StatusCode MIFARE_Read_h(MFRC522_Handle *dev, 	uint8_t blockAddr, 	///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The first page to return data from.
                             uint8_t *buffer,		///< The buffer to store the data in
                             uint8_t *bufferSize	///< Buffer size, at least 18 bytes. Also number of bytes returned if STATUS_OK.
 						) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_READ);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_READ);
     uint8_t result;
 
 	// Sanity check
@@ -1119,18 +2555,34 @@ enum StatusCode MIFARE_Read(	uint8_t blockAddr, 	///< MIFARE Classic: The block
 		return STATUS_NO_ROOM;
 	}
 
+	if (dev->_crcMode == PCD_CRC_HARDWARE) {
+		// CRC_A is appended and checked by the MFRC522. Only the 16 data bytes are returned.
+		if (PCD_SetCRCOffload(dev, true, true) != ESP_OK)
+			return STATUS_ERROR;
+		buffer[0] = PICC_CMD_MF_READ;
+		buffer[1] = blockAddr;
+		PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_READ);
+		return PCD_CommunicateWithPICC_h(dev, PCD_Transceive, 0x30, buffer, 2, buffer, bufferSize, NULL, 0, true);
+	}
+
 	// Build command buffer
-	buffer[0] = PICC_CMD_MF_READ;
-	buffer[1] = blockAddr;
-	// Calculate CRC_A
-	result = PCD_CalculateCRC(buffer, 2, &buffer[2]);
-	if (result != STATUS_OK) {
-		return result;
+	if (dev->_crcMode == PCD_CRC_SOFTWARE) {
+		CRC_A_BuildReadFrame(blockAddr, buffer);	// Precomputed READ CRC_A state, one table lookup.
+	}
+	else {
+		buffer[0] = PICC_CMD_MF_READ;
+		buffer[1] = blockAddr;
+		// Calculate CRC_A
+		result = PCD_CalculateCRC_h(dev, buffer, 2, &buffer[2]);
+		if (result != STATUS_OK) {
+			return result;
+		}
 	}
 
 	// Transmit the buffer and receive the response, validate CRC_A.
-	return PCD_TransceiveData(buffer, 4, buffer, bufferSize, NULL, 0, true);
-} // End MIFARE_Read()
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_READ);
+	return PCD_TransceiveData_h(dev, buffer, 4, buffer, bufferSize, NULL, 0, true);
+} // End MIFARE_Read_h()
 
 /**
  * Writes 16 bytes to the active PICC.
@@ -1143,10 +2595,12 @@ enum StatusCode MIFARE_Read(	uint8_t blockAddr, 	///< MIFARE Classic: The block
  * *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Write(const uint8_t blockAddr, ///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The page (2-15) to write to.
+enum StatusCode MIFARE_Write_h(MFRC522_Handle *dev, const uint8_t blockAddr, ///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The page (2-15) to write to.
                              const uint8_t *buffer,	///< The 16 bytes to write to the PICC
                              const uint8_t bufferSize	///< Buffer size, must be at least 16 bytes. Exactly 16 bytes are written.
 						) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_WRITE);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_WRITE);
 	// Sanity check
 	if (buffer == NULL || bufferSize < 16) {
 		return STATUS_INVALID;
@@ -1157,29 +2611,33 @@ enum StatusCode MIFARE_Write(const uint8_t blockAddr, ///< MIFARE Classic: The b
     uint8_t cmdBuffer[2];
 	cmdBuffer[0] = PICC_CMD_MF_WRITE;
 	cmdBuffer[1] = blockAddr;
-	enum StatusCode result = PCD_MIFARE_Transceive(cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	enum StatusCode result = PCD_MIFARE_Transceive_h(dev, cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
 	if (result != STATUS_OK) {
 		return result;
 	}
 
 	// Step 2: Transfer the data
-	result = PCD_MIFARE_Transceive(buffer, bufferSize, false); // Adds CRC_A and checks that the response is MF_ACK.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	result = PCD_MIFARE_Transceive_h(dev, buffer, bufferSize, false); // Adds CRC_A and checks that the response is MF_ACK.
 	if (result != STATUS_OK) {
 		return result;
 	}
 
 	return STATUS_OK;
-} // End MIFARE_Write()
+} // End MIFARE_Write_h()
 
 /**
  * Writes a 4 byte page to the active MIFARE Ultralight PICC.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode  MIFARE_Ultralight_Write(	const uint8_t page, 		///< The page (2-15) to write to.
+enum StatusCode  MIFARE_Ultralight_Write_h(MFRC522_Handle *dev, 	const uint8_t page, 		///< The page (2-15) to write to.
 											const uint8_t *buffer,		///< The 4 bytes to write to the PICC
 											const uint8_t bufferSize	///< Buffer size, must be at least 4 bytes. Exactly 4 bytes are written.
 									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_WRITE);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_WRITE);
 	// Sanity check
 	if (buffer == NULL || bufferSize < 4) {
 		return STATUS_INVALID;
@@ -1192,83 +2650,273 @@ enum StatusCode  MIFARE_Ultralight_Write(	const uint8_t page, 		///< The page (2
 	memcpy(&cmdBuffer[2], buffer, 4);
 
 	// Perform the write
-	const enum StatusCode result = PCD_MIFARE_Transceive(cmdBuffer, 6, false); // Adds CRC_A and checks that the response is MF_ACK.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	const enum StatusCode result = PCD_MIFARE_Transceive_h(dev, cmdBuffer, 6, false); // Adds CRC_A and checks that the response is MF_ACK.
+	if (result != STATUS_OK) {
+		return result;
+	}
+	return STATUS_OK;
+} // End MIFARE_Ultralight_Write_h()
+
+/**
+ * Reads the pages startPage..endPage from the active PICC in one exchange (NTAG21x, MIFARE Ultralight EV1).
+ * The response is streamed through the FIFO (PCD_TransceiveStream_h()), at most MIFARE_FastReadMaxPages_h() pages.
+ * Original MIFARE Ultralight PICCs do not support FAST_READ and go to IDLE. Use MIFARE_Read_h() for those.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_FastRead_h(MFRC522_Handle *dev,	const uint8_t startPage,	///< The first page to read
+														const uint8_t endPage,		///< The last page to read, inclusive
+														uint8_t *buffer,			///< The buffer to store the data in
+														uint8_t *bufferSize			///< Buffer size, at least 4 bytes per page + 2 bytes CRC_A. Out: the number of data bytes returned if STATUS_OK.
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_READ);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_READ);
+	// Sanity check
+	if (endPage < startPage || endPage - startPage + 1 > MIFARE_FastReadMaxPages_h(dev)) {
+		return STATUS_INVALID;
+	}
+	if (buffer == NULL || *bufferSize < (endPage - startPage + 1) * 4 + 2) {
+		return STATUS_NO_ROOM;
+	}
+
+	uint8_t cmdBuffer[3];
+	cmdBuffer[0] = PICC_CMD_UL_FAST_READ;
+	cmdBuffer[1] = startPage;
+	cmdBuffer[2] = endPage;
+
+	uint16_t backLen = *bufferSize;
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_READ);
+	const enum StatusCode result = PCD_TransceiveStream_h(dev, cmdBuffer, sizeof(cmdBuffer), buffer, &backLen, NULL, true);
+	*bufferSize = backLen;
+	return result;
+} // End MIFARE_FastRead_h()
+
+/**
+ * The most pages one MIFARE_FastRead_h() can return: MFRC_FAST_READ_MAX_PAGES, limited by the uint8_t buffer size.
+ */
+uint8_t MIFARE_FastReadMaxPages_h(MFRC522_Handle *dev) {
+	return MFRC_FAST_READ_MAX_PAGES < 63 ? MFRC_FAST_READ_MAX_PAGES : 63;
+} // End MIFARE_FastReadMaxPages_h()
+
+/**
+ * Reads the 8 byte version information of the active PICC (NTAG21x, MIFARE Ultralight EV1):
+ * fixed header, vendor ID, product type, product subtype, major and minor product version, storage size, protocol type.
+ * PICCs without GET_VERSION (original MIFARE Ultralight) go to IDLE.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. STATUS_TIMEOUT if the PICC does not support GET_VERSION.
+ */
+enum StatusCode MIFARE_GetVersion_h(MFRC522_Handle *dev,	uint8_t *buffer,		///< The buffer to store the data in
+															uint8_t *bufferSize		///< Buffer size, at least 10 bytes. Also number of bytes returned if STATUS_OK.
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_READ);
+	// Sanity check
+	if (buffer == NULL || *bufferSize < 10) {
+		return STATUS_NO_ROOM;
+	}
+
+	uint8_t cmdBuffer[3];
+	cmdBuffer[0] = PICC_CMD_UL_GET_VERSION;
+
+	if (dev->_crcMode == PCD_CRC_HARDWARE) {
+		if (PCD_SetCRCOffload(dev, true, true) != ESP_OK)
+			return STATUS_ERROR;
+		PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_READ);
+		return PCD_CommunicateWithPICC_h(dev, PCD_Transceive, 0x30, cmdBuffer, 1, buffer, bufferSize, NULL, 0, true);
+	}
+
+	const enum StatusCode result = PCD_CalculateCRC_h(dev, cmdBuffer, 1, &cmdBuffer[1]);
 	if (result != STATUS_OK) {
 		return result;
 	}
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_READ);
+	return PCD_TransceiveData_h(dev, cmdBuffer, 3, buffer, bufferSize, NULL, 0, true);
+} // End MIFARE_GetVersion_h()
+
+/**
+ * Finds the number of pages of a MIFARE Ultralight or NTAG PICC with GET_VERSION.
+ * The PICC is selected again if it does not support GET_VERSION; it is then assumed to be an original
+ * MIFARE Ultralight with 16 pages, which only supports READ.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_Ultralight_GetPageCount_h(MFRC522_Handle *dev,	const Uid *uid,			///< The selected PICC
+																		uint16_t *pageCount,	///< Out: the number of pages
+																		bool *fastRead			///< Out (NULL: unused): true if the PICC supports FAST_READ
+												) {
+	uint8_t version[10];
+	uint8_t versionSize = sizeof(version);
+	enum StatusCode result = MIFARE_GetVersion_h(dev, version, &versionSize);
+
+	*pageCount = 0;
+	if (result == STATUS_OK && versionSize >= 8 && version[1] == 0x04) {	// NXP
+		const uint8_t productType = version[2];		// 0x03: MIFARE Ultralight EV1, 0x04: NTAG
+		switch (version[6]) {						// storage size
+			case 0x0B: *pageCount = 20;		break;	// NTAG210, MF0UL11
+			case 0x0E: *pageCount = 41;		break;	// NTAG212, MF0UL21
+			case 0x0F: *pageCount = 45;		break;	// NTAG213
+			case 0x11: *pageCount = 135;	break;	// NTAG215
+			case 0x13: *pageCount = 231;	break;	// NTAG216
+		}
+		if (productType != 0x03 && productType != 0x04) {
+			*pageCount = 0;
+		}
+	}
+	if (*pageCount) {
+		if (fastRead) {
+			*fastRead = true;
+		}
+		return STATUS_OK;
+	}
+
+	// No (known) GET_VERSION answer. An original MIFARE Ultralight went to IDLE, get it back.
+	if (result != STATUS_OK) {
+		result = PICC_Reselect_h(dev, uid);
+		if (result != STATUS_OK) {
+			return result;
+		}
+	}
+	*pageCount = 16;
+	if (fastRead) {
+		*fastRead = false;
+	}
+	return STATUS_OK;
+} // End MIFARE_Ultralight_GetPageCount_h()
+
+/**
+ * Reads pageCount pages from the active MIFARE Ultralight or NTAG PICC into buffer, starting at firstPage.
+ * With fastRead, one FAST_READ per MIFARE_FastReadMaxPages_h() pages, else one READ per 4 pages.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_Ultralight_ReadPages_h(MFRC522_Handle *dev,	const uint8_t firstPage,	///< The first page to read
+																	const uint16_t pageCount,	///< The number of pages to read
+																	const bool fastRead,		///< True => FAST_READ, the PICC must support it. See MIFARE_Ultralight_GetPageCount_h().
+																	uint8_t *buffer,			///< Out: 4 bytes per page
+																	const size_t bufferSize		///< At least 4 * pageCount bytes
+											  ) {
+	if (buffer == NULL || bufferSize < (size_t)pageCount * 4) {
+		return STATUS_NO_ROOM;
+	}
+	if (firstPage + pageCount > 256) {
+		return STATUS_INVALID;
+	}
+
+	const uint8_t maxPages = fastRead ? MIFARE_FastReadMaxPages_h(dev) : 4;
+	uint8_t chunk[63 * 4 + 2];			// the most MIFARE_FastReadMaxPages_h() allows, and at least the 18 bytes of a READ
+	for (uint16_t done = 0; done < pageCount; ) {
+		const uint16_t left = pageCount - done;
+		const uint8_t pages = left < maxPages ? left : maxPages;
+		const uint8_t page = firstPage + done;
+		uint8_t chunkSize = sizeof(chunk);
+
+		enum StatusCode result = fastRead
+				? MIFARE_FastRead_h(dev, page, page + pages - 1, chunk, &chunkSize)
+				: MIFARE_Read_h(dev, page, chunk, &chunkSize);	// always 4 pages, wrapping around at the end of the memory
+		if (result != STATUS_OK) {
+			return result;
+		}
+		if (chunkSize < pages * 4) {
+			return STATUS_ERROR;
+		}
+		memcpy(&buffer[done * 4], chunk, pages * 4);
+		done += pages;
+	}
 	return STATUS_OK;
-} // End MIFARE_Ultralight_Write()
+} // End MIFARE_Ultralight_ReadPages_h()
+
+/**
+ * Reads the whole memory of a MIFARE Ultralight or NTAG PICC: finds its size with GET_VERSION and reads it with
+ * FAST_READ, or with READ on an original MIFARE Ultralight.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. STATUS_NO_ROOM if the buffer is smaller than the memory.
+ */
+enum StatusCode MIFARE_Ultralight_ReadAll_h(MFRC522_Handle *dev,	const Uid *uid,			///< The selected PICC
+																	uint8_t *buffer,		///< Out: 4 bytes per page
+																	const size_t bufferSize,	///< NTAG216: 924 bytes
+																	uint16_t *pageCount		///< Out: the number of pages read
+											) {
+	bool fastRead;
+	enum StatusCode result = MIFARE_Ultralight_GetPageCount_h(dev, uid, pageCount, &fastRead);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	return MIFARE_Ultralight_ReadPages_h(dev, 0, *pageCount, fastRead, buffer, bufferSize);
+} // End MIFARE_Ultralight_ReadAll_h()
 
 /**
  * MIFARE Decrement subtracts the delta from the value of the addressed block, and stores the result in a volatile memory.
  * For MIFARE Classic only. The sector containing the block must be authenticated before calling this function.
  * Only for blocks in "value block" mode, ie with access bits [C1 C2 C3] = [110] or [001].
- * Use MIFARE_Transfer() to store the result in a block.
+ * Use MIFARE_Transfer_h() to store the result in a block.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Decrement(const uint8_t blockAddr, ///< The block (0-0xff) number.
+enum StatusCode MIFARE_Decrement_h(MFRC522_Handle *dev, const uint8_t blockAddr, ///< The block (0-0xff) number.
 								 const long delta		///< This number is subtracted from the value of block blockAddr.
 							) {
-	return MIFARE_TwoStepHelper(PICC_CMD_MF_DECREMENT, blockAddr, delta);
-} // End MIFARE_Decrement()
+	return MIFARE_TwoStepHelper_h(dev, PICC_CMD_MF_DECREMENT, blockAddr, delta);
+} // End MIFARE_Decrement_h()
 
 /**
  * MIFARE Increment adds the delta to the value of the addressed block, and stores the result in a volatile memory.
  * For MIFARE Classic only. The sector containing the block must be authenticated before calling this function.
  * Only for blocks in "value block" mode, ie with access bits [C1 C2 C3] = [110] or [001].
- * Use MIFARE_Transfer() to store the result in a block.
+ * Use MIFARE_Transfer_h() to store the result in a block.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Increment(const uint8_t blockAddr, ///< The block (0-0xff) number.
+enum StatusCode MIFARE_Increment_h(MFRC522_Handle *dev, const uint8_t blockAddr, ///< The block (0-0xff) number.
 								 const long delta		///< This number is added to the value of block blockAddr.
 							) {
-	return MIFARE_TwoStepHelper(PICC_CMD_MF_INCREMENT, blockAddr, delta);
-} // End MIFARE_Increment()
+	return MIFARE_TwoStepHelper_h(dev, PICC_CMD_MF_INCREMENT, blockAddr, delta);
+} // End MIFARE_Increment_h()
 
 /**
  * MIFARE Restore copies the value of the addressed block into a volatile memory.
  * For MIFARE Classic only. The sector containing the block must be authenticated before calling this function.
  * Only for blocks in "value block" mode, ie with access bits [C1 C2 C3] = [110] or [001].
- * Use MIFARE_Transfer() to store the result in a block.
+ * Use MIFARE_Transfer_h() to store the result in a block.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Restore(	uint8_t blockAddr ///< The block (0-0xff) number.
+enum StatusCode MIFARE_Restore_h(MFRC522_Handle *dev, 	uint8_t blockAddr ///< The block (0-0xff) number.
 							) {
 	// The datasheet describes Restore as a two step operation, but does not explain what data to transfer in step 2.
 	// Doing only a single step does not work, so I chose to transfer 0L in step two.
-	return MIFARE_TwoStepHelper(PICC_CMD_MF_RESTORE, blockAddr, 0L);
-} // End MIFARE_Restore()
+	return MIFARE_TwoStepHelper_h(dev, PICC_CMD_MF_RESTORE, blockAddr, 0L);
+} // End MIFARE_Restore_h()
 
 /**
  * Helper function for the two-step MIFARE Classic protocol operations Decrement, Increment and Restore.
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_TwoStepHelper(const uint8_t command,	///< The command to use
+enum StatusCode MIFARE_TwoStepHelper_h(MFRC522_Handle *dev, const uint8_t command,	///< The command to use
                                      const uint8_t blockAddr,	///< The block (0-0xff) number.
 									 const long data		///< The data to transfer in step 2
 									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_WRITE);
 	uint8_t cmdBuffer[2]; // We only need room for 2 bytes.
 
 	// Step 1: Tell the PICC the command and block address
 	cmdBuffer[0] = command;
 	cmdBuffer[1] = blockAddr;
-	enum StatusCode result = PCD_MIFARE_Transceive(cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	enum StatusCode result = PCD_MIFARE_Transceive_h(dev, cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
 	if (result != STATUS_OK) {
 		return result;
 	}
 
-	// Step 2: Transfer the data
-    result = PCD_MIFARE_Transceive(	(uint8_t *)&data, 4, true); // Adds CRC_A and accept timeout as success.
+	// Step 2: Transfer the data. The PICC does not answer, the timeout is the time it gets to compute the value.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+    result = PCD_MIFARE_Transceive_h(dev, 	(uint8_t *)&data, 4, true); // Adds CRC_A and accept timeout as success.
 	if (result != STATUS_OK) {
 		return result;
 	}
 
 	return STATUS_OK;
-} // End MIFARE_TwoStepHelper()
+} // End MIFARE_TwoStepHelper_h()
 
 /**
  * MIFARE Transfer writes the value stored in the volatile memory into one MIFARE Classic block.
@@ -1277,19 +2925,21 @@ enum StatusCode MIFARE_TwoStepHelper(const uint8_t command,	///< The command to
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_Transfer(const uint8_t blockAddr ///< The block (0-0xff) number.
+enum StatusCode MIFARE_Transfer_h(MFRC522_Handle *dev, const uint8_t blockAddr ///< The block (0-0xff) number.
 								) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_WRITE);
 	uint8_t cmdBuffer[2]; // We only need room for 2 bytes.
 
 	// Tell the PICC we want to transfer the result into block blockAddr.
 	cmdBuffer[0] = PICC_CMD_MF_TRANSFER;
 	cmdBuffer[1] = blockAddr;
-	const enum StatusCode result = PCD_MIFARE_Transceive(cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_WRITE);
+	const enum StatusCode result = PCD_MIFARE_Transceive_h(dev, cmdBuffer, 2, false); // Adds CRC_A and checks that the response is MF_ACK.
 	if (result != STATUS_OK) {
 		return result;
 	}
 	return STATUS_OK;
-} // End MIFARE_Transfer()
+} // End MIFARE_Transfer_h()
 
 /**
  * Helper routine to read the current value from a Value Block.
@@ -1302,12 +2952,12 @@ enum StatusCode MIFARE_Transfer(const uint8_t blockAddr ///< The block (0-0xff)
  * @param[out]  value       Current value of the Value Block.
  * @return STATUS_OK on success, STATUS_??? otherwise.
   */
-enum StatusCode MIFARE_GetValue(const uint8_t blockAddr, long *value) {
+enum StatusCode MIFARE_GetValue_h(MFRC522_Handle *dev, const uint8_t blockAddr, long *value) {
 	uint8_t buffer[18];
     uint8_t size = sizeof(buffer);
 
 	// Read the block
-	const enum StatusCode status = MIFARE_Read(blockAddr, buffer, &size);
+	const enum StatusCode status = MIFARE_Read_h(dev, blockAddr, buffer, &size);
 	if (status == STATUS_OK) {
 		// Extract the value
 		*value =
@@ -1317,7 +2967,7 @@ enum StatusCode MIFARE_GetValue(const uint8_t blockAddr, long *value) {
                 ((long)(buffer[0]));
 	}
 	return status;
-} // End MIFARE_GetValue()
+} // End MIFARE_GetValue_h()
 
 /**
  * Helper routine to write a specific value into a Value Block.
@@ -1330,7 +2980,7 @@ enum StatusCode MIFARE_GetValue(const uint8_t blockAddr, long *value) {
  * @param[in]   value       New value of the Value Block.
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode MIFARE_SetValue(const uint8_t blockAddr, const long value) {
+enum StatusCode MIFARE_SetValue_h(MFRC522_Handle *dev, const uint8_t blockAddr, const long value) {
     uint8_t buffer[18];
 
 	// Translate the long into 4 bytes; repeated 2x in value block
@@ -1348,8 +2998,8 @@ enum StatusCode MIFARE_SetValue(const uint8_t blockAddr, const long value) {
 	buffer[13] = buffer[15] = ~blockAddr;
 
 	// Write the whole data block
-	return MIFARE_Write(blockAddr, buffer, 16);
-} // End MIFARE_SetValue()
+	return MIFARE_Write_h(dev, blockAddr, buffer, 16);
+} // End MIFARE_SetValue_h()
 
 /////////////////////////////////////////////////////////////////////////////////////
 // Support functions
@@ -1361,32 +3011,87 @@ enum StatusCode MIFARE_SetValue(const uint8_t blockAddr, const long value) {
  *
  * @return STATUS_OK on success, STATUS_??? otherwise.
  */
-enum StatusCode PCD_MIFARE_Transceive(	const uint8_t *sendData,		///< Pointer to the data to transfer to the FIFO. Do NOT include the CRC_A.
+enum StatusCode PCD_MIFARE_Transceive_h(MFRC522_Handle *dev, 	const uint8_t *sendData,		///< Pointer to the data to transfer to the FIFO. Do NOT include the CRC_A.
                                         const uint8_t sendLenIn,		///< Number of bytes in sendData.
 										const bool acceptTimeout	///< True => A timeout is also success
 									) {
-	uint8_t cmdBuffer[18]; // We need room for 16 bytes data and 2 bytes CRC_A.
+	// Sanity check
+	if (sendData == NULL) {
+		return STATUS_INVALID;
+	}
+	const PCD_Segment segment = {sendData, sendLenIn};
+	return PCD_MIFARE_TransceiveSegments_h(dev, &segment, 1, acceptTimeout);
+} // End PCD_MIFARE_Transceive_h()
+
+/**
+ * PCD_MIFARE_Transceive_h() with the data in pieces, e.g. command and address in one buffer and the 16 bytes of a block
+ * in another. The CRC_A is sent as one more segment: nothing is copied.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_MIFARE_TransceiveSegments_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< The data to transfer to the FIFO. Do NOT include the CRC_A.
+												const uint8_t count,		///< Number of segments, at most MFRC_MAX_SEGMENTS - 1.
+												const bool acceptTimeout	///< True => A timeout is also success
+									) {
+	return PCD_MIFARE_TransceiveWithCRC_h(dev, segments, count, NULL, acceptTimeout);
+} // End PCD_MIFARE_TransceiveSegments_h()
 
+/**
+ * PCD_MIFARE_TransceiveSegments_h() with the CRC_A of the frame computed ahead, e.g. for a series of frames known in
+ * advance: no CRC calculation between the frames, whatever PCD_SetCRCMode_h() says. With PCD_CRC_HARDWARE the
+ * MFRC522 appends the CRC_A and crc is not used.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_MIFARE_TransceiveWithCRC_h(MFRC522_Handle *dev,	const PCD_Segment *segments,	///< The data to transfer to the FIFO. Do NOT include the CRC_A.
+												const uint8_t count,		///< Number of segments, at most MFRC_MAX_SEGMENTS - 1.
+												const uint8_t *crc,			///< The CRC_A of the segments (CRC_A_Calculate()), 2 bytes. NULL => calculated here.
+												const bool acceptTimeout	///< True => A timeout is also success
+									) {
 	// Sanity check
-	if (sendData == NULL || sendLenIn > 16) {
+	if (count > MFRC_MAX_SEGMENTS - 1) {
+		return STATUS_INVALID;
+	}
+	PCD_Segment frame[MFRC_MAX_SEGMENTS];
+	uint16_t sendLen = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		frame[i] = segments[i];
+		sendLen += segments[i].length;
+	}
+	if (sendLen > 16) {
 		return STATUS_INVALID;
 	}
 
-	// Copy sendData[] to cmdBuffer[] and add CRC_A
-	memcpy(cmdBuffer, sendData, sendLenIn);
-	enum StatusCode result = PCD_CalculateCRC(cmdBuffer, sendLenIn, &cmdBuffer[sendLenIn]);
-	if (result != STATUS_OK) {
-		return result;
+	// Add CRC_A as the last segment, unless the MFRC522 does it for us.
+	// The reply is a 4 bit ACK/NAK without CRC_A, so RxCRCEn stays off either way.
+	const bool useCRCOffload = dev->_crcMode == PCD_CRC_HARDWARE;
+	if (PCD_SetCRCOffload(dev, useCRCOffload, false) != ESP_OK) {
+		return STATUS_ERROR;
+	}
+	enum StatusCode result;
+	uint8_t frameCount = count;
+	uint8_t calculated[2];
+	if (!useCRCOffload) {
+		if (!crc) {
+			result = PCD_CalculateCRCSegments_h(dev, segments, count, calculated);
+			if (result != STATUS_OK) {
+				return result;
+			}
+			crc = calculated;
+		}
+		frame[frameCount].data = crc;
+		frame[frameCount].length = 2;
+		frameCount++;
 	}
-	const uint8_t sendLen = sendLenIn + 2;
 
-	// Transceive the data, store the reply in cmdBuffer[]
+	// Transceive the data, store the reply in response[]
     const uint8_t waitIRq = 0x30;		// RxIRq and IdleIRq
-    uint8_t cmdBufferSize = sizeof(cmdBuffer);
+    uint8_t response[18];				// a 4 bit ACK/NAK is expected, anything longer is an error
+    uint8_t responseSize = sizeof(response);
     uint8_t validBits = 0;
     const uint8_t rxAlign = 0;
     const bool checkCRC = false;
-	result = PCD_CommunicateWithPICC(PCD_Transceive, waitIRq, cmdBuffer, sendLen, cmdBuffer, &cmdBufferSize, &validBits, rxAlign, checkCRC);
+	result = PCD_CommunicateWithPICCSegments_h(dev, PCD_Transceive, waitIRq, frame, frameCount, response, &responseSize, &validBits, rxAlign, checkCRC);
 	if (acceptTimeout && result == STATUS_TIMEOUT) {
 		return STATUS_OK;
 	}
@@ -1394,14 +3099,14 @@ enum StatusCode PCD_MIFARE_Transceive(	const uint8_t *sendData,		///< Pointer to
 		return result;
 	}
 	// The PICC must reply with a 4 bit ACK
-	if (cmdBufferSize != 1 || validBits != 4) {
+	if (responseSize != 1 || validBits != 4) {
 		return STATUS_ERROR;
 	}
-	if (cmdBuffer[0] != MF_ACK) {
+	if (response[0] != MF_ACK) {
 		return STATUS_MIFARE_NACK;
 	}
 	return STATUS_OK;
-} // End PCD_MIFARE_Transceive()
+} // End PCD_MIFARE_TransceiveWithCRC_h()
 
 /**
  * Returns a __FlashStringHelper pointer to a status code name.
@@ -1420,6 +3125,7 @@ const char *GetStatusCodeName(const uint8_t code	///< One of the StatusCode enum
         case STATUS_INVALID:		return "Invalid argument.";
         case STATUS_CRC_WRONG:		return "The CRC_A does not match.";
         case STATUS_MIFARE_NACK:	return "A MIFARE PICC responded with NAK.";
+        case STATUS_PENDING:		return "The command is still running.";
         default:					return "Unknown error";
 	}
 } // End GetStatusCodeName()
@@ -1479,64 +3185,73 @@ const char *PICC_GetTypeName(uint8_t piccType	///< One of the PICC_Type enums.
 	}
 } // End PICC_GetTypeName()
 
+/**
+ * Sets where the dump functions (PCD_DumpVersionToSerial_h(), PICC_Dump*ToSerial_h()) write their text to:
+ * a UART, the log, a ring buffer... The writer is called once per line. NULL: stdout, like printf.
+ */
+void PCD_SetDumpWriter_h(MFRC522_Handle *dev, MFRC522_DumpWriter writer,
+						void *ctx			///< Passed to every writer call.
+						) {
+	dev->_dumpWriter = writer;
+	dev->_dumpWriterCtx = ctx;
+} // End PCD_SetDumpWriter_h()
+
 /**
  * Dumps debug info about the connected PCD to serial_
  * Shows all known firmware versions
  */
-void PCD_DumpVersionToSerial() {
+void PCD_DumpVersionToSerial_h(MFRC522_Handle *dev) {
+	DumpLine line = {.dev = dev};
 	// Get the MFRC522 firmware version
     uint8_t v;
-	if (PCD_GetVersion(&v) != ESP_OK)
+	if (PCD_GetVersion_h(dev, &v) != ESP_OK)
 	{
-		serial_println("MFRC522: couldn't read version#");
+		dump_println(&line, "MFRC522: couldn't read version#");
 		return;
 	}
-    serial_print("MFRC522 Firmware Version Detected: 0x");
-	serial_print_f(v, HEX);
+    dump_str(&line, "MFRC522 Firmware Version Detected: 0x");
+	dump_hex(&line, v);
 	// Lookup which version
 	switch(v) {
-		case 0x88: serial_println(" = (clone)");  break;
-		case 0x90: serial_println(" = v0.0");     break;
-		case 0x91: serial_println(" = v1.0");     break;
-		case 0x92: serial_println(" = v2.0");     break;
-		case 0x12: serial_println(" = counterfeit chip");     break;
-		default:   serial_println(" = (unknown)");
+		case 0x88: dump_println(&line, " = (clone)");  break;
+		case 0x90: dump_println(&line, " = v0.0");     break;
+		case 0x91: dump_println(&line, " = v1.0");     break;
+		case 0x92: dump_println(&line, " = v2.0");     break;
+		case 0x12: dump_println(&line, " = counterfeit chip");     break;
+		default:   dump_println(&line, " = (unknown)");
 	}
 	// When 0x00 or 0xFF is returned, communication probably failed
 	if ((v == 0x00) || (v == 0xFF))
-		serial_println("WARNING: Communication failure, is the MFRC522 properly connected?");
+		dump_println(&line, "WARNING: Communication failure, is the MFRC522 properly connected?");
 }
 
-esp_err_t PCD_GetVersion(uint8_t* version_out) {
-    return PCD_ReadRegister(VersionReg, version_out);
+esp_err_t PCD_GetVersion_h(MFRC522_Handle *dev, uint8_t* version_out) {
+    return PCD_ReadRegister_h(dev, VersionReg, version_out);
 }
 
-// End PCD_DumpVersionToSerial()
+// End PCD_DumpVersionToSerial_h()
 
 /**
  * Dumps debug info about the selected PICC to serial_
  * On success the PICC is halted after dumping the data.
  * For MIFARE Classic the factory default key of 0xFFFFFFFFFFFF is tried.
  */
-void PICC_DumpToSerial(const Uid *uid	///< Pointer to Uid struct returned from a successful PICC_Select().
+void PICC_DumpToSerial_h(MFRC522_Handle *dev, const Uid *uid	///< Pointer to Uid struct returned from a successful PICC_Select().
 								) {
 	MIFARE_Key key;
+	DumpLine line = {.dev = dev};
 
 	// UID
-    serial_print("Card UID:");
+    dump_str(&line, "Card UID:");
     for (uint8_t i = 0; i < uid->size; i++) {
-		if(uid->uidByte[i] < 0x10)
-            serial_print(" 0");
-		else
-            serial_print(" ");
-		serial_print_f(uid->uidByte[i], HEX);
+		dump_hex_byte(&line, uid->uidByte[i]);
 	}
-	serial_println("");
+	dump_println(&line, "");
 
 	// PICC type
     const enum PICC_Type piccType = PICC_GetType(uid->sak);
-    serial_print("PICC type: ");
-	serial_println(PICC_GetTypeName(piccType));
+    dump_str(&line, "PICC type: ");
+	dump_println(&line, PICC_GetTypeName(piccType));
 
 	// Dump contents
 	switch (piccType) {
@@ -1547,18 +3262,18 @@ void PICC_DumpToSerial(const Uid *uid	///< Pointer to Uid struct returned from a
             for (uint8_t i = 0; i < 6; i++) {
 				key.keyByte[i] = 0xFF;
 			}
-			PICC_DumpMifareClassicToSerial(uid, piccType, &key);
+			PICC_DumpMifareClassicToSerial_h(dev, uid, piccType, &key);
 			break;
 
 		case PICC_TYPE_MIFARE_UL:
-			PICC_DumpMifareUltralightToSerial();
+			PICC_DumpMifareUltralightToSerial_h(dev);
 			break;
 
 		case PICC_TYPE_ISO_14443_4:
 		case PICC_TYPE_ISO_18092:
 		case PICC_TYPE_MIFARE_PLUS:
 		case PICC_TYPE_TNP3XXX:
-            serial_println("Dumping memory contents not implemented for that PICC type.");
+            dump_println(&line, "Dumping memory contents not implemented for that PICC type.");
 			break;
 
 		case PICC_TYPE_UNKNOWN:
@@ -1567,15 +3282,15 @@ void PICC_DumpToSerial(const Uid *uid	///< Pointer to Uid struct returned from a
 			break; // No memory dump here
 	}
 
-    serial_println("");
-	PICC_HaltA(); // Already done if it was a MIFARE Classic PICC.
-} // End PICC_DumpToSerial()
+    dump_println(&line, "");
+	PICC_HaltA_h(dev); // Already done if it was a MIFARE Classic PICC.
+} // End PICC_DumpToSerial_h()
 
 /**
  * Dumps memory contents of a MIFARE Classic PICC.
  * On success the PICC is halted after dumping the data.
  */
-void PICC_DumpMifareClassicToSerial(	const Uid *uid,		    ///< Pointer to Uid struct returned from a successful PICC_Select().
+void PICC_DumpMifareClassicToSerial_h(MFRC522_Handle *dev, 	const Uid *uid,		    ///< Pointer to Uid struct returned from a successful PICC_Select().
                                         const uint8_t piccType,	///< One of the PICC_Type enums.
                                         const MIFARE_Key *key	    ///< Key A used for all sectors.
 											) {
@@ -1602,21 +3317,22 @@ void PICC_DumpMifareClassicToSerial(	const Uid *uid,		    ///< Pointer to Uid st
 
 	// Dump sectors, highest address first.
 	if (no_of_sectors) {
-        serial_println("Sector Block   0  1  2  3   4  5  6  7   8  9 10 11  12 13 14 15  AccessBits");
+		DumpLine line = {.dev = dev};
+        dump_println(&line, "Sector Block   0  1  2  3   4  5  6  7   8  9 10 11  12 13 14 15  AccessBits");
 		for (int i = no_of_sectors - 1; i >= 0; i--) {
-			PICC_DumpMifareClassicSectorToSerial(uid, key, i);
+			PICC_DumpMifareClassicSectorToSerial_h(dev, uid, key, i);
 		}
 	}
-	PICC_HaltA(); // Halt the PICC before stopping the encrypted session.
-	PCD_StopCrypto1();
-} // End PICC_DumpMifareClassicToSerial()
+	PICC_HaltA_h(dev); // Halt the PICC before stopping the encrypted session.
+	PCD_StopCrypto1_h(dev);
+} // End PICC_DumpMifareClassicToSerial_h()
 
 /**
  * Dumps memory contents of a sector of a MIFARE Classic PICC.
- * Uses PCD_Authenticate(), MIFARE_Read() and PCD_StopCrypto1.
+ * Uses PCD_Authenticate_h(), MIFARE_Read_h() and PCD_StopCrypto1.
  * Always uses PICC_CMD_MF_AUTH_KEY_A because only Key A can always read the sector trailer access bits.
  */
-void PICC_DumpMifareClassicSectorToSerial(	const Uid *uid,			///< Pointer to Uid struct returned from a successful PICC_Select().
+void PICC_DumpMifareClassicSectorToSerial_h(MFRC522_Handle *dev, 	const Uid *uid,			///< Pointer to Uid struct returned from a successful PICC_Select().
 											const MIFARE_Key *key,	///< Key A for the sector.
 	                                        const uint8_t sector    ///< The sector to dump, 0..39.
 													) {
@@ -1653,62 +3369,47 @@ void PICC_DumpMifareClassicSectorToSerial(	const Uid *uid,			///< Pointer to Uid
 		return;
 	}
 
-	// Dump blocks, highest address first.
+	// Dump blocks, highest address first. One line per block.
     uint8_t byteCount;
     uint8_t buffer[18];
     uint8_t blockAddr;
+	DumpLine line = {.dev = dev};
 	isSectorTrailer = true;
 	for (int8_t blockOffset = no_of_blocks - 1; blockOffset >= 0; blockOffset--) {
 		blockAddr = firstBlock + blockOffset;
 		// Sector number - only on first line
 		if (isSectorTrailer) {
-			if(sector < 10)
-                serial_print("   "); // Pad with spaces
-			else
-                serial_print("  "); // Pad with spaces
-			serial_print_f(sector, DEC);
-            serial_print("   ");
+			dump_dec(&line, sector, 4);
+            dump_str(&line, "   ");
 		}
 		else {
-            serial_print("       ");
+            dump_str(&line, "       ");
 		}
         // Block number
-		if(blockAddr < 10)
-            serial_print("   "); // Pad with spaces
-		else {
-			if(blockAddr < 100)
-                serial_print("  "); // Pad with spaces
-			else
-                serial_print(" "); // Pad with spaces
-		}
-		serial_print_f(blockAddr, DEC);
-        serial_print("  ");
+		dump_dec(&line, blockAddr, 4);
+        dump_str(&line, "  ");
 		// Establish encrypted communications before reading the first block
 		if (isSectorTrailer) {
-			status = PCD_Authenticate(PICC_CMD_MF_AUTH_KEY_A, firstBlock, key, uid);
+			status = PCD_Authenticate_h(dev, PICC_CMD_MF_AUTH_KEY_A, firstBlock, key, uid);
 			if (status != STATUS_OK) {
-                serial_print("PCD_Authenticate() failed: ");
-				serial_println(GetStatusCodeName(status));
+                dump_str(&line, "PCD_Authenticate() failed: ");
+				dump_println(&line, GetStatusCodeName(status));
 				return;
 			}
 		}
 		// Read block
 		byteCount = sizeof(buffer);
-		status = MIFARE_Read(blockAddr, buffer, &byteCount);
+		status = MIFARE_Read_h(dev, blockAddr, buffer, &byteCount);
 		if (status != STATUS_OK) {
-            serial_print("MIFARE_Read() failed: ");
-			serial_println(GetStatusCodeName(status));
+            dump_str(&line, "MIFARE_Read() failed: ");
+			dump_println(&line, GetStatusCodeName(status));
 			continue;
 		}
 		// Dump data
         for (uint8_t index = 0; index < 16; index++) {
-			if(buffer[index] < 0x10)
-                serial_print(" 0");
-			else
-                serial_print(" ");
-			serial_print_f(buffer[index], HEX);
+			dump_hex_byte(&line, buffer[index]);
 			if ((index % 4) == 3) {
-                serial_print(" ");
+                dump_str(&line, " ");
 			}
 		}
 		// Parse sector trailer data
@@ -1739,64 +3440,55 @@ void PICC_DumpMifareClassicSectorToSerial(	const Uid *uid,			///< Pointer to Uid
 
 		if (firstInGroup) {
 			// Print access bits
-            serial_print(" [ ");
-            serial_print_f((g[group] >> 2) & 1, DEC); serial_print(" ");
-            serial_print_f((g[group] >> 1) & 1, DEC); serial_print(" ");
-			serial_print_f((g[group] >> 0) & 1, DEC);
-            serial_print(" ] ");
+			char *bits = dump_reserve(&line, 11);
+			memcpy(bits, " [ c c c ] ", 11);
+			bits[3] = (char)('0' + ((g[group] >> 2) & 1));
+			bits[5] = (char)('0' + ((g[group] >> 1) & 1));
+			bits[7] = (char)('0' + ((g[group] >> 0) & 1));
 			if (invertedError) {
-                serial_print(" Inverted access bits did not match! ");
+                dump_str(&line, " Inverted access bits did not match! ");
 			}
 		}
 
 		if (group != 3 && (g[group] == 1 || g[group] == 6)) { // Not a sector trailer, a value block
-			long value = ((long)((buffer[3])<<24)) | ((long)((buffer[2])<<16)) | ((long)((buffer[1])<<8)) | ((long)(buffer[0]));
-            serial_print(" Value=0x"); serial_print_f(value, HEX);
-            serial_print(" Adr=0x"); serial_print_f(buffer[12], HEX);
+			const uint32_t value = ((uint32_t)buffer[3] << 24) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[1] << 8) | buffer[0];
+            dump_str(&line, " Value=0x"); dump_hex(&line, value);
+            dump_str(&line, " Adr=0x"); dump_hex(&line, buffer[12]);
 		}
-		serial_println("");
+		dump_println(&line, "");
 	}
-} // End PICC_DumpMifareClassicSectorToSerial()
+} // End PICC_DumpMifareClassicSectorToSerial_h()
 
 /**
  * Dumps memory contents of a MIFARE Ultralight PICC.
  */
-void PICC_DumpMifareUltralightToSerial() {
+void PICC_DumpMifareUltralightToSerial_h(MFRC522_Handle *dev) {
 	uint8_t byteCount;
     uint8_t buffer[18];
+	DumpLine line = {.dev = dev};
 
-	serial_println("Page  0  1  2  3");
+	dump_println(&line, "Page  0  1  2  3");
 	// Try the mpages of the original Ultralight. Ultralight C has more pages.
     for (uint8_t page = 0; page < 16; page +=4) { // Read returns data for 4 pages at a time.
 		// Read pages
 		byteCount = sizeof(buffer);
-		const enum StatusCode status = MIFARE_Read(page, buffer, &byteCount);
+		const enum StatusCode status = MIFARE_Read_h(dev, page, buffer, &byteCount);
 		if (status != STATUS_OK) {
-            serial_print("MIFARE_Read() failed: ");
-			serial_println(GetStatusCodeName(status));
+            dump_str(&line, "MIFARE_Read() failed: ");
+			dump_println(&line, GetStatusCodeName(status));
 			break;
 		}
 		// Dump data
         for (uint8_t offset = 0; offset < 4; offset++) {
-			uint8_t i = page + offset;
-			if(i < 10)
-                serial_print("  "); // Pad with spaces
-			else
-                serial_print(" "); // Pad with spaces
-			serial_print_f(i, DEC);
-            serial_print("  ");
+			dump_dec(&line, page + offset, 3);
+            dump_str(&line, "  ");
             for (uint8_t index = 0; index < 4; index++) {
-				i = 4 * offset + index;
-				if(buffer[i] < 0x10)
-                    serial_print(" 0");
-				else
-                    serial_print(" ");
-				serial_print_f(buffer[i], HEX);
+				dump_hex_byte(&line, buffer[4 * offset + index]);
 			}
-			serial_println("");
+			dump_println(&line, "");
 		}
 	}
-} // End PICC_DumpMifareUltralightToSerial()
+} // End PICC_DumpMifareUltralightToSerial_h()
 
 /**
  * Calculates the bit pattern needed for the specified access bits. In the [C1 C2 C3] tupples C1 is MSB (=4) and C3 is LSB (=1).
@@ -1828,7 +3520,7 @@ void MIFARE_SetAccessBits(	uint8_t *accessBitBuffer,	///< Pointer to byte 6, 7 a
  *
  * Of course with non-bricked devices, you're free to select them before calling this function.
  */
-bool MIFARE_OpenUidBackdoor(const bool logErrors) {
+bool MIFARE_OpenUidBackdoor_h(MFRC522_Handle *dev, const bool logErrors) {
 	// Magic sequence:
 	// > 50 00 57 CD (HALT + CRC)
 	// > 40 (7 bits only)
@@ -1837,14 +3529,14 @@ bool MIFARE_OpenUidBackdoor(const bool logErrors) {
 	// < A (4 bits only)
 	// Then you can write to sector 0 without authenticating
 
-	PICC_HaltA(); // 50 00 57 CD
+	PICC_HaltA_h(dev); // 50 00 57 CD
 
     uint8_t cmd = 0x40;
     uint8_t validBits = 7; /* Our command is only 7 bits. After receiving card response,
 						  this will contain amount of valid response bits. */
     uint8_t response[32]; // Card's response is written here
     uint8_t received;
-    enum StatusCode status = PCD_TransceiveData(&cmd, (uint8_t)1, response, &received, &validBits, (uint8_t)0, false); // 40
+    enum StatusCode status = PCD_TransceiveData_h(dev, &cmd, (uint8_t)1, response, &received, &validBits, (uint8_t)0, false); // 40
 	if(status != STATUS_OK) {
 		if (logErrors) {
             serial_println("Card did not respond to 0x40 after HALT command. Are you sure it is a UID changeable one?");
@@ -1866,7 +3558,7 @@ bool MIFARE_OpenUidBackdoor(const bool logErrors) {
 
 	cmd = 0x43;
 	validBits = 8;
-    status = PCD_TransceiveData(&cmd, (uint8_t)1, response, &received, &validBits, (uint8_t)0, false); // 43
+    status = PCD_TransceiveData_h(dev, &cmd, (uint8_t)1, response, &received, &validBits, (uint8_t)0, false); // 43
 	if(status != STATUS_OK) {
 		if(logErrors) {
             serial_println("Error in communication at command 0x43, after successfully executing 0x40");
@@ -1888,7 +3580,7 @@ bool MIFARE_OpenUidBackdoor(const bool logErrors) {
 
 	// You can now write to sector 0 without authenticating!
 	return true;
-} // End MIFARE_OpenUidBackdoor()
+} // End MIFARE_OpenUidBackdoor_h()
 
 /**
  * note: Only for specialized cards that allow changing block 0 (these are not normal/typical cards)
@@ -1900,7 +3592,7 @@ bool MIFARE_OpenUidBackdoor(const bool logErrors) {
  * It assumes a default KEY A of 0xFFFFFFFFFFFF.
  * Make sure to have selected the card before this function is called.
  */
-bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logErrors) {
+bool MIFARE_SetUid_h(MFRC522_Handle *dev, const uint8_t *newUid, const uint8_t uidSize, const bool logErrors) {
 
 	// UID + BCC byte can not be larger than 16 together
 	if (!newUid || !uidSize || uidSize > 15) {
@@ -1913,7 +3605,7 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 	// Authenticate for reading
     const MIFARE_Key key = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
     Uid original_id = {0};
-    uint8_t status = PCD_Authenticate(PICC_CMD_MF_AUTH_KEY_A, (uint8_t)1, &key, &original_id);
+    uint8_t status = PCD_Authenticate_h(dev, PICC_CMD_MF_AUTH_KEY_A, (uint8_t)1, &key, &original_id);
 	if (status != STATUS_OK) {
 
 		if (status == STATUS_TIMEOUT) {
@@ -1922,14 +3614,14 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 			// Wake the card up again if sleeping
 //			  byte atqa_answer[2];
 //			  byte atqa_size = 2;
-//			  PICC_WakeupA(atqa_answer, &atqa_size);
+//			  PICC_WakeupA_h(atqa_answer, &atqa_size);
 
-			if (!PICC_IsNewCardPresent() || !PICC_ReadCardSerial(&original_id)) {
+			if (!PICC_IsNewCardPresent_h(dev) || !PICC_ReadCardSerial_h(dev, &original_id)) {
                 serial_println("No card prev selected & none available. set UID fail.");
 				return false;
 			}
 
-            status = PCD_Authenticate(PICC_CMD_MF_AUTH_KEY_A, (uint8_t)1, &key, &original_id);
+            status = PCD_Authenticate_h(dev, PICC_CMD_MF_AUTH_KEY_A, (uint8_t)1, &key, &original_id);
 			if (status != STATUS_OK) {
 				// We tried, time to give up
 				if (logErrors) {
@@ -1951,7 +3643,7 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 	// Read block 0
     uint8_t block0_buffer[18];
     uint8_t byteCount = sizeof(block0_buffer);
-    status = MIFARE_Read((uint8_t)0, block0_buffer, &byteCount);
+    status = MIFARE_Read_h(dev, (uint8_t)0, block0_buffer, &byteCount);
 	if (status != STATUS_OK) {
 		if (logErrors) {
             serial_print("MIFARE_Read() failed: ");
@@ -1972,10 +3664,10 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 	block0_buffer[uidSize] = bcc;
 
 	// Stop encrypted traffic so we can send raw bytes
-	PCD_StopCrypto1();
+	PCD_StopCrypto1_h(dev);
 
 	// Activate UID backdoor
-	if (!MIFARE_OpenUidBackdoor(logErrors)) {
+	if (!MIFARE_OpenUidBackdoor_h(dev, logErrors)) {
 		if (logErrors) {
             serial_println("Activating the UID backdoor failed.");
 		}
@@ -1983,7 +3675,7 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 	}
 
 	// Write modified block 0 back to card
-    status = MIFARE_Write((uint8_t)0, block0_buffer, (uint8_t)16);
+    status = MIFARE_Write_h(dev, (uint8_t)0, block0_buffer, (uint8_t)16);
 	if (status != STATUS_OK) {
 		if (logErrors) {
             serial_print("MIFARE_Write() failed: ");
@@ -1995,7 +3687,7 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 	// Wake the card up again
     uint8_t atqa_answer[2];
     uint8_t atqa_size = 2;
-	PICC_WakeupA(atqa_answer, &atqa_size);
+	PICC_WakeupA_h(dev, atqa_answer, &atqa_size);
 
 	return true;
 }
@@ -2003,13 +3695,13 @@ bool MIFARE_SetUid(const uint8_t *newUid, const uint8_t uidSize, const bool logE
 /**
  * Resets entire sector 0 to zeroes, so the card can be read again by readers.
  */
-bool MIFARE_UnbrickUidSector(const bool logErrors) {
-	MIFARE_OpenUidBackdoor(logErrors);
+bool MIFARE_UnbrickUidSector_h(MFRC522_Handle *dev, const bool logErrors) {
+	MIFARE_OpenUidBackdoor_h(dev, logErrors);
 
     uint8_t block0_buffer[] = {0x01, 0x02, 0x03, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 	// Write modified block 0 back to card
-    const enum StatusCode status = MIFARE_Write((uint8_t)0, block0_buffer, (uint8_t)16);
+    const enum StatusCode status = MIFARE_Write_h(dev, (uint8_t)0, block0_buffer, (uint8_t)16);
 	if (status != STATUS_OK) {
 		if (logErrors) {
             serial_print("MIFARE_Write() failed: ");
@@ -2024,34 +3716,513 @@ bool MIFARE_UnbrickUidSector(const bool logErrors) {
 // Convenience functions - does not add extra functionality
 /////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * The REQA or WUPA of PICC_ProbePresence_h()/PICC_ProbeWakeup_h(), from the first register write to the answer.
+ * With checkATQA a clean answer is only STATUS_OK if it was exactly 16 bits, like in PICC_REQA_or_WUPA_h(): two more
+ * reads, on an answer only.
+ */
+static enum StatusCode PICC_Probe(MFRC522_Handle *dev, const uint8_t command, const bool checkATQA) {
+	// REQA/ATQA run at 106 kbit/s without CRC_A, bits after a collision are cleared (ValuesAfterColl=0), and an empty
+	// field only costs the PCD_TIMEOUT_REQA timeout. These are all shadowed: no i2c traffic unless they changed.
+	if (PCD_SetBitRate_h(dev, PCD_BITRATE_106, PCD_BITRATE_106) != ESP_OK
+			|| PCD_SetCRCOffload(dev, false, false) != ESP_OK
+			|| PCD_WriteRegisterCached(dev, CollReg, 0x00) != ESP_OK) {		// ValuesAfterColl is the only writable bit
+		return STATUS_ERROR;
+	}
+	dev->_timeoutClass = PCD_TIMEOUT_REQA;
+	if (PCD_ApplyCommandTimeout(dev) != ESP_OK)
+		return STATUS_ERROR;
+
+	esp_err_t err = PCD_WriteRegister_h(dev, CommandReg, PCD_Idle);		// Stop the Transceive of the last probe
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, ComIrqReg, 0x7F);						// Clear all seven interrupt request bits
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, FIFOLevelReg, 0x80);					// FlushBuffer; the other bits are read-only, no read-modify-write
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, FIFODataReg, command);
+	if (err != ESP_OK) return STATUS_ERROR;
+	err = PCD_WriteRegister_h(dev, CommandReg, PCD_Transceive);
+	if (err != ESP_OK) return STATUS_ERROR;
+
+	const bool useIrq = dev->_irqPin != GPIO_NUM_NC;
+	if (useIrq) {
+		err = PCD_ArmIrq(dev, ComIrqReg, 0x20 | 0x01);						// RxIRq + TimerIRq
+		if (err != ESP_OK) return STATUS_ERROR;
+	}
+	err = PCD_WriteRegister_h(dev, BitFramingReg, 0x80 | 0x07);			// StartSend and TxLastBits=7 (short frame) in one write
+	if (err != ESP_OK) return STATUS_ERROR;
+	const int64_t sentUs = esp_timer_get_time();
+
+	// The REQA takes ~90us on the air, the timer starts after it (TAuto). With the IRQ pin, sleep until RxIRq or
+	// TimerIRq. Without it, sleep through the whole ticks of that time and poll ComIrqReg for the rest: each read is
+	// an i2c transaction the task blocks in, so the CPU is not held, and the first RxIRq or TimerIRq ends the probe.
+	const uint32_t waitUs = 90 + PCD_TimerPeriodUs(dev);
+	if (useIrq) {
+		PCD_WaitForIrq(dev, ComIrqReg);
+	}
+	else if (waitUs >= portTICK_PERIOD_MS * 1000) {
+		vTaskDelay(pdMS_TO_TICKS(waitUs / 1000));
+	}
+
+	uint8_t n;
+	while (1) {
+		err = PCD_ReadRegister_h(dev, ComIrqReg, &n);	// ComIrqReg[7..0] bits are: Set1 TxIRq RxIRq IdleIRq HiAlertIRq LoAlertIRq ErrIRq TimerIRq
+		if (err != ESP_OK) return STATUS_ERROR;
+		if (n & 0x20) {							// RxIRq: something answered
+			break;
+		}
+		if (n & 0x01) {							// TimerIRq: nobody did
+			return STATUS_TIMEOUT;
+		}
+		if (esp_timer_get_time() - sentUs > (int64_t)waitUs + IRQ_WAIT_MARGIN_MS * 1000) {	// Communication with the MFRC522 might be down.
+			return STATUS_TIMEOUT;
+		}
+	}
+	if (!(n & 0x02)) {							// No ErrIRq: a clean ATQA
+		if (!checkATQA) {
+			return STATUS_OK;
+		}
+		uint8_t level, control;
+		err = PCD_ReadRegister_h(dev, FIFOLevelReg, &level);
+		if (err != ESP_OK) return STATUS_ERROR;
+		err = PCD_ReadRegister_h(dev, ControlReg, &control);	// RxLastBits[2:0]
+		if (err != ESP_OK) return STATUS_ERROR;
+		return (level == 2 && (control & 0x07) == 0) ? STATUS_OK : STATUS_ERROR;	// ATQA must be exactly 16 bits.
+	}
+	uint8_t errorRegValue;
+	err = PCD_ReadRegister_h(dev, ErrorReg, &errorRegValue);	// ErrorReg[7..0] bits are: WrErr TempErr reserved BufferOvfl CollErr CRCErr ParityErr ProtocolErr
+	if (err != ESP_OK) return STATUS_ERROR;
+	PCD_STATS_ERROR_REG(dev, errorRegValue);
+	if (errorRegValue & 0x13) {					// BufferOvfl ParityErr ProtocolErr
+		return STATUS_ERROR;
+	}
+	return (errorRegValue & 0x08) ? STATUS_COLLISION : STATUS_OK;
+} // End PICC_Probe()
+
+/**
+ * Looks for PICCs in state IDLE with a REQA, like PICC_RequestA_h(), in as few i2c transactions as possible for
+ * polling an empty field. The settings that stay the same from probe to probe (bit rate, CRC, CollReg, timeout) are
+ * only programmed when they changed. A probe then writes CommandReg (Idle), ComIrqReg, FIFOLevelReg, FIFODataReg,
+ * CommandReg (Transceive) and BitFramingReg, and reads ComIrqReg until RxIRq or TimerIRq: 7 transactions on an empty field with the IRQ pin,
+ * instead of the ~20 of PICC_RequestA_h(). Without the pin it sleeps the whole ticks of the timer period and polls
+ * ComIrqReg for the rest, one read per i2c transaction time. ErrorReg is only read when a PICC answered with an error.
+ * The ATQA is not read: continue with PICC_Select_h() (or PICC_RequestA_h() if the ATQA matters).
+ *
+ * @return STATUS_OK if a PICC answered, STATUS_COLLISION if several did, STATUS_TIMEOUT on an empty field,
+ * 		   STATUS_??? otherwise.
+ */
+enum StatusCode PICC_ProbePresence_h(MFRC522_Handle *dev,	uint32_t *transactions		///< Out (NULL: unused): the i2c transactions the probe took
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_REQUEST);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_REQA);
+	const uint32_t start = dev->_i2cTransactions;
+	const enum StatusCode result = PICC_Probe(dev, PICC_CMD_REQA, false);
+	if (transactions) {
+		*transactions = dev->_i2cTransactions - start;
+	}
+	return result;
+} // End PICC_ProbePresence_h()
+
+/**
+ * PICC_ProbePresence_h() with a WUPA: also PICCs in state HALT answer. Costs the same i2c transactions.
+ * Continue with PICC_Select_h(), e.g. with the known UID of a PICC halted before.
+ *
+ * @return STATUS_OK if a PICC answered, STATUS_COLLISION if several did, STATUS_TIMEOUT on an empty field,
+ * 		   STATUS_??? otherwise.
+ */
+enum StatusCode PICC_ProbeWakeup_h(MFRC522_Handle *dev,	uint32_t *transactions		///< Out (NULL: unused): the i2c transactions the probe took
+									) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_REQUEST);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_REQA);
+	const uint32_t start = dev->_i2cTransactions;
+	const enum StatusCode result = PICC_Probe(dev, PICC_CMD_WUPA, false);
+	if (transactions) {
+		*transactions = dev->_i2cTransactions - start;
+	}
+	return result;
+} // End PICC_ProbeWakeup_h()
+
 /**
  * Returns true if a PICC responds to PICC_CMD_REQA.
  * Only "new" cards in state IDLE are invited. Sleeping cards in state HALT are ignored.
+ * Uses the probe of PICC_ProbePresence_h(); an answer that is not a 16 bit ATQA is rejected, like before.
  *
  * @return bool
  */
-bool PICC_IsNewCardPresent() {
-    uint8_t bufferATQA[2];
-    uint8_t bufferSize = sizeof(bufferATQA);
-    const enum StatusCode result = PICC_RequestA(bufferATQA, &bufferSize);
+bool PICC_IsNewCardPresent_h(MFRC522_Handle *dev) {
+	PCD_ACCOUNT_OP(dev, MFRC_OP_IS_NEW_CARD_PRESENT);
+	PCD_STATS_LATENCY(dev, MFRC_LATENCY_REQA);
+    const enum StatusCode result = PICC_Probe(dev, PICC_CMD_REQA, true);
 	return (result == STATUS_OK || result == STATUS_COLLISION);
-} // End PICC_IsNewCardPresent()
+} // End PICC_IsNewCardPresent_h()
 
 /**
  * Simple wrapper around PICC_Select.
  * Returns true if a UID could be read.
- * Remember to call PICC_IsNewCardPresent(), PICC_RequestA() or PICC_WakeupA() first.
+ * Remember to call PICC_IsNewCardPresent_h(), PICC_RequestA_h() or PICC_WakeupA_h() first.
  * The read UID is available in the global variable g_mfrc._uid).
  *
  * @return true if a UID was present and it was copied into uid, false if not. uid will be unchanged if not successful.
  * the UID passed in will be a COPY of the last UID scanned (if it exists), you do not need to free or de-allocate it.
  * don't use it unless the function returns true.
  */
-bool PICC_ReadCardSerial(Uid* uid)
+bool PICC_ReadCardSerial_h(MFRC522_Handle *dev, Uid* uid)
 {
     assert(uid);
     if (!uid)
         return false;
 
-    return PICC_Select(uid, 0) == STATUS_OK;
-}
\ No newline at end of file
+    return PICC_Select_h(dev, uid, 0) == STATUS_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Single-reader API: thin wrappers that run the *_h() functions on the default handle
+/////////////////////////////////////////////////////////////////////////////////////
+
+bool MFRC522_Init(i2c_master_dev_handle_t dev_handle, int resetPowerDownPin) {
+	return MFRC522_Init_h(&g_mfrc, dev_handle, resetPowerDownPin);
+}
+
+bool MFRC522_InitWithIrq(i2c_master_dev_handle_t dev_handle, int resetPowerDownPin, int irqPin) {
+	return MFRC522_InitWithIrq_h(&g_mfrc, dev_handle, resetPowerDownPin, irqPin);
+}
+
+void MFRC522_Deinit() {
+	MFRC522_Deinit_h(&g_mfrc);
+}
+
+esp_err_t PCD_WriteRegister(uint8_t reg, uint8_t value) {
+	return PCD_WriteRegister_h(&g_mfrc, reg, value);
+}
+
+esp_err_t PCD_WriteRegisterData(uint8_t reg, uint8_t count, const uint8_t* values) {
+	return PCD_WriteRegisterData_h(&g_mfrc, reg, count, values);
+}
+
+esp_err_t PCD_WriteRegisterSegments(uint8_t reg, const PCD_Segment *segments, uint8_t count) {
+	return PCD_WriteRegisterSegments_h(&g_mfrc, reg, segments, count);
+}
+
+esp_err_t PCD_ReadRegister(uint8_t reg, uint8_t* val_out) {
+	return PCD_ReadRegister_h(&g_mfrc, reg, val_out);
+}
+
+esp_err_t PCD_ReadRegisterData(uint8_t reg, uint8_t count, uint8_t *values, uint8_t rxAlign) {
+	return PCD_ReadRegisterData_h(&g_mfrc, reg, count, values, rxAlign);
+}
+
+esp_err_t PCD_SetRegisterBitMask(uint8_t reg, uint8_t mask) {
+	return PCD_SetRegisterBitMask_h(&g_mfrc, reg, mask);
+}
+
+esp_err_t PCD_ClearRegisterBitMask(uint8_t reg, uint8_t mask) {
+	return PCD_ClearRegisterBitMask_h(&g_mfrc, reg, mask);
+}
+
+esp_err_t PCD_VerifyShadowRegisters() {
+	return PCD_VerifyShadowRegisters_h(&g_mfrc);
+}
+
+enum StatusCode PCD_CalculateCRC(const uint8_t *data, uint8_t length, uint8_t *result) {
+	return PCD_CalculateCRC_h(&g_mfrc, data, length, result);
+}
+
+enum StatusCode PCD_CalculateCRCSegments(const PCD_Segment *segments, uint8_t count, uint8_t *result) {
+	return PCD_CalculateCRCSegments_h(&g_mfrc, segments, count, result);
+}
+
+void PCD_SetCRCMode(enum PCD_CRCMode mode) {
+	PCD_SetCRCMode_h(&g_mfrc, mode);
+}
+
+enum PCD_CRCMode PCD_GetCRCMode() {
+	return PCD_GetCRCMode_h(&g_mfrc);
+}
+
+esp_err_t PCD_SetBitRate(enum PCD_BitRate txRate, enum PCD_BitRate rxRate) {
+	return PCD_SetBitRate_h(&g_mfrc, txRate, rxRate);
+}
+
+void PCD_GetBitRate(enum PCD_BitRate *txRate, enum PCD_BitRate *rxRate) {
+	PCD_GetBitRate_h(&g_mfrc, txRate, rxRate);
+}
+
+void PCD_SetMaxBitRate(enum PCD_BitRate maxRate) {
+	PCD_SetMaxBitRate_h(&g_mfrc, maxRate);
+}
+
+enum PCD_BitRate PCD_GetMaxBitRate() {
+	return PCD_GetMaxBitRate_h(&g_mfrc);
+}
+
+esp_err_t PCD_SetTimeoutUs(uint32_t timeoutUs) {
+	return PCD_SetTimeoutUs_h(&g_mfrc, timeoutUs);
+}
+
+uint32_t PCD_GetTimeoutUs() {
+	return PCD_GetTimeoutUs_h(&g_mfrc);
+}
+
+void PCD_SetCommandTimeoutUs(enum PCD_TimeoutClass timeoutClass, uint32_t timeoutUs) {
+	PCD_SetCommandTimeoutUs_h(&g_mfrc, timeoutClass, timeoutUs);
+}
+
+uint32_t PCD_GetCommandTimeoutUs(enum PCD_TimeoutClass timeoutClass) {
+	return PCD_GetCommandTimeoutUs_h(&g_mfrc, timeoutClass);
+}
+
+void PCD_UseCommandTimeout(enum PCD_TimeoutClass timeoutClass) {
+	PCD_UseCommandTimeout_h(&g_mfrc, timeoutClass);
+}
+
+esp_err_t PCD_Init() {
+	return PCD_Init_h(&g_mfrc);
+}
+
+esp_err_t PCD_Reset() {
+	return PCD_Reset_h(&g_mfrc);
+}
+
+esp_err_t PCD_AntennaOn() {
+	return PCD_AntennaOn_h(&g_mfrc);
+}
+
+esp_err_t PCD_AntennaOff() {
+	return PCD_AntennaOff_h(&g_mfrc);
+}
+
+esp_err_t PCD_GetAntennaGain(uint8_t* val_out) {
+	return PCD_GetAntennaGain_h(&g_mfrc, val_out);
+}
+
+esp_err_t PCD_SetAntennaGain(uint8_t mask) {
+	return PCD_SetAntennaGain_h(&g_mfrc, mask);
+}
+
+esp_err_t PCD_SetMaxInductance() {
+	return PCD_SetMaxInductance_h(&g_mfrc);
+}
+
+bool PCD_PerformSelfTest() {
+	return PCD_PerformSelfTest_h(&g_mfrc);
+}
+
+enum StatusCode PCD_TransceiveData(const uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC) {
+	return PCD_TransceiveData_h(&g_mfrc, sendData, sendLen, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+enum StatusCode PCD_TransceiveDataSegments(const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC) {
+	return PCD_TransceiveDataSegments_h(&g_mfrc, segments, count, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+enum StatusCode PCD_CommunicateWithPICC(uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign,bool checkCRC) {
+	return PCD_CommunicateWithPICC_h(&g_mfrc, command, waitIRq, sendData, sendLen, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+enum StatusCode PCD_CommunicateWithPICCSegments(uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC) {
+	return PCD_CommunicateWithPICCSegments_h(&g_mfrc, command, waitIRq, segments, count, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+enum StatusCode PCD_TransceiveStream(const uint8_t *sendData, uint16_t sendLen, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC) {
+	return PCD_TransceiveStream_h(&g_mfrc, sendData, sendLen, backData, backLen, validBits, withCRC);
+}
+
+enum StatusCode PCD_TransceiveStreamSegments(const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC) {
+	return PCD_TransceiveStreamSegments_h(&g_mfrc, segments, count, backData, backLen, validBits, withCRC);
+}
+
+enum StatusCode PCD_TransceiveBlock(const uint8_t *txHeader, uint8_t headerLen, const uint8_t *sendData, uint16_t sendLen, uint8_t *rxHeader, uint8_t *backData, uint16_t *backLen) {
+	return PCD_TransceiveBlock_h(&g_mfrc, txHeader, headerLen, sendData, sendLen, rxHeader, backData, backLen);
+}
+
+enum StatusCode PCD_StartCommand(uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign) {
+	return PCD_StartCommand_h(&g_mfrc, command, waitIRq, sendData, sendLen, txLastBits, rxAlign);
+}
+
+enum StatusCode PCD_StartCommandSegments(uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign) {
+	return PCD_StartCommandSegments_h(&g_mfrc, command, waitIRq, segments, count, txLastBits, rxAlign);
+}
+
+enum StatusCode PCD_StartTransceive(const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign) {
+	return PCD_StartTransceive_h(&g_mfrc, sendData, sendLen, txLastBits, rxAlign);
+}
+
+enum StatusCode PCD_StartTransceiveSegments(const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign) {
+	return PCD_StartTransceiveSegments_h(&g_mfrc, segments, count, txLastBits, rxAlign);
+}
+
+enum StatusCode PCD_PollCommand() {
+	return PCD_PollCommand_h(&g_mfrc);
+}
+
+enum StatusCode PCD_FinishCommand(uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC) {
+	return PCD_FinishCommand_h(&g_mfrc, backData, backLen, validBits, rxAlign, checkCRC);
+}
+
+enum StatusCode PICC_RequestA(uint8_t *bufferATQA, uint8_t *bufferSize) {
+	return PICC_RequestA_h(&g_mfrc, bufferATQA, bufferSize);
+}
+
+enum StatusCode PICC_WakeupA(uint8_t *bufferATQA, uint8_t *bufferSize) {
+	return PICC_WakeupA_h(&g_mfrc, bufferATQA, bufferSize);
+}
+
+enum StatusCode PICC_REQA_or_WUPA(uint8_t command, uint8_t *bufferATQA, uint8_t *bufferSize) {
+	return PICC_REQA_or_WUPA_h(&g_mfrc, command, bufferATQA, bufferSize);
+}
+
+enum StatusCode PICC_Select(Uid *uid, uint8_t validBits) {
+	return PICC_Select_h(&g_mfrc, uid, validBits);
+}
+
+enum StatusCode PICC_Inventory(Uid *out, size_t max, size_t *found, bool reactivate) {
+	return PICC_Inventory_h(&g_mfrc, out, max, found, reactivate);
+}
+
+enum StatusCode PICC_Reselect(const Uid *uid) {
+	return PICC_Reselect_h(&g_mfrc, uid);
+}
+
+enum StatusCode PICC_HaltA() {
+	return PICC_HaltA_h(&g_mfrc);
+}
+
+enum StatusCode PCD_Authenticate(uint8_t command, uint8_t blockAddr, const MIFARE_Key *key, const Uid *uid) {
+	return PCD_Authenticate_h(&g_mfrc, command, blockAddr, key, uid);
+}
+
+esp_err_t PCD_StopCrypto1() {
+	return PCD_StopCrypto1_h(&g_mfrc);
+}
+
+enum StatusCode MIFARE_Read(uint8_t blockAddr, uint8_t *buffer, uint8_t *bufferSize) {
+	return MIFARE_Read_h(&g_mfrc, blockAddr, buffer, bufferSize);
+}
+
+enum StatusCode MIFARE_Write(uint8_t blockAddr, const uint8_t *buffer, uint8_t bufferSize) {
+	return MIFARE_Write_h(&g_mfrc, blockAddr, buffer, bufferSize);
+}
+
+enum StatusCode MIFARE_Decrement(uint8_t blockAddr, long delta) {
+	return MIFARE_Decrement_h(&g_mfrc, blockAddr, delta);
+}
+
+enum StatusCode MIFARE_Increment(uint8_t blockAddr, long delta) {
+	return MIFARE_Increment_h(&g_mfrc, blockAddr, delta);
+}
+
+enum StatusCode MIFARE_Restore(uint8_t blockAddr) {
+	return MIFARE_Restore_h(&g_mfrc, blockAddr);
+}
+
+enum StatusCode MIFARE_Transfer(uint8_t blockAddr) {
+	return MIFARE_Transfer_h(&g_mfrc, blockAddr);
+}
+
+enum StatusCode MIFARE_Ultralight_Write(uint8_t page, const uint8_t *buffer, uint8_t bufferSize) {
+	return MIFARE_Ultralight_Write_h(&g_mfrc, page, buffer, bufferSize);
+}
+
+enum StatusCode MIFARE_FastRead(uint8_t startPage, uint8_t endPage, uint8_t *buffer, uint8_t *bufferSize) {
+	return MIFARE_FastRead_h(&g_mfrc, startPage, endPage, buffer, bufferSize);
+}
+
+uint8_t MIFARE_FastReadMaxPages() {
+	return MIFARE_FastReadMaxPages_h(&g_mfrc);
+}
+
+enum StatusCode MIFARE_GetVersion(uint8_t *buffer, uint8_t *bufferSize) {
+	return MIFARE_GetVersion_h(&g_mfrc, buffer, bufferSize);
+}
+
+enum StatusCode MIFARE_Ultralight_GetPageCount(const Uid *uid, uint16_t *pageCount, bool *fastRead) {
+	return MIFARE_Ultralight_GetPageCount_h(&g_mfrc, uid, pageCount, fastRead);
+}
+
+enum StatusCode MIFARE_Ultralight_ReadPages(uint8_t firstPage, uint16_t pageCount, bool fastRead, uint8_t *buffer, size_t bufferSize) {
+	return MIFARE_Ultralight_ReadPages_h(&g_mfrc, firstPage, pageCount, fastRead, buffer, bufferSize);
+}
+
+enum StatusCode MIFARE_Ultralight_ReadAll(const Uid *uid, uint8_t *buffer, size_t bufferSize, uint16_t *pageCount) {
+	return MIFARE_Ultralight_ReadAll_h(&g_mfrc, uid, buffer, bufferSize, pageCount);
+}
+
+enum StatusCode MIFARE_GetValue(uint8_t blockAddr, long *value) {
+	return MIFARE_GetValue_h(&g_mfrc, blockAddr, value);
+}
+
+enum StatusCode MIFARE_SetValue(uint8_t blockAddr, long value) {
+	return MIFARE_SetValue_h(&g_mfrc, blockAddr, value);
+}
+
+enum StatusCode PCD_MIFARE_Transceive(const uint8_t *sendData, uint8_t sendLenIn, bool acceptTimeout) {
+	return PCD_MIFARE_Transceive_h(&g_mfrc, sendData, sendLenIn, acceptTimeout);
+}
+
+enum StatusCode PCD_MIFARE_TransceiveSegments(const PCD_Segment *segments, uint8_t count, bool acceptTimeout) {
+	return PCD_MIFARE_TransceiveSegments_h(&g_mfrc, segments, count, acceptTimeout);
+}
+
+enum StatusCode PCD_MIFARE_TransceiveWithCRC(const PCD_Segment *segments, uint8_t count, const uint8_t *crc, bool acceptTimeout) {
+	return PCD_MIFARE_TransceiveWithCRC_h(&g_mfrc, segments, count, crc, acceptTimeout);
+}
+
+enum StatusCode MIFARE_TwoStepHelper(uint8_t command, uint8_t blockAddr, long data) {
+	return MIFARE_TwoStepHelper_h(&g_mfrc, command, blockAddr, data);
+}
+
+void PCD_SetDumpWriter(MFRC522_DumpWriter writer, void *ctx) {
+	PCD_SetDumpWriter_h(&g_mfrc, writer, ctx);
+}
+
+void PCD_DumpVersionToSerial() {
+	PCD_DumpVersionToSerial_h(&g_mfrc);
+}
+
+esp_err_t PCD_GetVersion(uint8_t* version_out) {
+	return PCD_GetVersion_h(&g_mfrc, version_out);
+}
+
+void PICC_DumpToSerial(const Uid *uid) {
+	PICC_DumpToSerial_h(&g_mfrc, uid);
+}
+
+void PICC_DumpMifareClassicToSerial(const Uid *uid, uint8_t piccType, const MIFARE_Key *key) {
+	PICC_DumpMifareClassicToSerial_h(&g_mfrc, uid, piccType, key);
+}
+
+void PICC_DumpMifareClassicSectorToSerial(const Uid *uid, const MIFARE_Key *key, uint8_t sector) {
+	PICC_DumpMifareClassicSectorToSerial_h(&g_mfrc, uid, key, sector);
+}
+
+void PICC_DumpMifareUltralightToSerial() {
+	PICC_DumpMifareUltralightToSerial_h(&g_mfrc);
+}
+
+bool MIFARE_OpenUidBackdoor(bool logErrors) {
+	return MIFARE_OpenUidBackdoor_h(&g_mfrc, logErrors);
+}
+
+bool MIFARE_SetUid(const uint8_t *newUid, uint8_t uidSize, bool logErrors) {
+	return MIFARE_SetUid_h(&g_mfrc, newUid, uidSize, logErrors);
+}
+
+bool MIFARE_UnbrickUidSector(bool logErrors) {
+	return MIFARE_UnbrickUidSector_h(&g_mfrc, logErrors);
+}
+
+enum StatusCode PICC_ProbePresence(uint32_t *transactions) {
+	return PICC_ProbePresence_h(&g_mfrc, transactions);
+}
+
+enum StatusCode PICC_ProbeWakeup(uint32_t *transactions) {
+	return PICC_ProbeWakeup_h(&g_mfrc, transactions);
+}
+
+bool PICC_IsNewCardPresent() {
+	return PICC_IsNewCardPresent_h(&g_mfrc);
+}
+
+bool PICC_ReadCardSerial(Uid* uid) {
+	return PICC_ReadCardSerial_h(&g_mfrc, uid);
+}
@@ -81,6 +81,8 @@
 // #include <cstdint>
 #include <driver/gpio.h>
 #include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 #define MFRC_INCLUDE_SELFTEST 0
 
@@ -139,6 +141,119 @@ const uint8_t FM17522_firmware_reference[] = {
 };
 #endif // MFRC_INCLUDE_SELFTEST
 
+// Set to 1 to cross-check the shadow copy of the configuration registers against the MFRC522 on every
+// PCD_SetRegisterBitMask()/PCD_ClearRegisterBitMask(). Costs the i2c read the shadow copy normally saves.
+#ifndef MFRC_SHADOW_VERIFY
+#define MFRC_SHADOW_VERIFY 0
+#endif
+
+// Set to 1 to build the register level MFRC522 simulator (MFRC522_Sim.c) and the transport hook that lets a reader
+// talk to it instead of the i2c bus, see MFRC522_AttachSimulator_h(). For regression tests and throughput benchmarks
+// without hardware; costs nothing when 0.
+#ifndef MFRC_INCLUDE_SIMULATOR
+#define MFRC_INCLUDE_SIMULATOR 0
+#endif
+
+// Set to 1 to count the i2c transactions, bytes and registers of every high-level operation and estimate their bus
+// time (MFRC522_Accounting.h). Costs a function call per transaction while an MFRC522_Accounting is attached.
+#ifndef MFRC_INCLUDE_ACCOUNTING
+#define MFRC_INCLUDE_ACCOUNTING 0
+#endif
+
+// Set to 1 to keep latency histograms, StatusCode, ErrorReg and i2c error counters per reader (MFRC522_Stats.h).
+// Costs two esp_timer reads per timed operation while an MFRC522_Stats is attached.
+#ifndef MFRC_INCLUDE_STATS
+#define MFRC_INCLUDE_STATS 0
+#endif
+
+// Set to 1 to put the i2c errors of the register functions into a ring buffer drained by a low priority task
+// (MFRC522_Log.h) instead of printing them on the reader task. Costs a few stores per error.
+#ifndef MFRC_INCLUDE_LOG_RING
+#define MFRC_INCLUDE_LOG_RING 0
+#endif
+
+// Messages of the library above this level are compiled out, the levels are those of esp_log_level_t:
+// 0 none, 1 errors (failed i2c transactions), 2 warnings, 3 info (the serial_print*() messages, e.g. of
+// PCD_PerformSelfTest_h() and MIFARE_SetUid_h()), 4 debug, 5 verbose. The dump functions are not affected.
+#ifndef MFRC_LOG_LEVEL
+#define MFRC_LOG_LEVEL 3
+#endif
+
+// Most segments (PCD_Segment) in one scatter-gather register write or transceive call.
+#ifndef MFRC_MAX_SEGMENTS
+#define MFRC_MAX_SEGMENTS 4
+#endif
+
+// Per-reader state (MFRC522_Handle) is aligned to this so that readers driven by tasks on different cores
+// never share a cache line.
+#ifndef MFRC_CACHE_LINE_SIZE
+#define MFRC_CACHE_LINE_SIZE 64
+#endif
+
+// Where CRC_A values are calculated by default. Can be changed at runtime with PCD_SetCRCMode().
+// PCD_CRC_SOFTWARE uses the table-driven CRC_A in MFRC522_CRC.c and needs no i2c traffic at all.
+// PCD_CRC_COPROCESSOR uses the CalcCRC command of the MFRC522 (the original behaviour, ~8 i2c transactions per CRC).
+// PCD_CRC_HARDWARE lets the MFRC522 append/check CRC_A on the fly (TxCRCEn/RxCRCEn) for PICC_Select, PICC_HaltA,
+// MIFARE_Read and PCD_MIFARE_Transceive. Any other CRC_A is then calculated in software.
+#ifndef MFRC_DEFAULT_CRC_MODE
+#define MFRC_DEFAULT_CRC_MODE PCD_CRC_SOFTWARE
+#endif
+
+// FIFO level at which PCD_TransceiveStream() refills (LoAlert: this many bytes or less left to send) and drains
+// (HiAlert: this many bytes or less free) the 64 byte FIFO. The FIFO must be serviced within WaterLevel byte times
+// on the air, about 2.7ms at 106 kbit/s with the default.
+#ifndef MFRC_STREAM_WATER_LEVEL
+#define MFRC_STREAM_WATER_LEVEL 32
+#endif
+
+// Highest bit rate at which the i2c bus keeps up with PCD_TransceiveStream() for frames longer than the FIFO: about
+// one byte on the air per byte on the bus. 212 kbit/s for a 400 kHz bus, 424 for 1 MHz, 848 for 3.4 MHz.
+// Faster than that, frames have to fit the 64 byte FIFO (TCL_NegotiateBitRate() takes care of it).
+#ifndef MFRC_STREAM_MAX_BIT_RATE
+#define MFRC_STREAM_MAX_BIT_RATE PCD_BITRATE_212
+#endif
+
+// Highest bit rate PCD_SetBitRate() and TCL_NegotiateBitRate() use on a reader, PCD_SetMaxBitRate() changes it per
+// reader. Lower it for antennas that do not handle the shorter pulses of the higher rates.
+#ifndef MFRC_MAX_BIT_RATE
+#define MFRC_MAX_BIT_RATE PCD_BITRATE_848
+#endif
+
+// Most pages MIFARE_FastRead() reads in one exchange. The response (4 bytes per page + CRC_A) is streamed through
+// the FIFO, so this is not limited to the 64 byte FIFO.
+#ifndef MFRC_FAST_READ_MAX_PAGES
+#define MFRC_FAST_READ_MAX_PAGES 60
+#endif
+
+// How long the MFRC522 waits for the answer to each kind of command (PCD_TimeoutClass), in microseconds, counted
+// from the end of the transmission. A command nobody answers - REQA on an empty field, HLTA, a wrong MIFARE key -
+// always takes the whole timeout, so the values are a few times the longest answer time of the datasheets instead
+// of one 25ms for everything. PCD_SetCommandTimeoutUs() changes them per reader.
+#ifndef MFRC_TIMEOUT_DEFAULT_US
+#define MFRC_TIMEOUT_DEFAULT_US 25000		// PCD_TransceiveData() & co., the timeout of PCD_SetTimeoutUs()
+#endif
+#ifndef MFRC_TIMEOUT_REQA_US
+#define MFRC_TIMEOUT_REQA_US 1000			// ATQA after ~90us
+#endif
+#ifndef MFRC_TIMEOUT_HLTA_US
+#define MFRC_TIMEOUT_HLTA_US 1000			// no answer means success
+#endif
+#ifndef MFRC_TIMEOUT_SELECT_US
+#define MFRC_TIMEOUT_SELECT_US 1000			// anticollision and SELECT, answered after ~90us
+#endif
+#ifndef MFRC_TIMEOUT_AUTH_US
+#define MFRC_TIMEOUT_AUTH_US 5000			// MIFARE Classic authentication, ~2ms on the air
+#endif
+#ifndef MFRC_TIMEOUT_READ_US
+#define MFRC_TIMEOUT_READ_US 5000			// READ, FAST_READ, GET_VERSION
+#endif
+#ifndef MFRC_TIMEOUT_WRITE_US
+#define MFRC_TIMEOUT_WRITE_US 10000			// WRITE, value operations and TRANSFER: the ACK comes after the EEPROM write
+#endif
+#ifndef MFRC_TIMEOUT_ISO14443_4_US
+#define MFRC_TIMEOUT_ISO14443_4_US 8433		// until an ATS says otherwise: FWT of FWI 4 (4833us) + 3600us, for RATS
+#endif
+
 // MFRC522 registers. Described in chapter 9 of the datasheet.
 enum PCD_Register {
     // Page 0: Command and status
@@ -228,6 +343,36 @@ enum PCD_Command {
     PCD_SoftReset			= 0x0F		// resets the MFRC522
 };
 
+// Ways to calculate a CRC_A. See MFRC_DEFAULT_CRC_MODE.
+enum PCD_CRCMode {
+    PCD_CRC_COPROCESSOR		= 0,	// CRC coprocessor in the MFRC522 (CalcCRC command)
+    PCD_CRC_SOFTWARE		= 1,	// table-driven CRC_A on the host
+    PCD_CRC_HARDWARE		= 2		// appended/checked by the MFRC522 during transceive (TxModeReg/RxModeReg CRCEn bits)
+};
+
+// Bit rates of the ISO/IEC 14443A link, the TxSpeed/RxSpeed values of TxModeReg/RxModeReg.
+// Everything of ISO/IEC 14443-3 (REQA, anticollision, MIFARE) runs at 106 kbit/s, the higher rates are for
+// ISO/IEC 14443-4 PICCs after PPS (TCL_NegotiateBitRate()).
+enum PCD_BitRate {
+    PCD_BITRATE_106			= 0,
+    PCD_BITRATE_212			= 1,
+    PCD_BITRATE_424			= 2,
+    PCD_BITRATE_848			= 3
+};
+
+// Kinds of commands with their own timeout, see MFRC_TIMEOUT_DEFAULT_US and PCD_SetCommandTimeoutUs().
+enum PCD_TimeoutClass {
+    PCD_TIMEOUT_DEFAULT		= 0,	// everything not listed below
+    PCD_TIMEOUT_REQA		= 1,	// REQA and WUPA
+    PCD_TIMEOUT_HLTA		= 2,
+    PCD_TIMEOUT_SELECT		= 3,	// anticollision and SELECT
+    PCD_TIMEOUT_AUTH		= 4,	// MIFARE Classic authentication
+    PCD_TIMEOUT_READ		= 5,
+    PCD_TIMEOUT_WRITE		= 6,
+    PCD_TIMEOUT_ISO14443_4	= 7,	// RATS, PPS and the blocks of PCD_TransceiveBlock(). TCL_Activate() sets the FWT of the ATS.
+    PCD_TIMEOUT_CLASSES		= 8
+};
+
 // MFRC522 RxGain[2:0] masks, defines the receiver's signal voltage gain factor (on the PCD).
 // Described in 9.3.3.6 / table 98 of the datasheet at http://www.nxp.com/documents/data_sheet/MFRC522.pdf
 enum PCD_RxGain {
@@ -267,7 +412,10 @@ enum PICC_Command {
     PICC_CMD_MF_TRANSFER	= 0xB0,		// Writes the contents of the internal data register to a block.
     // The commands used for MIFARE Ultralight (from http://www.nxp.com/documents/data_sheet/MF0ICU1.pdf, Section 8.6)
     // The PICC_CMD_MF_READ and PICC_CMD_MF_WRITE can also be used for MIFARE Ultralight.
-    PICC_CMD_UL_WRITE		= 0xA2		// Writes one 4 byte page to the PICC.
+    PICC_CMD_UL_WRITE		= 0xA2,		// Writes one 4 byte page to the PICC.
+    // NTAG21x and MIFARE Ultralight EV1 (from https://www.nxp.com/docs/en/data-sheet/NTAG213_215_216.pdf, Section 10)
+    PICC_CMD_UL_GET_VERSION	= 0x60,		// Returns product type and memory size. Same code as PICC_CMD_MF_AUTH_KEY_A.
+    PICC_CMD_UL_FAST_READ	= 0x3A		// Reads the pages from a start to an end address in one frame.
 };
 
 // MIFARE constants that does not fit anywhere else
@@ -300,7 +448,8 @@ enum StatusCode {
     STATUS_INTERNAL_ERROR	= 6,	// Internal error in the code. Should not happen ;-)
     STATUS_INVALID			= 7,	// Invalid argument.
     STATUS_CRC_WRONG		= 8,	// The CRC_A does not match
-    STATUS_MIFARE_NACK		= 9		// A MIFARE PICC responded with NAK.
+    STATUS_MIFARE_NACK		= 9,	// A MIFARE PICC responded with NAK.
+    STATUS_PENDING			= 10	// The command is still running (split-phase functions only, see PCD_StartTransceive()).
 };
 
 // A struct used for passing the UID of a PICC.
@@ -315,6 +464,109 @@ typedef struct {
     uint8_t		keyByte[MF_KEY_SIZE];
 } MIFARE_Key;
 
+// A piece of a register write or a frame. The pieces of a list are sent back to back without being copied together:
+// a header in one buffer, the data in another, the CRC_A in a third. See PCD_WriteRegisterSegments_h(). Before
+// ESP-IDF 5.4 the i2c driver takes one buffer only, so the pieces of a register write are gathered into 64 bytes.
+typedef struct {
+    const uint8_t	*data;
+    uint16_t	length;
+} PCD_Segment;
+
+// CRC_OFFLOAD_xxx bits of MFRC522_Handle._crcOffload
+#define CRC_OFFLOAD_TX	0x01
+#define CRC_OFFLOAD_RX	0x02
+
+// Receives the text of the dump functions, see PCD_SetDumpWriter_h(). One line per call, "\n" included,
+// not NUL terminated.
+typedef void (*MFRC522_DumpWriter)(void *ctx, const char *text, size_t length);
+
+struct MFRC522_Sim;			// MFRC522_Sim.h
+struct MFRC522_Accounting;	// MFRC522_Accounting.h
+struct MFRC522_Stats;		// MFRC522_Stats.h
+
+// State of one MFRC522 reader. Allocate one per reader (static or heap, contents don't matter), set it up with
+// MFRC522_Init_h() and pass it to the *_h() functions. The fields are private to the library.
+// The functions without a handle argument all work on one built-in reader, see MFRC522_DefaultHandle().
+typedef struct __attribute__((aligned(MFRC_CACHE_LINE_SIZE))) MFRC522_Handle {
+    // if not GPIO_NUM_NC, we'll pulse this GPIO pin# connected to MFRC522's reset and power down input (Pin 6, NRSTPD, active low)
+    int _resetPowerDownPin;
+
+    // set to true to enable more debug logging
+    bool _logDebugInfo;
+
+    // set to true if this device has been initialized
+    bool _initialized;
+
+    // when performing i2c operations, how long should we block and wait before timing out? [0 = don't block]
+    int _i2cIoTimeoutMs;
+
+    // registered i2c device to send commands to (uses the new ESP-IDF >= 5.0 i2c API)
+    i2c_master_dev_handle_t _dev_handle;
+
+    // where CRC_A values get calculated. see PCD_SetCRCMode_h()
+    enum PCD_CRCMode _crcMode;
+
+    // TxCRCEn/RxCRCEn state currently programmed into TxModeReg/RxModeReg (CRC_OFFLOAD_TX | CRC_OFFLOAD_RX)
+    uint8_t _crcOffload;
+
+    // TxSpeed/RxSpeed currently programmed, and the highest rate allowed on this reader. see PCD_SetBitRate_h()
+    enum PCD_BitRate _txBitRate;
+    enum PCD_BitRate _rxBitRate;
+    enum PCD_BitRate _maxBitRate;
+
+    // timeout per PCD_TimeoutClass in microseconds, and the class the next command runs with (then back to
+    // PCD_TIMEOUT_DEFAULT). see PCD_SetCommandTimeoutUs_h() and PCD_UseCommandTimeout_h()
+    uint32_t _timeoutUs[PCD_TIMEOUT_CLASSES];
+    uint8_t _timeoutClass;
+
+    // host-side copy of the registers only we write to (see shadow_owned_bits). bit n of _shadowValid => _shadow[n] is known.
+    // lets PCD_SetRegisterBitMask_h()/PCD_ClearRegisterBitMask_h() skip the i2c read. cleared by PCD_Reset_h()/PCD_Init_h().
+    uint8_t _shadow[0x40];
+    uint64_t _shadowValid;
+
+    // i2c transactions (register reads and writes) since MFRC522_Init_h(), failed ones included
+    uint32_t _i2cTransactions;
+
+#if MFRC_INCLUDE_SIMULATOR == 1
+    // if not NULL, the register reads and writes go to this simulator instead of _dev_handle, and its virtual
+    // clock follows esp_timer_get_time() - _simEpochUs. see MFRC522_AttachSimulator_h()
+    struct MFRC522_Sim *_sim;
+    int64_t _simEpochUs;
+#endif
+
+#if MFRC_INCLUDE_ACCOUNTING == 1
+    // if not NULL, where the i2c transactions are counted, and the operation (MFRC522_Op) they are counted against.
+    // see MFRC522_Accounting_Attach()
+    struct MFRC522_Accounting *_accounting;
+    uint8_t _accountOp;
+#endif
+
+#if MFRC_INCLUDE_STATS == 1
+    // if not NULL, where latencies and error counters are recorded. see MFRC522_Stats_Attach()
+    struct MFRC522_Stats *_stats;
+#endif
+
+    // where PCD_DumpVersionToSerial_h() and PICC_Dump*ToSerial_h() write their lines to, NULL: stdout.
+    // see PCD_SetDumpWriter_h()
+    MFRC522_DumpWriter _dumpWriter;
+    void *_dumpWriterCtx;
+
+    // if not GPIO_NUM_NC, GPIO connected to the MFRC522 IRQ output. see MFRC522_InitWithIrq_h()
+    int _irqPin;
+
+    // task blocked in PCD_WaitForIrq(), notified from PCD_IrqHandler(). NULL when nobody is waiting.
+    TaskHandle_t volatile _irqWaiter;
+
+    // interrupt request bits left set by the last command. while set, the IRQ line stays asserted and
+    // would swallow the edge of the next command, so they are cleared before waiting on the other register.
+    bool _comIrqPending;
+    bool _divIrqPending;
+
+    // command started by PCD_StartTransceive_h(): the ComIrqReg bits that complete it, and when it was started (esp_timer time)
+    uint8_t _cmdWaitIRq;
+    int64_t _cmdStartUs;
+} MFRC522_Handle;
+
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for setting up the MFRC
 /////////////////////////////////////////////////////////////////////////////////////
@@ -324,16 +576,58 @@ typedef struct {
 // resetPowerDownPin: if -1, ignored. otherwise, the number of a GPIO pin to hold to powerup/reset the MFRC chip
 bool MFRC522_Init(i2c_master_dev_handle_t dev_handle, int resetPowerDownPin);
 
+// same as MFRC522_Init(), plus:
+// irqPin: if -1, ignored (completion is polled over i2c). otherwise, the GPIO connected to the MFRC522 IRQ output (pin 23).
+//         the calling task then sleeps on a task notification from a GPIO ISR while a command is running on the chip,
+//         which leaves the i2c bus free for other devices. needs the GPIO ISR service (installed if not already).
+bool MFRC522_InitWithIrq(i2c_master_dev_handle_t dev_handle, int resetPowerDownPin, int irqPin);
+
+// removes the IRQ pin handler of MFRC522_InitWithIrq(). call it before the reader or its pin is used otherwise.
+void MFRC522_Deinit();
+
 /////////////////////////////////////////////////////////////////////////////////////
 // Basic interface functions for communicating with the MFRC522
 /////////////////////////////////////////////////////////////////////////////////////
 esp_err_t PCD_WriteRegister(uint8_t reg, uint8_t value);
 esp_err_t PCD_WriteRegisterData(uint8_t reg, uint8_t count, const uint8_t* values);
+// one i2c transaction with the bytes of count segments (at most MFRC_MAX_SEGMENTS), which are not copied together
+esp_err_t PCD_WriteRegisterSegments(uint8_t reg, const PCD_Segment *segments, uint8_t count);
 esp_err_t PCD_ReadRegister(uint8_t reg, uint8_t* val_out);
 esp_err_t PCD_ReadRegisterData(uint8_t reg, uint8_t count, uint8_t *values, uint8_t rxAlign); // default rxAlign=0
 esp_err_t PCD_SetRegisterBitMask(uint8_t reg, uint8_t mask);
 esp_err_t PCD_ClearRegisterBitMask(uint8_t reg, uint8_t mask);
+esp_err_t PCD_VerifyShadowRegisters();
 enum StatusCode PCD_CalculateCRC(const uint8_t *data, uint8_t length, uint8_t *result);
+enum StatusCode PCD_CalculateCRCSegments(const PCD_Segment *segments, uint8_t count, uint8_t *result);
+void PCD_SetCRCMode(enum PCD_CRCMode mode);
+enum PCD_CRCMode PCD_GetCRCMode();
+// how long the MFRC522 waits for a PICC answer to commands of PCD_TIMEOUT_DEFAULT. MFRC_TIMEOUT_DEFAULT_US (25ms).
+esp_err_t PCD_SetTimeoutUs(uint32_t timeoutUs);
+uint32_t PCD_GetTimeoutUs();
+// the timeout of a kind of command, see MFRC_TIMEOUT_DEFAULT_US. the timer registers are only written when the
+// timeout of a command differs from the one before.
+void PCD_SetCommandTimeoutUs(enum PCD_TimeoutClass timeoutClass, uint32_t timeoutUs);
+uint32_t PCD_GetCommandTimeoutUs(enum PCD_TimeoutClass timeoutClass);
+// the next command started (PCD_TransceiveData(), PCD_CommunicateWithPICC(), PCD_StartTransceive(), ...) waits as
+// long as timeoutClass says, the commands after it PCD_TIMEOUT_DEFAULT again. for own commands to PICCs.
+void PCD_UseCommandTimeout(enum PCD_TimeoutClass timeoutClass);
+// bit rates PCD->PICC (tx) and PICC->PCD (rx), capped at PCD_SetMaxBitRate(). PCD_Init(), REQA/WUPA and HLTA go back
+// to 106 kbit/s. above 106 kbit/s the MFRC522 appends and checks CRC_A itself (only PCD_TransceiveStream() and
+// PCD_TransceiveBlock() frames are valid then, whatever PCD_SetCRCMode() says).
+esp_err_t PCD_SetBitRate(enum PCD_BitRate txRate, enum PCD_BitRate rxRate);
+void PCD_GetBitRate(enum PCD_BitRate *txRate, enum PCD_BitRate *rxRate);
+void PCD_SetMaxBitRate(enum PCD_BitRate maxRate);
+enum PCD_BitRate PCD_GetMaxBitRate();
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Host-side CRC_A (MFRC522_CRC.c)
+/////////////////////////////////////////////////////////////////////////////////////
+#define CRC_A_PRESET 0x6363
+extern const uint8_t CRC_A_HLTA_FRAME[4];		// precomputed HLTA frame: 50 00 57 CD
+uint16_t CRC_A_Update(uint16_t crc, const uint8_t *data, size_t length);
+void CRC_A_Calculate(const uint8_t *data, size_t length, uint8_t *result);
+bool CRC_A_Check(const uint8_t *data, size_t length);
+void CRC_A_BuildReadFrame(uint8_t blockAddr, uint8_t *frame);
 
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for manipulating the MFRC522
@@ -365,11 +659,47 @@ enum StatusCode PCD_TransceiveData(const uint8_t *sendData, uint8_t sendLen, uin
 //const bool checkCRC = false;
 enum StatusCode PCD_CommunicateWithPICC(uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign,bool checkCRC);
 
+// the same with the frame as a list of segments (PCD_Segment, e.g. header, data and CRC_A in their own buffers), which
+// go to the FIFO in one i2c transaction without being copied together. at most MFRC_MAX_SEGMENTS, and one less for
+// the functions that add the CRC_A (PCD_TransceiveStreamSegments(), PCD_MIFARE_TransceiveSegments()).
+enum StatusCode PCD_TransceiveDataSegments(const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+enum StatusCode PCD_CommunicateWithPICCSegments(uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+
+// transceive of frames of any size: the FIFO is refilled while sending and drained while receiving (see
+// MFRC_STREAM_WATER_LEVEL). withCRC => CRC_A is appended to sendData and checked and not counted in *backLen
+// (backData still needs room for it). validBits may be NULL.
+enum StatusCode PCD_TransceiveStream(const uint8_t *sendData, uint16_t sendLen, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC);
+enum StatusCode PCD_TransceiveStreamSegments(const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC);
+// the same with CRC_A for block protocols (MFRC522_TCL.h): txHeader is sent in front of sendData and the first
+// headerLen bytes of the response go to rxHeader, the rest to backData (which needs 2 bytes room for CRC_A).
+enum StatusCode PCD_TransceiveBlock(const uint8_t *txHeader, uint8_t headerLen, const uint8_t *sendData, uint16_t sendLen, uint8_t *rxHeader, uint8_t *backData, uint16_t *backLen);
+
+// split-phase transceive: start the command, then poll (one i2c read per call, never blocks on the PICC)
+// until the result is not STATUS_PENDING, then collect the response. same rxAlign for start and finish.
+// PCD_CommunicateWithPICC() is the blocking combination of the three.
+// PCD_StartCommand() starts any command (e.g. PCD_MFAuthent) and leaves the TxCRCEn/RxCRCEn settings alone.
+enum StatusCode PCD_StartCommand(uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartTransceive(const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartCommandSegments(uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartTransceiveSegments(const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_PollCommand();
+enum StatusCode PCD_FinishCommand(uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+
 enum StatusCode  PICC_RequestA(uint8_t *bufferATQA, uint8_t *bufferSize);
 enum StatusCode  PICC_WakeupA(uint8_t *bufferATQA, uint8_t *bufferSize);
 enum StatusCode  PICC_REQA_or_WUPA(uint8_t command, uint8_t *bufferATQA, uint8_t *bufferSize);
+// REQA in the fewest i2c transactions (7 on an empty field with the IRQ pin), for polling: STATUS_OK or STATUS_COLLISION if a PICC
+// answered (the ATQA is not read), STATUS_TIMEOUT if none did. transactions (NULL: unused) gets the i2c
+// transactions the probe took. PICC_IsNewCardPresent() uses it and also checks that the ATQA is 16 bits.
+enum StatusCode  PICC_ProbePresence(uint32_t *transactions);
+// PICC_ProbePresence() with a WUPA, which PICCs in state HALT answer too.
+enum StatusCode  PICC_ProbeWakeup(uint32_t *transactions);
 enum StatusCode  PICC_Select(Uid *uid, uint8_t validBits); // defaults: validbits=0
 enum StatusCode  PICC_HaltA();
+// selects and halts every PICC in the field, see PICC_Inventory_h(). defaults: reactivate=false
+enum StatusCode  PICC_Inventory(Uid *out, size_t max, size_t *found, bool reactivate);
+// WUPA + SELECT of a PICC whose UID is known, e.g. after a failed authentication
+enum StatusCode  PICC_Reselect(const Uid *uid);
 
 /////////////////////////////////////////////////////////////////////////////////////
 // Functions for communicating with MIFARE PICCs
@@ -383,6 +713,14 @@ enum StatusCode MIFARE_Increment(uint8_t blockAddr, long delta);
 enum StatusCode MIFARE_Restore(uint8_t blockAddr);
 enum StatusCode MIFARE_Transfer(uint8_t blockAddr);
 enum StatusCode MIFARE_Ultralight_Write(uint8_t page, const uint8_t *buffer, uint8_t bufferSize);
+// NTAG21x / MIFARE Ultralight EV1
+enum StatusCode MIFARE_FastRead(uint8_t startPage, uint8_t endPage, uint8_t *buffer, uint8_t *bufferSize);
+uint8_t MIFARE_FastReadMaxPages();
+enum StatusCode MIFARE_GetVersion(uint8_t *buffer, uint8_t *bufferSize);
+// bulk reading: page count via GET_VERSION (16 pages, READ only, for the original Ultralight), then one FAST_READ per MFRC_FAST_READ_MAX_PAGES
+enum StatusCode MIFARE_Ultralight_GetPageCount(const Uid *uid, uint16_t *pageCount, bool *fastRead);
+enum StatusCode MIFARE_Ultralight_ReadPages(uint8_t firstPage, uint16_t pageCount, bool fastRead, uint8_t *buffer, size_t bufferSize);
+enum StatusCode MIFARE_Ultralight_ReadAll(const Uid *uid, uint8_t *buffer, size_t bufferSize, uint16_t *pageCount);
 enum StatusCode MIFARE_GetValue(uint8_t blockAddr, long *value);
 enum StatusCode MIFARE_SetValue(uint8_t blockAddr, long value);
 
@@ -390,6 +728,10 @@ enum StatusCode MIFARE_SetValue(uint8_t blockAddr, long value);
 // Support functions
 /////////////////////////////////////////////////////////////////////////////////////
 enum StatusCode PCD_MIFARE_Transceive(const uint8_t *sendData, uint8_t sendLenIn, bool acceptTimeout); // acceptTimeout default=false
+enum StatusCode PCD_MIFARE_TransceiveSegments(const PCD_Segment *segments, uint8_t count, bool acceptTimeout);
+// PCD_MIFARE_TransceiveSegments() with the CRC_A of the segments computed ahead (CRC_A_Calculate()), NULL: calculated.
+// not used with PCD_CRC_HARDWARE, the MFRC522 appends it.
+enum StatusCode PCD_MIFARE_TransceiveWithCRC(const PCD_Segment *segments, uint8_t count, const uint8_t *crc, bool acceptTimeout);
 // old function used too much memory, now name moved to flash; if you need char, copy from flash to memory
 //const char *GetStatusCodeName(byte code);
 const char *GetStatusCodeName(uint8_t code);
@@ -399,8 +741,9 @@ enum PICC_Type PICC_GetType(uint8_t sak);
 const char *PICC_GetTypeName(uint8_t type);
 
 // Support functions for debugging
+void PCD_SetDumpWriter(MFRC522_DumpWriter writer, void *ctx);
 void PCD_DumpVersionToSerial();
-esp_err_t PCD_GetVersion();
+esp_err_t PCD_GetVersion(uint8_t* version_out);
 void PICC_DumpToSerial(const Uid *uid);
 void PICC_DumpMifareClassicToSerial(const Uid *uid, uint8_t piccType, const MIFARE_Key *key);
 void PICC_DumpMifareClassicSectorToSerial(const Uid *uid, const MIFARE_Key *key, uint8_t sector);
@@ -418,4 +761,117 @@ bool PICC_ReadCardSerial(Uid* uid);
 
 enum StatusCode MIFARE_TwoStepHelper(uint8_t command, uint8_t blockAddr, long data);
 
+/////////////////////////////////////////////////////////////////////////////////////
+// Explicit reader handle API - same functions as above, for any number of readers
+// Each reader needs its own MFRC522_Handle. Calls on different handles are independent; calls on the
+// same handle must not run concurrently.
+/////////////////////////////////////////////////////////////////////////////////////
+MFRC522_Handle *MFRC522_DefaultHandle();		// the reader used by the functions above
+
+// Setting up a reader
+bool MFRC522_Init_h(MFRC522_Handle *dev, i2c_master_dev_handle_t dev_handle, int resetPowerDownPin);
+bool MFRC522_InitWithIrq_h(MFRC522_Handle *dev, i2c_master_dev_handle_t dev_handle, int resetPowerDownPin, int irqPin);
+void MFRC522_Deinit_h(MFRC522_Handle *dev);
+#if MFRC_INCLUDE_SIMULATOR == 1
+// routes the register traffic of dev to sim (MFRC522_Sim_Init() done) instead of the i2c bus. call it after
+// MFRC522_Init_h() (dev_handle NULL, resetPowerDownPin -1), before PCD_Init_h(). NULL goes back to the bus.
+void MFRC522_AttachSimulator_h(MFRC522_Handle *dev, struct MFRC522_Sim *sim);
+#endif
+
+// Basic interface functions
+esp_err_t PCD_WriteRegister_h(MFRC522_Handle *dev, uint8_t reg, uint8_t value);
+esp_err_t PCD_WriteRegisterData_h(MFRC522_Handle *dev, uint8_t reg, uint8_t count, const uint8_t* values);
+esp_err_t PCD_WriteRegisterSegments_h(MFRC522_Handle *dev, uint8_t reg, const PCD_Segment *segments, uint8_t count);
+esp_err_t PCD_ReadRegister_h(MFRC522_Handle *dev, uint8_t reg, uint8_t* val_out);
+esp_err_t PCD_ReadRegisterData_h(MFRC522_Handle *dev, uint8_t reg, uint8_t count, uint8_t *values, uint8_t rxAlign);
+esp_err_t PCD_SetRegisterBitMask_h(MFRC522_Handle *dev, uint8_t reg, uint8_t mask);
+esp_err_t PCD_ClearRegisterBitMask_h(MFRC522_Handle *dev, uint8_t reg, uint8_t mask);
+esp_err_t PCD_VerifyShadowRegisters_h(MFRC522_Handle *dev);
+enum StatusCode PCD_CalculateCRC_h(MFRC522_Handle *dev, const uint8_t *data, uint8_t length, uint8_t *result);
+enum StatusCode PCD_CalculateCRCSegments_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, uint8_t *result);
+void PCD_SetCRCMode_h(MFRC522_Handle *dev, enum PCD_CRCMode mode);
+enum PCD_CRCMode PCD_GetCRCMode_h(MFRC522_Handle *dev);
+esp_err_t PCD_SetTimeoutUs_h(MFRC522_Handle *dev, uint32_t timeoutUs);
+uint32_t PCD_GetTimeoutUs_h(MFRC522_Handle *dev);
+void PCD_SetCommandTimeoutUs_h(MFRC522_Handle *dev, enum PCD_TimeoutClass timeoutClass, uint32_t timeoutUs);
+uint32_t PCD_GetCommandTimeoutUs_h(MFRC522_Handle *dev, enum PCD_TimeoutClass timeoutClass);
+void PCD_UseCommandTimeout_h(MFRC522_Handle *dev, enum PCD_TimeoutClass timeoutClass);
+esp_err_t PCD_SetBitRate_h(MFRC522_Handle *dev, enum PCD_BitRate txRate, enum PCD_BitRate rxRate);
+void PCD_GetBitRate_h(MFRC522_Handle *dev, enum PCD_BitRate *txRate, enum PCD_BitRate *rxRate);
+void PCD_SetMaxBitRate_h(MFRC522_Handle *dev, enum PCD_BitRate maxRate);
+enum PCD_BitRate PCD_GetMaxBitRate_h(MFRC522_Handle *dev);
+
+// Manipulating the MFRC522
+esp_err_t PCD_Init_h(MFRC522_Handle *dev);
+esp_err_t PCD_Reset_h(MFRC522_Handle *dev);
+esp_err_t PCD_AntennaOn_h(MFRC522_Handle *dev);
+esp_err_t PCD_AntennaOff_h(MFRC522_Handle *dev);
+esp_err_t PCD_GetAntennaGain_h(MFRC522_Handle *dev, uint8_t* val_out);
+esp_err_t PCD_SetAntennaGain_h(MFRC522_Handle *dev, uint8_t mask);
+esp_err_t PCD_SetMaxInductance_h(MFRC522_Handle *dev);
+bool PCD_PerformSelfTest_h(MFRC522_Handle *dev);
+
+// Communicating with PICCs
+enum StatusCode PCD_TransceiveData_h(MFRC522_Handle *dev, const uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+enum StatusCode PCD_CommunicateWithPICC_h(MFRC522_Handle *dev, uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign,bool checkCRC);
+enum StatusCode PCD_TransceiveDataSegments_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+enum StatusCode PCD_CommunicateWithPICCSegments_h(MFRC522_Handle *dev, uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+enum StatusCode PCD_TransceiveStream_h(MFRC522_Handle *dev, const uint8_t *sendData, uint16_t sendLen, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC);
+enum StatusCode PCD_TransceiveStreamSegments_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, uint8_t *backData, uint16_t *backLen, uint8_t *validBits, bool withCRC);
+enum StatusCode PCD_TransceiveBlock_h(MFRC522_Handle *dev, const uint8_t *txHeader, uint8_t headerLen, const uint8_t *sendData, uint16_t sendLen, uint8_t *rxHeader, uint8_t *backData, uint16_t *backLen);
+enum StatusCode PCD_StartCommand_h(MFRC522_Handle *dev, uint8_t command, uint8_t waitIRq, const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartTransceive_h(MFRC522_Handle *dev, const uint8_t *sendData, uint8_t sendLen, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartCommandSegments_h(MFRC522_Handle *dev, uint8_t command, uint8_t waitIRq, const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_StartTransceiveSegments_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, uint8_t txLastBits, uint8_t rxAlign);
+enum StatusCode PCD_PollCommand_h(MFRC522_Handle *dev);
+enum StatusCode PCD_FinishCommand_h(MFRC522_Handle *dev, uint8_t *backData, uint8_t *backLen, uint8_t *validBits, uint8_t rxAlign, bool checkCRC);
+enum StatusCode PICC_RequestA_h(MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize);
+enum StatusCode PICC_WakeupA_h(MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize);
+enum StatusCode PICC_REQA_or_WUPA_h(MFRC522_Handle *dev, uint8_t command, uint8_t *bufferATQA, uint8_t *bufferSize);
+enum StatusCode PICC_ProbePresence_h(MFRC522_Handle *dev, uint32_t *transactions);
+enum StatusCode PICC_ProbeWakeup_h(MFRC522_Handle *dev, uint32_t *transactions);
+enum StatusCode PICC_Select_h(MFRC522_Handle *dev, Uid *uid, uint8_t validBits);
+enum StatusCode PICC_HaltA_h(MFRC522_Handle *dev);
+enum StatusCode PICC_Inventory_h(MFRC522_Handle *dev, Uid *out, size_t max, size_t *found, bool reactivate);
+enum StatusCode PICC_Reselect_h(MFRC522_Handle *dev, const Uid *uid);
+
+// Communicating with MIFARE PICCs
+enum StatusCode PCD_Authenticate_h(MFRC522_Handle *dev, uint8_t command, uint8_t blockAddr, const MIFARE_Key *key, const Uid *uid);
+esp_err_t PCD_StopCrypto1_h(MFRC522_Handle *dev);
+enum StatusCode MIFARE_Read_h(MFRC522_Handle *dev, uint8_t blockAddr, uint8_t *buffer, uint8_t *bufferSize);
+enum StatusCode MIFARE_Write_h(MFRC522_Handle *dev, uint8_t blockAddr, const uint8_t *buffer, uint8_t bufferSize);
+enum StatusCode MIFARE_Decrement_h(MFRC522_Handle *dev, uint8_t blockAddr, long delta);
+enum StatusCode MIFARE_Increment_h(MFRC522_Handle *dev, uint8_t blockAddr, long delta);
+enum StatusCode MIFARE_Restore_h(MFRC522_Handle *dev, uint8_t blockAddr);
+enum StatusCode MIFARE_Transfer_h(MFRC522_Handle *dev, uint8_t blockAddr);
+enum StatusCode MIFARE_Ultralight_Write_h(MFRC522_Handle *dev, uint8_t page, const uint8_t *buffer, uint8_t bufferSize);
+enum StatusCode MIFARE_FastRead_h(MFRC522_Handle *dev, uint8_t startPage, uint8_t endPage, uint8_t *buffer, uint8_t *bufferSize);
+uint8_t MIFARE_FastReadMaxPages_h(MFRC522_Handle *dev);
+enum StatusCode MIFARE_GetVersion_h(MFRC522_Handle *dev, uint8_t *buffer, uint8_t *bufferSize);
+enum StatusCode MIFARE_Ultralight_GetPageCount_h(MFRC522_Handle *dev, const Uid *uid, uint16_t *pageCount, bool *fastRead);
+enum StatusCode MIFARE_Ultralight_ReadPages_h(MFRC522_Handle *dev, uint8_t firstPage, uint16_t pageCount, bool fastRead, uint8_t *buffer, size_t bufferSize);
+enum StatusCode MIFARE_Ultralight_ReadAll_h(MFRC522_Handle *dev, const Uid *uid, uint8_t *buffer, size_t bufferSize, uint16_t *pageCount);
+enum StatusCode MIFARE_GetValue_h(MFRC522_Handle *dev, uint8_t blockAddr, long *value);
+enum StatusCode MIFARE_SetValue_h(MFRC522_Handle *dev, uint8_t blockAddr, long value);
+enum StatusCode PCD_MIFARE_Transceive_h(MFRC522_Handle *dev, const uint8_t *sendData, uint8_t sendLenIn, bool acceptTimeout);
+enum StatusCode PCD_MIFARE_TransceiveSegments_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, bool acceptTimeout);
+enum StatusCode PCD_MIFARE_TransceiveWithCRC_h(MFRC522_Handle *dev, const PCD_Segment *segments, uint8_t count, const uint8_t *crc, bool acceptTimeout);
+enum StatusCode MIFARE_TwoStepHelper_h(MFRC522_Handle *dev, uint8_t command, uint8_t blockAddr, long data);
+
+// Support and debugging
+void PCD_SetDumpWriter_h(MFRC522_Handle *dev, MFRC522_DumpWriter writer, void *ctx);
+void PCD_DumpVersionToSerial_h(MFRC522_Handle *dev);
+esp_err_t PCD_GetVersion_h(MFRC522_Handle *dev, uint8_t* version_out);
+void PICC_DumpToSerial_h(MFRC522_Handle *dev, const Uid *uid);
+void PICC_DumpMifareClassicToSerial_h(MFRC522_Handle *dev, const Uid *uid, uint8_t piccType, const MIFARE_Key *key);
+void PICC_DumpMifareClassicSectorToSerial_h(MFRC522_Handle *dev, const Uid *uid, const MIFARE_Key *key, uint8_t sector);
+void PICC_DumpMifareUltralightToSerial_h(MFRC522_Handle *dev);
+bool MIFARE_OpenUidBackdoor_h(MFRC522_Handle *dev, bool logErrors);
+bool MIFARE_SetUid_h(MFRC522_Handle *dev, const uint8_t *newUid, uint8_t uidSize, bool logErrors);
+bool MIFARE_UnbrickUidSector_h(MFRC522_Handle *dev, bool logErrors);
+
+// Convenience functions
+bool PICC_IsNewCardPresent_h(MFRC522_Handle *dev);
+bool PICC_ReadCardSerial_h(MFRC522_Handle *dev, Uid* uid);
+
 #endif // MFRC522_h
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+* MFRC522_KeyRing.c - MIFARE Classic key dictionary with a per UID/sector cache of the key that last worked.
+* See MFRC522_KeyRing.h for an overview.
+*/
+
+#include <memory.h>
+
+#include "MFRC522_KeyRing.h"
+
+void MIFARE_KeyRing_Init(MIFARE_KeyRing *ring) {
+	memset(ring, 0, sizeof(*ring));
+	ring->authTimeoutUs = MFRC_KEYRING_AUTH_TIMEOUT_US;
+} // End MIFARE_KeyRing_Init()
+
+int MIFARE_KeyRing_AddKey(MIFARE_KeyRing *ring, const MIFARE_Key *key, const uint8_t command) {
+	if (ring->keyCount >= MFRC_KEYRING_MAX_KEYS) {
+		return -1;
+	}
+	ring->keys[ring->keyCount].key = *key;
+	ring->keys[ring->keyCount].command = command;
+	return ring->keyCount++;
+} // End MIFARE_KeyRing_AddKey()
+
+void MIFARE_KeyRing_SetAuthTimeout(MIFARE_KeyRing *ring, const uint32_t timeoutUs) {
+	ring->authTimeoutUs = timeoutUs;
+} // End MIFARE_KeyRing_SetAuthTimeout()
+
+void MIFARE_KeyRing_ClearCache(MIFARE_KeyRing *ring) {
+	memset(ring->cache, 0, sizeof(ring->cache));
+} // End MIFARE_KeyRing_ClearCache()
+
+/**
+ * Finds the cache entry of a UID/sector pair.
+ *
+ * @return The entry, NULL if the pair is not remembered.
+ */
+static MIFARE_KeyRingEntry *MIFARE_KeyRing_Find(MIFARE_KeyRing *ring, const Uid *uid, const uint8_t sector) {
+	for (size_t i = 0; i < MFRC_KEYRING_CACHE_SIZE; i++) {
+		MIFARE_KeyRingEntry *entry = &ring->cache[i];
+		if (entry->uidSize == uid->size && entry->sector == sector && memcmp(entry->uidByte, uid->uidByte, uid->size) == 0) {
+			return entry;
+		}
+	}
+	return NULL;
+} // End MIFARE_KeyRing_Find()
+
+/**
+ * The dictionary index tried at a key attempt: the remembered key first, then the dictionary in order without it.
+ *
+ * @return The index, ring->keyCount if there are no more keys.
+ */
+static uint8_t MIFARE_KeyRing_KeyOfAttempt(const MIFARE_KeyRing *ring, const MIFARE_KeyRingEntry *entry, const uint8_t attempt) {
+	uint8_t index = attempt;
+	if (entry) {
+		if (attempt == 0) {
+			return entry->keyIndex;
+		}
+		index = attempt - 1;
+		if (index >= entry->keyIndex) {
+			index++;
+		}
+	}
+	return index < ring->keyCount ? index : ring->keyCount;
+} // End MIFARE_KeyRing_KeyOfAttempt()
+
+static bool MIFARE_KeyRing_GetKey(void *context, const Uid *uid, uint8_t sector, uint8_t attempt, uint8_t *command, MIFARE_Key *key) {
+	MIFARE_KeyRing *ring = context;
+	const uint8_t index = MIFARE_KeyRing_KeyOfAttempt(ring, MIFARE_KeyRing_Find(ring, uid, sector), attempt);
+	if (index >= ring->keyCount) {
+		return false;
+	}
+	*command = ring->keys[index].command;
+	*key = ring->keys[index].key;
+	ring->attempts++;
+	return true;
+} // End MIFARE_KeyRing_GetKey()
+
+static void MIFARE_KeyRing_Authenticated(void *context, const Uid *uid, uint8_t sector, uint8_t attempt) {
+	MIFARE_KeyRing *ring = context;
+	MIFARE_KeyRingEntry *entry = MIFARE_KeyRing_Find(ring, uid, sector);
+
+	if (attempt == MIFARE_KEY_NONE) {
+		ring->failures++;
+		if (entry) {
+			entry->uidSize = 0;		// the remembered key is stale
+		}
+		return;
+	}
+	if (entry && attempt == 0) {
+		ring->hits++;
+		entry->lastUsed = ++ring->clock;
+		return;
+	}
+
+	ring->misses++;
+	const uint8_t index = MIFARE_KeyRing_KeyOfAttempt(ring, entry, attempt);
+	if (entry == NULL) {
+		// a free entry, else the least recently used one
+		entry = &ring->cache[0];
+		for (size_t i = 0; i < MFRC_KEYRING_CACHE_SIZE && entry->uidSize; i++) {
+			if (ring->cache[i].uidSize == 0 || ring->cache[i].lastUsed < entry->lastUsed) {
+				entry = &ring->cache[i];
+			}
+		}
+		entry->uidSize = uid->size;
+		memcpy(entry->uidByte, uid->uidByte, uid->size);
+		entry->sector = sector;
+	}
+	entry->keyIndex = index;
+	entry->lastUsed = ++ring->clock;
+} // End MIFARE_KeyRing_Authenticated()
+
+MIFARE_KeyProvider MIFARE_KeyRing_Provider(MIFARE_KeyRing *ring) {
+	const MIFARE_KeyProvider provider = {
+		.getKey = MIFARE_KeyRing_GetKey,
+		.authenticated = MIFARE_KeyRing_Authenticated,
+		.context = ring,
+		.authTimeoutUs = ring->authTimeoutUs,
+	};
+	return provider;
+} // End MIFARE_KeyRing_Provider()
+
+/**
+ * Authenticates the sector of blockAddr with the keys of the ring, the remembered key of the UID/sector pair first.
+ * The PICC must be selected - ie in state ACTIVE(*) - before calling this function.
+ * Remember to call PCD_StopCrypto1_h() after communicating with the authenticated PICC.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise. STATUS_TIMEOUT if no key worked.
+ */
+enum StatusCode MIFARE_KeyRing_Authenticate_h(MFRC522_Handle *dev, MIFARE_KeyRing *ring,
+											  const uint8_t blockAddr,	///< Any block of the sector. See numbering in the comments in MFRC522_I2C.h.
+											  const Uid *uid			///< The selected PICC
+											  ) {
+	const MIFARE_KeyProvider provider = MIFARE_KeyRing_Provider(ring);
+	return MIFARE_AuthenticateSector_h(dev, uid, &provider, MIFARE_SectorOfBlock(blockAddr), NULL, NULL);
+} // End MIFARE_KeyRing_Authenticate_h()
+
+enum StatusCode MIFARE_KeyRing_Authenticate(MIFARE_KeyRing *ring, uint8_t blockAddr, const Uid *uid) {
+	return MIFARE_KeyRing_Authenticate_h(MFRC522_DefaultHandle(), ring, blockAddr, uid);
+}
+
+void MIFARE_KeyRing_GetStats(const MIFARE_KeyRing *ring, uint32_t *hits, uint32_t *misses, uint32_t *failures, uint32_t *attempts) {
+	if (hits) *hits = ring->hits;
+	if (misses) *misses = ring->misses;
+	if (failures) *failures = ring->failures;
+	if (attempts) *attempts = ring->attempts;
+} // End MIFARE_KeyRing_GetStats()
+
+float MIFARE_KeyRing_GetHitRate(const MIFARE_KeyRing *ring) {
+	const uint32_t total = ring->hits + ring->misses + ring->failures;
+	return total ? (float)ring->hits / total : 0.0f;
+} // End MIFARE_KeyRing_GetHitRate()
@@ -0,0 +1,101 @@
+/**
+ * MFRC522_KeyRing.h - MIFARE Classic key dictionary with a cache of the key that last worked per UID and sector.
+ *
+ * Sites with many keys pay for every wrong one: PCD_Authenticate() only fails when the MFRC522 timer expires
+ * (PCD_TIMEOUT_AUTH, 5ms by default) and the PICC has to be woken up and selected again before the next try. The key ring
+ * tries the keys of its dictionary in the order they were added, but first the key (and key type A/B) that last
+ * authenticated the same sector of the same card, so a card that is presented again normally needs one attempt per
+ * sector. The cache holds MFRC_KEYRING_CACHE_SIZE UID/sector pairs and drops the least recently used one when full.
+ * While keys are tried the authentication timeout is MFRC_KEYRING_AUTH_TIMEOUT_US, so wrong keys fail fast.
+ *
+ * 		static MIFARE_KeyRing ring;
+ * 		MIFARE_KeyRing_Init(&ring);
+ * 		MIFARE_KeyRing_AddKey(&ring, &siteKey, PICC_CMD_MF_AUTH_KEY_A);
+ * 		MIFARE_KeyRing_AddKey(&ring, &defaultKey, PICC_CMD_MF_AUTH_KEY_A);
+ * 		...
+ * 		MIFARE_KeyRing_Authenticate(&ring, blockAddr, &uid);		// instead of PCD_Authenticate()
+ * 		MIFARE_KeyProvider keys = MIFARE_KeyRing_Provider(&ring);	// or for MIFARE_ReadCard()
+ *
+ * A ring is not thread safe: use one per task, or lock around it.
+ */
+#ifndef MFRC522_KeyRing_h
+#define MFRC522_KeyRing_h
+
+#include "MFRC522_Classic.h"
+
+// Maximum number of keys in the dictionary
+#ifndef MFRC_KEYRING_MAX_KEYS
+#define MFRC_KEYRING_MAX_KEYS 32
+#endif
+
+// Number of UID/sector pairs whose key is remembered
+#ifndef MFRC_KEYRING_CACHE_SIZE
+#define MFRC_KEYRING_CACHE_SIZE 64
+#endif
+
+// MFRC522 timeout while keys are tried, below the MFRC_TIMEOUT_AUTH_US of single authentications. A MIFARE
+// authentication takes about 2ms on the air, and the timer only covers the wait for each answer within it.
+#ifndef MFRC_KEYRING_AUTH_TIMEOUT_US
+#define MFRC_KEYRING_AUTH_TIMEOUT_US 2000
+#endif
+
+// A dictionary entry: a key and whether it is tried as key A or key B.
+typedef struct {
+    MIFARE_Key	key;
+    uint8_t		command;		// PICC_CMD_MF_AUTH_KEY_A or PICC_CMD_MF_AUTH_KEY_B
+} MIFARE_KeyRingKey;
+
+// A remembered UID/sector pair. Private to MFRC522_KeyRing.c.
+typedef struct {
+    uint8_t		uidSize;		// 0: unused
+    uint8_t		uidByte[10];
+    uint8_t		sector;
+    uint8_t		keyIndex;		// into MIFARE_KeyRing.keys
+    uint32_t	lastUsed;		// MIFARE_KeyRing.clock when last looked up
+} MIFARE_KeyRingEntry;
+
+// A key ring. Allocate one (static or heap), set it up with MIFARE_KeyRing_Init(). The fields are private.
+typedef struct {
+    MIFARE_KeyRingKey	keys[MFRC_KEYRING_MAX_KEYS];
+    uint8_t		keyCount;
+    MIFARE_KeyRingEntry	cache[MFRC_KEYRING_CACHE_SIZE];
+    uint32_t	clock;			// LRU time, counts lookups
+    uint32_t	authTimeoutUs;
+    // statistics, see MIFARE_KeyRing_GetStats()
+    uint32_t	hits;
+    uint32_t	misses;
+    uint32_t	failures;
+    uint32_t	attempts;
+} MIFARE_KeyRing;
+
+// sets up an empty ring: no keys, empty cache, MFRC_KEYRING_AUTH_TIMEOUT_US.
+void MIFARE_KeyRing_Init(MIFARE_KeyRing *ring);
+
+// appends a key to the dictionary. command is PICC_CMD_MF_AUTH_KEY_A or _B; add a key twice to try it as both.
+// returns its index, or -1 if the dictionary is full.
+int MIFARE_KeyRing_AddKey(MIFARE_KeyRing *ring, const MIFARE_Key *key, uint8_t command);
+
+// MFRC522 timeout while keys are tried, 0 => keep the PCD_TIMEOUT_AUTH timeout of the reader.
+void MIFARE_KeyRing_SetAuthTimeout(MIFARE_KeyRing *ring, uint32_t timeoutUs);
+
+// forgets all remembered keys (the dictionary and the statistics stay).
+void MIFARE_KeyRing_ClearCache(MIFARE_KeyRing *ring);
+
+// a MIFARE_KeyProvider that tries the remembered key first, then the dictionary, and remembers the key that worked.
+// the ring must stay valid while the provider is used.
+MIFARE_KeyProvider MIFARE_KeyRing_Provider(MIFARE_KeyRing *ring);
+
+// like PCD_Authenticate(), with the keys of the ring. the PICC uid must be selected.
+// STATUS_TIMEOUT if no key worked; the PICC is selected again (but not authenticated) then.
+enum StatusCode MIFARE_KeyRing_Authenticate(MIFARE_KeyRing *ring, uint8_t blockAddr, const Uid *uid);
+enum StatusCode MIFARE_KeyRing_Authenticate_h(MFRC522_Handle *dev, MIFARE_KeyRing *ring, uint8_t blockAddr, const Uid *uid);
+
+// statistics since MIFARE_KeyRing_Init(), all pointers may be NULL. per sector authentication:
+// hits: the remembered key worked. misses: there was none, or it no longer worked, but a dictionary key did.
+// failures: no key worked. attempts: PCD_Authenticate() calls in total.
+void MIFARE_KeyRing_GetStats(const MIFARE_KeyRing *ring, uint32_t *hits, uint32_t *misses, uint32_t *failures, uint32_t *attempts);
+
+// hits / (hits + misses + failures), 0 before the first authentication.
+float MIFARE_KeyRing_GetHitRate(const MIFARE_KeyRing *ring);
+
+#endif // MFRC522_KeyRing_h
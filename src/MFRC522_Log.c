@@ -0,0 +1,166 @@
+/*
+* MFRC522_Log.c - deferred, rate-limited log of the i2c errors of the register functions.
+* See MFRC522_Log.h for an overview. Compiled only with MFRC_INCLUDE_LOG_RING=1.
+*/
+
+#include <inttypes.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "MFRC522_Log.h"
+
+#if MFRC_INCLUDE_LOG_RING == 1
+
+#if (MFRC_LOG_RING_SIZE & (MFRC_LOG_RING_SIZE - 1)) != 0
+#error "MFRC_LOG_RING_SIZE must be a power of 2"
+#endif
+
+static const char* TAG = "mfrc_log";
+
+// A record and its sequence number: 0 while a writer fills it, index + 1 once it is complete.
+typedef struct {
+	uint32_t sequence;
+	MFRC522_LogRecord record;
+} MFRC522_LogSlot;
+
+static MFRC522_LogSlot ring[MFRC_LOG_RING_SIZE];
+static uint32_t head;				// index of the next record to write, claimed by the writers with an atomic add
+static uint32_t tail;				// index of the next record to read, the draining task only
+static uint32_t dropped;			// overwritten before they were read, the draining task only
+static uint32_t droppedReported;	// dropped at the last MFRC522_Log_Drain()
+static TaskHandle_t drainTask;
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Writer side: the reader tasks
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Records an i2c error. Never waits: a time read, the rate limit and a dozen stores. When the ring is full, the
+ * oldest record is overwritten.
+ *
+ * The site is not locked either; two tasks failing in the same function at once may let an extra record through.
+ */
+void MFRC522_Log_I2cError(MFRC522_LogSite *site, const MFRC522_Handle *dev, const uint8_t reg, const uint8_t value,
+						const uint16_t length, const esp_err_t err) {
+	const int64_t nowUs = esp_timer_get_time();
+	if (nowUs - site->periodStartUs >= (int64_t)MFRC_LOG_SITE_PERIOD_MS * 1000) {
+		site->periodStartUs = nowUs;
+		site->inPeriod = 0;
+	}
+	if (site->inPeriod >= MFRC_LOG_SITE_BURST) {
+		site->suppressed++;
+		return;
+	}
+	site->inPeriod++;
+
+	const uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+	MFRC522_LogSlot *slot = &ring[index & (MFRC_LOG_RING_SIZE - 1)];
+	__atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->record.timeUs = nowUs;
+	slot->record.function = site->function;
+	slot->record.dev = dev;
+	slot->record.err = err;
+	slot->record.reg = reg;
+	slot->record.value = value;
+	slot->record.length = length;
+	slot->record.suppressed = site->suppressed;
+	__atomic_store_n(&slot->sequence, index + 1, __ATOMIC_RELEASE);
+	site->suppressed = 0;
+} // End MFRC522_Log_I2cError()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Reader side: the draining task
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Copies the oldest complete record out of the ring. Records overwritten before or while they are copied are
+ * skipped and counted as dropped.
+ *
+ * @return false if the ring is empty, or the oldest record is still being written.
+ */
+bool MFRC522_Log_Pop(MFRC522_LogRecord *out) {
+	while (1) {
+		const uint32_t written = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+		if (written == tail) {
+			return false;
+		}
+		if (written - tail > MFRC_LOG_RING_SIZE) {		// lapped: the oldest records are gone
+			dropped += written - tail - MFRC_LOG_RING_SIZE;
+			tail = written - MFRC_LOG_RING_SIZE;
+		}
+
+		const MFRC522_LogSlot *slot = &ring[tail & (MFRC_LOG_RING_SIZE - 1)];
+		const uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		if (sequence != tail + 1) {
+			if (sequence != 0 && (int32_t)(sequence - 1 - tail) > 0) {
+				dropped++;			// a writer of a later lap took the slot
+				tail++;
+				continue;
+			}
+			return false;			// claimed, but not complete yet
+		}
+		*out = slot->record;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		const bool intact = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == sequence;
+		tail++;
+		if (intact) {
+			return true;
+		}
+		dropped++;					// overwritten while it was copied
+	}
+} // End MFRC522_Log_Pop()
+
+size_t MFRC522_Log_Drain(void) {
+	size_t count = 0;
+	MFRC522_LogRecord record;
+	while (MFRC522_Log_Pop(&record)) {
+		ESP_LOGW(TAG, "%s(reg 0x%02x, value 0x%02x, %u bytes) i2c err: %s, reader %p, at %" PRId64 " us",
+				record.function, record.reg, record.value, record.length, esp_err_to_name(record.err), record.dev,
+				record.timeUs);
+		if (record.suppressed) {
+			ESP_LOGW(TAG, "%s: %u more i2c errors suppressed", record.function, record.suppressed);
+		}
+		count++;
+	}
+	if (dropped != droppedReported) {
+		ESP_LOGW(TAG, "%" PRIu32 " records lost, the ring was full", dropped - droppedReported);
+		droppedReported = dropped;
+	}
+	return count;
+} // End MFRC522_Log_Drain()
+
+uint32_t MFRC522_Log_Dropped(void) {
+	return dropped;
+} // End MFRC522_Log_Dropped()
+
+static void MFRC522_Log_DrainTask(void *arg) {
+	while (1) {
+		MFRC522_Log_Drain();
+		vTaskDelay(pdMS_TO_TICKS(MFRC_LOG_DRAIN_PERIOD_MS));
+	}
+}
+
+/**
+ * Starts the task that prints the records. Call it once; further calls do nothing.
+ *
+ * @return false if the task could not be created.
+ */
+bool MFRC522_Log_StartTask(const UBaseType_t priority,	///< FreeRTOS priority, best below the reader tasks
+						const uint32_t stackSize		///< Stack size, in bytes
+						) {
+	if (drainTask) {
+		return true;
+	}
+	if (xTaskCreate(MFRC522_Log_DrainTask, "mfrc_log", stackSize, NULL, priority, &drainTask) != pdPASS) {
+		ESP_LOGE(TAG, "can't create the log task");
+		drainTask = NULL;
+		return false;
+	}
+	return true;
+} // End MFRC522_Log_StartTask()
+
+#endif // MFRC_INCLUDE_LOG_RING
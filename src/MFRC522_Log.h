@@ -0,0 +1,81 @@
+/**
+ * MFRC522_Log.h - deferred, rate-limited log of the i2c errors of the register functions.
+ *
+ * Without it PCD_WriteRegister_h() & co. printf every failed i2c transaction on the reader task. With a flaky reader
+ * cable that is thousands of lines, and each one holds up the reader task for the UART (~1ms per line at 115200
+ * baud), which makes the outage worse. With MFRC_INCLUDE_LOG_RING=1 (MFRC522_I2C.h) a failed transaction only stores
+ * a record - function, reader, register, value, esp_err_t, timestamp - into a ring buffer, and a low priority task
+ * prints it later:
+ *
+ * 		MFRC522_Log_StartTask(1, 3072);		// or call MFRC522_Log_Drain() from a task of your own
+ *
+ * Writers never wait: they claim a slot with one atomic add and publish it with a sequence number. When the ring is
+ * full the oldest records are overwritten and counted in MFRC522_Log_Dropped(). Each call site lets through
+ * MFRC_LOG_SITE_BURST records per MFRC_LOG_SITE_PERIOD_MS; the ones it holds back are counted and reported with its
+ * next record. The ring is shared by all readers, drain it from one task only.
+ */
+#ifndef MFRC522_Log_h
+#define MFRC522_Log_h
+
+#include <freertos/FreeRTOS.h>
+
+#include "MFRC522_I2C.h"
+
+#if MFRC_INCLUDE_LOG_RING == 1
+
+// Records in the ring, a power of 2.
+#ifndef MFRC_LOG_RING_SIZE
+#define MFRC_LOG_RING_SIZE 32
+#endif
+
+// Rate limit per call site: at most MFRC_LOG_SITE_BURST records per MFRC_LOG_SITE_PERIOD_MS.
+#ifndef MFRC_LOG_SITE_BURST
+#define MFRC_LOG_SITE_BURST 5
+#endif
+#ifndef MFRC_LOG_SITE_PERIOD_MS
+#define MFRC_LOG_SITE_PERIOD_MS 1000
+#endif
+
+// How often the task of MFRC522_Log_StartTask() drains the ring.
+#ifndef MFRC_LOG_DRAIN_PERIOD_MS
+#define MFRC_LOG_DRAIN_PERIOD_MS 100
+#endif
+
+// One failed i2c transaction.
+typedef struct {
+    int64_t		timeUs;				// esp_timer_get_time() when it failed
+    const char	*function;			// e.g. "PCD_WriteRegister_h"
+    const MFRC522_Handle *dev;		// the reader
+    esp_err_t	err;
+    uint8_t		reg;				// PCD_Register
+    uint8_t		value;				// the byte written, the last one of a multi-byte write; 0 for reads
+    uint16_t	length;				// data bytes of the transaction
+    uint16_t	suppressed;			// records the rate limit of this site held back since its previous record
+} MFRC522_LogRecord;
+
+// The state of one call site, a static in the function that logs. See PCD_LOG_I2C_ERROR() in MFRC522_I2C.c.
+typedef struct {
+    const char	*function;
+    int64_t		periodStartUs;
+    uint16_t	inPeriod;			// records let through in the current period
+    uint16_t	suppressed;			// held back since the last record let through
+} MFRC522_LogSite;
+
+// starts a task that drains the ring every MFRC_LOG_DRAIN_PERIOD_MS and prints the records with ESP_LOGW.
+// a priority below the reader tasks keeps the UART off their path. false if the task could not be created.
+bool MFRC522_Log_StartTask(UBaseType_t priority, uint32_t stackSize);
+
+// moves the oldest record to out. false if the ring is empty. for a consumer of your own (log to flash, MQTT...).
+bool MFRC522_Log_Pop(MFRC522_LogRecord *out);
+
+// prints all records in the ring with ESP_LOGW, returns how many.
+size_t MFRC522_Log_Drain(void);
+
+// records overwritten before they were drained, since boot.
+uint32_t MFRC522_Log_Dropped(void);
+
+// hook for MFRC522_I2C.c: records an i2c error, unless the rate limit of site holds it back.
+void MFRC522_Log_I2cError(MFRC522_LogSite *site, const MFRC522_Handle *dev, uint8_t reg, uint8_t value, uint16_t length, esp_err_t err);
+
+#endif // MFRC_INCLUDE_LOG_RING
+#endif // MFRC522_Log_h
@@ -0,0 +1,197 @@
+/*
+* MFRC522_LowPower.c - card detection with the MFRC522 asleep between timed wake-ups.
+* See MFRC522_LowPower.h for an overview.
+*/
+
+#include <memory.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+
+#include "MFRC522_LowPower.h"
+
+static const char* TAG = "mfrc_lowpower";
+
+#define COMMAND_REG_POWER_DOWN	0x10	// PowerDown bit of CommandReg
+
+void MFRC522_LowPower_DefaultConfig(MFRC522_LowPowerConfig *config) {
+	config->mode = MFRC522_LOWPOWER_SOFT_POWERDOWN;
+	config->intervalMs = MFRC_LOWPOWER_INTERVAL_MS;
+	config->burst = MFRC_LOWPOWER_BURST;
+	config->fieldSettleUs = MFRC_LOWPOWER_FIELD_SETTLE_US;
+	config->holdOffMs = MFRC_LOWPOWER_HOLD_OFF_MS;
+	config->pollIntervalMs = MFRC_LOWPOWER_POLL_INTERVAL_MS;
+} // End MFRC522_LowPower_DefaultConfig()
+
+void MFRC522_LowPower_Init(MFRC522_LowPower *lp, MFRC522_Handle *dev, const MFRC522_LowPowerConfig *config) {
+	memset(lp, 0, sizeof(*lp));
+	lp->dev = dev;
+	if (config) {
+		lp->config = *config;
+	}
+	else {
+		MFRC522_LowPower_DefaultConfig(&lp->config);
+	}
+	if (lp->config.burst == 0) {
+		lp->config.burst = 1;
+	}
+	lp->startUs = esp_timer_get_time();
+	lp->awakeSinceUs = lp->startUs;
+} // End MFRC522_LowPower_Init()
+
+// Waits us microseconds: sleeping if that is at least a tick, else busy.
+static void MFRC522_LowPower_DelayUs(const uint32_t us) {
+	if (us >= portTICK_PERIOD_MS * 1000) {
+		vTaskDelay(pdMS_TO_TICKS(us / 1000));
+	}
+	else if (us) {
+		esp_rom_delay_us(us);
+	}
+} // End MFRC522_LowPower_DelayUs()
+
+/**
+ * Switches the field off, and with MFRC522_LOWPOWER_SOFT_POWERDOWN the MFRC522 too. Any command is stopped.
+ */
+esp_err_t MFRC522_LowPower_Sleep(MFRC522_LowPower *lp) {
+	if (lp->asleep) {
+		return ESP_OK;
+	}
+	esp_err_t err;
+	if (lp->config.mode == MFRC522_LOWPOWER_SOFT_POWERDOWN) {
+		err = PCD_WriteRegister_h(lp->dev, CommandReg, COMMAND_REG_POWER_DOWN | PCD_Idle);
+	}
+	else {
+		err = PCD_WriteRegister_h(lp->dev, CommandReg, PCD_Idle);
+		if (err == ESP_OK) {
+			err = PCD_AntennaOff_h(lp->dev);
+		}
+	}
+	if (err != ESP_OK) {
+		return err;
+	}
+	lp->awakeUs += esp_timer_get_time() - lp->awakeSinceUs;
+	lp->asleep = true;
+	return ESP_OK;
+} // End MFRC522_LowPower_Sleep()
+
+/**
+ * Brings the reader back: clears PowerDown and waits until the MFRC522 reads it as 0 (oscillator running), or
+ * switches the antenna on. Then waits the field settling time, so the first REQA finds the PICCs powered up.
+ */
+esp_err_t MFRC522_LowPower_Wake(MFRC522_LowPower *lp) {
+	if (!lp->asleep) {
+		return ESP_OK;
+	}
+	const int64_t wakeStartUs = esp_timer_get_time();
+	esp_err_t err;
+	if (lp->config.mode == MFRC522_LOWPOWER_SOFT_POWERDOWN) {
+		// The field comes back by itself with the transmitter settings of TxControlReg, the registers were kept.
+		err = PCD_WriteRegister_h(lp->dev, CommandReg, PCD_Idle);
+		uint8_t command = COMMAND_REG_POWER_DOWN;
+		while (err == ESP_OK && (command & COMMAND_REG_POWER_DOWN)) {		// PowerDown reads 1 until the MFRC522 is ready
+			if (esp_timer_get_time() - wakeStartUs > MFRC_LOWPOWER_WAKE_TIMEOUT_US) {
+				ESP_LOGE(TAG, "MFRC522 not ready %d us after soft power-down", MFRC_LOWPOWER_WAKE_TIMEOUT_US);
+				return ESP_ERR_TIMEOUT;
+			}
+			err = PCD_ReadRegister_h(lp->dev, CommandReg, &command);
+		}
+	}
+	else {
+		err = PCD_AntennaOn_h(lp->dev);
+	}
+	if (err != ESP_OK) {
+		return err;
+	}
+	const int64_t readyUs = esp_timer_get_time();
+	lp->asleep = false;
+	lp->awakeSinceUs = wakeStartUs;
+
+	lp->stats.wakeups++;
+	lp->stats.lastWakeUs = (uint32_t)(readyUs - wakeStartUs);
+	if (lp->stats.lastWakeUs > lp->stats.maxWakeUs) {
+		lp->stats.maxWakeUs = lp->stats.lastWakeUs;
+	}
+	lp->wakeSumUs += lp->stats.lastWakeUs;
+
+	MFRC522_LowPower_DelayUs(lp->config.fieldSettleUs);
+	return ESP_OK;
+} // End MFRC522_LowPower_Wake()
+
+/**
+ * One REQA probe. A PICC that answers starts the hold-off.
+ *
+ * @return STATUS_OK if a PICC answered, STATUS_TIMEOUT if none did, STATUS_ERROR on i2c errors.
+ */
+static enum StatusCode MFRC522_LowPower_Probe(MFRC522_LowPower *lp) {
+	lp->stats.probes++;
+	const enum StatusCode result = PICC_ProbePresence_h(lp->dev, NULL);
+	if (result == STATUS_OK || result == STATUS_COLLISION) {
+		lp->stats.detections++;
+		lp->holdOffUntilUs = esp_timer_get_time() + (int64_t)lp->config.holdOffMs * 1000;
+		return STATUS_OK;
+	}
+	return result == STATUS_ERROR ? STATUS_ERROR : STATUS_TIMEOUT;	// a garbled answer counts as nothing
+} // End MFRC522_LowPower_Probe()
+
+/**
+ * The detection loop: full rate polling while the hold-off of the last detection lasts, otherwise sleep intervalMs,
+ * wake up and send burst REQAs.
+ *
+ * @return STATUS_OK if a PICC answered (the reader is awake), STATUS_TIMEOUT, or STATUS_ERROR on i2c errors.
+ */
+enum StatusCode MFRC522_LowPower_WaitForCard(MFRC522_LowPower *lp, const TickType_t timeout) {
+	const bool forever = timeout == portMAX_DELAY;
+	const int64_t deadlineUs = esp_timer_get_time() + (int64_t)timeout * portTICK_PERIOD_MS * 1000;
+
+	while (1) {
+		int64_t nowUs = esp_timer_get_time();
+		if (nowUs < lp->holdOffUntilUs) {
+			if (MFRC522_LowPower_Wake(lp) != ESP_OK) {
+				return STATUS_ERROR;
+			}
+			const enum StatusCode result = MFRC522_LowPower_Probe(lp);
+			if (result != STATUS_TIMEOUT) {
+				return result;
+			}
+			if (!forever && esp_timer_get_time() >= deadlineUs) {
+				return STATUS_TIMEOUT;
+			}
+			vTaskDelay(pdMS_TO_TICKS(lp->config.pollIntervalMs));
+			continue;
+		}
+
+		if (MFRC522_LowPower_Sleep(lp) != ESP_OK) {
+			return STATUS_ERROR;
+		}
+		int64_t sleepUs = (int64_t)lp->config.intervalMs * 1000;
+		if (!forever && nowUs + sleepUs > deadlineUs) {
+			if (deadlineUs > nowUs) {
+				vTaskDelay(pdMS_TO_TICKS((deadlineUs - nowUs) / 1000));
+			}
+			return STATUS_TIMEOUT;
+		}
+		vTaskDelay(pdMS_TO_TICKS(lp->config.intervalMs));
+
+		if (MFRC522_LowPower_Wake(lp) != ESP_OK) {
+			return STATUS_ERROR;
+		}
+		for (uint8_t i = 0; i < lp->config.burst; i++) {
+			const enum StatusCode result = MFRC522_LowPower_Probe(lp);
+			if (result != STATUS_TIMEOUT) {
+				return result;
+			}
+		}
+	}
+} // End MFRC522_LowPower_WaitForCard()
+
+void MFRC522_LowPower_GetStats(const MFRC522_LowPower *lp, MFRC522_LowPowerStats *stats) {
+	const int64_t nowUs = esp_timer_get_time();
+	*stats = lp->stats;
+	stats->avgWakeUs = stats->wakeups ? (uint32_t)(lp->wakeSumUs / stats->wakeups) : 0;
+	stats->awakeUs = lp->awakeUs + (lp->asleep ? 0 : nowUs - lp->awakeSinceUs);
+	stats->totalUs = nowUs - lp->startUs;
+	stats->dutyCycle = stats->totalUs ? (float)stats->awakeUs / stats->totalUs : 1.0f;
+} // End MFRC522_LowPower_GetStats()
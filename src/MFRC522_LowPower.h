@@ -0,0 +1,122 @@
+/**
+ * MFRC522_LowPower.h - card detection with the MFRC522 asleep between timed wake-ups, for battery powered readers.
+ *
+ * Polling keeps the RF field and the MFRC522 on all the time, while a card shows up only now and then. The detector
+ * keeps the reader in a low power state - soft power-down (PowerDown bit of CommandReg: oscillator, field and
+ * receiver off, the registers are kept) or only the antenna off - and wakes it every intervalMs for a short burst of
+ * REQA probes (PICC_ProbePresence_h()). After a detection the reader stays awake and polls at full rate for
+ * holdOffMs, so the card can be read and the next one is not missed; then it goes back to sleep.
+ *
+ * 		static MFRC522_LowPower lp;
+ * 		MFRC522_LowPower_Init(&lp, &reader, NULL);				// MFRC_LOWPOWER_xxx defaults
+ * 		while (1) {
+ * 			if (MFRC522_LowPower_WaitForCard(&lp, portMAX_DELAY) == STATUS_OK && PICC_ReadCardSerial_h(&reader, &uid)) {
+ * 				...												// the reader is awake until the hold-off ends
+ * 				PICC_HaltA_h(&reader);
+ * 			}
+ * 		}
+ *
+ * The field is off while the reader sleeps, so a card that stays on the reader is detected again at the first
+ * wake-up after the hold-off. MFRC522_LowPower_GetStats() reports the wake-up latency and the duty cycle (share of
+ * the time the reader is awake), the two knobs are intervalMs (detection latency) and burst/holdOffMs.
+ * While the detector runs, it owns the reader between the calls: wake it with MFRC522_LowPower_Wake() before using
+ * it from elsewhere.
+ */
+#ifndef MFRC522_LowPower_h
+#define MFRC522_LowPower_h
+
+#include <freertos/FreeRTOS.h>
+
+#include "MFRC522_I2C.h"
+
+// Time asleep between two wake-ups: the worst case detection latency.
+#ifndef MFRC_LOWPOWER_INTERVAL_MS
+#define MFRC_LOWPOWER_INTERVAL_MS 250
+#endif
+
+// REQA probes per wake-up. More than one catches cards that are just entering the field.
+#ifndef MFRC_LOWPOWER_BURST
+#define MFRC_LOWPOWER_BURST 2
+#endif
+
+// Wait after the field comes back on before the first REQA: a PICC needs its power-up time (ISO/IEC 14443-3: 5ms).
+#ifndef MFRC_LOWPOWER_FIELD_SETTLE_US
+#define MFRC_LOWPOWER_FIELD_SETTLE_US 5000
+#endif
+
+// Full rate polling after a detection, and the time between two REQAs meanwhile.
+#ifndef MFRC_LOWPOWER_HOLD_OFF_MS
+#define MFRC_LOWPOWER_HOLD_OFF_MS 3000
+#endif
+#ifndef MFRC_LOWPOWER_POLL_INTERVAL_MS
+#define MFRC_LOWPOWER_POLL_INTERVAL_MS 20
+#endif
+
+// Longest wait for the oscillator after soft power-down before the wake-up counts as failed.
+#ifndef MFRC_LOWPOWER_WAKE_TIMEOUT_US
+#define MFRC_LOWPOWER_WAKE_TIMEOUT_US 50000
+#endif
+
+// How the reader sleeps between the wake-ups.
+enum MFRC522_LowPowerMode {
+    MFRC522_LOWPOWER_SOFT_POWERDOWN	= 0,	// PowerDown bit of CommandReg: least current, the oscillator has to start up again
+    MFRC522_LOWPOWER_ANTENNA_OFF	= 1		// TX1/TX2 off, the MFRC522 stays on: wakes up at once
+};
+
+typedef struct {
+    enum MFRC522_LowPowerMode mode;
+    uint32_t	intervalMs;			// time asleep between wake-ups
+    uint8_t		burst;				// REQA probes per wake-up, at least 1
+    uint32_t	fieldSettleUs;		// field on to first REQA
+    uint32_t	holdOffMs;			// full rate polling after a detection
+    uint32_t	pollIntervalMs;		// between the REQAs of the full rate polling
+} MFRC522_LowPowerConfig;
+
+// Counters since MFRC522_LowPower_Init(), see MFRC522_LowPower_GetStats().
+typedef struct {
+    uint32_t	wakeups;
+    uint32_t	probes;				// REQAs sent, asleep and at full rate
+    uint32_t	detections;
+    uint32_t	lastWakeUs;			// wake-up latency: wake command until the MFRC522 reports ready, field settling excluded
+    uint32_t	maxWakeUs;
+    uint32_t	avgWakeUs;
+    uint64_t	awakeUs;			// time awake (field on)
+    uint64_t	totalUs;			// time since MFRC522_LowPower_Init()
+    float		dutyCycle;			// awakeUs / totalUs
+} MFRC522_LowPowerStats;
+
+// A low power detector for one reader. Set it up with MFRC522_LowPower_Init(); the fields are private.
+typedef struct {
+    MFRC522_Handle *dev;
+    MFRC522_LowPowerConfig config;
+    bool		asleep;
+    int64_t		holdOffUntilUs;		// full rate polling until then
+    int64_t		startUs;			// MFRC522_LowPower_Init()
+    int64_t		awakeSinceUs;		// last wake-up, while awake
+    uint64_t	awakeUs;			// time awake before awakeSinceUs
+    uint64_t	wakeSumUs;
+    MFRC522_LowPowerStats stats;
+} MFRC522_LowPower;
+
+// sets up a detector for dev (MFRC522_Init_h() and PCD_Init_h() done). config NULL => MFRC_LOWPOWER_xxx defaults,
+// soft power-down. The reader stays awake until the first MFRC522_LowPower_WaitForCard().
+void MFRC522_LowPower_Init(MFRC522_LowPower *lp, MFRC522_Handle *dev, const MFRC522_LowPowerConfig *config);
+
+// the MFRC_LOWPOWER_xxx defaults, to change a few of them for MFRC522_LowPower_Init().
+void MFRC522_LowPower_DefaultConfig(MFRC522_LowPowerConfig *config);
+
+// sleeps and wakes up until a PICC answers a REQA: STATUS_OK, the reader is awake and the PICC in state READY
+// (continue with PICC_Select_h()/PICC_ReadCardSerial_h()). STATUS_TIMEOUT after timeout (portMAX_DELAY: never),
+// the reader may be asleep then. STATUS_ERROR on i2c errors.
+enum StatusCode MFRC522_LowPower_WaitForCard(MFRC522_LowPower *lp, TickType_t timeout);
+
+// puts the reader to sleep right away, e.g. when the card has been handled before the hold-off is over.
+esp_err_t MFRC522_LowPower_Sleep(MFRC522_LowPower *lp);
+
+// wakes the reader up (field on, settled), to use it outside the detector.
+esp_err_t MFRC522_LowPower_Wake(MFRC522_LowPower *lp);
+
+// wake-up latency and duty cycle so far.
+void MFRC522_LowPower_GetStats(const MFRC522_LowPower *lp, MFRC522_LowPowerStats *stats);
+
+#endif // MFRC522_LowPower_h
@@ -0,0 +1,164 @@
+/*
+* MFRC522_Presence.c - card arrived / card removed events, by tracking the PICC on the reader.
+* See MFRC522_Presence.h for an overview.
+*/
+
+#include <memory.h>
+
+#include "MFRC522_Presence.h"
+
+// Tracker states
+#define PRESENCE_ABSENT		0	// no PICC known, polls look for one
+#define PRESENCE_ARRIVING	1	// a PICC was found, its arrival is not reported yet
+#define PRESENCE_PRESENT	2	// the arrival was reported, polls confirm the PICC
+
+void MFRC522_Presence_DefaultConfig(MFRC522_PresenceConfig *config) {
+	config->arrivalConfirmations = MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS;
+	config->removalMisses = MFRC_PRESENCE_REMOVAL_MISSES;
+} // End MFRC522_Presence_DefaultConfig()
+
+void MFRC522_Presence_Init(MFRC522_Presence *presence, MFRC522_Handle *dev, const MFRC522_PresenceConfig *config) {
+	memset(presence, 0, sizeof(*presence));
+	presence->dev = dev;
+	if (config) {
+		presence->config = *config;
+	}
+	else {
+		MFRC522_Presence_DefaultConfig(&presence->config);
+	}
+	if (presence->config.arrivalConfirmations == 0) {
+		presence->config.arrivalConfirmations = 1;
+	}
+	if (presence->config.removalMisses == 0) {
+		presence->config.removalMisses = 1;
+	}
+	presence->state = PRESENCE_ABSENT;
+} // End MFRC522_Presence_Init()
+
+/**
+ * Looks for any PICC, also one in state HALT: WUPA and a full select. The PICC found is left selected.
+ *
+ * @return true if a PICC was selected, its UID is in presence->uid.
+ */
+static bool MFRC522_Presence_Find(MFRC522_Presence *presence) {
+	MFRC522_Handle *dev = presence->dev;
+	const uint32_t start = dev->_i2cTransactions;
+	const enum StatusCode probe = PICC_ProbeWakeup_h(dev, NULL);
+	if (probe != STATUS_OK && probe != STATUS_COLLISION) {			// Collision => several PICCs, the select picks one
+		return false;
+	}
+	if (PICC_Select_h(dev, &presence->uid, 0) != STATUS_OK) {
+		return false;
+	}
+	presence->stats.selects++;
+	presence->stats.lastSelectTransactions = dev->_i2cTransactions - start;
+	presence->selectTransactionSum += presence->stats.lastSelectTransactions;
+	return true;
+} // End MFRC522_Presence_Find()
+
+/**
+ * Confirms that the known PICC is still there: wakes it and selects it again with its UID, without anticollision,
+ * like PICC_Reselect_h(). It is left selected.
+ *
+ * @return true if the PICC answered.
+ */
+static bool MFRC522_Presence_Confirm(MFRC522_Presence *presence) {
+	MFRC522_Handle *dev = presence->dev;
+	const uint32_t start = dev->_i2cTransactions;
+	presence->stats.confirmations++;
+
+	// The PICC is normally still selected from the last poll, maybe authenticated by the application. In state ACTIVE
+	// it drops to IDLE on the WUPA without answering, and answers the second one. Two probes (~12 i2c transactions)
+	// cost less than a HLTA (20-30 and a 1ms timeout) before the WUPA.
+	enum StatusCode result = STATUS_ERROR;
+	if (PCD_StopCrypto1_h(dev) == ESP_OK) {
+		result = PICC_ProbeWakeup_h(dev, NULL);
+		if (result == STATUS_TIMEOUT) {
+			result = PICC_ProbeWakeup_h(dev, NULL);
+		}
+	}
+	if (result == STATUS_OK || result == STATUS_COLLISION) {		// Collision => other PICCs woke up too, the SELECT picks ours
+		Uid known = presence->uid;
+		result = PICC_Select_h(dev, &known, known.size * 8);
+	}
+	if (result != STATUS_OK) {
+		presence->stats.misses++;
+		return false;
+	}
+	presence->stats.lastConfirmTransactions = dev->_i2cTransactions - start;
+	presence->confirmTransactionSum += presence->stats.lastConfirmTransactions;
+	return true;
+} // End MFRC522_Presence_Confirm()
+
+/**
+ * One poll. Absent: WUPA and full select, a PICC found starts arriving. Arriving: confirms the PICC, reports the
+ * arrival after arrivalConfirmations successful polls, or forgets it at the first miss. Present: confirms the PICC,
+ * reports the removal after removalMisses misses in a row.
+ *
+ * @return the event, if any.
+ */
+enum MFRC522_PresenceEvent MFRC522_Presence_Poll(MFRC522_Presence *presence, Uid *uid) {
+	presence->stats.polls++;
+
+	switch (presence->state) {
+		case PRESENCE_ABSENT:
+			if (!MFRC522_Presence_Find(presence)) {
+				return MFRC522_PRESENCE_NONE;
+			}
+			presence->state = PRESENCE_ARRIVING;
+			presence->hits = 1;
+			presence->misses = 0;
+			break;
+
+		case PRESENCE_ARRIVING:
+			if (!MFRC522_Presence_Confirm(presence)) {
+				presence->stats.bounces++;
+				presence->state = PRESENCE_ABSENT;
+				return MFRC522_PRESENCE_NONE;
+			}
+			presence->hits++;
+			break;
+
+		default:
+			if (MFRC522_Presence_Confirm(presence)) {
+				presence->misses = 0;
+				return MFRC522_PRESENCE_NONE;
+			}
+			if (++presence->misses < presence->config.removalMisses) {
+				return MFRC522_PRESENCE_NONE;
+			}
+			presence->state = PRESENCE_ABSENT;
+			presence->stats.removals++;
+			if (uid) {
+				*uid = presence->uid;
+			}
+			return MFRC522_PRESENCE_REMOVED;
+	}
+
+	if (presence->hits < presence->config.arrivalConfirmations) {
+		return MFRC522_PRESENCE_NONE;
+	}
+	presence->state = PRESENCE_PRESENT;
+	presence->stats.arrivals++;
+	if (uid) {
+		*uid = presence->uid;
+	}
+	return MFRC522_PRESENCE_ARRIVED;
+} // End MFRC522_Presence_Poll()
+
+bool MFRC522_Presence_IsPresent(const MFRC522_Presence *presence, Uid *uid) {
+	if (presence->state != PRESENCE_PRESENT) {
+		return false;
+	}
+	if (uid) {
+		*uid = presence->uid;
+	}
+	return true;
+} // End MFRC522_Presence_IsPresent()
+
+void MFRC522_Presence_GetStats(const MFRC522_Presence *presence, MFRC522_PresenceStats *stats) {
+	*stats = presence->stats;
+	const uint32_t confirmed = stats->confirmations - stats->misses;
+	stats->avgSelectTransactions = stats->selects ? (float)presence->selectTransactionSum / stats->selects : 0.0f;
+	stats->avgConfirmTransactions = confirmed ? (float)presence->confirmTransactionSum / confirmed : 0.0f;
+} // End MFRC522_Presence_GetStats()
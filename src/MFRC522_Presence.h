@@ -0,0 +1,99 @@
+/**
+ * MFRC522_Presence.h - card arrived / card removed events, by tracking the PICC on the reader.
+ *
+ * PICC_IsNewCardPresent_h() + PICC_ReadCardSerial_h() tell whether a REQA succeeded, and do a full anticollision each
+ * time; a PICC that was halted does not answer the REQA anymore. The tracker keeps the Uid of the PICC on the reader
+ * instead and confirms it on every poll with a WUPA and a SELECT of the known UID, like PICC_Reselect_h(), which skips
+ * the anticollision. A PICC counts as arrived after arrivalConfirmations successful polls in a row, and as removed after
+ * removalMisses failed confirmations in a row, so a PICC at the edge of the field or a single lost frame do not make
+ * events.
+ *
+ * 		static MFRC522_Presence presence;
+ * 		MFRC522_Presence_Init(&presence, &reader, NULL);		// MFRC_PRESENCE_xxx defaults
+ * 		while (1) {
+ * 			Uid uid;
+ * 			switch (MFRC522_Presence_Poll(&presence, &uid)) {
+ * 				case MFRC522_PRESENCE_ARRIVED: ...				// the PICC is selected (ACTIVE): read it right away
+ * 				case MFRC522_PRESENCE_REMOVED: ...
+ * 				default: break;
+ * 			}
+ * 			vTaskDelay(pdMS_TO_TICKS(50));
+ * 		}
+ *
+ * After a successful poll the PICC is left selected, so it can be authenticated and read after the arrival event.
+ * Each confirmation stops Crypto1 first. MFRC522_Presence_GetStats() reports the i2c transactions
+ * of a confirmation next to those of the full select done when a PICC arrives.
+ * While the tracker is used, it owns the reader between the polls: only talk to the selected PICC in between.
+ */
+#ifndef MFRC522_Presence_h
+#define MFRC522_Presence_h
+
+#include "MFRC522_I2C.h"
+
+// Successful polls in a row, the first one with the full select, until MFRC522_PRESENCE_ARRIVED.
+#ifndef MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS
+#define MFRC_PRESENCE_ARRIVAL_CONFIRMATIONS 2
+#endif
+
+// Failed confirmations in a row until MFRC522_PRESENCE_REMOVED.
+#ifndef MFRC_PRESENCE_REMOVAL_MISSES
+#define MFRC_PRESENCE_REMOVAL_MISSES 3
+#endif
+
+// What MFRC522_Presence_Poll() saw.
+enum MFRC522_PresenceEvent {
+    MFRC522_PRESENCE_NONE		= 0,	// no change: still present, still absent, or not debounced yet
+    MFRC522_PRESENCE_ARRIVED	= 1,	// a PICC arrived, it is selected
+    MFRC522_PRESENCE_REMOVED	= 2		// the PICC left the field
+};
+
+typedef struct {
+    uint8_t		arrivalConfirmations;	// successful polls in a row for an arrival, at least 1
+    uint8_t		removalMisses;			// failed confirmations in a row for a removal, at least 1
+} MFRC522_PresenceConfig;
+
+// Counters since MFRC522_Presence_Init(), see MFRC522_Presence_GetStats().
+typedef struct {
+    uint32_t	polls;
+    uint32_t	arrivals;
+    uint32_t	removals;
+    uint32_t	selects;				// PICCs found by a full select (WUPA + anticollision)
+    uint32_t	confirmations;			// WUPA + SELECT of the known PICC, successful or not
+    uint32_t	misses;					// failed confirmations
+    uint32_t	bounces;				// PICCs lost again before their arrival was reported
+    uint32_t	lastSelectTransactions;	// i2c transactions of the last successful full select
+    uint32_t	lastConfirmTransactions;	// i2c transactions of the last successful confirmation
+    float		avgSelectTransactions;
+    float		avgConfirmTransactions;
+} MFRC522_PresenceStats;
+
+// A presence tracker for one reader. Set it up with MFRC522_Presence_Init(); the fields are private.
+typedef struct {
+    MFRC522_Handle *dev;
+    MFRC522_PresenceConfig config;
+    uint8_t		state;
+    Uid			uid;					// the PICC tracked, unless the state is absent
+    uint8_t		hits;					// successful polls in a row while arriving
+    uint8_t		misses;					// failed confirmations in a row
+    uint64_t	selectTransactionSum;	// of the successful full selects
+    uint64_t	confirmTransactionSum;	// of the successful confirmations
+    MFRC522_PresenceStats stats;
+} MFRC522_Presence;
+
+// sets up a tracker for dev (MFRC522_Init_h() and PCD_Init_h() done). config NULL => MFRC_PRESENCE_xxx defaults.
+void MFRC522_Presence_Init(MFRC522_Presence *presence, MFRC522_Handle *dev, const MFRC522_PresenceConfig *config);
+
+// the MFRC_PRESENCE_xxx defaults, to change a few of them for MFRC522_Presence_Init().
+void MFRC522_Presence_DefaultConfig(MFRC522_PresenceConfig *config);
+
+// looks for a PICC (absent) or confirms the known one (arriving, present). uid (NULL: unused) gets the PICC of an
+// arrival or removal event. call it periodically; the poll interval times the debounce counts is the event latency.
+enum MFRC522_PresenceEvent MFRC522_Presence_Poll(MFRC522_Presence *presence, Uid *uid);
+
+// true between the arrival and the removal event, uid (NULL: unused) gets the PICC then.
+bool MFRC522_Presence_IsPresent(const MFRC522_Presence *presence, Uid *uid);
+
+// counters and the i2c cost of confirmations and full selects so far.
+void MFRC522_Presence_GetStats(const MFRC522_Presence *presence, MFRC522_PresenceStats *stats);
+
+#endif // MFRC522_Presence_h
@@ -0,0 +1,300 @@
+/*
+* MFRC522_ReaderPool.c - polls many MFRC522 readers for new cards, one FreeRTOS worker task per i2c bus.
+* See MFRC522_ReaderPool.h for an overview.
+*/
+
+#include <memory.h>
+#include <stdio.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "MFRC522_ReaderPool.h"
+
+static const char* TAG = "mfrc_pool";
+
+// MFRC522_PoolReader.state
+#define POOL_READER_IDLE	0		// no command running, the next pass starts a REQA
+#define POOL_READER_REQA	1		// REQA started, waiting for the ATQA or the timer
+
+/**
+ * Sets up an empty pool.
+ *
+ * @return false if the event queue could not be allocated.
+ */
+bool MFRC522_Pool_Init(MFRC522_ReaderPool *pool,	///< The pool to set up. Previous contents don't matter.
+						size_t eventQueueLength		///< Number of MFRC522_PoolEvent the queue can hold.
+						) {
+	memset(pool, 0, sizeof(*pool));
+	pool->idleDelayTicks = 1;
+	pool->events = xQueueCreate(eventQueueLength, sizeof(MFRC522_PoolEvent));
+	if (pool->events == NULL) {
+		ESP_LOGE(TAG, "can't allocate the event queue");
+		return false;
+	}
+	return true;
+} // End MFRC522_Pool_Init()
+
+/**
+ * Adds a reader on i2c bus busId. Readers must be added before MFRC522_Pool_Start().
+ *
+ * @return The reader id used in events, or -1 if there is no room.
+ */
+int MFRC522_Pool_AddReader(MFRC522_ReaderPool *pool,	///< The pool
+							MFRC522_Handle *dev,		///< An initialized reader (MFRC522_Init_h() and PCD_Init_h())
+							const uint8_t busId			///< The i2c bus the reader is connected to, 0..MFRC_POOL_MAX_BUSES-1
+							) {
+	if (pool->running || busId >= MFRC_POOL_MAX_BUSES) {
+		return -1;
+	}
+	MFRC522_PoolBus *bus = &pool->buses[busId];
+	if (bus->readerCount >= MFRC_POOL_MAX_READERS_PER_BUS || pool->readerCount == UINT8_MAX) {
+		return -1;
+	}
+
+	MFRC522_PoolReader *reader = &bus->readers[bus->readerCount++];
+	memset(reader, 0, sizeof(*reader));
+	reader->dev = dev;
+	reader->readerId = pool->readerCount++;
+	reader->state = POOL_READER_IDLE;
+	return reader->readerId;
+} // End MFRC522_Pool_AddReader()
+
+void MFRC522_Pool_SetIdleDelay(MFRC522_ReaderPool *pool, const TickType_t ticks) {
+	pool->idleDelayTicks = ticks;
+} // End MFRC522_Pool_SetIdleDelay()
+
+/**
+ * Starts the REQA of a reader without waiting for the answer.
+ */
+static void MFRC522_Pool_StartScan(MFRC522_PoolReader *reader) {
+	const int64_t now = esp_timer_get_time();
+	if (reader->lastScanUs != 0) {
+		reader->scanIntervalUs = (uint32_t)(now - reader->lastScanUs);
+	}
+	reader->lastScanUs = now;
+
+	const uint8_t command = PICC_CMD_REQA;
+	PCD_UseCommandTimeout_h(reader->dev, PCD_TIMEOUT_REQA);
+	if (PCD_ClearRegisterBitMask_h(reader->dev, CollReg, 0x80) != ESP_OK			// ValuesAfterColl=1 => Bits received after collision are cleared.
+		|| PCD_StartTransceive_h(reader->dev, &command, 1, 7, 0) != STATUS_OK) {	// REQA is a 7 bit short frame
+		reader->errors++;
+		return;
+	}
+	reader->state = POOL_READER_REQA;
+} // End MFRC522_Pool_StartScan()
+
+/**
+ * A reader got an answer to its REQA: selects the card, reports it and halts it so that the next REQA
+ * does not see it again. Blocks for the few milliseconds the anticollision takes.
+ */
+static void MFRC522_Pool_ReadCard(MFRC522_ReaderPool *pool, MFRC522_PoolReader *reader) {
+	MFRC522_PoolEvent event;
+	event.readerId = reader->readerId;
+
+	const enum StatusCode result = PICC_Select_h(reader->dev, &event.uid, 0);
+	if (result != STATUS_OK) {
+		ESP_LOGD(TAG, "reader %d: select failed: %s", reader->readerId, GetStatusCodeName(result));
+		reader->errors++;
+		return;
+	}
+	event.timestampUs = esp_timer_get_time();
+	reader->cards++;
+
+	PICC_HaltA_h(reader->dev);
+
+	if (xQueueSend(pool->events, &event, 0) != pdTRUE) {
+		ESP_LOGW(TAG, "reader %d: event queue full, card dropped", reader->readerId);
+	}
+} // End MFRC522_Pool_ReadCard()
+
+/**
+ * One pass over the readers of a bus: idle readers start a REQA, waiting readers are polled once.
+ * A reader whose REQA completed is handled right away and starts its next REQA in the following pass.
+ *
+ * @return The number of readers that completed a REQA cycle in this pass.
+ */
+int MFRC522_Pool_Service(MFRC522_ReaderPool *pool,		///< The pool
+						const uint8_t busId				///< The bus to service
+						) {
+	if (busId >= MFRC_POOL_MAX_BUSES) {
+		return 0;
+	}
+	MFRC522_PoolBus *bus = &pool->buses[busId];
+	int completed = 0;
+
+	// Start with a different reader every pass, so that a reader with a card does not always delay the same neighbours.
+	for (uint8_t i = 0; i < bus->readerCount; i++) {
+		uint8_t index = bus->next + i;
+		if (index >= bus->readerCount) {
+			index -= bus->readerCount;
+		}
+		MFRC522_PoolReader *reader = &bus->readers[index];
+
+		if (reader->state == POOL_READER_IDLE) {
+			MFRC522_Pool_StartScan(reader);
+			continue;
+		}
+
+		enum StatusCode result = PCD_PollCommand_h(reader->dev);
+		if (result == STATUS_PENDING) {
+			continue;
+		}
+
+		reader->state = POOL_READER_IDLE;
+		reader->scans++;
+		bus->scans++;
+		completed++;
+
+		if (result == STATUS_OK) {
+			uint8_t bufferATQA[2];
+			uint8_t bufferSize = sizeof(bufferATQA);
+			uint8_t validBits = 0;
+			result = PCD_FinishCommand_h(reader->dev, bufferATQA, &bufferSize, &validBits, 0, false);
+			// Collisions mean several cards answered; anticollision in PICC_Select_h() sorts them out.
+			if (result == STATUS_COLLISION || (result == STATUS_OK && bufferSize == 2 && validBits == 0)) {
+				MFRC522_Pool_ReadCard(pool, reader);
+			}
+		}
+		else if (result != STATUS_TIMEOUT) {
+			reader->errors++;
+		}
+	}
+
+	if (bus->readerCount > 0 && ++bus->next >= bus->readerCount) {
+		bus->next = 0;
+	}
+	return completed;
+} // End MFRC522_Pool_Service()
+
+/**
+ * Worker task of one bus. Services the bus until MFRC522_Pool_Stop().
+ */
+static void MFRC522_Pool_Worker(void *arg) {
+	MFRC522_PoolBus *bus = (MFRC522_PoolBus *)arg;
+	MFRC522_ReaderPool *pool = bus->pool;
+	const uint8_t busId = bus->busId;
+
+	while (pool->running) {
+		if (MFRC522_Pool_Service(pool, busId) == 0) {
+			// Everyone is waiting for the RF field. Don't hold the CPU, the timers run on in the MFRC522s.
+			if (pool->idleDelayTicks > 0) {
+				vTaskDelay(pool->idleDelayTicks);
+			}
+			else {
+				taskYIELD();
+			}
+		}
+	}
+
+	for (uint8_t i = 0; i < bus->readerCount; i++) {
+		PCD_WriteRegister_h(bus->readers[i].dev, CommandReg, PCD_Idle);
+		bus->readers[i].state = POOL_READER_IDLE;
+	}
+	bus->task = NULL;
+	vTaskDelete(NULL);
+} // End MFRC522_Pool_Worker()
+
+/**
+ * Starts one worker task per bus that has readers.
+ *
+ * @return false if a task could not be created. The workers that were started are stopped again.
+ */
+bool MFRC522_Pool_Start(MFRC522_ReaderPool *pool,	///< The pool
+						const UBaseType_t priority,	///< FreeRTOS priority of the workers
+						const uint32_t stackSize	///< Stack size of each worker, in bytes
+						) {
+	if (pool->running) {
+		return true;
+	}
+	pool->running = true;
+	pool->rateScans = 0;
+	pool->rateSinceUs = esp_timer_get_time();
+
+	for (uint8_t busId = 0; busId < MFRC_POOL_MAX_BUSES; busId++) {
+		MFRC522_PoolBus *bus = &pool->buses[busId];
+		if (bus->readerCount == 0) {
+			continue;
+		}
+		bus->pool = pool;
+		bus->busId = busId;
+
+		char name[configMAX_TASK_NAME_LEN];
+		snprintf(name, sizeof(name), "mfrc_bus%d", busId);
+		// xTaskCreate() stores the handle before the worker can run: a worker that exits at once clears it afterwards
+		if (xTaskCreate(MFRC522_Pool_Worker, name, stackSize, bus, priority, (TaskHandle_t *)&bus->task) != pdPASS) {
+			ESP_LOGE(TAG, "can't create the worker of bus %d", busId);
+			bus->task = NULL;
+			MFRC522_Pool_Stop(pool);
+			return false;
+		}
+	}
+	return true;
+} // End MFRC522_Pool_Start()
+
+/**
+ * Stops the workers and waits until they have exited.
+ */
+void MFRC522_Pool_Stop(MFRC522_ReaderPool *pool) {
+	pool->running = false;
+	for (uint8_t busId = 0; busId < MFRC_POOL_MAX_BUSES; busId++) {
+		while (pool->buses[busId].task != NULL) {
+			vTaskDelay(1);
+		}
+	}
+} // End MFRC522_Pool_Stop()
+
+/**
+ * Waits for the next detected card.
+ *
+ * @return false if no card was detected within ticksToWait.
+ */
+bool MFRC522_Pool_GetEvent(MFRC522_ReaderPool *pool, MFRC522_PoolEvent *event, const TickType_t ticksToWait) {
+	return xQueueReceive(pool->events, event, ticksToWait) == pdTRUE;
+} // End MFRC522_Pool_GetEvent()
+
+/**
+ * Aggregate scan rate of all readers since the previous call (or MFRC522_Pool_Start()).
+ * Call from one task only.
+ *
+ * @return Completed REQA cycles per second.
+ */
+float MFRC522_Pool_GetScansPerSecond(MFRC522_ReaderPool *pool) {
+	uint32_t scans = 0;
+	for (uint8_t busId = 0; busId < MFRC_POOL_MAX_BUSES; busId++) {
+		scans += pool->buses[busId].scans;
+	}
+	const int64_t now = esp_timer_get_time();
+	const int64_t elapsedUs = now - pool->rateSinceUs;
+	const uint32_t delta = scans - pool->rateScans;
+
+	pool->rateScans = scans;
+	pool->rateSinceUs = now;
+	return elapsedUs > 0 ? (float)delta * 1000000.0f / (float)elapsedUs : 0.0f;
+} // End MFRC522_Pool_GetScansPerSecond()
+
+/**
+ * Statistics of one reader. Any of the output pointers can be NULL.
+ *
+ * @return false if there is no reader with this id.
+ */
+bool MFRC522_Pool_GetReaderStats(MFRC522_ReaderPool *pool, const uint8_t readerId, uint32_t *scans, uint32_t *cards, uint32_t *errors, uint32_t *scanIntervalUs) {
+	for (uint8_t busId = 0; busId < MFRC_POOL_MAX_BUSES; busId++) {
+		MFRC522_PoolBus *bus = &pool->buses[busId];
+		for (uint8_t i = 0; i < bus->readerCount; i++) {
+			const MFRC522_PoolReader *reader = &bus->readers[i];
+			if (reader->readerId != readerId) {
+				continue;
+			}
+			if (scans)			*scans = reader->scans;
+			if (cards)			*cards = reader->cards;
+			if (errors)			*errors = reader->errors;
+			if (scanIntervalUs)	*scanIntervalUs = reader->scanIntervalUs;
+			return true;
+		}
+	}
+	return false;
+} // End MFRC522_Pool_GetReaderStats()
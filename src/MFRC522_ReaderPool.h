@@ -0,0 +1,117 @@
+/**
+ * MFRC522_ReaderPool.h - polls many MFRC522 readers for new cards, one FreeRTOS worker task per i2c bus.
+ *
+ * Polling readers one after the other with PICC_IsNewCardPresent_h() costs a full MFRC522 timer period (the
+ * PCD_TIMEOUT_REQA timeout) per empty reader, so the scan interval of every reader grows with the number of readers.
+ * The pool instead starts a REQA on every reader of a bus with PCD_StartTransceive_h() and then services them
+ * round-robin with PCD_PollCommand_h(): while one reader waits for the RF field, the bus is used for the register
+ * traffic of the others. The scan interval of a reader stays close to one timer period regardless of the number
+ * of readers on the bus, as long as the i2c traffic of one pass over the bus fits into it.
+ *
+ * Readers that answer the REQA are selected (PICC_Select_h()) and halted (PICC_HaltA_h()), and the UID is posted to
+ * the event queue with the reader id and a timestamp. Like PICC_IsNewCardPresent_h() only "new" cards are reported:
+ * a card is reported again after it left the field (or was woken up by someone else).
+ *
+ * Usage:
+ * 		static MFRC522_ReaderPool pool;
+ * 		MFRC522_Pool_Init(&pool, 16);
+ * 		MFRC522_Pool_AddReader(&pool, &reader0, 0);		// readers already set up with MFRC522_Init_h()/PCD_Init_h()
+ * 		MFRC522_Pool_AddReader(&pool, &reader1, 1);
+ * 		MFRC522_Pool_Start(&pool, 5, 4096);
+ * 		MFRC522_PoolEvent event;
+ * 		while (MFRC522_Pool_GetEvent(&pool, &event, portMAX_DELAY)) { ... }
+ *
+ * While the pool runs, its worker tasks own the readers: don't call any *_h() function on them.
+ */
+#ifndef MFRC522_ReaderPool_h
+#define MFRC522_ReaderPool_h
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "MFRC522_I2C.h"
+
+// Maximum number of i2c buses (= worker tasks) in one pool
+#ifndef MFRC_POOL_MAX_BUSES
+#define MFRC_POOL_MAX_BUSES 4
+#endif
+
+// Maximum number of readers on one bus
+#ifndef MFRC_POOL_MAX_READERS_PER_BUS
+#define MFRC_POOL_MAX_READERS_PER_BUS 8
+#endif
+
+// A card detected by the pool
+typedef struct {
+    uint8_t		readerId;		// as returned by MFRC522_Pool_AddReader()
+    Uid			uid;
+    int64_t		timestampUs;	// esp_timer_get_time() when the card was selected
+} MFRC522_PoolEvent;
+
+// State of one reader in the pool. Private to MFRC522_ReaderPool.c.
+typedef struct {
+    MFRC522_Handle *dev;
+    uint8_t		readerId;
+    uint8_t		state;
+    int64_t		lastScanUs;		// start of the last REQA
+    uint32_t	scans;			// completed REQA cycles
+    uint32_t	cards;			// cards reported
+    uint32_t	errors;			// i2c errors and failed selects
+    uint32_t	scanIntervalUs;	// time between the last two REQA starts
+} MFRC522_PoolReader;
+
+// One i2c bus and its worker. Aligned so that the workers don't share cache lines.
+typedef struct __attribute__((aligned(MFRC_CACHE_LINE_SIZE))) {
+    MFRC522_PoolReader readers[MFRC_POOL_MAX_READERS_PER_BUS];
+    struct MFRC522_ReaderPool *pool;
+    uint8_t		busId;
+    uint8_t		readerCount;
+    uint8_t		next;			// round-robin position
+    TaskHandle_t volatile task;
+    uint32_t volatile scans;	// completed REQA cycles on this bus, read by MFRC522_Pool_GetScansPerSecond()
+} MFRC522_PoolBus;
+
+// A reader pool. Allocate one (static or heap), set it up with MFRC522_Pool_Init(). The fields are private.
+typedef struct MFRC522_ReaderPool {
+    MFRC522_PoolBus buses[MFRC_POOL_MAX_BUSES];
+    QueueHandle_t events;
+    uint8_t		readerCount;
+    bool volatile running;
+    TickType_t	idleDelayTicks;	// sleep of a worker after a pass over its bus in which no reader completed anything
+    uint32_t	rateScans;		// MFRC522_Pool_GetScansPerSecond() bookkeeping
+    int64_t		rateSinceUs;
+} MFRC522_ReaderPool;
+
+// sets up an empty pool whose event queue holds eventQueueLength events. false if the queue could not be allocated.
+bool MFRC522_Pool_Init(MFRC522_ReaderPool *pool, size_t eventQueueLength);
+
+// adds an initialized reader (MFRC522_Init_h() and PCD_Init_h() done) that is connected to i2c bus busId
+// (0..MFRC_POOL_MAX_BUSES-1, numbering is up to the caller). only before MFRC522_Pool_Start().
+// returns the reader id used in events, or -1 if the pool or the bus is full.
+int MFRC522_Pool_AddReader(MFRC522_ReaderPool *pool, MFRC522_Handle *dev, uint8_t busId);
+
+// sleep of a worker after a pass in which all its readers were still waiting. default 1 tick, 0 => just yield.
+void MFRC522_Pool_SetIdleDelay(MFRC522_ReaderPool *pool, TickType_t ticks);
+
+// starts one worker task per bus that has readers. false if a task could not be created (the others are stopped).
+bool MFRC522_Pool_Start(MFRC522_ReaderPool *pool, UBaseType_t priority, uint32_t stackSize);
+
+// stops the workers and waits until they have exited. the readers are idle (PCD_Idle) afterwards.
+void MFRC522_Pool_Stop(MFRC522_ReaderPool *pool);
+
+// one pass over the readers of a bus: starts, polls and completes their REQA cycles, never waits for the RF field.
+// this is the loop body of the worker tasks; call it from your own task instead of MFRC522_Pool_Start() if preferred.
+// returns the number of readers that completed a REQA cycle in this pass.
+int MFRC522_Pool_Service(MFRC522_ReaderPool *pool, uint8_t busId);
+
+// waits up to ticksToWait for the next detected card. false if there was none.
+bool MFRC522_Pool_GetEvent(MFRC522_ReaderPool *pool, MFRC522_PoolEvent *event, TickType_t ticksToWait);
+
+// completed REQA cycles per second of all readers together, since the previous call (or MFRC522_Pool_Start()).
+float MFRC522_Pool_GetScansPerSecond(MFRC522_ReaderPool *pool);
+
+// statistics of one reader. scanIntervalUs is the time between its last two scans. false for an unknown readerId.
+bool MFRC522_Pool_GetReaderStats(MFRC522_ReaderPool *pool, uint8_t readerId, uint32_t *scans, uint32_t *cards, uint32_t *errors, uint32_t *scanIntervalUs);
+
+#endif // MFRC522_ReaderPool_h
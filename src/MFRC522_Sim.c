@@ -0,0 +1,1224 @@
+/*
+* MFRC522_Sim.c - register level model of an MFRC522 with virtual ISO/IEC 14443A PICCs.
+* See MFRC522_Sim.h for what is modelled. Compiled only with MFRC_INCLUDE_SIMULATOR=1.
+*/
+
+#include <string.h>
+
+#include "MFRC522_Sim.h"
+
+#if MFRC_INCLUDE_SIMULATOR == 1
+
+// PICC states (ISO/IEC 14443-3 figure 7, plus the ISO/IEC 14443-4 protocol state)
+enum {
+	SIM_PICC_IDLE		= 0,
+	SIM_PICC_READY		= 1,
+	SIM_PICC_ACTIVE		= 2,
+	SIM_PICC_HALT		= 3,
+	SIM_PICC_PROTOCOL	= 4		// after RATS
+};
+
+#define SIM_FDT_US			86		// frame delay time PCD->PICC at 106 kbit/s, ~1172/fc
+#define SIM_AUTH_US			1500	// three pass authentication on the air
+#define SIM_NO_RESPONSE		0xFFFF
+
+// A frame received by, or sent from, a PICC. Bits are LSB first; bit n is in data[n / 8].
+typedef struct {
+	uint8_t data[300];
+	uint16_t bits;
+} SimFrame;
+
+static const uint8_t sim_reset_values[0x40] = {
+	[CommandReg] = 0x20, [ComIEnReg] = 0x80, [ComIrqReg] = 0x14, [Status1Reg] = 0x21, [WaterLevelReg] = 0x08,
+	[ControlReg] = 0x10, [CollReg] = 0xA0, [ModeReg] = 0x3F, [TxControlReg] = 0x80, [TxSelReg] = 0x10,
+	[RxSelReg] = 0x84, [RxThresholdReg] = 0x84, [DemodReg] = 0x4D, [MfTxReg] = 0x62, [SerialSpeedReg] = 0xEB,
+	[CRCResultRegH] = 0xFF, [CRCResultRegL] = 0xFF, [ModWidthReg] = 0x26, [RFCfgReg] = 0x48, [GsNReg] = 0x88,
+	[CWGsPReg] = 0x20, [ModGsPReg] = 0x20, [VersionReg] = 0x92
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Small helpers
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool sim_field_on(const MFRC522_Sim *sim) {
+	return (sim->_regs[TxControlReg] & 0x03) && !(sim->_regs[CommandReg] & 0x10);
+}
+
+static uint8_t sim_command(const MFRC522_Sim *sim) {
+	return sim->_regs[CommandReg] & 0x0F;
+}
+
+// air time of one byte (8 data bits + parity) at the rate programmed in TxModeReg/RxModeReg [6:4]
+static int64_t sim_byte_us(const uint8_t modeReg) {
+	return (9 * 128 * 1000 / 13560) >> ((modeReg >> 4) & 0x03);	// 84us at 106 kbit/s
+}
+
+static uint32_t sim_timer_period_us(const MFRC522_Sim *sim) {
+	const uint32_t prescaler = ((sim->_regs[TModeReg] & 0x0F) << 8) | sim->_regs[TPrescalerReg];
+	const uint32_t reload = (sim->_regs[TReloadRegH] << 8) | sim->_regs[TReloadRegL];
+	return (uint32_t)(((uint64_t)(reload + 1) * (2 * prescaler + 1) * 100) / 1356);
+}
+
+static void sim_start_timer(MFRC522_Sim *sim, const int64_t atUs) {
+	sim->_timerRunning = true;
+	sim->_timerExpiryUs = atUs + sim_timer_period_us(sim);
+}
+
+static void sim_set_com_irq(MFRC522_Sim *sim, const uint8_t bits) {
+	sim->_regs[ComIrqReg] |= bits;
+}
+
+static void sim_update_alerts(MFRC522_Sim *sim) {
+	const uint8_t waterLevel = sim->_regs[WaterLevelReg] & 0x3F;
+	uint8_t alerts = 0;
+	if (sim->_fifoLen <= waterLevel)
+		alerts |= 0x01;						// LoAlert
+	if (64 - sim->_fifoLen <= waterLevel)
+		alerts |= 0x02;						// HiAlert
+	// the IRQ bits store the rising edge of the status bits
+	if ((alerts & 0x01) && !(sim->_status1Alerts & 0x01))
+		sim_set_com_irq(sim, 0x04);
+	if ((alerts & 0x02) && !(sim->_status1Alerts & 0x02))
+		sim_set_com_irq(sim, 0x08);
+	sim->_status1Alerts = alerts;
+}
+
+static bool sim_fifo_push(MFRC522_Sim *sim, const uint8_t value) {
+	if (sim->_fifoLen >= sizeof(sim->_fifo)) {
+		sim->_regs[ErrorReg] |= 0x10;		// BufferOvfl
+		sim_set_com_irq(sim, 0x02);			// ErrIRq
+		return false;
+	}
+	sim->_fifo[sim->_fifoLen++] = value;
+	sim_update_alerts(sim);
+	return true;
+}
+
+static uint8_t sim_fifo_pop(MFRC522_Sim *sim) {
+	if (sim->_fifoLen == 0)
+		return 0;
+	const uint8_t value = sim->_fifo[0];
+	memmove(sim->_fifo, sim->_fifo + 1, --sim->_fifoLen);
+	sim_update_alerts(sim);
+	return value;
+}
+
+static uint16_t sim_crc_preset(const MFRC522_Sim *sim) {
+	static const uint16_t presets[4] = {0x0000, 0x6363, 0xA671, 0xFFFF};
+	return presets[sim->_regs[ModeReg] & 0x03];
+}
+
+static bool sim_get_bit(const uint8_t *data, const uint16_t bit) {
+	return (data[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void sim_put_bit(uint8_t *data, const uint16_t bit, const bool value) {
+	if (value)
+		data[bit / 8] |= 1 << (bit % 8);
+	else
+		data[bit / 8] &= ~(1 << (bit % 8));
+}
+
+static void sim_frame_bytes(SimFrame *frame, const uint8_t *data, const uint16_t length) {
+	memcpy(frame->data, data, length);
+	frame->bits = length * 8;
+}
+
+static void sim_frame_bytes_crc(SimFrame *frame, const uint8_t *data, const uint16_t length) {
+	memcpy(frame->data, data, length);
+	CRC_A_Calculate(data, length, &frame->data[length]);
+	frame->bits = (length + 2) * 8;
+}
+
+static void sim_frame_nibble(SimFrame *frame, const uint8_t value) {
+	frame->data[0] = value & 0x0F;
+	frame->bits = 4;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Virtual PICCs
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool sim_is_classic(const MFRC522_SimCard *card) {
+	return card->type <= SIM_CARD_MIFARE_4K;
+}
+
+static uint16_t sim_classic_blocks(const MFRC522_SimCard *card) {
+	switch (card->type) {
+		case SIM_CARD_MIFARE_MINI:	return 20;
+		case SIM_CARD_MIFARE_1K:	return 64;
+		default:					return 256;
+	}
+}
+
+static uint8_t sim_classic_sector(const uint8_t block) {
+	return block < 128 ? block / 4 : 32 + (block - 128) / 16;
+}
+
+static uint8_t sim_classic_trailer(const uint8_t sector) {
+	return sector < 32 ? sector * 4 + 3 : 128 + (sector - 32) * 16 + 15;
+}
+
+static uint16_t sim_pages(const MFRC522_SimCard *card) {
+	return card->memorySize / 4;
+}
+
+// the 5 bytes (4 UID/CT bytes + BCC) a PICC answers at a cascade level
+static void sim_level_bytes(const MFRC522_SimCard *card, const uint8_t level, uint8_t *out) {
+	const uint8_t cascades = card->uidSize == 4 ? 1 : (card->uidSize == 7 ? 2 : 3);
+	const uint8_t uidIndex = (level - 1) * 3;
+	if (level < cascades) {
+		out[0] = PICC_CMD_CT;
+		memcpy(&out[1], &card->uid[uidIndex], 3);
+	}
+	else {
+		memcpy(out, &card->uid[uidIndex], 4);
+	}
+	out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+}
+
+static uint8_t sim_cascade_levels(const MFRC522_SimCard *card) {
+	return card->uidSize == 4 ? 1 : (card->uidSize == 7 ? 2 : 3);
+}
+
+static void sim_card_reset(MFRC522_SimCard *card) {
+	card->_state = SIM_PICC_IDLE;
+	card->_level = 1;
+	card->_authSector = -1;
+	card->_pendingCmd = 0;
+	card->_transferValid = false;
+	card->_rateIn = card->_rateOut = 0;
+	card->_wtxLeft = 0;
+	card->_apduLen = 0;
+	card->_responseLen = 0;
+	card->_responseSent = 0;
+	card->_lastBlockLen = 0;
+}
+
+// PICC sends a T=CL block: pcb [cid] info, CRC_A appended
+static void sim_tcl_send(MFRC522_SimCard *card, SimFrame *out, const uint8_t pcb, const uint8_t *info, const uint16_t infoLen) {
+	uint8_t block[260];
+	uint16_t length = 0;
+	block[length++] = pcb | (card->_cidFollows ? 0x08 : 0x00);
+	if (card->_cidFollows)
+		block[length++] = card->_cid;
+	if (infoLen) {					// R- and S-blocks without INF field come with info NULL
+		memcpy(&block[length], info, infoLen);
+		length += infoLen;
+	}
+	memcpy(card->_lastBlock, block, length);
+	card->_lastBlockLen = length;
+	sim_frame_bytes_crc(out, block, length);
+}
+
+static uint16_t sim_default_apdu(const uint8_t *apdu, const uint16_t apduLen, uint8_t *response, const uint16_t responseSize) {
+	uint16_t length = 0;
+	if (apduLen == 5 && apdu[0] == 0x00 && apdu[1] == 0xB0) {		// READ BINARY
+		const uint16_t offset = (apdu[2] << 8) | apdu[3];
+		const uint16_t le = apdu[4] ? apdu[4] : 256;
+		for (; length < le && length + 2 < responseSize; length++)
+			response[length] = (uint8_t)(offset + length);
+	}
+	else {
+		length = apduLen + 2 <= responseSize ? apduLen : responseSize - 2;
+		memcpy(response, apdu, length);
+	}
+	response[length++] = 0x90;
+	response[length++] = 0x00;
+	return length;
+}
+
+static void sim_tcl_send_response_chunk(MFRC522_SimCard *card, SimFrame *out) {
+	const uint16_t overhead = 1 + (card->_cidFollows ? 1 : 0) + 2;
+	const uint16_t maxInfo = card->_fsd - overhead;
+	const uint16_t remaining = card->_responseLen - card->_responseSent;
+	const uint16_t chunk = remaining > maxInfo ? maxInfo : remaining;
+	const uint8_t pcb = 0x02 | card->_blockNumber | (remaining > maxInfo ? 0x10 : 0x00);
+	sim_tcl_send(card, out, pcb, &card->_response[card->_responseSent], chunk);
+	card->_responseSent += chunk;
+	if (card->_responseSent >= card->_responseLen)
+		card->_responseLen = card->_responseSent = 0;
+}
+
+static void sim_tcl_response_or_wtx(MFRC522_SimCard *card, SimFrame *out) {
+	if (card->_wtxLeft) {
+		card->_wtxLeft--;
+		const uint8_t wtxm = 1;
+		sim_tcl_send(card, out, 0xF2, &wtxm, 1);		// S(WTX)
+		return;
+	}
+	sim_tcl_send_response_chunk(card, out);
+}
+
+// ISO/IEC 14443-4 block handling of a PICC in state PROTOCOL. in is the frame without CRC_A.
+static void sim_tcl_receive(MFRC522_SimCard *card, const uint8_t *in, uint16_t length, SimFrame *out) {
+	if ((in[0] & 0xF0) == 0xD0 && card->_apduLen == 0 && card->_lastBlockLen == 0) {
+		// PPS: PPSS(CID in the low nibble) PPS0 [PPS1], only right after the ATS
+		if ((in[0] & 0x0F) != card->_cid)
+			return;
+		uint8_t dsi = 0, dri = 0;
+		if (length > 2 && (in[1] & 0x10)) {
+			dsi = (in[2] >> 2) & 0x03;
+			dri = in[2] & 0x03;
+		}
+		const uint8_t ppss = in[0];
+		sim_frame_bytes_crc(out, &ppss, 1);
+		card->_rateIn = dri;					// the PPS response still goes out at the old rate, see sim_process_frame()
+		card->_rateOut = dsi;
+		return;
+	}
+
+	const uint8_t pcb = in[0];
+	uint16_t index = 1;
+	if (pcb & 0x08) {
+		if (length < 2 || in[1] != card->_cid)
+			return;								// not for us
+		index++;
+	}
+	else if (card->_cid != 0) {
+		return;									// we have a CID, the PCD must address us with it
+	}
+	card->_cidFollows = pcb & 0x08;				// answer in the same format
+
+	if ((pcb & 0xE2) == 0x02) {					// I-block
+		card->_blockNumber ^= 1;				// rule D
+		if ((size_t)card->_apduLen + (length - index) > sizeof(card->_apdu))
+			return;
+		memcpy(&card->_apdu[card->_apduLen], &in[index], length - index);
+		card->_apduLen += length - index;
+		if (pcb & 0x10) {						// chaining: acknowledge and wait for the rest
+			sim_tcl_send(card, out, 0xA2 | card->_blockNumber, NULL, 0);
+			return;
+		}
+		card->_responseLen = card->apduHandler
+				? card->apduHandler(card, card->_apdu, card->_apduLen, card->_response, sizeof(card->_response))
+				: sim_default_apdu(card->_apdu, card->_apduLen, card->_response, sizeof(card->_response));
+		card->_responseSent = 0;
+		card->_apduLen = 0;
+		card->_wtxLeft = card->wtxRequests;
+		sim_tcl_response_or_wtx(card, out);
+		return;
+	}
+
+	if ((pcb & 0xE6) == 0xA2) {					// R-block
+		const bool nak = pcb & 0x10;
+		if ((pcb & 0x01) == card->_blockNumber) {	// rule 11: re-transmit the last block
+			if (card->_lastBlockLen)
+				sim_frame_bytes_crc(out, card->_lastBlock, card->_lastBlockLen);
+			return;
+		}
+		if (nak) {								// rule 12
+			sim_tcl_send(card, out, 0xA2 | card->_blockNumber, NULL, 0);
+			return;
+		}
+		card->_blockNumber ^= 1;				// rule E
+		if (card->_responseLen)					// next block of a chained response
+			sim_tcl_send_response_chunk(card, out);
+		return;
+	}
+
+	if ((pcb & 0xC7) == 0xC2) {					// S-block
+		if ((pcb & 0x30) == 0x00) {				// DESELECT
+			sim_tcl_send(card, out, 0xC2, NULL, 0);
+			card->_state = SIM_PICC_HALT;
+			card->_rateIn = card->_rateOut = 0;
+			return;
+		}
+		if ((pcb & 0x30) == 0x30 && card->_responseLen) {	// WTX response
+			sim_tcl_response_or_wtx(card, out);
+		}
+	}
+}
+
+static bool sim_classic_value_block(const uint8_t *block, int32_t *value) {
+	int32_t v, inv, v2;
+	memcpy(&v, &block[0], 4);
+	memcpy(&inv, &block[4], 4);
+	memcpy(&v2, &block[8], 4);
+	if (v != v2 || v != ~inv || block[12] != block[14] || block[13] != block[15] || (block[12] ^ block[13]) != 0xFF)
+		return false;
+	*value = v;
+	return true;
+}
+
+// MIFARE Classic commands of an ACTIVE PICC. in is the frame without CRC_A.
+static void sim_classic_receive(MFRC522_SimCard *card, const uint8_t *in, const uint16_t length, SimFrame *out) {
+	const uint16_t blocks = sim_classic_blocks(card);
+
+	if (card->_pendingCmd) {					// second step of WRITE / INCREMENT / DECREMENT / RESTORE
+		const uint8_t command = card->_pendingCmd;
+		const uint8_t addr = card->_pendingAddr;
+		card->_pendingCmd = 0;
+		if (command == PICC_CMD_MF_WRITE) {
+			if (length != 16) {
+				sim_frame_nibble(out, 0x5);
+				return;
+			}
+			memcpy(&card->memory[addr * 16], in, 16);
+			sim_frame_nibble(out, MF_ACK);
+			return;
+		}
+		if (length != 4) {
+			sim_frame_nibble(out, 0x5);
+			return;
+		}
+		int32_t value, delta;
+		if (!sim_classic_value_block(&card->memory[addr * 16], &value)) {
+			sim_frame_nibble(out, 0x4);
+			return;
+		}
+		memcpy(&delta, in, 4);
+		if (command == PICC_CMD_MF_INCREMENT)
+			value += delta;
+		else if (command == PICC_CMD_MF_DECREMENT)
+			value -= delta;
+		card->_transferValue = value;
+		card->_transferValid = true;
+		return;									// no answer to the second step
+	}
+
+	if (length != 2) {
+		card->_state = SIM_PICC_IDLE;
+		return;
+	}
+	const uint8_t command = in[0];
+	const uint8_t addr = in[1];
+	if (addr >= blocks || card->_authSector != sim_classic_sector(addr)) {
+		sim_frame_nibble(out, 0x4);
+		return;
+	}
+
+	switch (command) {
+		case PICC_CMD_MF_READ: {
+			uint8_t block[16];
+			memcpy(block, &card->memory[addr * 16], 16);
+			if (addr == sim_classic_trailer(sim_classic_sector(addr)))
+				memset(block, 0, MF_KEY_SIZE);	// Key A is never readable
+			sim_frame_bytes_crc(out, block, 16);
+			return;
+		}
+		case PICC_CMD_MF_WRITE:
+			if (addr == 0) {					// manufacturer block
+				sim_frame_nibble(out, 0x4);
+				return;
+			}
+			// fall through
+		case PICC_CMD_MF_INCREMENT:
+		case PICC_CMD_MF_DECREMENT:
+		case PICC_CMD_MF_RESTORE:
+			card->_pendingCmd = command;
+			card->_pendingAddr = addr;
+			sim_frame_nibble(out, MF_ACK);
+			return;
+		case PICC_CMD_MF_TRANSFER:
+			if (!card->_transferValid || addr == 0) {
+				sim_frame_nibble(out, 0x4);
+				return;
+			}
+			uint8_t *block = &card->memory[addr * 16];
+			const int32_t value = card->_transferValue;
+			const int32_t inverted = ~value;
+			memcpy(&block[0], &value, 4);
+			memcpy(&block[4], &inverted, 4);
+			memcpy(&block[8], &value, 4);
+			block[12] = block[14] = addr;
+			block[13] = block[15] = ~addr;
+			card->_transferValid = false;
+			sim_frame_nibble(out, MF_ACK);
+			return;
+		default:
+			card->_state = SIM_PICC_IDLE;
+			return;
+	}
+}
+
+// MIFARE Ultralight / NTAG commands of an ACTIVE PICC. in is the frame without CRC_A.
+static void sim_ultralight_receive(MFRC522_SimCard *card, const uint8_t *in, const uint16_t length, SimFrame *out) {
+	const uint16_t pages = sim_pages(card);
+	const bool ntag = card->type != SIM_CARD_ULTRALIGHT;
+
+	if (card->_pendingCmd) {					// second step of COMPATIBILITY WRITE
+		card->_pendingCmd = 0;
+		if (length != 16) {
+			sim_frame_nibble(out, 0x0);
+			return;
+		}
+		memcpy(&card->memory[card->_pendingAddr * 4], in, 4);
+		sim_frame_nibble(out, MF_ACK);
+		return;
+	}
+
+	switch (in[0]) {
+		case PICC_CMD_MF_READ: {
+			if (length != 2 || in[1] >= pages) {
+				sim_frame_nibble(out, 0x0);
+				return;
+			}
+			uint8_t data[16];
+			for (uint8_t i = 0; i < 16; i++)
+				data[i] = card->memory[((in[1] * 4) + i) % card->memorySize];
+			sim_frame_bytes_crc(out, data, 16);
+			return;
+		}
+		case 0x3A: {							// FAST_READ
+			if (!ntag) {
+				card->_state = SIM_PICC_IDLE;
+				return;
+			}
+			if (length != 3 || in[1] > in[2] || in[2] >= pages) {
+				sim_frame_nibble(out, 0x0);
+				return;
+			}
+			sim_frame_bytes_crc(out, &card->memory[in[1] * 4], (in[2] - in[1] + 1) * 4);
+			return;
+		}
+		case 0x60: {							// GET_VERSION
+			if (!ntag || length != 1) {
+				card->_state = SIM_PICC_IDLE;
+				return;
+			}
+			const uint8_t storageSize = card->type == SIM_CARD_NTAG213 ? 0x0F : (card->type == SIM_CARD_NTAG215 ? 0x11 : 0x13);
+			const uint8_t version[8] = {0x00, 0x04, 0x04, 0x02, 0x01, 0x00, storageSize, 0x03};
+			sim_frame_bytes_crc(out, version, sizeof(version));
+			return;
+		}
+		case PICC_CMD_UL_WRITE:
+			if (length != 6 || in[1] < 2 || in[1] >= pages) {
+				sim_frame_nibble(out, 0x0);
+				return;
+			}
+			if (in[1] < 4) {					// lock bytes and OTP can only be set
+				for (uint8_t i = 0; i < 4; i++)
+					card->memory[in[1] * 4 + i] |= in[2 + i];
+			}
+			else {
+				memcpy(&card->memory[in[1] * 4], &in[2], 4);
+			}
+			sim_frame_nibble(out, MF_ACK);
+			return;
+		case PICC_CMD_MF_WRITE:
+			if (length != 2 || in[1] < 4 || in[1] >= pages) {
+				sim_frame_nibble(out, 0x0);
+				return;
+			}
+			card->_pendingCmd = PICC_CMD_MF_WRITE;
+			card->_pendingAddr = in[1];
+			sim_frame_nibble(out, MF_ACK);
+			return;
+		default:
+			card->_state = SIM_PICC_IDLE;
+			return;
+	}
+}
+
+// One PICC receives a frame from the PCD. Fills out with the response, bits == 0 => silence.
+static void sim_card_receive(MFRC522_Sim *sim, MFRC522_SimCard *card, const SimFrame *in, SimFrame *out) {
+	const bool crypto = sim->_regs[Status2Reg] & 0x08;
+	const bool authenticated = card->_authSector >= 0;
+	out->bits = 0;
+
+	// Crypto1 is not simulated on the air, but its effect is: encrypted frames are noise to a PICC that is
+	// not authenticated, and plain frames are noise to an authenticated one.
+	if (sim_is_classic(card) && card->_state == SIM_PICC_ACTIVE && crypto != authenticated) {
+		card->_state = SIM_PICC_IDLE;
+		card->_authSector = -1;
+		return;
+	}
+	if (crypto && !authenticated)
+		return;
+
+	// short frames: REQA / WUPA
+	if (in->bits == 7) {
+		const uint8_t command = in->data[0] & 0x7F;
+		const bool wakeable = card->_state == SIM_PICC_IDLE || (command == PICC_CMD_WUPA && card->_state == SIM_PICC_HALT);
+		if (command != PICC_CMD_REQA && command != PICC_CMD_WUPA)
+			return;
+		if (!wakeable) {
+			if (card->_state != SIM_PICC_HALT)
+				sim_card_reset(card);			// READY/ACTIVE PICCs drop back to IDLE without answering
+			return;
+		}
+		sim_card_reset(card);
+		card->_state = SIM_PICC_READY;
+		sim_frame_bytes(out, card->atqa, 2);
+		return;
+	}
+	if (in->bits < 16)
+		return;
+
+	if (card->_state == SIM_PICC_READY) {
+		const uint8_t sel = PICC_CMD_SEL_CL1 + 2 * (card->_level - 1);
+		uint8_t levelBytes[5];
+		sim_level_bytes(card, card->_level, levelBytes);
+		if (in->data[0] != sel) {
+			card->_state = SIM_PICC_IDLE;
+			return;
+		}
+		const uint8_t nvb = in->data[1];
+		if (nvb == 0x70) {						// SELECT
+			if (in->bits != 9 * 8 || !CRC_A_Check(in->data, 9) || memcmp(&in->data[2], levelBytes, 5) != 0) {
+				card->_state = SIM_PICC_IDLE;
+				return;
+			}
+			uint8_t sak = card->sak;
+			if (card->_level < sim_cascade_levels(card)) {
+				sak = 0x04;						// cascade bit, UID not complete
+				card->_level++;
+			}
+			else {
+				card->_state = SIM_PICC_ACTIVE;
+			}
+			sim_frame_bytes_crc(out, &sak, 1);
+			return;
+		}
+		// ANTICOLLISION: answer the UID bits after the ones the PCD already knows
+		const uint16_t knownBits = ((nvb >> 4) - 2) * 8 + (nvb & 0x07);
+		if (knownBits >= 40 || in->bits != 16 + knownBits)
+			return;
+		for (uint16_t i = 0; i < knownBits; i++) {
+			if (sim_get_bit(levelBytes, i) != sim_get_bit(in->data, 16 + i))
+				return;							// not our UID
+		}
+		memset(out->data, 0, sizeof(out->data));
+		for (uint16_t i = knownBits; i < 40; i++)
+			sim_put_bit(out->data, i - knownBits, sim_get_bit(levelBytes, i));
+		out->bits = 40 - knownBits;
+		return;
+	}
+
+	if (card->_state != SIM_PICC_ACTIVE && card->_state != SIM_PICC_PROTOCOL)
+		return;
+
+	// everything from here on carries a CRC_A
+	if (in->bits % 8 || in->bits < 24 || !CRC_A_Check(in->data, in->bits / 8))
+		return;
+	const uint8_t *cmd = in->data;
+	const uint16_t length = in->bits / 8 - 2;
+
+	if (card->_state == SIM_PICC_PROTOCOL) {
+		sim_tcl_receive(card, cmd, length, out);
+		return;
+	}
+
+	if (length == 2 && cmd[0] == PICC_CMD_HLTA && cmd[1] == 0x00) {
+		card->_state = SIM_PICC_HALT;
+		card->_authSector = -1;
+		card->_level = 1;
+		return;
+	}
+
+	switch (card->type) {
+		case SIM_CARD_MIFARE_MINI:
+		case SIM_CARD_MIFARE_1K:
+		case SIM_CARD_MIFARE_4K:
+			sim_classic_receive(card, cmd, length, out);
+			break;
+		case SIM_CARD_ISO14443_4:
+			if (length == 2 && cmd[0] == 0xE0) {	// RATS
+				static const uint16_t fsdTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+				const uint8_t fsdi = cmd[1] >> 4;
+				card->_fsd = fsdTable[fsdi > 8 ? 8 : fsdi];
+				card->_cid = cmd[1] & 0x0F;
+				card->_blockNumber = 1;			// rule C
+				// TL T0(FSCI=7, TA TB TC present) TA(212/424/848 both ways) TB(FWI=8, SFGI=1) TC(CID) historical
+				static const uint8_t ats[6] = {0x06, 0x77, 0x77, 0x81, 0x02, 0x80};
+				sim_frame_bytes_crc(out, ats, sizeof(ats));
+				card->_state = SIM_PICC_PROTOCOL;
+				card->_lastBlockLen = 0;
+			}
+			else {
+				card->_state = SIM_PICC_IDLE;
+			}
+			break;
+		default:
+			sim_ultralight_receive(card, cmd, length, out);
+			break;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// RF front end
+/////////////////////////////////////////////////////////////////////////////////////
+
+// The PCD finished transmitting txBuf at endUs. Let the PICCs answer and set up the reception.
+static void sim_process_frame(MFRC522_Sim *sim, const int64_t endUs) {
+	SimFrame in;
+	const uint8_t txRate = (sim->_regs[TxModeReg] >> 4) & 0x03;
+	const uint8_t rxRate = (sim->_regs[RxModeReg] >> 4) & 0x03;
+
+	memcpy(in.data, sim->_txBuf, sim->_txLen);
+	in.bits = sim->_txLen * 8;
+	if (sim->_txLastBits && sim->_txLen)
+		in.bits -= 8 - sim->_txLastBits;
+	if ((sim->_regs[TxModeReg] & 0x80) && in.bits % 8 == 0) {	// TxCRCEn
+		CRC_A_Calculate(in.data, in.bits / 8, &in.data[in.bits / 8]);
+		in.bits += 16;
+	}
+	sim->rfFrames++;
+	const bool lost = sim->lostFrame && --sim->lostFrame == 0;
+
+	// collect the answers
+	SimFrame answer;
+	uint8_t combined[300] = {0};
+	uint16_t combinedBits = 0;
+	int32_t collision = -1;
+	uint8_t responders = 0;
+	uint32_t delayUs = 0;
+	for (uint8_t c = 0; c < sim->cardCount; c++) {
+		MFRC522_SimCard *card = &sim->cards[c];
+		if (!card->inField || lost)
+			continue;
+		if (card->_rateIn != txRate) {
+			continue;							// cannot demodulate the frame
+		}
+		const uint8_t rateBefore = card->_rateOut;
+		sim_card_receive(sim, card, &in, &answer);
+		if (answer.bits == 0 || rateBefore != rxRate)
+			continue;
+		if (card->responseDelayUs > delayUs)
+			delayUs = card->responseDelayUs;
+		if (responders++ == 0) {
+			memcpy(combined, answer.data, (answer.bits + 7) / 8);
+			combinedBits = answer.bits;
+			continue;
+		}
+		const uint16_t common = answer.bits < combinedBits ? answer.bits : combinedBits;
+		for (uint16_t i = 0; i < common && (collision < 0 || i < collision); i++) {
+			if (sim_get_bit(combined, i) != sim_get_bit(answer.data, i)) {
+				collision = i;
+				break;
+			}
+		}
+		if (answer.bits != combinedBits && (collision < 0 || collision > common))
+			collision = common;
+		if (answer.bits > combinedBits) {
+			for (uint16_t i = combinedBits; i < answer.bits; i++)
+				sim_put_bit(combined, i, sim_get_bit(answer.data, i));
+			combinedBits = answer.bits;
+		}
+	}
+
+	if (sim_command(sim) == PCD_Transmit) {
+		sim->_regs[CommandReg] &= ~0x0F;
+		sim_set_com_irq(sim, 0x10);				// IdleIRq
+		return;
+	}
+
+	if (sim->_regs[TModeReg] & 0x80)			// TAuto
+		sim_start_timer(sim, endUs);
+	if (responders == 0)
+		return;
+
+	// place the bits at RxAlign, clear everything after a collision (ValuesAfterColl=0)
+	const uint8_t rxAlign = (sim->_regs[BitFramingReg] >> 4) & 0x07;
+	memset(sim->_rxBuf, 0, sizeof(sim->_rxBuf));
+	for (uint16_t i = 0; i < combinedBits; i++) {
+		bool bit = sim_get_bit(combined, i);
+		if (collision >= 0 && i >= collision && !(sim->_regs[CollReg] & 0x80))
+			bit = false;
+		sim_put_bit(sim->_rxBuf, rxAlign + i, bit);
+	}
+	const uint16_t streamBits = rxAlign + combinedBits;
+	sim->_rxLen = (streamBits + 7) / 8;
+	sim->_rxLastBits = streamBits % 8;
+	sim->_rxDelivered = 0;
+	sim->_rxError = 0;
+	sim->_rxCollPos = 0;
+	if (collision >= 0) {
+		const uint16_t position = rxAlign + collision + 1;		// counted from bit 0 of the first FIFO byte
+		sim->_rxError |= 0x08;					// CollErr
+		sim->_rxCollPos = position > 32 ? 0x20 : (position & 0x1F);
+	}
+	if (sim->_regs[RxModeReg] & 0x80) {			// RxCRCEn: check and strip the CRC_A
+		if (sim->_rxLastBits || rxAlign || sim->_rxLen < 3 || !CRC_A_Check(sim->_rxBuf, sim->_rxLen))
+			sim->_rxError |= 0x04;				// CRCErr
+		else
+			sim->_rxLen -= 2;
+	}
+	sim->_rxActive = true;
+	sim->_rxStartUs = endUs + (SIM_FDT_US >> rxRate) + delayUs;
+}
+
+// Brings the model up to nowUs: moves bytes between FIFO and air, fires the timer, finishes MFAuthent.
+#define SIM_WAKE_US 200						// soft power-down to ready
+
+static void sim_run(MFRC522_Sim *sim, const int64_t nowUs) {
+	const int64_t elapsed = nowUs - sim->_lastUs;
+	if (elapsed > 0) {
+		if (sim->_regs[CommandReg] & 0x10)
+			sim->powerDownUs += elapsed;
+		else if (sim_field_on(sim))
+			sim->fieldOnUs += elapsed;
+	}
+	sim->_lastUs = nowUs;
+	if (sim->_wakeReadyUs && nowUs >= sim->_wakeReadyUs) {
+		sim->_regs[CommandReg] &= ~0x10;		// oscillator running: PowerDown reads 0, the field comes back
+		sim->_wakeReadyUs = 0;
+	}
+
+	while (true) {
+		int64_t next = INT64_MAX;
+		uint8_t event = 0;
+		const int64_t txByteUs = sim_byte_us(sim->_regs[TxModeReg]);
+		const int64_t rxByteUs = sim_byte_us(sim->_regs[RxModeReg]);
+		if (sim->_txActive && sim->_txStartUs + sim->_txLen * txByteUs < next) {
+			next = sim->_txStartUs + sim->_txLen * txByteUs;
+			event = 1;
+		}
+		if (sim->_rxActive && sim->_rxStartUs + (sim->_rxDelivered + 1) * rxByteUs < next) {
+			next = sim->_rxStartUs + (sim->_rxDelivered + 1) * rxByteUs;
+			event = 2;
+		}
+		if (sim->_timerRunning && sim->_timerExpiryUs < next) {
+			next = sim->_timerExpiryUs;
+			event = 3;
+		}
+		if (sim->_authPending && sim->_authDoneUs < next) {
+			next = sim->_authDoneUs;
+			event = 4;
+		}
+		if (event == 0 || next > nowUs)
+			return;
+
+		switch (event) {
+			case 1:								// transmitter: next byte due
+				if (sim->_fifoLen == 0) {		// FIFO ran dry: end of frame
+					sim->_txActive = false;
+					int64_t endUs = next;
+					if ((sim->_regs[TxModeReg] & 0x80) && sim->_txLastBits == 0)
+						endUs += 2 * txByteUs;
+					sim_set_com_irq(sim, 0x40);	// TxIRq
+					if (sim_field_on(sim))
+						sim_process_frame(sim, endUs);
+					else if (sim->_regs[TModeReg] & 0x80)
+						sim_start_timer(sim, endUs);
+				}
+				else if (sim->_txLen < sizeof(sim->_txBuf)) {
+					sim->_txBuf[sim->_txLen++] = sim_fifo_pop(sim);
+				}
+				else {
+					sim->_txActive = false;
+				}
+				break;
+			case 2:								// receiver: next byte arrived
+				if (sim->_rxDelivered == 0)
+					sim->_timerRunning = false;	// TAuto: the timer stops when the reception starts
+				sim_fifo_push(sim, sim->_rxBuf[sim->_rxDelivered++]);
+				if (sim->_rxDelivered >= sim->_rxLen) {
+					sim->_rxActive = false;
+					sim->_regs[ErrorReg] |= sim->_rxError;
+					sim->_regs[ControlReg] = (sim->_regs[ControlReg] & ~0x07) | sim->_rxLastBits;
+					sim->_regs[CollReg] = (sim->_regs[CollReg] & 0x80) | (sim->_rxError & 0x08 ? sim->_rxCollPos : 0x20);
+					sim_set_com_irq(sim, 0x20 | (sim->_rxError ? 0x02 : 0x00));	// RxIRq (+ ErrIRq)
+				}
+				break;
+			case 3:								// timer underflow
+				sim_set_com_irq(sim, 0x01);		// TimerIRq
+				if (sim->_regs[TModeReg] & 0x10)	// TAutoRestart
+					sim->_timerExpiryUs += sim_timer_period_us(sim);
+				else
+					sim->_timerRunning = false;
+				break;
+			case 4:								// MFAuthent done
+				sim->_authPending = false;
+				if (sim->_authOk) {
+					sim->_regs[Status2Reg] |= 0x08;	// MFCrypto1On
+					sim->_regs[CommandReg] &= ~0x0F;
+					sim_set_com_irq(sim, 0x10);	// IdleIRq
+				}
+				else if (sim->_regs[TModeReg] & 0x80) {
+					sim_start_timer(sim, next);	// no answer from the PICC, the timer runs out
+				}
+				break;
+		}
+	}
+}
+
+static void sim_soft_reset(MFRC522_Sim *sim) {
+	memcpy(sim->_regs, sim_reset_values, sizeof(sim->_regs));
+	sim->_fifoLen = 0;
+	sim->_status1Alerts = 0;
+	sim->_txActive = sim->_rxActive = sim->_timerRunning = sim->_authPending = false;
+	sim_update_alerts(sim);
+	for (uint8_t c = 0; c < sim->cardCount; c++)
+		sim_card_reset(&sim->cards[c]);			// the antenna goes off
+}
+
+static void sim_mf_authent(MFRC522_Sim *sim) {
+	uint8_t frame[12];
+	const uint8_t length = sim->_fifoLen < 12 ? sim->_fifoLen : 12;
+	for (uint8_t i = 0; i < length; i++)
+		frame[i] = sim_fifo_pop(sim);
+
+	sim->_authPending = true;
+	sim->_authOk = false;
+	sim->_authDoneUs = sim->nowUs + SIM_AUTH_US;
+	if (length != 12 || !sim_field_on(sim) || (frame[0] != PICC_CMD_MF_AUTH_KEY_A && frame[0] != PICC_CMD_MF_AUTH_KEY_B))
+		return;
+
+	for (uint8_t c = 0; c < sim->cardCount; c++) {
+		MFRC522_SimCard *card = &sim->cards[c];
+		if (!card->inField || card->_state != SIM_PICC_ACTIVE || !sim_is_classic(card))
+			continue;
+		if (frame[1] >= sim_classic_blocks(card) || memcmp(&frame[8], &card->uid[card->uidSize - 4], 4) != 0) {
+			card->_state = SIM_PICC_IDLE;
+			continue;
+		}
+		const uint8_t sector = sim_classic_sector(frame[1]);
+		const uint8_t *trailer = &card->memory[sim_classic_trailer(sector) * 16];
+		const uint8_t *key = frame[0] == PICC_CMD_MF_AUTH_KEY_A ? &trailer[0] : &trailer[10];
+		if (memcmp(&frame[2], key, MF_KEY_SIZE) != 0) {
+			card->_state = SIM_PICC_IDLE;		// failed authentication: the PICC stops talking to us
+			card->_authSector = -1;
+			continue;
+		}
+		card->_authSector = sector;
+		sim->_authOk = true;
+	}
+}
+
+static void sim_start_command(MFRC522_Sim *sim, const uint8_t command) {
+	switch (command) {
+		case PCD_Idle:
+			sim->_txActive = sim->_rxActive = sim->_authPending = false;
+			break;
+		case PCD_Mem:
+		case PCD_GenerateRandomID:
+			sim->_fifoLen = 0;
+			sim->_regs[CommandReg] &= ~0x0F;
+			sim_set_com_irq(sim, 0x10);
+			break;
+		case PCD_CalcCRC:
+			sim->_crc = sim_crc_preset(sim);
+			break;
+		case PCD_Transmit:
+			sim->_txActive = true;
+			sim->_txStartUs = sim->nowUs;
+			sim->_txLen = 0;
+			sim->_txLastBits = sim->_regs[BitFramingReg] & 0x07;
+			break;
+		case PCD_Receive:
+		case PCD_Transceive:
+			sim->_regs[ErrorReg] = 0;
+			break;
+		case PCD_MFAuthent:
+			sim->_regs[ErrorReg] = 0;
+			sim_mf_authent(sim);
+			break;
+		case PCD_SoftReset:
+			sim_soft_reset(sim);
+			break;
+		default:
+			break;
+	}
+}
+
+// CalcCRC eats the FIFO as it fills
+static void sim_crc_feed(MFRC522_Sim *sim) {
+	if (sim_command(sim) != PCD_CalcCRC)
+		return;
+	while (sim->_fifoLen)
+		sim->_crc = CRC_A_Update(sim->_crc, (const uint8_t[]){sim_fifo_pop(sim)}, 1);
+	sim->_regs[CRCResultRegL] = sim->_crc & 0xFF;
+	sim->_regs[CRCResultRegH] = sim->_crc >> 8;
+	sim->_regs[DivIrqReg] |= 0x04;				// CRCIRq
+}
+
+static void sim_write_register(MFRC522_Sim *sim, const uint8_t reg, const uint8_t value) {
+	switch (reg) {
+		case CommandReg: {
+			const bool wasPowerDown = sim->_regs[CommandReg] & 0x10;
+			const bool fieldWasOn = sim_field_on(sim);
+			const uint8_t command = value & 0x0F;
+			sim->_regs[CommandReg] = (sim->_regs[CommandReg] & 0x0F) | (value & 0x30);
+			if (command != PCD_NoCmdChange) {
+				sim->_regs[CommandReg] = (sim->_regs[CommandReg] & 0xF0) | command;
+				sim_start_command(sim, command);
+				sim_crc_feed(sim);
+			}
+			if (fieldWasOn && !sim_field_on(sim)) {
+				for (uint8_t c = 0; c < sim->cardCount; c++)
+					sim_card_reset(&sim->cards[c]);
+			}
+			if (wasPowerDown && !(value & 0x10)) {
+				sim->_regs[CommandReg] |= 0x10;		// PowerDown reads 1 until the oscillator has started
+				sim->_wakeReadyUs = sim->nowUs + SIM_WAKE_US;
+			}
+			break;
+		}
+		case ComIrqReg:
+			if (value & 0x80)
+				sim->_regs[ComIrqReg] |= value & 0x7F;
+			else
+				sim->_regs[ComIrqReg] &= ~value;
+			break;
+		case DivIrqReg:
+			if (value & 0x80)
+				sim->_regs[DivIrqReg] |= value & 0x14;
+			else
+				sim->_regs[DivIrqReg] &= ~(value & 0x14);
+			break;
+		case ErrorReg:
+		case Status1Reg:
+		case VersionReg:
+		case CRCResultRegH:
+		case CRCResultRegL:
+			break;								// read-only
+		case Status2Reg:
+			// MFCrypto1On can only be cleared, ModemState is read-only
+			sim->_regs[Status2Reg] = (sim->_regs[Status2Reg] & 0x07) | (sim->_regs[Status2Reg] & value & 0x08) | (value & 0xC0);
+			break;
+		case FIFODataReg:
+			if (sim_fifo_push(sim, value))
+				sim_crc_feed(sim);
+			break;
+		case FIFOLevelReg:
+			if (value & 0x80) {
+				sim->_fifoLen = 0;
+				sim->_regs[ErrorReg] &= ~0x10;
+				sim_update_alerts(sim);
+			}
+			break;
+		case ControlReg:
+			if (value & 0x80)					// TStopNow
+				sim->_timerRunning = false;
+			if (value & 0x40)					// TStartNow
+				sim_start_timer(sim, sim->nowUs);
+			break;
+		case BitFramingReg:
+			sim->_regs[BitFramingReg] = value & 0x77;
+			if ((value & 0x80) && sim_command(sim) == PCD_Transceive && !sim->_txActive) {	// StartSend
+				sim->_txActive = true;
+				sim->_rxActive = false;
+				sim->_timerRunning = false;
+				sim->_txStartUs = sim->nowUs;
+				sim->_txLen = 0;
+				sim->_txLastBits = value & 0x07;
+				sim->_regs[ErrorReg] = 0;
+			}
+			break;
+		case CollReg:
+			sim->_regs[CollReg] = (sim->_regs[CollReg] & 0x7F) | (value & 0x80);
+			break;
+		case TxControlReg: {
+			const bool fieldWasOn = sim_field_on(sim);
+			sim->_regs[TxControlReg] = value;
+			if (fieldWasOn && !sim_field_on(sim)) {
+				for (uint8_t c = 0; c < sim->cardCount; c++)
+					sim_card_reset(&sim->cards[c]);
+			}
+			break;
+		}
+		case WaterLevelReg:
+			sim->_regs[WaterLevelReg] = value & 0x3F;
+			sim_update_alerts(sim);
+			break;
+		default:
+			sim->_regs[reg & 0x3F] = value;
+			break;
+	}
+}
+
+static uint8_t sim_read_register(MFRC522_Sim *sim, const uint8_t reg) {
+	switch (reg) {
+		case FIFODataReg:
+			return sim_fifo_pop(sim);
+		case FIFOLevelReg:
+			return sim->_fifoLen;
+		case Status1Reg: {
+			const uint8_t enabled = sim->_regs[ComIrqReg] & sim->_regs[ComIEnReg] & 0x7F;
+			const uint8_t divEnabled = sim->_regs[DivIrqReg] & sim->_regs[DivIEnReg] & 0x14;
+			return sim->_status1Alerts | (sim->_timerRunning ? 0x08 : 0) | ((enabled || divEnabled) ? 0x10 : 0) | 0x20;
+		}
+		case TCounterValueRegH:
+		case TCounterValueRegL: {
+			uint32_t ticks = 0;
+			if (sim->_timerRunning && sim->_timerExpiryUs > sim->nowUs) {
+				const uint32_t prescaler = ((sim->_regs[TModeReg] & 0x0F) << 8) | sim->_regs[TPrescalerReg];
+				ticks = (uint32_t)(((sim->_timerExpiryUs - sim->nowUs) * 1356) / (100 * (2 * prescaler + 1)));
+			}
+			return reg == TCounterValueRegH ? (ticks >> 8) & 0xFF : ticks & 0xFF;
+		}
+		default:
+			return sim->_regs[reg & 0x3F];
+	}
+}
+
+// advances the virtual clock by the bus time of one i2c transaction with the given number of bytes on the wire
+static void sim_bus_time(MFRC522_Sim *sim, const size_t wireBytes) {
+	sim->i2cTransactions++;
+	sim->i2cBytes += wireBytes;
+	sim->nowUs += ((int64_t)wireBytes * 9 + 3) * 1000000 / sim->i2cHz;
+	sim_run(sim, sim->nowUs);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Public functions
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sets up a simulated MFRC522 in its power-on state with an empty field.
+ */
+void MFRC522_Sim_Init(MFRC522_Sim *sim) {
+	memset(sim, 0, sizeof(*sim));
+	sim->i2cHz = 400000;
+	sim_soft_reset(sim);
+} // End MFRC522_Sim_Init()
+
+/**
+ * Puts a factory fresh virtual PICC into the field: transport keys FFFFFFFFFFFFh, access bits FF 07 80,
+ * UID/BCC/manufacturer data in block 0 (Classic) or pages 0-2 (Ultralight/NTAG, capability container in page 3).
+ *
+ * @return the PICC, or NULL if MFRC522_SIM_MAX_CARDS are in use or the UID size does not fit the type.
+ */
+MFRC522_SimCard *MFRC522_Sim_AddCard(MFRC522_Sim *sim, const enum MFRC522_SimCardType type,
+									const uint8_t *uid,			///< UID bytes
+									const uint8_t uidSize		///< 4, 7 or 10
+									) {
+	if (sim->cardCount >= MFRC522_SIM_MAX_CARDS || (uidSize != 4 && uidSize != 7 && uidSize != 10))
+		return NULL;
+	if (type > SIM_CARD_MIFARE_4K && uidSize == 4)
+		return NULL;
+
+	MFRC522_SimCard *card = &sim->cards[sim->cardCount++];
+	memset(card, 0, sizeof(*card));
+	card->type = type;
+	card->inField = true;
+	memcpy(card->uid, uid, uidSize);
+	card->uidSize = uidSize;
+	card->_cid = 0xFF;
+	card->_fsd = 256;
+	sim_card_reset(card);
+
+	switch (type) {
+		case SIM_CARD_MIFARE_MINI:
+		case SIM_CARD_MIFARE_1K:
+		case SIM_CARD_MIFARE_4K: {
+			static const uint8_t sak[3] = {0x09, 0x08, 0x18};
+			card->sak = sak[type];
+			card->atqa[0] = type == SIM_CARD_MIFARE_4K ? 0x02 : 0x04;
+			card->memorySize = sim_classic_blocks(card) * 16;
+			memcpy(card->memory, uid, uidSize);
+			card->memory[uidSize] = uidSize == 4 ? uid[0] ^ uid[1] ^ uid[2] ^ uid[3] : 0;
+			card->memory[uidSize + 1] = card->sak;
+			card->memory[uidSize + 2] = card->atqa[0];
+			card->memory[uidSize + 3] = card->atqa[1];
+			const MIFARE_Key transportKey = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+			for (uint8_t sector = 0; sector <= sim_classic_sector(sim_classic_blocks(card) - 1); sector++)
+				MFRC522_Sim_SetSectorKeys(card, sector, &transportKey, &transportKey);
+			break;
+		}
+		case SIM_CARD_ISO14443_4:
+			card->sak = 0x20;
+			card->atqa[0] = 0x44;
+			card->atqa[1] = 0x03;
+			break;
+		default: {
+			static const uint16_t pages[4] = {16, 45, 135, 231};
+			static const uint8_t ccSize[4] = {0x00, 0x12, 0x3E, 0x6D};
+			const uint8_t model = type - SIM_CARD_ULTRALIGHT;
+			card->sak = 0x00;
+			card->atqa[0] = 0x44;
+			card->memorySize = pages[model] * 4;
+			card->memory[0] = uid[0];
+			card->memory[1] = uid[1];
+			card->memory[2] = uid[2];
+			card->memory[3] = PICC_CMD_CT ^ uid[0] ^ uid[1] ^ uid[2];
+			memcpy(&card->memory[4], &uid[3], 4);
+			card->memory[8] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];
+			card->memory[9] = 0x48;
+			if (ccSize[model]) {
+				card->memory[12] = 0xE1;
+				card->memory[13] = 0x10;
+				card->memory[14] = ccSize[model];
+			}
+			break;
+		}
+	}
+	return card;
+} // End MFRC522_Sim_AddCard()
+
+/**
+ * Programs Key A and Key B of a sector trailer of a virtual MIFARE Classic PICC. The access bits are left alone.
+ */
+void MFRC522_Sim_SetSectorKeys(MFRC522_SimCard *card, const uint8_t sector, const MIFARE_Key *keyA, const MIFARE_Key *keyB) {
+	if (!sim_is_classic(card) || sim_classic_trailer(sector) >= sim_classic_blocks(card))
+		return;
+	uint8_t *trailer = &card->memory[sim_classic_trailer(sector) * 16];
+	memcpy(&trailer[0], keyA->keyByte, MF_KEY_SIZE);
+	memcpy(&trailer[10], keyB->keyByte, MF_KEY_SIZE);
+	if (trailer[6] == 0 && trailer[7] == 0 && trailer[8] == 0) {
+		trailer[6] = 0xFF;						// transport configuration
+		trailer[7] = 0x07;
+		trailer[8] = 0x80;
+		trailer[9] = 0x69;
+	}
+} // End MFRC522_Sim_SetSectorKeys()
+
+/**
+ * Lets virtual time pass without i2c traffic, e.g. from a vTaskDelay() hook.
+ */
+void MFRC522_Sim_AdvanceUs(MFRC522_Sim *sim, const int64_t us) {
+	sim->nowUs += us;
+	sim_run(sim, sim->nowUs);
+} // End MFRC522_Sim_AdvanceUs()
+
+// true if this transaction is one of the failTransactions, after the failAfterTransactions
+static bool sim_fail(MFRC522_Sim *sim) {
+	if (!sim->failTransactions)
+		return false;
+	if (sim->failAfterTransactions) {
+		sim->failAfterTransactions--;
+		return false;
+	}
+	sim->failTransactions--;
+	return true;
+}
+
+/**
+ * An i2c write: register address followed by data bytes, all of which go to the same register.
+ */
+esp_err_t MFRC522_Sim_Transmit(MFRC522_Sim *sim, const uint8_t *data, const size_t length) {
+	sim_bus_time(sim, 1 + length);
+	if (sim_fail(sim))
+		return ESP_FAIL;
+	if (length < 1)
+		return ESP_ERR_INVALID_ARG;
+	const uint8_t reg = data[0] & 0x3F;
+	for (size_t i = 1; i < length; i++)
+		sim_write_register(sim, reg, data[i]);
+	return ESP_OK;
+} // End MFRC522_Sim_Transmit()
+
+/**
+ * An i2c write of the register address and the bytes of count segments, as i2c_master_multi_buffer_transmit() sends it.
+ */
+esp_err_t MFRC522_Sim_TransmitSegments(MFRC522_Sim *sim, const uint8_t reg, const PCD_Segment *segments, const size_t count) {
+	size_t length = 0;
+	for (size_t i = 0; i < count; i++)
+		length += segments[i].length;
+	sim_bus_time(sim, 2 + length);
+	if (sim_fail(sim))
+		return ESP_FAIL;
+	for (size_t i = 0; i < count; i++)
+		for (uint16_t j = 0; j < segments[i].length; j++)
+			sim_write_register(sim, reg & 0x3F, segments[i].data[j]);
+	return ESP_OK;
+} // End MFRC522_Sim_TransmitSegments()
+
+/**
+ * An i2c write of the register address, repeated start, and a read of rxLength bytes from that register.
+ */
+esp_err_t MFRC522_Sim_TransmitReceive(MFRC522_Sim *sim, const uint8_t *txData, const size_t txLength, uint8_t *rxData, const size_t rxLength) {
+	sim_bus_time(sim, 2 + txLength + rxLength);
+	if (sim_fail(sim))
+		return ESP_FAIL;
+	if (txLength != 1)
+		return ESP_ERR_INVALID_ARG;
+	const uint8_t reg = txData[0] & 0x3F;
+	for (size_t i = 0; i < rxLength; i++)
+		rxData[i] = sim_read_register(sim, reg);
+	return ESP_OK;
+} // End MFRC522_Sim_TransmitReceive()
+
+#endif // MFRC_INCLUDE_SIMULATOR
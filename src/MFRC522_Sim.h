@@ -0,0 +1,156 @@
+/**
+ * MFRC522_Sim.h - register level model of an MFRC522 with virtual ISO/IEC 14443A PICCs.
+ *
+ * Plugs in as the transport of an MFRC522_Handle (see MFRC522_AttachSimulator_h()), so every library function
+ * runs unmodified against it: same register writes, same FIFO traffic, same polling loops.
+ *
+ * Modelled:
+ * 		- register file with the reset values of the datasheet, FIFO (64 bytes) with WaterLevel HiAlert/LoAlert
+ * 		- CommandReg state machine: Idle, Mem, CalcCRC, Transmit, Receive, Transceive, MFAuthent, SoftReset, PowerDown
+ * 		- ComIrqReg/DivIrqReg with Set1/Set2 semantics, ErrorReg, CollReg, ControlReg RxLastBits
+ * 		- the timer (TAuto, TStartNow/TStopNow, prescaler/reload), TxCRCEn/RxCRCEn, TxLastBits/RxAlign
+ * 		- RF timing: frames take their real air time at the programmed bit rate, bytes leave/arrive in the FIFO
+ * 		  one at a time, and every i2c transaction advances a virtual clock by its bus time.
+ * 		  Polling loops therefore see the same number of "not yet" reads as on hardware.
+ * 		- PICCs: MIFARE Classic Mini/1K/4K (keys from the sector trailers, value blocks; no Crypto1 on the air),
+ * 		  MIFARE Ultralight, NTAG213/215/216 (GET_VERSION, FAST_READ) and ISO/IEC 14443-4 cards (RATS, PPS,
+ * 		  I-block chaining, WTX, DESELECT), up to MFRC522_SIM_MAX_CARDS of them in the field, with bit accurate
+ * 		  anticollision.
+ *
+ * Enable with MFRC_INCLUDE_SIMULATOR=1 (MFRC522_I2C.h).
+ */
+#ifndef MFRC522_Sim_h
+#define MFRC522_Sim_h
+
+#include "MFRC522_I2C.h"
+
+#if MFRC_INCLUDE_SIMULATOR == 1
+
+// Maximum number of virtual PICCs per simulated reader. MFRC522_Sim_AddCard() returns NULL beyond it.
+// Each one takes MFRC522_SIM_MEMORY_SIZE bytes and more in MFRC522_Sim.
+#ifndef MFRC522_SIM_MAX_CARDS
+#define MFRC522_SIM_MAX_CARDS 16
+#endif
+
+// Bytes of card memory per virtual PICC. 4096 is enough for a MIFARE Classic 4K.
+#ifndef MFRC522_SIM_MEMORY_SIZE
+#define MFRC522_SIM_MEMORY_SIZE 4096
+#endif
+
+// Virtual PICC types.
+enum MFRC522_SimCardType {
+	SIM_CARD_MIFARE_MINI	= 0,	// 4 byte UID, 5 sectors
+	SIM_CARD_MIFARE_1K		= 1,	// 4 byte UID, 16 sectors
+	SIM_CARD_MIFARE_4K		= 2,	// 4 byte UID, 32 + 8 sectors
+	SIM_CARD_ULTRALIGHT		= 3,	// 7 byte UID, 16 pages, no GET_VERSION
+	SIM_CARD_NTAG213		= 4,	// 7 byte UID, 45 pages
+	SIM_CARD_NTAG215		= 5,	// 7 byte UID, 135 pages
+	SIM_CARD_NTAG216		= 6,	// 7 byte UID, 231 pages
+	SIM_CARD_ISO14443_4		= 7		// 7 byte UID, T=CL. See MFRC522_SimCard.apduHandler.
+};
+
+typedef struct MFRC522_SimCard MFRC522_SimCard;
+
+// Produces the response APDU (including SW1 SW2) of a virtual ISO/IEC 14443-4 PICC. Returns the response length.
+// NULL handler: READ BINARY (00 B0 P1 P2 Le) returns Le bytes counting up from P1P2, everything else is echoed back, both + 90 00.
+typedef uint16_t (*MFRC522_SimApduHandler)(MFRC522_SimCard *card, const uint8_t *apdu, uint16_t apduLen, uint8_t *response, uint16_t responseSize);
+
+// A virtual PICC. Set up with MFRC522_Sim_AddCard(), then tweak the public fields as needed.
+struct MFRC522_SimCard {
+	// public
+	enum MFRC522_SimCardType type;
+	bool inField;							// false => the PICC does not see the RF field (removed from the reader)
+	uint8_t uid[10];
+	uint8_t uidSize;						// 4, 7 or 10
+	uint8_t atqa[2];
+	uint8_t sak;
+	uint8_t memory[MFRC522_SIM_MEMORY_SIZE];	// Classic: blocks, Ultralight/NTAG: pages
+	uint16_t memorySize;
+	uint32_t responseDelayUs;				// extra processing time before every response (on top of the FDT)
+	uint8_t wtxRequests;					// ISO 14443-4: number of S(WTX) requests sent before the next response
+	MFRC522_SimApduHandler apduHandler;		// ISO 14443-4: application, NULL => built-in READ BINARY/echo
+
+	// private protocol state
+	uint8_t _state;
+	uint8_t _level;
+	int16_t _authSector;
+	uint8_t _pendingCmd;
+	uint8_t _pendingAddr;
+	int32_t _transferValue;
+	bool _transferValid;
+	uint8_t _rateIn;						// 0..3 => 106/212/424/848 kbit/s PCD->PICC (DRI)
+	uint8_t _rateOut;						// PICC->PCD (DSI)
+	uint8_t _blockNumber;
+	uint16_t _fsd;
+	uint8_t _cid;
+	bool _cidFollows;
+	uint8_t _wtxLeft;
+	uint8_t _apdu[512];
+	uint16_t _apduLen;
+	uint8_t _response[512];
+	uint16_t _responseLen;
+	uint16_t _responseSent;
+	uint8_t _lastBlock[260];
+	uint16_t _lastBlockLen;
+};
+
+// One simulated MFRC522 with its RF field.
+typedef struct MFRC522_Sim {
+	// public
+	uint32_t i2cHz;							// bus clock used for the transaction time model, default 400 kHz
+	int64_t nowUs;							// virtual time, advanced by every i2c transaction and MFRC522_Sim_AdvanceUs()
+	uint32_t i2cTransactions;				// statistics, reset them at will
+	uint32_t i2cBytes;
+	uint32_t rfFrames;
+	int64_t fieldOnUs;						// time with the antenna drivers on
+	int64_t powerDownUs;					// time in soft power-down
+	uint32_t failTransactions;				// > 0 => the next n i2c transactions fail with ESP_FAIL
+	uint32_t failAfterTransactions;			// > 0 => with failTransactions: that many i2c transactions succeed first
+	uint32_t lostFrame;						// > 0 => the lostFrame-th RF frame from now (1: the next one) reaches no PICC
+	MFRC522_SimCard cards[MFRC522_SIM_MAX_CARDS];
+	uint8_t cardCount;
+
+	// private
+	uint8_t _regs[0x40];
+	uint8_t _fifo[64];
+	uint8_t _fifoLen;
+	int64_t _lastUs;
+	int64_t _wakeReadyUs;					// end of the wake-up from soft power-down, 0 if none
+	uint8_t _status1Alerts;
+	uint16_t _crc;
+	// transmitter
+	bool _txActive;
+	int64_t _txStartUs;
+	uint16_t _txLen;
+	uint8_t _txLastBits;
+	uint8_t _txBuf[300];
+	// receiver
+	bool _rxActive;
+	int64_t _rxStartUs;
+	uint16_t _rxLen;
+	uint16_t _rxDelivered;
+	uint8_t _rxBuf[300];
+	uint8_t _rxLastBits;
+	uint8_t _rxError;
+	uint8_t _rxCollPos;
+	// timer
+	bool _timerRunning;
+	int64_t _timerExpiryUs;
+	// MFAuthent
+	int64_t _authDoneUs;
+	bool _authPending;
+	bool _authOk;
+} MFRC522_Sim;
+
+void MFRC522_Sim_Init(MFRC522_Sim *sim);
+MFRC522_SimCard *MFRC522_Sim_AddCard(MFRC522_Sim *sim, enum MFRC522_SimCardType type, const uint8_t *uid, uint8_t uidSize);
+void MFRC522_Sim_SetSectorKeys(MFRC522_SimCard *card, uint8_t sector, const MIFARE_Key *keyA, const MIFARE_Key *keyB);
+void MFRC522_Sim_AdvanceUs(MFRC522_Sim *sim, int64_t us);
+
+// i2c transactions, as issued by the library through the transport
+esp_err_t MFRC522_Sim_Transmit(MFRC522_Sim *sim, const uint8_t *data, size_t length);
+esp_err_t MFRC522_Sim_TransmitSegments(MFRC522_Sim *sim, uint8_t reg, const PCD_Segment *segments, size_t count);
+esp_err_t MFRC522_Sim_TransmitReceive(MFRC522_Sim *sim, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength);
+
+#endif // MFRC_INCLUDE_SIMULATOR
+#endif // MFRC522_Sim_h
@@ -0,0 +1,229 @@
+/*
+* MFRC522_Stats.c - per-reader latency histograms and error counters.
+* See MFRC522_Stats.h for an overview. Compiled only with MFRC_INCLUDE_STATS=1.
+*/
+
+#include <memory.h>
+#include <inttypes.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "MFRC522_Stats.h"
+
+#if MFRC_INCLUDE_STATS == 1
+
+static const char* TAG = "mfrc_stats";
+
+static const char *const latency_names[MFRC_LATENCY_KINDS] = {
+	[MFRC_LATENCY_REQA] = "reqa",
+	[MFRC_LATENCY_SELECT] = "select",
+	[MFRC_LATENCY_AUTH] = "auth",
+	[MFRC_LATENCY_READ] = "read",
+	[MFRC_LATENCY_WRITE] = "write",
+	[MFRC_LATENCY_CRC] = "crc",
+};
+
+static const char *const error_bit_names[MFRC_STATS_ERROR_BITS] = {"ProtocolErr", "ParityErr", "CRCErr", "CollErr", "BufferOvfl"};
+
+static const char *const i2c_error_names[MFRC_I2C_ERR_KINDS] = {
+	[MFRC_I2C_ERR_FAIL] = "ESP_FAIL",
+	[MFRC_I2C_ERR_TIMEOUT] = "ESP_ERR_TIMEOUT",
+	[MFRC_I2C_ERR_INVALID_STATE] = "ESP_ERR_INVALID_STATE",
+	[MFRC_I2C_ERR_INVALID_ARG] = "ESP_ERR_INVALID_ARG",
+	[MFRC_I2C_ERR_INVALID_RESPONSE] = "ESP_ERR_INVALID_RESPONSE",
+	[MFRC_I2C_ERR_OTHER] = "other",
+};
+
+void MFRC522_Stats_Attach(MFRC522_Stats *stats, MFRC522_Handle *dev) {
+	if (stats) {
+		memset(stats, 0, sizeof(*stats));
+	}
+	dev->_stats = stats;
+} // End MFRC522_Stats_Attach()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Writer side: the reader task
+/////////////////////////////////////////////////////////////////////////////////////
+
+// Brackets an update of live: the sequence number is odd in between, so a snapshot taken meanwhile is retried.
+static MFRC522_StatsCounters *MFRC522_Stats_BeginUpdate(MFRC522_Stats *stats) {
+	__atomic_store_n(&stats->sequence, stats->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return &stats->live;
+}
+
+static void MFRC522_Stats_EndUpdate(MFRC522_Stats *stats) {
+	__atomic_store_n(&stats->sequence, stats->sequence + 1, __ATOMIC_RELEASE);
+}
+
+MFRC522_StatsScope MFRC522_Stats_Enter(MFRC522_Handle *dev, const enum MFRC522_LatencyKind kind) {
+	const MFRC522_StatsScope scope = {dev, kind, dev->_stats ? esp_timer_get_time() : 0};
+	return scope;
+} // End MFRC522_Stats_Enter()
+
+/**
+ * Puts the time since MFRC522_Stats_Enter() into the histogram of the operation.
+ */
+void MFRC522_Stats_Leave(const MFRC522_StatsScope *scope) {
+	MFRC522_Stats *stats = scope->dev->_stats;
+	if (!stats) {
+		return;
+	}
+	const int64_t elapsedUs = esp_timer_get_time() - scope->startUs;
+	const uint32_t us = elapsedUs > 0 ? (elapsedUs < UINT32_MAX ? (uint32_t)elapsedUs : UINT32_MAX) : 0;
+	uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;		// 2^(bucket-1) <= us < 2^bucket
+	if (bucket >= MFRC_STATS_LATENCY_BUCKETS) {
+		bucket = MFRC_STATS_LATENCY_BUCKETS - 1;
+	}
+
+	MFRC522_StatsCounters *live = MFRC522_Stats_BeginUpdate(stats);
+	live->latency[scope->kind][bucket]++;
+	live->latencySumUs[scope->kind] += us;
+	MFRC522_Stats_EndUpdate(stats);
+} // End MFRC522_Stats_Leave()
+
+void MFRC522_Stats_RecordStatus(MFRC522_Handle *dev, const enum StatusCode status) {
+	MFRC522_Stats *stats = dev->_stats;
+	if (!stats || status > STATUS_PENDING) {
+		return;
+	}
+	MFRC522_StatsCounters *live = MFRC522_Stats_BeginUpdate(stats);
+	live->status[status]++;
+	MFRC522_Stats_EndUpdate(stats);
+} // End MFRC522_Stats_RecordStatus()
+
+void MFRC522_Stats_RecordErrorReg(MFRC522_Handle *dev, const uint8_t errorReg) {
+	MFRC522_Stats *stats = dev->_stats;
+	if (!stats || !(errorReg & ((1 << MFRC_STATS_ERROR_BITS) - 1))) {
+		return;
+	}
+	MFRC522_StatsCounters *live = MFRC522_Stats_BeginUpdate(stats);
+	for (uint8_t bit = 0; bit < MFRC_STATS_ERROR_BITS; bit++) {
+		if (errorReg & (1 << bit)) {
+			live->errorReg[bit]++;
+		}
+	}
+	MFRC522_Stats_EndUpdate(stats);
+} // End MFRC522_Stats_RecordErrorReg()
+
+void MFRC522_Stats_RecordI2cError(MFRC522_Handle *dev, const esp_err_t err) {
+	MFRC522_Stats *stats = dev->_stats;
+	if (!stats) {
+		return;
+	}
+	enum MFRC522_I2cErrorKind kind;
+	switch (err) {
+		case ESP_FAIL:					kind = MFRC_I2C_ERR_FAIL; break;
+		case ESP_ERR_TIMEOUT:			kind = MFRC_I2C_ERR_TIMEOUT; break;
+		case ESP_ERR_INVALID_STATE:		kind = MFRC_I2C_ERR_INVALID_STATE; break;
+		case ESP_ERR_INVALID_ARG:		kind = MFRC_I2C_ERR_INVALID_ARG; break;
+		case ESP_ERR_INVALID_RESPONSE:	kind = MFRC_I2C_ERR_INVALID_RESPONSE; break;
+		default:						kind = MFRC_I2C_ERR_OTHER; break;
+	}
+	MFRC522_StatsCounters *live = MFRC522_Stats_BeginUpdate(stats);
+	live->i2cErrors[kind]++;
+	MFRC522_Stats_EndUpdate(stats);
+} // End MFRC522_Stats_RecordI2cError()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Reader side: the monitoring task
+/////////////////////////////////////////////////////////////////////////////////////
+
+// Copies live while no update runs. The reader task is never held up, at worst the copy is repeated.
+static void MFRC522_Stats_CopyLive(const MFRC522_Stats *stats, MFRC522_StatsCounters *out) {
+	while (1) {
+		const uint32_t before = __atomic_load_n(&stats->sequence, __ATOMIC_ACQUIRE);
+		if (before & 1) {
+			vTaskDelay(1);		// the reader task was preempted in the middle of an update, let it finish
+			continue;
+		}
+		memcpy(out, &stats->live, sizeof(*out));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&stats->sequence, __ATOMIC_RELAXED) == before) {
+			return;
+		}
+	}
+}
+
+void MFRC522_Stats_Snapshot(const MFRC522_Stats *stats, MFRC522_StatsCounters *out) {
+	MFRC522_Stats_CopyLive(stats, out);
+
+	// everything is a counter: subtract the values of the last reset
+	uint32_t *counter = (uint32_t *)out->latency;
+	const uint32_t *zero = (const uint32_t *)stats->zero.latency;
+	for (size_t i = 0; i < MFRC_LATENCY_KINDS * MFRC_STATS_LATENCY_BUCKETS; i++) {
+		counter[i] -= zero[i];
+	}
+	for (uint8_t kind = 0; kind < MFRC_LATENCY_KINDS; kind++) {
+		out->latencySumUs[kind] -= stats->zero.latencySumUs[kind];
+	}
+	for (uint8_t i = 0; i <= STATUS_PENDING; i++) {
+		out->status[i] -= stats->zero.status[i];
+	}
+	for (uint8_t i = 0; i < MFRC_STATS_ERROR_BITS; i++) {
+		out->errorReg[i] -= stats->zero.errorReg[i];
+	}
+	for (uint8_t i = 0; i < MFRC_I2C_ERR_KINDS; i++) {
+		out->i2cErrors[i] -= stats->zero.i2cErrors[i];
+	}
+} // End MFRC522_Stats_Snapshot()
+
+void MFRC522_Stats_Reset(MFRC522_Stats *stats) {
+	MFRC522_Stats_CopyLive(stats, &stats->zero);
+} // End MFRC522_Stats_Reset()
+
+uint32_t MFRC522_Stats_Percentile(const MFRC522_StatsCounters *counters, const enum MFRC522_LatencyKind kind, const uint8_t percent) {
+	const uint32_t *histogram = counters->latency[kind];
+	uint64_t count = 0;
+	for (uint8_t bucket = 0; bucket < MFRC_STATS_LATENCY_BUCKETS; bucket++) {
+		count += histogram[bucket];
+	}
+	if (count == 0) {
+		return 0;
+	}
+	const uint64_t wanted = (count * percent + 99) / 100;
+	uint64_t seen = 0;
+	uint8_t bucket = 0;
+	for (; bucket < MFRC_STATS_LATENCY_BUCKETS - 1; bucket++) {
+		seen += histogram[bucket];
+		if (seen >= wanted) {
+			break;
+		}
+	}
+	return 1UL << bucket;
+} // End MFRC522_Stats_Percentile()
+
+void MFRC522_Stats_Print(const MFRC522_StatsCounters *counters) {
+	for (uint8_t kind = 0; kind < MFRC_LATENCY_KINDS; kind++) {
+		uint32_t count = 0;
+		for (uint8_t bucket = 0; bucket < MFRC_STATS_LATENCY_BUCKETS; bucket++) {
+			count += counters->latency[kind][bucket];
+		}
+		if (count == 0) {
+			continue;
+		}
+		ESP_LOGI(TAG, "%-6s %7" PRIu32 " x  avg %6" PRIu32 " us  p50 < %6" PRIu32 " us  p99 < %6" PRIu32 " us",
+				latency_names[kind], count, (uint32_t)(counters->latencySumUs[kind] / count),
+				MFRC522_Stats_Percentile(counters, kind, 50), MFRC522_Stats_Percentile(counters, kind, 99));
+	}
+	for (uint8_t i = 0; i <= STATUS_PENDING; i++) {
+		if (counters->status[i]) {
+			ESP_LOGI(TAG, "status %-40s %7" PRIu32, GetStatusCodeName(i), counters->status[i]);
+		}
+	}
+	for (uint8_t i = 0; i < MFRC_STATS_ERROR_BITS; i++) {
+		if (counters->errorReg[i]) {
+			ESP_LOGI(TAG, "ErrorReg %-12s %7" PRIu32, error_bit_names[i], counters->errorReg[i]);
+		}
+	}
+	for (uint8_t i = 0; i < MFRC_I2C_ERR_KINDS; i++) {
+		if (counters->i2cErrors[i]) {
+			ESP_LOGW(TAG, "i2c %-24s %7" PRIu32, i2c_error_names[i], counters->i2cErrors[i]);
+		}
+	}
+} // End MFRC522_Stats_Print()
+
+#endif // MFRC_INCLUDE_STATS
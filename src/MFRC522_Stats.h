@@ -0,0 +1,111 @@
+/**
+ * MFRC522_Stats.h - per-reader latency histograms and error counters, for monitoring readers in the field.
+ *
+ * With MFRC_INCLUDE_STATS=1 (MFRC522_I2C.h) and an MFRC522_Stats attached to a reader, the library records:
+ * 		- latency histograms of REQA (PICC_REQA_or_WUPA_h(), PICC_ProbePresence_h()/PICC_ProbeWakeup_h()), PICC_Select_h(),
+ * 		  PCD_Authenticate_h(), MIFARE_Read_h()/MIFARE_FastRead_h(), MIFARE_Write_h()/MIFARE_Ultralight_Write_h()
+ * 		  and PCD_CalculateCRC_h(), in log2 buckets: bucket b holds latencies of 2^(b-1) .. 2^b - 1 us
+ * 		- how often PCD_CommunicateWithPICC_h() returned each StatusCode
+ * 		- the error bits found in ErrorReg after a command: ProtocolErr, ParityErr, CRCErr, CollErr, BufferOvfl
+ * 		- failed i2c transactions by esp_err_t
+ *
+ * 		static MFRC522_Stats stats;
+ * 		MFRC522_Stats_Attach(&stats, &reader);
+ * 		...
+ * 		// monitoring task
+ * 		MFRC522_StatsCounters snapshot;
+ * 		MFRC522_Stats_Snapshot(&stats, &snapshot);
+ * 		MFRC522_Stats_Print(&snapshot);
+ * 		MFRC522_Stats_Reset(&stats);
+ *
+ * The reader task is the only writer of the counters and never waits: it marks its updates with a sequence number
+ * (a seqlock), and MFRC522_Stats_Snapshot() copies until it got a copy no update ran through. MFRC522_Stats_Reset()
+ * does not touch the counters either, it records the current values as the new zero, which the snapshots subtract.
+ * Snapshot and reset are meant for one monitoring task.
+ */
+#ifndef MFRC522_Stats_h
+#define MFRC522_Stats_h
+
+#include "MFRC522_I2C.h"
+
+#if MFRC_INCLUDE_STATS == 1
+
+// Number of log2 latency buckets. The last one also holds everything longer, with 20 from 2^18 us = 262 ms.
+#ifndef MFRC_STATS_LATENCY_BUCKETS
+#define MFRC_STATS_LATENCY_BUCKETS 20
+#endif
+
+// The operations with a latency histogram.
+enum MFRC522_LatencyKind {
+    MFRC_LATENCY_REQA		= 0,
+    MFRC_LATENCY_SELECT		= 1,
+    MFRC_LATENCY_AUTH		= 2,
+    MFRC_LATENCY_READ		= 3,
+    MFRC_LATENCY_WRITE		= 4,
+    MFRC_LATENCY_CRC		= 5,
+    MFRC_LATENCY_KINDS		= 6
+};
+
+// ErrorReg bits counted, index = bit number: ProtocolErr, ParityErr, CRCErr, CollErr, BufferOvfl.
+#define MFRC_STATS_ERROR_BITS	5
+
+// Failed i2c transactions by esp_err_t.
+enum MFRC522_I2cErrorKind {
+    MFRC_I2C_ERR_FAIL				= 0,	// ESP_FAIL, e.g. no ACK
+    MFRC_I2C_ERR_TIMEOUT			= 1,	// ESP_ERR_TIMEOUT: bus busy or clock stretched too long
+    MFRC_I2C_ERR_INVALID_STATE		= 2,	// ESP_ERR_INVALID_STATE
+    MFRC_I2C_ERR_INVALID_ARG		= 3,	// ESP_ERR_INVALID_ARG
+    MFRC_I2C_ERR_INVALID_RESPONSE	= 4,	// ESP_ERR_INVALID_RESPONSE
+    MFRC_I2C_ERR_OTHER				= 5,
+    MFRC_I2C_ERR_KINDS				= 6
+};
+
+// The counters, live or as a snapshot.
+typedef struct {
+    uint32_t	latency[MFRC_LATENCY_KINDS][MFRC_STATS_LATENCY_BUCKETS];
+    uint64_t	latencySumUs[MFRC_LATENCY_KINDS];
+    uint32_t	status[STATUS_PENDING + 1];			// PCD_CommunicateWithPICC_h() results, indexed by StatusCode
+    uint32_t	errorReg[MFRC_STATS_ERROR_BITS];
+    uint32_t	i2cErrors[MFRC_I2C_ERR_KINDS];
+} MFRC522_StatsCounters;
+
+// The statistics of one reader, see MFRC522_Stats_Attach(). The fields are private.
+typedef struct MFRC522_Stats {
+    uint32_t	sequence;		// odd while the reader updates live
+    MFRC522_StatsCounters live;	// written by the reader task only
+    MFRC522_StatsCounters zero;	// live at the last MFRC522_Stats_Reset(), written by the monitoring task only
+} MFRC522_Stats;
+
+// Used by MFRC522_I2C.c to time an operation, see PCD_STATS_LATENCY().
+typedef struct {
+    MFRC522_Handle *dev;
+    uint8_t		kind;
+    int64_t		startUs;
+} MFRC522_StatsScope;
+
+// zeroes stats and records the statistics of dev into it from now on. stats NULL: stop recording.
+// call it before the reader is used, not while it runs.
+void MFRC522_Stats_Attach(MFRC522_Stats *stats, MFRC522_Handle *dev);
+
+// copies the counters since the last MFRC522_Stats_Reset() to out. lock-free, from any task.
+void MFRC522_Stats_Snapshot(const MFRC522_Stats *stats, MFRC522_StatsCounters *out);
+
+// starts counting from zero again, without stopping the reader.
+void MFRC522_Stats_Reset(MFRC522_Stats *stats);
+
+// the latency (upper bound of its bucket, us) below which percent (0..100) of the kind operations in counters
+// completed. 0 if there were none.
+uint32_t MFRC522_Stats_Percentile(const MFRC522_StatsCounters *counters, enum MFRC522_LatencyKind kind, uint8_t percent);
+
+// logs counters: per operation count, average, p50/p99, then the non-zero status, ErrorReg and i2c error counters.
+void MFRC522_Stats_Print(const MFRC522_StatsCounters *counters);
+
+// hooks for MFRC522_I2C.c
+MFRC522_StatsScope MFRC522_Stats_Enter(MFRC522_Handle *dev, enum MFRC522_LatencyKind kind);
+void MFRC522_Stats_Leave(const MFRC522_StatsScope *scope);
+void MFRC522_Stats_RecordStatus(MFRC522_Handle *dev, enum StatusCode status);
+void MFRC522_Stats_RecordErrorReg(MFRC522_Handle *dev, uint8_t errorReg);
+void MFRC522_Stats_RecordI2cError(MFRC522_Handle *dev, esp_err_t err);
+
+#endif // MFRC_INCLUDE_STATS
+#endif // MFRC522_Stats_h
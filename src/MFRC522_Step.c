@@ -0,0 +1,425 @@
+/*
+* MFRC522_Step.c - non-blocking, resumable versions of the PICC operations.
+* See MFRC522_Step.h for an overview.
+*/
+
+#include <memory.h>
+
+#include <esp_log.h>
+
+#include "MFRC522_Step.h"
+
+static const char* TAG = "mfrc_step";
+
+// MFRC522_Op.kind
+#define MFRC522_OP_REQA			1
+#define MFRC522_OP_SELECT		2
+#define MFRC522_OP_AUTHENTICATE	3
+#define MFRC522_OP_READ			4
+#define MFRC522_OP_WRITE		5
+
+// The MFRC522 timeout of each MFRC522_Op.kind
+static const uint8_t opTimeoutClass[] = {
+	[MFRC522_OP_REQA]			= PCD_TIMEOUT_REQA,
+	[MFRC522_OP_SELECT]			= PCD_TIMEOUT_SELECT,
+	[MFRC522_OP_AUTHENTICATE]	= PCD_TIMEOUT_AUTH,
+	[MFRC522_OP_READ]			= PCD_TIMEOUT_READ,
+	[MFRC522_OP_WRITE]			= PCD_TIMEOUT_WRITE,
+};
+
+// MFRC522_Op.phase of MFRC522_OP_SELECT
+#define SELECT_PHASE_ANTICOLLISION	0
+#define SELECT_PHASE_SELECT			1
+
+// MFRC522_Op.phase of MFRC522_OP_WRITE
+#define WRITE_PHASE_COMMAND		0
+#define WRITE_PHASE_DATA		1
+
+/**
+ * Starts the next frame of an operation. The response is collected by MFRC522_Op_Poll().
+ *
+ * @return STATUS_PENDING if the frame is on its way, STATUS_??? otherwise.
+ */
+static enum StatusCode MFRC522_Op_Transceive(MFRC522_Op *op, 	const uint8_t *sendData,	///< The frame to send, including CRC_A if any
+												const uint8_t sendLen,		///< Number of bytes to send
+												const uint8_t txLastBits,	///< The number of valid bits in the last byte. 0 for 8 valid bits.
+												uint8_t *rxData,			///< Where the response goes. NULL => none expected
+												const uint8_t rxSize,		///< Room at rxData
+												const uint8_t rxAlign,		///< Bit position in rxData[0] for the first bit received
+												const bool checkCRC			///< True => the response ends with a CRC_A that must be validated
+											) {
+	op->rxData = rxData;
+	op->rxSize = rxSize;
+	op->rxValidBits = 0;
+	op->rxAlign = rxAlign;
+	op->checkCRC = checkCRC;
+
+	PCD_UseCommandTimeout_h(op->dev, opTimeoutClass[op->kind]);
+	const enum StatusCode result = PCD_StartTransceive_h(op->dev, sendData, sendLen, txLastBits, rxAlign);
+	return result == STATUS_OK ? STATUS_PENDING : result;
+} // End MFRC522_Op_Transceive()
+
+/**
+ * Sets up the frame for a MIFARE command that is answered with a 4 bit ACK/NAK and starts it.
+ *
+ * @return STATUS_PENDING if the frame is on its way, STATUS_??? otherwise.
+ */
+static enum StatusCode MFRC522_Op_MifareTransceive(MFRC522_Op *op, const uint8_t length) {
+	const enum StatusCode result = PCD_CalculateCRC_h(op->dev, op->frame, length, &op->frame[length]);
+	if (result != STATUS_OK) {
+		return result;
+	}
+	return MFRC522_Op_Transceive(op, op->frame, length + 2, 0, op->frame, sizeof(op->frame), 0, false);
+} // End MFRC522_Op_MifareTransceive()
+
+/**
+ * Checks the 4 bit ACK/NAK of a MIFARE command, like PCD_MIFARE_Transceive_h().
+ */
+static enum StatusCode MFRC522_Op_CheckAck(const MFRC522_Op *op) {
+	if (op->rxSize != 1 || op->rxValidBits != 4) {
+		return STATUS_ERROR;
+	}
+	if (op->frame[0] != MF_ACK) {
+		return STATUS_MIFARE_NACK;
+	}
+	return STATUS_OK;
+} // End MFRC522_Op_CheckAck()
+
+/**
+ * Prepares the state of an operation.
+ */
+static void MFRC522_Op_Setup(MFRC522_Op *op, MFRC522_Handle *dev, const uint8_t kind) {
+	memset(op, 0, sizeof(*op));
+	op->dev = dev;
+	op->kind = kind;
+	op->status = STATUS_PENDING;
+} // End MFRC522_Op_Setup()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// REQA / WUPA
+/////////////////////////////////////////////////////////////////////////////////////
+
+static enum StatusCode PICC_BeginREQA_or_WUPA(MFRC522_Op *op, MFRC522_Handle *dev, 	const uint8_t command,		///< PICC_CMD_REQA or PICC_CMD_WUPA
+																	uint8_t *bufferATQA,		///< The buffer to store the ATQA in
+																	uint8_t *bufferSize			///< Buffer size, at least two bytes. Also number of bytes returned if STATUS_OK.
+											) {
+	MFRC522_Op_Setup(op, dev, MFRC522_OP_REQA);
+	if (bufferATQA == NULL || *bufferSize < 2) {	// The ATQA response is 2 bytes long.
+		return op->status = STATUS_NO_ROOM;
+	}
+	op->out = bufferATQA;
+	op->outSize = bufferSize;
+
+	if (PCD_SetBitRate_h(dev, PCD_BITRATE_106, PCD_BITRATE_106) != ESP_OK) {	// A PICC answers REQA/WUPA at 106 kbit/s only
+		return op->status = STATUS_ERROR;
+	}
+	if (PCD_ClearRegisterBitMask_h(dev, CollReg, 0x80) != ESP_OK) {		// ValuesAfterColl=1 => Bits received after collision are cleared.
+		return op->status = STATUS_ERROR;
+	}
+	op->frame[0] = command;
+	return op->status = MFRC522_Op_Transceive(op, op->frame, 1, 7, bufferATQA, *bufferSize, 0, false);	// 7 bit short frame
+} // End PICC_BeginREQA_or_WUPA()
+
+/**
+ * Starts a REQA. Completes with STATUS_OK and the ATQA in bufferATQA, STATUS_COLLISION if several PICCs answered,
+ * STATUS_TIMEOUT if none did.
+ *
+ * @return STATUS_PENDING if the REQA was sent, STATUS_??? otherwise.
+ */
+enum StatusCode PICC_BeginRequestA(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize) {
+	return PICC_BeginREQA_or_WUPA(op, dev, PICC_CMD_REQA, bufferATQA, bufferSize);
+} // End PICC_BeginRequestA()
+
+/**
+ * Starts a WUPA. Completes like PICC_BeginRequestA().
+ *
+ * @return STATUS_PENDING if the WUPA was sent, STATUS_??? otherwise.
+ */
+enum StatusCode PICC_BeginWakeupA(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize) {
+	return PICC_BeginREQA_or_WUPA(op, dev, PICC_CMD_WUPA, bufferATQA, bufferSize);
+} // End PICC_BeginWakeupA()
+
+static enum StatusCode PICC_StepREQA_or_WUPA(MFRC522_Op *op, const enum StatusCode result) {
+	if (result != STATUS_OK) {
+		return result;
+	}
+	*op->outSize = op->rxSize;
+	if (op->rxSize != 2 || op->rxValidBits != 0) {		// ATQA must be exactly 16 bits.
+		return STATUS_ERROR;
+	}
+	return STATUS_OK;
+} // End PICC_StepREQA_or_WUPA()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Anticollision / SELECT. Same frames as PICC_Select_h(), see the buffer description there.
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Sends the ANTICOLLISION frame for the bits known so far in the current cascade level,
+ * or the SELECT frame once all 32 are known.
+ */
+static enum StatusCode PICC_SelectSendFrame(MFRC522_Op *op) {
+	uint8_t *buffer = op->frame;
+
+	if (op->knownBits >= 32) {		// All UID bits in this Cascade Level are known. This is a SELECT.
+		op->phase = SELECT_PHASE_SELECT;
+		buffer[1] = 0x70;			// NVB - Number of Valid Bits: Seven whole bytes
+		buffer[6] = buffer[2] ^ buffer[3] ^ buffer[4] ^ buffer[5];	// BCC - Block Check Character
+		const enum StatusCode result = PCD_CalculateCRC_h(op->dev, buffer, 7, &buffer[7]);
+		if (result != STATUS_OK) {
+			return result;
+		}
+		// SAK + CRC_A go behind the frame, the UID bytes in buffer[2..5] are still needed.
+		return MFRC522_Op_Transceive(op, buffer, 9, 0, &buffer[9], 3, 0, true);
+	}
+
+	// This is an ANTICOLLISION.
+	op->phase = SELECT_PHASE_ANTICOLLISION;
+	const uint8_t txLastBits = op->knownBits % 8;
+	const uint8_t index = 2 + op->knownBits / 8;			// Number of whole bytes: SEL + NVB + UIDs
+	buffer[1] = (index << 4) + txLastBits;					// NVB - Number of Valid Bits
+	// The response completes the partial byte and fills the rest of the cascade level.
+	return MFRC522_Op_Transceive(op, buffer, index + (txLastBits ? 1 : 0), txLastBits, &buffer[index], 9 - index, txLastBits, false);
+} // End PICC_SelectSendFrame()
+
+/**
+ * Starts the anticollision loop of a cascade level.
+ */
+static enum StatusCode PICC_SelectStartLevel(MFRC522_Op *op) {
+	static const uint8_t selCommands[] = { PICC_CMD_SEL_CL1, PICC_CMD_SEL_CL2, PICC_CMD_SEL_CL3 };
+	memset(op->frame, 0, sizeof(op->frame));
+	op->frame[0] = selCommands[op->cascadeLevel - 1];
+	op->knownBits = 0;
+	return PICC_SelectSendFrame(op);
+} // End PICC_SelectStartLevel()
+
+/**
+ * Starts anticollision and selection of one PICC. The PICCs must be in state READY(*), see PICC_BeginRequestA().
+ * Completes with STATUS_OK and the UID and SAK in *uid.
+ *
+ * @return STATUS_PENDING if the first frame was sent, STATUS_??? otherwise.
+ */
+enum StatusCode PICC_BeginSelect(MFRC522_Op *op, MFRC522_Handle *dev, Uid *uid) {
+	MFRC522_Op_Setup(op, dev, MFRC522_OP_SELECT);
+	op->uid = uid;
+	op->cascadeLevel = 1;
+
+	if (PCD_ClearRegisterBitMask_h(dev, CollReg, 0x80) != ESP_OK) {		// ValuesAfterColl=1 => Bits received after collision are cleared.
+		return op->status = STATUS_ERROR;
+	}
+	return op->status = PICC_SelectStartLevel(op);
+} // End PICC_BeginSelect()
+
+static enum StatusCode PICC_StepSelect(MFRC522_Op *op, const enum StatusCode result) {
+	uint8_t *buffer = op->frame;
+
+	if (op->phase == SELECT_PHASE_ANTICOLLISION) {
+		if (result == STATUS_COLLISION) {		// More than one PICC in the field => collision.
+			uint8_t coll;
+			if (PCD_ReadRegister_h(op->dev, CollReg, &coll) != ESP_OK) {	// CollReg[7..0] bits are: ValuesAfterColl reserved CollPosNotValid CollPos[4:0]
+				return STATUS_ERROR;
+			}
+			if (coll & 0x20) {					// CollPosNotValid
+				return STATUS_COLLISION;		// Without a valid collision position we cannot continue
+			}
+			uint8_t collisionPos = coll & 0x1F;	// Values 0-31, 0 means bit 32.
+			if (collisionPos == 0) {
+				collisionPos = 32;
+			}
+			// CollPos counts from the first bit of the first received byte, which starts with the known bits.
+			collisionPos += (op->knownBits / 8) * 8;
+			if (collisionPos <= op->knownBits || collisionPos > 32) {	// No progress - should not happen
+				return STATUS_INTERNAL_ERROR;
+			}
+			// Choose the PICC with the bit set.
+			op->knownBits = collisionPos;
+			buffer[2 + (collisionPos - 1) / 8] |= 1 << ((collisionPos - 1) % 8);
+			return PICC_SelectSendFrame(op);
+		}
+		if (result != STATUS_OK) {
+			return result;
+		}
+		// We now have all 32 bits of the UID in this Cascade Level
+		op->knownBits = 32;
+		return PICC_SelectSendFrame(op);
+	}
+
+	// SELECT answered
+	if (result != STATUS_OK) {
+		return result;
+	}
+	if (op->rxSize != 3 || op->rxValidBits != 0) {		// SAK must be exactly 24 bits (1 byte + CRC_A).
+		return STATUS_ERROR;
+	}
+
+	// Copy the found UID bytes from buffer[] to uid->uidByte[]
+	const uint8_t uidIndex = 3 * (op->cascadeLevel - 1);
+	const bool cascadeTag = buffer[2] == PICC_CMD_CT;
+	memcpy(&op->uid->uidByte[uidIndex], &buffer[cascadeTag ? 3 : 2], cascadeTag ? 3 : 4);
+
+	const uint8_t sak = buffer[9];
+	if (sak & 0x04) {			// Cascade bit set - UID not complete yet
+		if (op->cascadeLevel == 3) {
+			return STATUS_INTERNAL_ERROR;
+		}
+		op->cascadeLevel++;
+		return PICC_SelectStartLevel(op);
+	}
+	op->uid->sak = sak;
+	op->uid->size = 3 * op->cascadeLevel + 1;
+	return STATUS_OK;
+} // End PICC_StepSelect()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// MIFARE
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Starts a MIFARE Classic authentication. Completes with STATUS_OK when Crypto1 is on, STATUS_TIMEOUT for a wrong key.
+ *
+ * @return STATUS_PENDING if the MFAuthent command was started, STATUS_??? otherwise.
+ */
+enum StatusCode PCD_BeginAuthenticate(MFRC522_Op *op, MFRC522_Handle *dev, 	const uint8_t command,		///< PICC_CMD_MF_AUTH_KEY_A or PICC_CMD_MF_AUTH_KEY_B
+																		const uint8_t blockAddr,	///< The block number
+																		const MIFARE_Key *key,		///< The Crypto1 key to use (6 bytes)
+																		const Uid *uid				///< The last 4 bytes of the UID are used
+									) {
+	MFRC522_Op_Setup(op, dev, MFRC522_OP_AUTHENTICATE);
+
+	op->frame[0] = command;
+	op->frame[1] = blockAddr;
+	memcpy(&op->frame[2], key->keyByte, MF_KEY_SIZE);
+	memcpy(&op->frame[8], &uid->uidByte[uid->size - 4], 4);
+
+	PCD_UseCommandTimeout_h(dev, opTimeoutClass[op->kind]);
+	const enum StatusCode result = PCD_StartCommand_h(dev, PCD_MFAuthent, 0x10, op->frame, 12, 0, 0);	// IdleIRq
+	return op->status = (result == STATUS_OK) ? STATUS_PENDING : result;
+} // End PCD_BeginAuthenticate()
+
+/**
+ * Starts a MIFARE READ. Completes with STATUS_OK and 16 data bytes + CRC_A in buffer.
+ *
+ * @return STATUS_PENDING if the READ was sent, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_BeginRead(MFRC522_Op *op, MFRC522_Handle *dev, 	const uint8_t blockAddr,	///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The first page to return data from.
+																	uint8_t *buffer,			///< The buffer to store the data in
+																	uint8_t *bufferSize			///< Buffer size, at least 18 bytes. Also number of bytes returned if STATUS_OK.
+								) {
+	MFRC522_Op_Setup(op, dev, MFRC522_OP_READ);
+	if (buffer == NULL || *bufferSize < 18) {
+		return op->status = STATUS_NO_ROOM;
+	}
+	op->out = buffer;
+	op->outSize = bufferSize;
+
+	op->frame[0] = PICC_CMD_MF_READ;
+	op->frame[1] = blockAddr;
+	const enum StatusCode result = PCD_CalculateCRC_h(dev, op->frame, 2, &op->frame[2]);
+	if (result != STATUS_OK) {
+		return op->status = result;
+	}
+	return op->status = MFRC522_Op_Transceive(op, op->frame, 4, 0, buffer, *bufferSize, 0, true);
+} // End MIFARE_BeginRead()
+
+/**
+ * Starts a MIFARE WRITE: the command frame, then (in MFRC522_Op_Poll()) the 16 data bytes.
+ *
+ * @return STATUS_PENDING if the WRITE was sent, STATUS_??? otherwise.
+ */
+enum StatusCode MIFARE_BeginWrite(MFRC522_Op *op, MFRC522_Handle *dev, 	const uint8_t blockAddr,	///< MIFARE Classic: The block (0-0xff) number. MIFARE Ultralight: The page (2-15) to write to.
+																	const uint8_t *buffer,		///< The 16 bytes to write to the PICC
+																	const uint8_t bufferSize	///< Buffer size, must be at least 16 bytes. Exactly 16 bytes are written.
+								) {
+	MFRC522_Op_Setup(op, dev, MFRC522_OP_WRITE);
+	if (buffer == NULL || bufferSize < 16) {
+		return op->status = STATUS_INVALID;
+	}
+	// The data waits in frame[2..17] until the command is acknowledged.
+	memcpy(&op->frame[2], buffer, 16);
+	op->blockAddr = blockAddr;
+	op->phase = WRITE_PHASE_COMMAND;
+
+	uint8_t command[4] = { PICC_CMD_MF_WRITE, blockAddr };
+	const enum StatusCode result = PCD_CalculateCRC_h(dev, command, 2, &command[2]);
+	if (result != STATUS_OK) {
+		return op->status = result;
+	}
+	// The ACK goes to frame[0..1], in front of the data.
+	return op->status = MFRC522_Op_Transceive(op, command, 4, 0, op->frame, 2, 0, false);
+} // End MIFARE_BeginWrite()
+
+static enum StatusCode MIFARE_StepWrite(MFRC522_Op *op, enum StatusCode result) {
+	if (result == STATUS_OK) {
+		result = MFRC522_Op_CheckAck(op);
+	}
+	if (result != STATUS_OK || op->phase == WRITE_PHASE_DATA) {
+		return result;
+	}
+	// Command acknowledged, transfer the data
+	op->phase = WRITE_PHASE_DATA;
+	memmove(op->frame, &op->frame[2], 16);
+	return MFRC522_Op_MifareTransceive(op, 16);
+} // End MIFARE_StepWrite()
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Driving operations
+/////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Advances an operation. Never waits for the PICC: while the MFRC522 is still busy this is a single i2c read.
+ *
+ * @return STATUS_PENDING while the operation runs, then its result.
+ */
+enum StatusCode MFRC522_Op_Poll(MFRC522_Op *op) {
+	if (op->status != STATUS_PENDING) {
+		return op->status;
+	}
+
+	enum StatusCode result = PCD_PollCommand_h(op->dev);
+	if (result == STATUS_PENDING) {
+		return STATUS_PENDING;
+	}
+	if (result == STATUS_OK) {
+		result = PCD_FinishCommand_h(op->dev, op->rxData, op->rxData ? &op->rxSize : NULL, &op->rxValidBits, op->rxAlign, op->checkCRC);
+	}
+
+	switch (op->kind) {
+		case MFRC522_OP_REQA:
+			result = PICC_StepREQA_or_WUPA(op, result);
+			break;
+
+		case MFRC522_OP_SELECT:
+			result = PICC_StepSelect(op, result);
+			break;
+
+		case MFRC522_OP_AUTHENTICATE:
+			break;
+
+		case MFRC522_OP_READ:
+			if (result == STATUS_OK) {
+				*op->outSize = op->rxSize;
+			}
+			break;
+
+		case MFRC522_OP_WRITE:
+			result = MIFARE_StepWrite(op, result);
+			break;
+
+		default:
+			ESP_LOGE(TAG, "unknown operation %d", op->kind);
+			result = STATUS_INTERNAL_ERROR;
+			break;
+	}
+	op->status = result;
+	return result;
+} // End MFRC522_Op_Poll()
+
+/**
+ * Abandons a pending operation.
+ */
+void MFRC522_Op_Cancel(MFRC522_Op *op) {
+	if (op->status == STATUS_PENDING) {
+		PCD_WriteRegister_h(op->dev, CommandReg, PCD_Idle);
+		op->status = STATUS_ERROR;
+	}
+} // End MFRC522_Op_Cancel()
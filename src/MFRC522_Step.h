@@ -0,0 +1,81 @@
+/**
+ * MFRC522_Step.h - non-blocking, resumable versions of the PICC operations.
+ *
+ * The PICC functions in MFRC522_I2C.h block inside PCD_CommunicateWithPICC_h() until the PICC answers or the
+ * MFRC522 timer expires. Here each operation is a state machine in a caller-provided MFRC522_Op:
+ * 		- a Begin function sets it up and starts the first frame on the MFRC522,
+ * 		- MFRC522_Op_Poll() advances it and returns STATUS_PENDING until it is done, then the final StatusCode.
+ * A poll costs one i2c read while the PICC has not answered yet. No call ever waits for the RF field, nothing is
+ * allocated, so a single task can drive any number of readers (one MFRC522_Op per reader) in a loop:
+ *
+ * 		MFRC522_Op op[READERS];
+ * 		uint8_t atqa[READERS][2], atqaSize[READERS];
+ * 		for (r...) { atqaSize[r] = 2; PICC_BeginRequestA(&op[r], &reader[r], atqa[r], &atqaSize[r]); }
+ * 		for (;;) {
+ * 			for (r...) {
+ * 				enum StatusCode status = MFRC522_Op_Poll(&op[r]);
+ * 				if (status == STATUS_PENDING) continue;
+ * 				... the REQA of reader r is done, start its next operation
+ * 			}
+ * 			... other work
+ * 		}
+ *
+ * Results (ATQA, Uid, block data) are written to the buffers passed to the Begin function when the operation
+ * completes; they must stay valid until then. CRC_A values are calculated with PCD_CalculateCRC_h(), which in
+ * PCD_CRC_COPROCESSOR mode is a short i2c exchange with the MFRC522 but no RF wait.
+ * Don't use the blocking functions on a reader while an operation is pending on it.
+ */
+#ifndef MFRC522_Step_h
+#define MFRC522_Step_h
+
+#include "MFRC522_I2C.h"
+
+// An operation in progress. Allocate one per reader (static, stack or heap). The fields are private.
+typedef struct {
+    MFRC522_Handle *dev;
+    uint8_t		kind;			// MFRC522_OP_xxx in MFRC522_Step.c
+    uint8_t		phase;			// kind specific
+    enum StatusCode status;		// STATUS_PENDING while running, then the result
+
+    // the frame on the air: transmit buffer, then response. 9 bytes for SELECT, 18 for 16 data bytes + CRC_A.
+    uint8_t		frame[18];
+    uint8_t		*rxData;		// where the response goes
+    uint8_t		rxSize;			// in: room at rxData, out: bytes received
+    uint8_t		rxValidBits;
+    uint8_t		rxAlign;
+    bool		checkCRC;
+
+    // caller's buffers
+    uint8_t		*out;
+    uint8_t		*outSize;
+    Uid			*uid;
+    uint8_t		blockAddr;
+
+    // anticollision
+    uint8_t		cascadeLevel;
+    uint8_t		knownBits;		// UID bits known in the current cascade level, including the cascade tag
+} MFRC522_Op;
+
+// REQA / WUPA. On STATUS_OK bufferATQA holds the 2 byte ATQA. STATUS_COLLISION means more than one PICC answered.
+enum StatusCode PICC_BeginRequestA(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize);
+enum StatusCode PICC_BeginWakeupA(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t *bufferATQA, uint8_t *bufferSize);
+
+// anticollision and SELECT through all cascade levels, like PICC_Select(uid, 0). uid gets the UID, its size and the SAK.
+enum StatusCode PICC_BeginSelect(MFRC522_Op *op, MFRC522_Handle *dev, Uid *uid);
+
+// MIFARE Classic authentication, like PCD_Authenticate(). key and uid are copied, they need not stay valid.
+enum StatusCode PCD_BeginAuthenticate(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t command, uint8_t blockAddr, const MIFARE_Key *key, const Uid *uid);
+
+// MIFARE READ, like MIFARE_Read(): buffer gets 16 data bytes + 2 CRC_A bytes, *bufferSize must be >= 18.
+enum StatusCode MIFARE_BeginRead(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t blockAddr, uint8_t *buffer, uint8_t *bufferSize);
+
+// MIFARE WRITE, like MIFARE_Write(). the 16 bytes are copied, buffer need not stay valid.
+enum StatusCode MIFARE_BeginWrite(MFRC522_Op *op, MFRC522_Handle *dev, uint8_t blockAddr, const uint8_t *buffer, uint8_t bufferSize);
+
+// advances the operation without blocking. STATUS_PENDING while it runs, then its result (returned again on every further call).
+enum StatusCode MFRC522_Op_Poll(MFRC522_Op *op);
+
+// abandons a pending operation and stops the MFRC522 (PCD_Idle). the result is STATUS_ERROR.
+void MFRC522_Op_Cancel(MFRC522_Op *op);
+
+#endif // MFRC522_Step_h
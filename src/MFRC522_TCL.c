@@ -0,0 +1,382 @@
+/*
+* MFRC522_TCL.c - ISO/IEC 14443-4 (T=CL) block transport: RATS, I-block chaining, WTX, DESELECT.
+* See MFRC522_TCL.h for an overview.
+*/
+
+#include <memory.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+
+#include "MFRC522_TCL.h"
+
+static const char* TAG = "mfrc_tcl";
+
+#define TCL_PICC_CMD_RATS	0xE0
+#define TCL_PICC_CMD_PPS	0xD0		// PPSS, the CID goes into the low nibble
+
+// PCB of the blocks (ISO/IEC 14443-4 7.1.1.1), the block number is bit 0
+#define TCL_PCB_I_BLOCK		0x02
+#define TCL_PCB_R_ACK		0xA2
+#define TCL_PCB_R_NAK		0xB2
+#define TCL_PCB_S_DESELECT	0xC2
+#define TCL_PCB_S_WTX		0xF2
+#define TCL_PCB_CHAINING	0x10
+#define TCL_PCB_CID			0x08
+
+#define TCL_IS_I_BLOCK(pcb)		(((pcb) & 0xE2) == 0x02)
+#define TCL_IS_R_BLOCK(pcb)		(((pcb) & 0xE6) == 0xA2)
+
+#define TCL_DELTA_FWT_US	3600		// ΔFWT: the PCD waits FWT + ΔFWT for the answer
+#define TCL_FWT_MAX_US		4949000		// FWT of FWI 14, also the limit of an extended waiting time
+
+// FWT or SFGT of an integer n: (256 * 16 / fc) * 2^n, ~302us * 2^n
+static uint32_t TCL_WaitingTimeUs(const uint8_t n) {
+	return (uint32_t)(((uint64_t)4096 * 100 << n) / 1356);
+}
+
+// The timeout of the blocks, PCD_TransceiveBlock_h() programs it when the next block starts
+static void TCL_SetTimeoutUs(MFRC522_TCL *tcl, const uint32_t timeoutUs) {
+	PCD_SetCommandTimeoutUs_h(tcl->dev, PCD_TIMEOUT_ISO14443_4, timeoutUs);
+}
+
+/**
+ * Takes FSCI, FWI, SFGI, TA(1) and the CID and NAD support from the ATS. Missing interface bytes keep the defaults
+ * of ISO/IEC 14443-4: FSCI 2 (32 bytes), FWI 4, SFGI 0. RFU values are treated as the defaults.
+ */
+static void TCL_ParseATS(MFRC522_TCL *tcl) {
+	static const uint16_t frameSizes[9] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+	uint8_t fsci = 2;
+	tcl->fwi = 4;
+	tcl->sfgi = 0;
+	tcl->ta1 = 0;
+	tcl->nadSupported = false;
+	bool cidSupported = false;
+
+	if (tcl->atsLength > 1) {
+		const uint8_t t0 = tcl->ats[1];
+		uint8_t index = 2;
+		fsci = t0 & 0x0F;
+		if ((t0 & 0x10) && index < tcl->atsLength) {			// TA(1)
+			tcl->ta1 = tcl->ats[index++];
+		}
+		if ((t0 & 0x20) && index < tcl->atsLength) {			// TB(1)
+			tcl->fwi = tcl->ats[index] >> 4;
+			tcl->sfgi = tcl->ats[index] & 0x0F;
+			index++;
+		}
+		if ((t0 & 0x40) && index < tcl->atsLength) {			// TC(1)
+			tcl->nadSupported = tcl->ats[index] & 0x01;
+			cidSupported = tcl->ats[index] & 0x02;
+		}
+	}
+	if (tcl->fwi == 15) {
+		tcl->fwi = 4;
+	}
+	if (tcl->sfgi == 15) {
+		tcl->sfgi = 0;
+	}
+	tcl->fsc = frameSizes[fsci < 8 ? fsci : 8];
+	tcl->fwtUs = TCL_WaitingTimeUs(tcl->fwi);
+	tcl->sfgtUs = tcl->sfgi ? TCL_WaitingTimeUs(tcl->sfgi) : 0;
+	tcl->useCid = cidSupported && tcl->cid != 0;
+} // End TCL_ParseATS()
+
+/**
+ * Sends RATS to the selected PICC and prepares the block transport with the parameters of its ATS.
+ * RATS is answered within the PCD_TIMEOUT_ISO14443_4 timeout of the reader (MFRC_TIMEOUT_ISO14443_4_US), which is
+ * then set to FWT + ΔFWT of the ATS. Before returning, the SFGT the PICC asked for is waited.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode TCL_Activate_h(MFRC522_Handle *dev,	MFRC522_TCL *tcl,
+													const uint8_t cid		///< Card identifier 0..14, 0 if only one PICC is active
+							) {
+	if (cid > 14) {
+		return STATUS_INVALID;
+	}
+	static const uint8_t fsdTable[9] = {16, 24, 32, 40, 48, 64, 96, 128, 0};
+	tcl->dev = dev;
+	tcl->cid = cid;
+	tcl->fsd = MFRC_TCL_FSDI < 8 ? fsdTable[MFRC_TCL_FSDI] : 256;
+	tcl->blockNumber = 0;			// rule A
+	tcl->blocksSent = false;
+	tcl->txBitRate = PCD_BITRATE_106;
+	tcl->rxBitRate = PCD_BITRATE_106;
+	tcl->savedTimeoutUs = PCD_GetCommandTimeoutUs_h(dev, PCD_TIMEOUT_ISO14443_4);
+
+	// The PICC has to answer RATS within the activation frame waiting time, ~4.8ms (FWI 4) + ΔFWT.
+	const uint8_t rats[2] = { TCL_PICC_CMD_RATS, (MFRC_TCL_FSDI << 4) | cid };
+	uint8_t ats[TCL_ATS_SIZE + 2];
+	uint16_t atsLength = sizeof(ats);
+	PCD_UseCommandTimeout_h(dev, PCD_TIMEOUT_ISO14443_4);
+	enum StatusCode result = PCD_TransceiveStream_h(dev, rats, sizeof(rats), ats, &atsLength, NULL, true);
+	if (result == STATUS_OK && (atsLength == 0 || ats[0] != atsLength)) {
+		result = STATUS_ERROR;		// TL is the length of the ATS
+	}
+	if (result != STATUS_OK) {
+		return result;
+	}
+	memcpy(tcl->ats, ats, atsLength);
+	tcl->atsLength = atsLength;
+	TCL_ParseATS(tcl);
+	ESP_LOGD(TAG, "ATS: FSC %d, FWT %lu us, SFGT %lu us, CID %s", tcl->fsc, (unsigned long)tcl->fwtUs, (unsigned long)tcl->sfgtUs, tcl->useCid ? "used" : "not used");
+
+	TCL_SetTimeoutUs(tcl, tcl->fwtUs + TCL_DELTA_FWT_US);
+	// The PICC is not ready for the next frame before the SFGT
+	if (tcl->sfgtUs >= portTICK_PERIOD_MS * 1000) {
+		vTaskDelay(pdMS_TO_TICKS((tcl->sfgtUs + 999) / 1000));
+	}
+	else if (tcl->sfgtUs) {
+		esp_rom_delay_us(tcl->sfgtUs);
+	}
+	return STATUS_OK;
+} // End TCL_Activate_h()
+
+enum StatusCode TCL_Activate(MFRC522_TCL *tcl, uint8_t cid) {
+	return TCL_Activate_h(MFRC522_DefaultHandle(), tcl, cid);
+}
+
+// The highest rate in a TA(1) bit field (bit 0: 212, bit 1: 424, bit 2: 848 kbit/s), at most maxRate
+static enum PCD_BitRate TCL_HighestBitRate(const uint8_t bits, const enum PCD_BitRate maxRate) {
+	enum PCD_BitRate rate = PCD_BITRATE_106;
+	for (enum PCD_BitRate r = PCD_BITRATE_212; r <= maxRate && r <= PCD_BITRATE_848; r++) {
+		if (bits & (1 << (r - 1))) {
+			rate = r;
+		}
+	}
+	return rate;
+}
+
+/**
+ * Negotiates the bit rates with PPS (ISO/IEC 14443-4 5.3): the highest ones in TA(1) of the ATS that the reader
+ * allows. The PICC answers PPS at the old rate and switches, then the MFRC522 is switched with PCD_SetBitRate_h().
+ * Above 106 kbit/s the MFRC522 appends and checks CRC_A itself, whatever the CRC mode of the reader.
+ * Above MFRC_STREAM_MAX_BIT_RATE frames must fit the FIFO: TCL_Exchange() then sends blocks of at most 64 bytes, and
+ * PICC->PCD only goes that fast if the PICC sends no longer frames (FSD <= 64, see MFRC_TCL_FSDI).
+ *
+ * @return STATUS_OK on success (also if both stay at 106 kbit/s), STATUS_??? otherwise.
+ */
+enum StatusCode TCL_NegotiateBitRate(MFRC522_TCL *tcl) {
+	if (tcl->dev == NULL || tcl->blocksSent) {
+		return STATUS_INVALID;
+	}
+	const enum PCD_BitRate maxRate = PCD_GetMaxBitRate_h(tcl->dev);
+	const enum PCD_BitRate rxMaxRate = tcl->fsd > 64 && maxRate > MFRC_STREAM_MAX_BIT_RATE ? MFRC_STREAM_MAX_BIT_RATE : maxRate;
+	enum PCD_BitRate dsi = TCL_HighestBitRate(tcl->ta1 >> 4, rxMaxRate);		// PICC->PCD
+	enum PCD_BitRate dri = TCL_HighestBitRate(tcl->ta1, maxRate);			// PCD->PICC
+	if (tcl->ta1 & 0x80) {							// only the same rate in both directions
+		dsi = dri = TCL_HighestBitRate((tcl->ta1 >> 4) & tcl->ta1, rxMaxRate);
+	}
+	if (dsi == PCD_BITRATE_106 && dri == PCD_BITRATE_106) {
+		return STATUS_OK;
+	}
+
+	// PPSS, PPS0 (PPS1 follows), PPS1 (DSI, DRI)
+	const uint8_t pps[3] = { TCL_PICC_CMD_PPS | tcl->cid, 0x11, (dsi << 2) | dri };
+	uint8_t response[3];
+	uint16_t responseLength = sizeof(response);
+	tcl->blocksSent = true;
+	PCD_UseCommandTimeout_h(tcl->dev, PCD_TIMEOUT_ISO14443_4);
+	enum StatusCode result = PCD_TransceiveStream_h(tcl->dev, pps, sizeof(pps), response, &responseLength, NULL, true);
+	if (result == STATUS_OK && (responseLength != 1 || response[0] != pps[0])) {
+		result = STATUS_ERROR;
+	}
+	if (result != STATUS_OK) {
+		return result;
+	}
+	if (PCD_SetBitRate_h(tcl->dev, dri, dsi) != ESP_OK) {
+		return STATUS_ERROR;
+	}
+	PCD_GetBitRate_h(tcl->dev, &tcl->txBitRate, &tcl->rxBitRate);
+	ESP_LOGD(TAG, "PPS: DRI %d, DSI %d", tcl->txBitRate, tcl->rxBitRate);
+	return STATUS_OK;
+} // End TCL_NegotiateBitRate()
+
+/**
+ * Sends one block and returns the answer the protocol continues with, recovering on the way:
+ * 		- S(WTX) is answered with the same WTXM, the answer after it is waited for WTXM * FWT (rule 3),
+ * 		- a timeout or broken block is answered with R(NAK), or with the R(ACK) again while the PICC chains (rule 4),
+ * 		- an R(ACK) for the previous block number means the PICC missed our I-block: it is sent again (rule 6).
+ * An I-block, or an R(ACK) with the current block number, toggles the block number (rule B).
+ *
+ * @return STATUS_OK with the answer (an I-block, R(ACK) or S(DESELECT)) in *rxPcb/back, STATUS_??? otherwise.
+ */
+static enum StatusCode TCL_Transceive(MFRC522_TCL *tcl,	const uint8_t pcb,		///< The block to send, without the CID bit
+														const uint8_t *info,	///< Its INF field, NULL if none
+														const uint16_t infoLength,
+														uint8_t *rxPcb,			///< Out: the PCB of the answer
+														uint8_t *back,			///< Out: the INF field of the answer, 2 bytes room for CRC_A
+														uint16_t *backLength	///< In: size of back. Out: length of the INF field.
+									) {
+	const uint8_t cidBit = tcl->useCid ? TCL_PCB_CID : 0x00;
+	const uint8_t headerLength = tcl->useCid ? 2 : 1;
+	const uint16_t room = *backLength;
+	uint8_t txHeader[2] = { pcb | cidBit, tcl->cid };
+	uint8_t rxHeader[2];
+	const uint8_t *txInfo = info;
+	uint16_t txInfoLength = infoLength;
+	uint8_t wtxm = 0;				// != 0: the block sent is the S(WTX) response, the timer is extended
+	uint8_t retries = 0;
+	tcl->blocksSent = true;
+
+	while (1) {
+		*backLength = room;
+		enum StatusCode result = PCD_TransceiveBlock_h(tcl->dev, txHeader, headerLength, txInfo, txInfoLength, rxHeader, back, backLength);
+		if (wtxm) {
+			wtxm = 0;
+			TCL_SetTimeoutUs(tcl, tcl->fwtUs + TCL_DELTA_FWT_US);
+		}
+		if (result == STATUS_NO_ROOM) {
+			return result;
+		}
+		if (result == STATUS_OK && (rxHeader[0] & TCL_PCB_CID) != cidBit) {
+			result = STATUS_ERROR;
+		}
+		if (result == STATUS_OK && tcl->useCid && rxHeader[1] != tcl->cid) {
+			result = STATUS_ERROR;
+		}
+
+		if (result == STATUS_OK) {
+			const uint8_t rx = rxHeader[0] & ~TCL_PCB_CID;
+			if (rx == TCL_PCB_S_WTX && *backLength == 1 && (back[0] & 0x3F) != 0) {
+				wtxm = back[0] & 0x3F;
+				uint64_t timeoutUs = (uint64_t)tcl->fwtUs * wtxm;
+				if (timeoutUs > TCL_FWT_MAX_US) {
+					timeoutUs = TCL_FWT_MAX_US;
+				}
+				ESP_LOGD(TAG, "WTX %d: waiting %lu us", wtxm, (unsigned long)timeoutUs);
+				TCL_SetTimeoutUs(tcl, timeoutUs + TCL_DELTA_FWT_US);
+				txHeader[0] = TCL_PCB_S_WTX | cidBit;
+				txInfo = &wtxm;
+				txInfoLength = 1;
+				continue;
+			}
+			if (TCL_IS_I_BLOCK(rx) && (rx & 0x01) == tcl->blockNumber) {
+				tcl->blockNumber ^= 1;
+				*rxPcb = rx;
+				return STATUS_OK;
+			}
+			if (TCL_IS_R_BLOCK(rx) && !(rx & TCL_PCB_CHAINING)) {
+				if ((rx & 0x01) == tcl->blockNumber) {
+					tcl->blockNumber ^= 1;
+					*rxPcb = rx;
+					return STATUS_OK;
+				}
+				if (TCL_IS_I_BLOCK(pcb) && retries < MFRC_TCL_MAX_RETRIES) {
+					retries++;
+					txHeader[0] = pcb | cidBit;
+					txInfo = info;
+					txInfoLength = infoLength;
+					continue;
+				}
+			}
+			if (rx == TCL_PCB_S_DESELECT && pcb == TCL_PCB_S_DESELECT) {
+				*rxPcb = rx;
+				return STATUS_OK;
+			}
+			result = STATUS_ERROR;		// a block that does not fit the state of the protocol
+		}
+
+		if (retries >= MFRC_TCL_MAX_RETRIES) {
+			return result;
+		}
+		retries++;
+		ESP_LOGD(TAG, "block %02x: %s, retry %d", pcb, GetStatusCodeName(result), retries);
+		if (pcb == (TCL_PCB_R_ACK | tcl->blockNumber) || pcb == TCL_PCB_S_DESELECT) {
+			txHeader[0] = pcb | cidBit;
+		}
+		else {
+			txHeader[0] = TCL_PCB_R_NAK | tcl->blockNumber | cidBit;
+		}
+		txInfo = NULL;
+		txInfoLength = 0;
+	}
+} // End TCL_Transceive()
+
+/**
+ * Sends a command APDU to the active PICC and receives its response APDU.
+ * The command is split into I-blocks of the frame size of the PICC (FSC), the response is received block by block
+ * into its place in response, acknowledging each chained block with R(ACK).
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode TCL_Exchange(MFRC522_TCL *tcl,	const uint8_t *command,		///< The command APDU
+												const uint16_t commandLength,
+												uint8_t *response,			///< Out: the response APDU, SW1 SW2 included
+												uint16_t *responseLength	///< In: size of response, 2 bytes more than the longest response. Out: length of the response.
+							) {
+	if (tcl->dev == NULL) {
+		return STATUS_INVALID;
+	}
+	const uint8_t headerLength = tcl->useCid ? 2 : 1;
+	uint16_t maxInfo = tcl->fsc - headerLength - 2;
+	if (tcl->txBitRate > MFRC_STREAM_MAX_BIT_RATE && maxInfo > 64 - headerLength) {
+		maxInfo = 64 - headerLength;		// too fast to stream: the block has to fit the FIFO (CRC_A comes from the MFRC522)
+	}
+	const uint16_t size = *responseLength;
+	uint8_t rxPcb;
+	uint16_t received;
+	enum StatusCode result;
+
+	// The command, chained if it does not fit one frame. Every chained I-block is acknowledged with R(ACK).
+	uint16_t sent = 0;
+	bool chaining;
+	do {
+		const uint16_t chunk = commandLength - sent > maxInfo ? maxInfo : commandLength - sent;
+		chaining = sent + chunk < commandLength;
+		received = size;
+		result = TCL_Transceive(tcl, TCL_PCB_I_BLOCK | tcl->blockNumber | (chaining ? TCL_PCB_CHAINING : 0x00),
+								&command[sent], chunk, &rxPcb, response, &received);
+		if (result != STATUS_OK) {
+			return result;
+		}
+		if (chaining != TCL_IS_R_BLOCK(rxPcb)) {
+			return STATUS_ERROR;
+		}
+		sent += chunk;
+	} while (chaining);
+
+	// The response, chained if it does not fit one frame: acknowledge and receive behind what is there.
+	uint16_t length = 0;
+	while (1) {
+		if (!TCL_IS_I_BLOCK(rxPcb)) {
+			return STATUS_ERROR;
+		}
+		length += received;
+		if (!(rxPcb & TCL_PCB_CHAINING)) {
+			break;
+		}
+		received = size - length;
+		result = TCL_Transceive(tcl, TCL_PCB_R_ACK | tcl->blockNumber, NULL, 0, &rxPcb, &response[length], &received);
+		if (result != STATUS_OK) {
+			return result;
+		}
+	}
+	*responseLength = length;
+	return STATUS_OK;
+} // End TCL_Exchange()
+
+/**
+ * Sends S(DESELECT): the PICC goes to HALT and the CID is free again. Restores the PCD_TIMEOUT_ISO14443_4 timeout
+ * and 106 kbit/s.
+ *
+ * @return STATUS_OK on success, STATUS_??? otherwise.
+ */
+enum StatusCode TCL_Deselect(MFRC522_TCL *tcl) {
+	if (tcl->dev == NULL) {
+		return STATUS_INVALID;
+	}
+	uint8_t rxPcb;
+	uint8_t back[2];
+	uint16_t backLength = sizeof(back);
+	enum StatusCode result = TCL_Transceive(tcl, TCL_PCB_S_DESELECT, NULL, 0, &rxPcb, back, &backLength);
+	TCL_SetTimeoutUs(tcl, tcl->savedTimeoutUs);
+	if (PCD_SetBitRate_h(tcl->dev, PCD_BITRATE_106, PCD_BITRATE_106) != ESP_OK && result == STATUS_OK) {
+		result = STATUS_ERROR;
+	}
+	tcl->dev = NULL;
+	return result;
+} // End TCL_Deselect()
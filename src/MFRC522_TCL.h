@@ -0,0 +1,89 @@
+/**
+ * MFRC522_TCL.h - ISO/IEC 14443-4 (T=CL) block transport: RATS, I-block chaining, WTX, DESELECT.
+ *
+ * PICCs whose SAK has bit 5 set (PICC_GetType() == PICC_TYPE_ISO_14443_4, e.g. smartcards, DESFire, payment and
+ * ID cards) speak the half-duplex block protocol of ISO/IEC 14443-4 after RATS. TCL_Activate() sends RATS to the
+ * selected PICC and takes the frame size (FSCI), frame waiting time (FWI) and start-up guard time (SFGI) from its
+ * ATS. TCL_NegotiateBitRate() optionally moves the link to the highest bit rate the PICC (TA(1)) and the reader
+ * support, up to 848 kbit/s, with PPS. TCL_Exchange() then sends a command APDU and returns the response APDU:
+ * 		- I-blocks use the frame size the PICC announced, up to 256 bytes, and are chained when the APDU is longer.
+ * 		  Frames are streamed through the FIFO (PCD_TransceiveBlock_h()), so the 64 byte FIFO is no limit.
+ * 		- the command is sent from, and the response assembled in, the caller's buffers without copies.
+ * 		- S(WTX) requests of the PICC are answered, the MFRC522 timer is stretched for the extended waiting time.
+ * 		- lost and broken blocks are recovered with R(NAK)/R(ACK) (the error handling rules of ISO/IEC 14443-4).
+ *
+ * 		MFRC522_TCL tcl;
+ * 		if (PICC_Select(&uid, 0) == STATUS_OK && PICC_GetType(uid.sak) == PICC_TYPE_ISO_14443_4
+ * 				&& TCL_Activate(&tcl, 0) == STATUS_OK) {
+ * 			TCL_NegotiateBitRate(&tcl);						// optional, stays at 106 kbit/s if it fails
+ * 			static const uint8_t selectApp[] = {0x00, 0xA4, 0x04, 0x00, 0x07, 0xD2, 0x76, 0x00, 0x00, 0x85, 0x01, 0x01, 0x00};
+ * 			uint8_t response[258];							// the longest expected response + 2
+ * 			uint16_t responseLength = sizeof(response);
+ * 			if (TCL_Exchange(&tcl, selectApp, sizeof(selectApp), response, &responseLength) == STATUS_OK) ...
+ * 			TCL_Deselect(&tcl);
+ * 		}
+ *
+ * While a PICC is active the PCD_TIMEOUT_ISO14443_4 timeout of the reader is its frame waiting time; TCL_Deselect()
+ * restores the previous one and goes back to 106 kbit/s. Other commands keep their own timeouts meanwhile.
+ */
+#ifndef MFRC522_TCL_h
+#define MFRC522_TCL_h
+
+#include "MFRC522_I2C.h"
+
+// Frame size the PCD announces in RATS, FSD = 16, 24, 32, 40, 48, 64, 96, 128, 256 bytes for FSDI 0..8.
+// Longer frames mean fewer blocks per APDU; PCD_TransceiveBlock_h() streams them, so the maximum costs nothing.
+#ifndef MFRC_TCL_FSDI
+#define MFRC_TCL_FSDI 8
+#endif
+
+// How often a lost or broken block is recovered (R(NAK), R(ACK) or retransmission) before TCL_Exchange() gives up.
+#ifndef MFRC_TCL_MAX_RETRIES
+#define MFRC_TCL_MAX_RETRIES 2
+#endif
+
+#define TCL_ATS_SIZE	32		// longest ATS kept, CRC_A excluded
+
+// An active ISO/IEC 14443-4 PICC. Set up by TCL_Activate(); the fields are read-only for the caller.
+typedef struct {
+    MFRC522_Handle *dev;
+    uint8_t		ats[TCL_ATS_SIZE];	// the ATS, ats[0] is its length TL
+    uint8_t		atsLength;
+    uint16_t	fsc;			// longest frame the PICC accepts, PCB and CRC_A included
+    uint16_t	fsd;			// longest frame the PICC may send, from MFRC_TCL_FSDI
+    uint8_t		fwi;			// frame waiting time integer, FWT = 302us * 2^fwi
+    uint8_t		sfgi;			// start-up frame guard time integer
+    uint8_t		ta1;			// bit rates supported by the PICC (TA(1)), for PPS. 0x00: 106 kbit/s only.
+    uint32_t	fwtUs;
+    uint32_t	sfgtUs;
+    uint8_t		cid;			// card identifier from RATS
+    bool		useCid;			// the PICC supports CID and cid != 0: blocks carry the CID
+    bool		nadSupported;
+    uint8_t		blockNumber;	// the PCD block number, toggled per ISO/IEC 14443-4 rule B
+    bool		blocksSent;		// PPS is only allowed before the first block
+    enum PCD_BitRate txBitRate;	// PCD->PICC, from PPS (DRI)
+    enum PCD_BitRate rxBitRate;	// PICC->PCD, from PPS (DSI)
+    uint32_t	savedTimeoutUs;	// the PCD_TIMEOUT_ISO14443_4 timeout before TCL_Activate()
+} MFRC522_TCL;
+
+// sends RATS to the selected (ACTIVE) PICC, parses the ATS and sets PCD_TIMEOUT_ISO14443_4 to its frame waiting time.
+// cid (0..14) addresses the PICC when several are active, 0 if there is only one. Waits the SFGT before it returns.
+enum StatusCode TCL_Activate(MFRC522_TCL *tcl, uint8_t cid);
+enum StatusCode TCL_Activate_h(MFRC522_Handle *dev, MFRC522_TCL *tcl, uint8_t cid);
+
+// sends PPS with the highest bit rates both the PICC (TA(1) of the ATS) and the reader (PCD_SetMaxBitRate_h())
+// support, then switches the MFRC522 to them. call it right after TCL_Activate(), before the first TCL_Exchange().
+// STATUS_OK without PPS if there is nothing faster than 106 kbit/s. on failure the link stays at 106 kbit/s.
+enum StatusCode TCL_NegotiateBitRate(MFRC522_TCL *tcl);
+
+// sends the command APDU and receives the response APDU (SW1 SW2 included), chaining I-blocks both ways.
+// *responseLength is in: the size of response, out: the response length. response needs 2 bytes more than the
+// longest expected response (the CRC_A of the last block lands behind it). STATUS_NO_ROOM if the response does
+// not fit; the PICC is then still in the middle of its answer, deselect it.
+enum StatusCode TCL_Exchange(MFRC522_TCL *tcl, const uint8_t *command, uint16_t commandLength, uint8_t *response, uint16_t *responseLength);
+
+// sends S(DESELECT), the PICC goes to HALT. Restores the timeout of before TCL_Activate() and 106 kbit/s,
+// even on failure.
+enum StatusCode TCL_Deselect(MFRC522_TCL *tcl);
+
+#endif // MFRC522_TCL_h